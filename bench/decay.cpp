@@ -0,0 +1,325 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Starting, stopping and expiring item decays, the std::map keyed by timestamp that Decay
+// used to keep against the timing wheel it keeps now. The clock is simulated and the
+// dispatcher event is only counted, so the numbers are the bookkeeping alone.
+//
+// Two ways of starting them:
+// - spread: durations anywhere between 1 second and 10 minutes, the clock moves 1 ms
+//   every 10 starts, like items decaying during play
+// - burst: ten fixed durations all started within the same millisecond, like the decays
+//   started while the map loads
+//
+// usage: bench_decay [items = 1000000]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int32_t DECAY_BUCKET_INTERVAL = 100;
+constexpr size_t DECAY_BUCKET_COUNT = 1024;
+
+struct Item
+{
+    int64_t timestamp = 0;
+    uint32_t decayIndex = 0;
+    bool decaying = false;
+};
+
+// before: items grouped by their exact timestamp, the dispatcher event re-armed for every new earliest one
+class MapDecay
+{
+public:
+    void startDecay(Item* item, int64_t now, int32_t duration) {
+        const int64_t timestamp = now + duration;
+        if (decayMap.empty() || timestamp < decayMap.begin()->first) {
+            ++events;
+        }
+
+        item->decaying = true;
+        item->timestamp = timestamp;
+        decayMap[timestamp].push_back(item);
+    }
+
+    void stopDecay(Item* item) {
+        const auto it = decayMap.find(item->timestamp);
+        if (it == decayMap.end()) {
+            return;
+        }
+
+        std::vector<Item*>& decayItems = it->second;
+        if (decayItems.size() == 1) {
+            if (item == decayItems.front()) {
+                item->decaying = false;
+                decayMap.erase(it);
+            }
+            return;
+        }
+
+        for (size_t i = 0, end = decayItems.size(); i < end; ++i) {
+            if (item == decayItems[i]) {
+                item->decaying = false;
+                decayItems[i] = decayItems.back();
+                decayItems.pop_back();
+                return;
+            }
+        }
+    }
+
+    // returns when it wants to run next, -1 once nothing is left
+    int64_t checkDecay(int64_t now, std::vector<Item*>& expired) {
+        auto it = decayMap.begin();
+        while (it != decayMap.end() && it->first <= now) {
+            expired.insert(expired.end(), it->second.begin(), it->second.end());
+            it = decayMap.erase(it);
+        }
+
+        if (it == decayMap.end()) {
+            return -1;
+        }
+        ++events;
+        return it->first;
+    }
+
+    size_t events = 0;
+
+private:
+    std::map<int64_t, std::vector<Item*>> decayMap;
+};
+
+// after: Decay's hashed timing wheel
+class WheelDecay
+{
+public:
+    void startDecay(Item* item, int64_t now, int32_t duration) {
+        if (!running) {
+            lastTick = now / DECAY_BUCKET_INTERVAL;
+            running = true;
+            ++events;
+        }
+
+        const int64_t timestamp = now + duration;
+        item->decaying = true;
+        item->timestamp = timestamp;
+
+        const int64_t tick = getDecayTick(timestamp);
+        std::vector<DecayEntry>& bucket = buckets[tick % DECAY_BUCKET_COUNT];
+        item->decayIndex = static_cast<uint32_t>(bucket.size());
+        bucket.push_back({item, tick});
+        ++decayingItems;
+    }
+
+    void stopDecay(Item* item) {
+        std::vector<DecayEntry>& bucket = buckets[getDecayTick(item->timestamp) % DECAY_BUCKET_COUNT];
+        const uint32_t index = item->decayIndex;
+        if (index >= bucket.size() || bucket[index].item != item) {
+            return;
+        }
+
+        item->decaying = false;
+        removeEntry(bucket, index);
+    }
+
+    int64_t checkDecay(int64_t now, std::vector<Item*>& expired) {
+        const int64_t currentTick = now / DECAY_BUCKET_INTERVAL;
+        const int64_t firstTick = std::max<int64_t>(lastTick + 1, currentTick - static_cast<int64_t>(DECAY_BUCKET_COUNT) + 1);
+        for (int64_t tick = firstTick; tick <= currentTick; ++tick) {
+            std::vector<DecayEntry>& bucket = buckets[tick % DECAY_BUCKET_COUNT];
+            for (uint32_t index = 0; index < bucket.size();) {
+                if (bucket[index].tick > currentTick) {
+                    ++index;
+                    continue;
+                }
+
+                expired.push_back(bucket[index].item);
+                removeEntry(bucket, index);
+            }
+        }
+        lastTick = std::max<int64_t>(lastTick, currentTick);
+
+        if (decayingItems == 0) {
+            running = false;
+            return -1;
+        }
+        ++events;
+        return now + DECAY_BUCKET_INTERVAL;
+    }
+
+    size_t events = 0;
+
+private:
+    struct DecayEntry
+    {
+        Item* item;
+        int64_t tick;
+    };
+
+    static int64_t getDecayTick(int64_t timestamp) {
+        return (timestamp + DECAY_BUCKET_INTERVAL - 1) / DECAY_BUCKET_INTERVAL;
+    }
+
+    void removeEntry(std::vector<DecayEntry>& bucket, uint32_t index) {
+        if (index + 1 != bucket.size()) {
+            bucket[index] = bucket.back();
+            bucket[index].item->decayIndex = index;
+        }
+        bucket.pop_back();
+        --decayingItems;
+    }
+
+    std::array<std::vector<DecayEntry>, DECAY_BUCKET_COUNT> buckets;
+    int64_t lastTick = 0;
+    size_t decayingItems = 0;
+    bool running = false;
+};
+
+struct Workload
+{
+    std::vector<int32_t> durations;
+    // how many starts happen within one millisecond
+    size_t startsPerMs;
+};
+
+Workload makeWorkload(bool burst, size_t count)
+{
+    std::mt19937 rng(1);
+    Workload workload;
+    workload.durations.resize(count);
+    if (burst) {
+        static constexpr std::array<int32_t, 10> durations = {10000, 30000, 60000, 120000, 180000, 240000, 300000, 420000, 480000, 600000};
+        std::uniform_int_distribution<size_t> pick(0, durations.size() - 1);
+        for (int32_t& duration : workload.durations) {
+            duration = durations[pick(rng)];
+        }
+        workload.startsPerMs = count;
+    } else {
+        std::uniform_int_distribution<int32_t> pick(1000, 600000);
+        for (int32_t& duration : workload.durations) {
+            duration = pick(rng);
+        }
+        workload.startsPerMs = 10;
+    }
+    return workload;
+}
+
+struct Result
+{
+    double start = 0;
+    double stop = 0;
+    double expire = 0;
+    size_t events = 0;
+};
+
+double since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Decay>
+Result run(const Workload& workload)
+{
+    const size_t count = workload.durations.size();
+    std::vector<Item> items(count);
+    std::vector<size_t> stopOrder(count);
+    for (size_t i = 0; i < count; ++i) {
+        stopOrder[i] = i;
+    }
+    std::shuffle(stopOrder.begin(), stopOrder.end(), std::mt19937(2));
+
+    Result result;
+    auto startAll = [&](Decay& decay) {
+        int64_t now = 1000000;
+        for (size_t i = 0; i < count; ++i) {
+            decay.startDecay(&items[i], now, workload.durations[i]);
+            if ((i + 1) % workload.startsPerMs == 0) {
+                ++now;
+            }
+        }
+        return now;
+    };
+
+    {
+        Decay decay;
+        auto start = std::chrono::steady_clock::now();
+        startAll(decay);
+        result.start = since(start);
+
+        start = std::chrono::steady_clock::now();
+        for (size_t i : stopOrder) {
+            decay.stopDecay(&items[i]);
+        }
+        result.stop = since(start);
+    }
+
+    {
+        Decay decay;
+        int64_t now = startAll(decay);
+        std::vector<Item*> expired;
+        expired.reserve(count);
+
+        const auto start = std::chrono::steady_clock::now();
+        // the dispatcher runs the check when it asked for it, or at the next beat of 50 ms
+        while ((now = decay.checkDecay(now, expired)) != -1) {
+            now = std::max<int64_t>(now, (now / 50 + 1) * 50);
+        }
+        result.expire = since(start);
+        result.events = decay.events;
+        if (expired.size() != count) {
+            std::cout << "only " << expired.size() << " of " << count << " items expired" << std::endl;
+            std::exit(EXIT_FAILURE);
+        }
+    }
+    return result;
+}
+
+void print(const char* name, const Result& result, size_t count)
+{
+    std::cout << std::left << std::setw(18) << name << std::right << std::fixed << std::setprecision(1)
+        << std::setw(12) << result.start << std::setw(12) << result.stop << std::setw(12) << result.expire
+        << std::setw(12) << (result.stop * 1e6 / count) << std::setw(10) << result.events << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t count = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000);
+
+    for (const bool burst : {false, true}) {
+        const Workload workload = makeWorkload(burst, count);
+        std::cout << count << " items, " << (burst ? "burst" : "spread") << std::endl;
+        std::cout << std::left << std::setw(18) << "scheduler" << std::right
+            << std::setw(12) << "start ms" << std::setw(12) << "stop ms" << std::setw(12) << "expire ms"
+            << std::setw(12) << "ns/stop" << std::setw(10) << "events" << std::endl;
+        print("timestamp map", run<MapDecay>(workload), count);
+        print("timing wheel", run<WheelDecay>(workload), count);
+        std::cout << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
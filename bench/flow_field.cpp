@@ -0,0 +1,636 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// A train of melee monsters of one type chasing a player across a map with walls, every
+// monster looking for its own path with Map::getPathMatchingCond against the flow field
+// Map::getFlowFieldPath shares between them. Only the time spent finding paths is counted.
+//
+// Every step of the player makes each chaser look for a new path, the way
+// Creature::onCreatureMove updates the follow path, and so does a chaser whose next
+// step is taken or that ran out of steps. The player walks ahead with some momentum
+// and a bit faster than the monsters, the clock is simulated.
+//
+// usage: bench_flow_field [monsters = 40] [seconds = 60]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int32_t MAP_SIZE = 256;
+constexpr int32_t TICK_MS = 50;
+constexpr int32_t PLAYER_STEP_MS = 200;
+constexpr int32_t MONSTER_STEP_MS = 250;
+
+constexpr int32_t MAP_NORMALWALKCOST = 10;
+constexpr int32_t MAP_DIAGONALWALKCOST = 25;
+
+// pathfindingMaxNodes, pathfindingMaxClosedNodes and the maxSearchDist of a follow path
+constexpr int32_t PATHFINDING_MAX_NODES = 4096;
+constexpr int32_t PATHFINDING_MAX_CLOSED_NODES = 100;
+constexpr int32_t MAX_SEARCH_DIST = 12;
+
+constexpr int32_t FLOW_FIELD_RADIUS = 12;
+constexpr int32_t FLOW_FIELD_WIDTH = FLOW_FIELD_RADIUS * 2 + 1;
+
+// the Direction values the server uses, diagonals from 4 on
+constexpr int32_t DIRECTION_DIAGONAL_MASK = 4;
+constexpr int32_t directionOffsets[8][2] = {
+    {0, -1}, {1, 0}, {0, 1}, {-1, 0}, {-1, 1}, {1, 1}, {-1, -1}, {1, -1}
+};
+
+int32_t getDirection(int32_t dx, int32_t dy)
+{
+    for (int32_t dir = 0; dir < 8; ++dir) {
+        if (directionOffsets[dir][0] == dx && directionOffsets[dir][1] == dy) {
+            return dir;
+        }
+    }
+    return -1;
+}
+
+struct Creature
+{
+    int32_t x;
+    int32_t y;
+    std::deque<int32_t> path;
+    int32_t nextStep = 0;
+};
+
+class World
+{
+public:
+    explicit World(uint32_t seed) : walls(MAP_SIZE * MAP_SIZE, false), occupied(MAP_SIZE * MAP_SIZE, false) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int32_t> coordinate(0, MAP_SIZE - 1);
+        std::uniform_int_distribution<int32_t> length(4, 14);
+        std::uniform_int_distribution<int32_t> percent(0, 99);
+
+        for (int32_t i = 0; i < MAP_SIZE; ++i) {
+            walls[i] = walls[(MAP_SIZE - 1) * MAP_SIZE + i] = true;
+            walls[i * MAP_SIZE] = walls[i * MAP_SIZE + MAP_SIZE - 1] = true;
+        }
+
+        // scattered obstacles and wall segments monsters have to walk around
+        for (int32_t i = 0; i < MAP_SIZE * MAP_SIZE / 12; ++i) {
+            walls[coordinate(rng) * MAP_SIZE + coordinate(rng)] = true;
+        }
+        for (int32_t i = 0; i < MAP_SIZE * MAP_SIZE / 160; ++i) {
+            const int32_t x = coordinate(rng), y = coordinate(rng), wallLength = length(rng);
+            const bool horizontal = percent(rng) < 50;
+            for (int32_t j = 0; j < wallLength; ++j) {
+                const int32_t wallX = horizontal ? x + j : x, wallY = horizontal ? y : y + j;
+                if (wallX < MAP_SIZE && wallY < MAP_SIZE) {
+                    walls[wallY * MAP_SIZE + wallX] = true;
+                }
+            }
+        }
+    }
+
+    bool isWall(int32_t x, int32_t y) const {
+        return x < 0 || y < 0 || x >= MAP_SIZE || y >= MAP_SIZE || walls[y * MAP_SIZE + x];
+    }
+
+    bool isOccupied(int32_t x, int32_t y) const {
+        return occupied[y * MAP_SIZE + x];
+    }
+
+    // Map::canWalkTo for a monster, creatures block
+    bool canWalkTo(int32_t x, int32_t y) const {
+        return !isWall(x, y) && !isOccupied(x, y);
+    }
+
+    void place(Creature& creature, int32_t x, int32_t y) {
+        occupied[creature.y * MAP_SIZE + creature.x] = false;
+        occupied[y * MAP_SIZE + x] = true;
+        creature.x = x;
+        creature.y = y;
+    }
+
+    void add(const Creature& creature) {
+        occupied[creature.y * MAP_SIZE + creature.x] = true;
+    }
+
+private:
+    std::vector<bool> walls;
+    std::vector<bool> occupied;
+};
+
+// before: Map::getPathMatchingCond with the AStarNodes node pool and the follow path parameters
+class AStar
+{
+public:
+    AStar() : grid(MAP_SIZE * MAP_SIZE, GridCell{0, 0}), nodes(PATHFINDING_MAX_NODES), heapPositions(PATHFINDING_MAX_NODES) {
+        heap.reserve(PATHFINDING_MAX_NODES);
+    }
+
+    bool getPath(const World& world, const Creature& creature, int32_t targetX, int32_t targetY, std::deque<int32_t>& path) {
+        static constexpr int32_t dirNeighbors[8][5][2] = {
+            {{-1, 0}, {0, 1}, {1, 0}, {1, 1}, {-1, 1}},
+            {{-1, 0}, {0, 1}, {0, -1}, {-1, -1}, {-1, 1}},
+            {{-1, 0}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}},
+            {{0, 1}, {1, 0}, {0, -1}, {1, -1}, {1, 1}},
+            {{1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}},
+            {{-1, 0}, {0, -1}, {-1, -1}, {1, -1}, {-1, 1}},
+            {{0, 1}, {1, 0}, {1, -1}, {1, 1}, {-1, 1}},
+            {{-1, 0}, {0, 1}, {-1, -1}, {1, 1}, {-1, 1}}
+        };
+        static constexpr int32_t allNeighbors[8][2] = {
+            {-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
+        };
+
+        ++generation;
+        heap.clear();
+        nodeCount = 0;
+        closedNodes = 0;
+        createNode(-1, creature.x, creature.y, 0, 0);
+
+        const int32_t startX = creature.x, startY = creature.y;
+        const int32_t sX = std::abs(targetX - startX), sY = std::abs(targetY - startY);
+        int32_t found = -1;
+        do {
+            if (heap.empty()) {
+                return false;
+            }
+
+            const int32_t n = popBest();
+            const int32_t x = nodes[n].x, y = nodes[n].y;
+            if (std::max(std::abs(targetX - x), std::abs(targetY - y)) == 1) {
+                found = n;
+                break;
+            }
+
+            const int32_t (*neighbors)[2];
+            int32_t dirCount;
+            if (nodes[n].parent != -1) {
+                const int32_t offsetX = nodes[nodes[n].parent].x - x, offsetY = nodes[nodes[n].parent].y - y;
+                int32_t dir;
+                if (offsetY == 0) {
+                    dir = (offsetX == -1 ? 3 : 1);
+                } else if (offsetX == 0) {
+                    dir = (offsetY == -1 ? 0 : 2);
+                } else if (offsetY == -1) {
+                    dir = (offsetX == -1 ? 6 : 7);
+                } else {
+                    dir = (offsetX == -1 ? 4 : 5);
+                }
+                neighbors = dirNeighbors[dir];
+                dirCount = 5;
+            } else {
+                neighbors = allNeighbors;
+                dirCount = 8;
+            }
+
+            const int32_t f = nodes[n].f;
+            for (int32_t i = 0; i < dirCount; ++i) {
+                const int32_t nx = x + neighbors[i][0], ny = y + neighbors[i][1];
+                if (std::abs(nx - startX) > MAX_SEARCH_DIST || std::abs(ny - startY) > MAX_SEARCH_DIST) {
+                    continue;
+                }
+
+                const GridCell& cell = grid[ny * MAP_SIZE + nx];
+                const int32_t neighborNode = (cell.generation == generation ? cell.node : -1);
+                if (neighborNode == -1 && !world.canWalkTo(nx, ny)) {
+                    continue;
+                }
+
+                const int32_t newf = f + (std::abs(x - nx) + std::abs(y - ny) - 1) * MAP_DIAGONALWALKCOST + MAP_NORMALWALKCOST;
+                if (neighborNode != -1) {
+                    if (nodes[neighborNode].f <= newf) {
+                        continue;
+                    }
+                    nodes[neighborNode].f = newf;
+                    nodes[neighborNode].parent = n;
+                    if (heapPositions[neighborNode] == -1) {
+                        --closedNodes;
+                        push(neighborNode);
+                    } else {
+                        siftUp(heapPositions[neighborNode]);
+                    }
+                } else {
+                    const int32_t dX = std::abs(targetX - nx), dY = std::abs(targetY - ny);
+                    if (!createNode(n, nx, ny, newf, ((dX - sX) << 3) + ((dY - sY) << 3) + (std::max(dX, dY) << 3))) {
+                        return false;
+                    }
+                }
+            }
+            ++closedNodes;
+        } while (closedNodes < PATHFINDING_MAX_CLOSED_NODES);
+
+        if (found == -1) {
+            return false;
+        }
+
+        path.clear();
+        for (int32_t n = found; nodes[n].parent != -1; n = nodes[n].parent) {
+            const Node& parent = nodes[nodes[n].parent];
+            path.push_front(getDirection(nodes[n].x - parent.x, nodes[n].y - parent.y));
+        }
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        int32_t parent;
+        int32_t x;
+        int32_t y;
+        int32_t f;
+        int32_t g;
+    };
+
+    struct GridCell
+    {
+        uint32_t generation;
+        int32_t node;
+    };
+
+    bool createNode(int32_t parent, int32_t x, int32_t y, int32_t f, int32_t heuristic) {
+        if (nodeCount >= PATHFINDING_MAX_NODES) {
+            return false;
+        }
+
+        const int32_t node = nodeCount++;
+        nodes[node] = Node{parent, x, y, f, heuristic};
+        grid[y * MAP_SIZE + x] = GridCell{generation, node};
+        push(node);
+        return true;
+    }
+
+    bool isBefore(int32_t lhs, int32_t rhs) const {
+        const int32_t lhsCost = nodes[lhs].f + nodes[lhs].g, rhsCost = nodes[rhs].f + nodes[rhs].g;
+        return lhsCost < rhsCost || (lhsCost == rhsCost && lhs < rhs);
+    }
+
+    void push(int32_t node) {
+        heap.push_back(node);
+        siftUp(static_cast<int32_t>(heap.size()) - 1);
+    }
+
+    int32_t popBest() {
+        const int32_t best = heap.front();
+        heapPositions[best] = -1;
+        const int32_t last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap.front() = last;
+            heapPositions[last] = 0;
+            siftDown(0);
+        }
+        return best;
+    }
+
+    void siftUp(int32_t position) {
+        const int32_t node = heap[position];
+        while (position > 0) {
+            const int32_t parent = (position - 1) / 2;
+            if (!isBefore(node, heap[parent])) {
+                break;
+            }
+            heap[position] = heap[parent];
+            heapPositions[heap[position]] = position;
+            position = parent;
+        }
+        heap[position] = node;
+        heapPositions[node] = position;
+    }
+
+    void siftDown(int32_t position) {
+        const int32_t size = static_cast<int32_t>(heap.size());
+        const int32_t node = heap[position];
+        while (true) {
+            int32_t child = position * 2 + 1;
+            if (child >= size) {
+                break;
+            }
+            if (child + 1 < size && isBefore(heap[child + 1], heap[child])) {
+                ++child;
+            }
+            if (!isBefore(heap[child], node)) {
+                break;
+            }
+            heap[position] = heap[child];
+            heapPositions[heap[position]] = position;
+            position = child;
+        }
+        heap[position] = node;
+        heapPositions[node] = position;
+    }
+
+    std::vector<GridCell> grid;
+    std::vector<Node> nodes;
+    std::vector<int32_t> heap;
+    std::vector<int32_t> heapPositions;
+    uint32_t generation = 0;
+    int32_t nodeCount = 0;
+    int32_t closedNodes = 0;
+};
+
+// after: one Dijkstra field per target shared by the chasers, A* for the ones it doesn't cover
+class FlowField
+{
+public:
+    bool getPath(const World& world, const Creature& creature, int32_t targetX, int32_t targetY, std::deque<int32_t>& path) {
+        int32_t x = creature.x - targetX + FLOW_FIELD_RADIUS;
+        int32_t y = creature.y - targetY + FLOW_FIELD_RADIUS;
+        if (x < 0 || x >= FLOW_FIELD_WIDTH || y < 0 || y >= FLOW_FIELD_WIDTH) {
+            return aStar.getPath(world, creature, targetX, targetY, path);
+        }
+
+        if (!built || targetX != fieldX || targetY != fieldY) {
+            build(world, targetX, targetY);
+        }
+
+        int32_t index = y * FLOW_FIELD_WIDTH + x;
+        if (costs[index] < 0) {
+            return aStar.getPath(world, creature, targetX, targetY, path);
+        }
+
+        path.clear();
+        if (costs[index] == 0) {
+            return true;
+        }
+
+        // the first step is checked against this monster, the field ignores the creatures in the way
+        int32_t dir = steps[index];
+        if (!world.canWalkTo(creature.x + directionOffsets[dir][0], creature.y + directionOffsets[dir][1])) {
+            dir = -1;
+            int32_t bestCost = std::numeric_limits<int32_t>::max();
+            for (int32_t nextDir = 0; nextDir < 8; ++nextDir) {
+                const int32_t nextX = x + directionOffsets[nextDir][0], nextY = y + directionOffsets[nextDir][1];
+                if (nextX < 0 || nextX >= FLOW_FIELD_WIDTH || nextY < 0 || nextY >= FLOW_FIELD_WIDTH) {
+                    continue;
+                }
+
+                const int32_t nextCost = costs[nextY * FLOW_FIELD_WIDTH + nextX];
+                if (nextCost < 0 || !world.canWalkTo(creature.x + directionOffsets[nextDir][0], creature.y + directionOffsets[nextDir][1])) {
+                    continue;
+                }
+
+                const int32_t cost = nextCost + ((nextDir & DIRECTION_DIAGONAL_MASK) ? MAP_NORMALWALKCOST + MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    dir = nextDir;
+                }
+            }
+
+            if (dir == -1) {
+                return false;
+            }
+        }
+
+        do {
+            path.push_back(dir);
+            x += directionOffsets[dir][0];
+            y += directionOffsets[dir][1];
+            index = y * FLOW_FIELD_WIDTH + x;
+            dir = steps[index];
+        } while (costs[index] > 0);
+        return true;
+    }
+
+private:
+    void build(const World& world, int32_t targetX, int32_t targetY) {
+        built = true;
+        fieldX = targetX;
+        fieldY = targetY;
+
+        // queryAdd with FLAG_IGNOREBLOCKCREATURE, occupied tiles only cost more
+        std::array<int32_t, FLOW_FIELD_WIDTH * FLOW_FIELD_WIDTH> tileCosts;
+        for (int32_t y = 0; y < FLOW_FIELD_WIDTH; ++y) {
+            for (int32_t x = 0; x < FLOW_FIELD_WIDTH; ++x) {
+                const int32_t mapX = targetX - FLOW_FIELD_RADIUS + x, mapY = targetY - FLOW_FIELD_RADIUS + y;
+                if (world.isWall(mapX, mapY)) {
+                    tileCosts[y * FLOW_FIELD_WIDTH + x] = -2;
+                } else {
+                    tileCosts[y * FLOW_FIELD_WIDTH + x] = (world.isOccupied(mapX, mapY) ? MAP_NORMALWALKCOST * 4 : 0);
+                }
+            }
+        }
+        tileCosts[FLOW_FIELD_RADIUS * FLOW_FIELD_WIDTH + FLOW_FIELD_RADIUS] = -2;
+
+        // neighbor offset and the direction of the step from that neighbor back to the tile
+        static constexpr int32_t neighbors[8][3] = {
+            {0, -1, 2}, {1, 0, 3}, {0, 1, 0}, {-1, 0, 1},
+            {-1, 1, 7}, {1, 1, 6}, {-1, -1, 5}, {1, -1, 4}
+        };
+
+        costs.fill(-1);
+        std::vector<std::pair<int32_t, int32_t>> openNodes;
+        openNodes.reserve(FLOW_FIELD_WIDTH * FLOW_FIELD_WIDTH);
+        for (const auto& neighbor : neighbors) {
+            const int32_t index = (FLOW_FIELD_RADIUS + neighbor[1]) * FLOW_FIELD_WIDTH + FLOW_FIELD_RADIUS + neighbor[0];
+            if (tileCosts[index] >= 0) {
+                costs[index] = 0;
+                openNodes.emplace_back(0, index);
+            }
+        }
+
+        const auto compareNodes = [](const std::pair<int32_t, int32_t>& lhs, const std::pair<int32_t, int32_t>& rhs) {
+            return lhs.first > rhs.first;
+        };
+        std::make_heap(openNodes.begin(), openNodes.end(), compareNodes);
+        while (!openNodes.empty()) {
+            std::pop_heap(openNodes.begin(), openNodes.end(), compareNodes);
+            const auto [cost, index] = openNodes.back();
+            openNodes.pop_back();
+            if (cost != costs[index]) {
+                continue;
+            }
+
+            const int32_t x = index % FLOW_FIELD_WIDTH, y = index / FLOW_FIELD_WIDTH;
+            const int32_t enterCost = cost + tileCosts[index];
+            for (const auto& neighbor : neighbors) {
+                const int32_t neighborX = x + neighbor[0], neighborY = y + neighbor[1];
+                if (neighborX < 0 || neighborX >= FLOW_FIELD_WIDTH || neighborY < 0 || neighborY >= FLOW_FIELD_WIDTH) {
+                    continue;
+                }
+
+                const int32_t neighborIndex = neighborY * FLOW_FIELD_WIDTH + neighborX;
+                if (tileCosts[neighborIndex] < 0) {
+                    continue;
+                }
+
+                const int32_t newCost = enterCost + ((neighbor[2] & DIRECTION_DIAGONAL_MASK) ? MAP_NORMALWALKCOST + MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+                int32_t& neighborCost = costs[neighborIndex];
+                if (neighborCost < 0 || newCost < neighborCost) {
+                    neighborCost = newCost;
+                    steps[neighborIndex] = neighbor[2];
+                    openNodes.emplace_back(newCost, neighborIndex);
+                    std::push_heap(openNodes.begin(), openNodes.end(), compareNodes);
+                }
+            }
+        }
+    }
+
+    AStar aStar;
+    std::array<int32_t, FLOW_FIELD_WIDTH * FLOW_FIELD_WIDTH> costs;
+    std::array<int32_t, FLOW_FIELD_WIDTH * FLOW_FIELD_WIDTH> steps;
+    int32_t fieldX = 0;
+    int32_t fieldY = 0;
+    bool built = false;
+};
+
+struct Result
+{
+    double seconds = 0;
+    uint64_t searches = 0;
+    uint64_t failures = 0;
+    uint64_t adjacent = 0;
+    uint64_t samples = 0;
+};
+
+template <typename Pathfinder>
+Result run(size_t monsterCount, int32_t simulatedSeconds)
+{
+    World world(1);
+    Pathfinder pathfinder;
+    Result result;
+
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int32_t> percent(0, 99);
+    std::uniform_int_distribution<int32_t> direction(0, 7);
+
+    // the player starts in the middle, the monsters in a crowd behind it
+    Creature player{MAP_SIZE / 2, MAP_SIZE / 2, {}, 0};
+    while (!world.canWalkTo(player.x, player.y)) {
+        ++player.x;
+    }
+    world.add(player);
+
+    std::vector<Creature> monsters;
+    for (int32_t radius = 2; monsters.size() < monsterCount; ++radius) {
+        for (int32_t y = player.y - radius; y <= player.y + radius && monsters.size() < monsterCount; ++y) {
+            for (int32_t x = player.x - radius; x <= player.x && monsters.size() < monsterCount; ++x) {
+                if (world.canWalkTo(x, y)) {
+                    monsters.push_back(Creature{x, y, {}, 0});
+                    world.add(monsters.back());
+                }
+            }
+        }
+    }
+
+    auto findPath = [&](Creature& monster) {
+        const auto start = std::chrono::steady_clock::now();
+        const bool found = pathfinder.getPath(world, monster, player.x, player.y, monster.path);
+        result.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ++result.searches;
+        if (!found) {
+            ++result.failures;
+            monster.path.clear();
+        }
+    };
+
+    int32_t playerDir = 1;
+    for (int32_t now = 0; now < simulatedSeconds * 1000; now += TICK_MS) {
+        if (now >= player.nextStep) {
+            player.nextStep = now + PLAYER_STEP_MS;
+            if (percent(rng) < 15) {
+                playerDir = direction(rng) & 3;
+            }
+
+            for (int32_t attempt = 0; attempt < 8; ++attempt) {
+                const int32_t x = player.x + directionOffsets[playerDir][0], y = player.y + directionOffsets[playerDir][1];
+                if (world.canWalkTo(x, y) && x > 32 && y > 32 && x < MAP_SIZE - 32 && y < MAP_SIZE - 32) {
+                    world.place(player, x, y);
+                    // every chaser updates its follow path when the target moves
+                    for (Creature& monster : monsters) {
+                        findPath(monster);
+                    }
+                    break;
+                }
+                playerDir = direction(rng) & 3;
+            }
+        }
+
+        for (Creature& monster : monsters) {
+            if (now < monster.nextStep) {
+                continue;
+            }
+            monster.nextStep = now + MONSTER_STEP_MS;
+
+            const bool isAdjacent = std::max(std::abs(monster.x - player.x), std::abs(monster.y - player.y)) == 1;
+            result.adjacent += isAdjacent;
+            ++result.samples;
+            if (isAdjacent) {
+                continue;
+            }
+
+            if (monster.path.empty()) {
+                findPath(monster);
+            }
+            if (monster.path.empty()) {
+                continue;
+            }
+
+            int32_t dir = monster.path.front();
+            int32_t x = monster.x + directionOffsets[dir][0], y = monster.y + directionOffsets[dir][1];
+            if (!world.canWalkTo(x, y)) {
+                findPath(monster);
+                if (monster.path.empty()) {
+                    continue;
+                }
+                dir = monster.path.front();
+                x = monster.x + directionOffsets[dir][0];
+                y = monster.y + directionOffsets[dir][1];
+                if (!world.canWalkTo(x, y)) {
+                    continue;
+                }
+            }
+
+            monster.path.pop_front();
+            world.place(monster, x, y);
+        }
+    }
+    return result;
+}
+
+void print(const char* name, const Result& result, int32_t simulatedSeconds)
+{
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed
+        << std::setw(12) << result.searches << std::setw(10) << result.failures
+        << std::setw(14) << std::setprecision(3) << (result.seconds * 1000 / simulatedSeconds)
+        << std::setw(12) << std::setprecision(2) << (result.seconds * 1e6 / result.searches)
+        << std::setw(12) << std::setprecision(1) << (100.0 * result.adjacent / result.samples) << '%' << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t monsterCount = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 40);
+    const int32_t simulatedSeconds = (argc > 2 ? std::atoi(argv[2]) : 60);
+
+    std::cout << monsterCount << " monsters chasing one player for " << simulatedSeconds << " simulated seconds" << std::endl;
+    std::cout << std::left << std::setw(12) << "paths" << std::right
+        << std::setw(12) << "searches" << std::setw(10) << "failed" << std::setw(14) << "cpu ms/s"
+        << std::setw(12) << "us/search" << std::setw(13) << "adjacent" << std::endl;
+    print("A*", run<AStar>(monsterCount, simulatedSeconds), simulatedSeconds);
+    print("flow field", run<FlowField>(monsterCount, simulatedSeconds), simulatedSeconds);
+    return EXIT_SUCCESS;
+}
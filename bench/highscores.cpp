@@ -0,0 +1,314 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Highscore requests over synthetic characters, sorting the whole category per request
+// like the ORDER BY the database used to run against the RankingTree treap Highscores
+// keeps now. Both answer a page of 20 characters and the rank of one character, the two
+// requests the client sends.
+//
+// The memory column counts the tree nodes of one category over every character and the
+// same again for the vocation groups, that is what every requested category costs and
+// what the index used to keep for all 9 of them.
+//
+// usage: bench_highscores [characters = 500000] [requests = 200]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr uint32_t ENTRIES_PER_PAGE = 20;
+constexpr uint16_t VOCATION_GROUPS = 4;
+constexpr size_t HIGHSCORE_CATEGORY_COUNT = 9;
+
+using RankingEntry = std::pair<uint64_t, uint32_t>;
+
+bool isRankedBefore(const RankingEntry& lhs, const RankingEntry& rhs)
+{
+    return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+}
+
+uint32_t getNodePriority(uint32_t id)
+{
+    id *= 0x9E3779B1U;
+    id ^= id >> 16;
+    id *= 0x85EBCA6BU;
+    id ^= id >> 13;
+    return id;
+}
+
+// RankingTree from highscores.h, trimmed to what the requests use
+class RankingTree
+{
+public:
+    void build(std::vector<RankingEntry>& entries) {
+        std::sort(entries.begin(), entries.end(), isRankedBefore);
+
+        nodes.resize(1);
+        nodes.reserve(entries.size() + 1);
+        root = 0;
+
+        std::vector<uint32_t> rightSpine;
+        for (const auto& entry : entries) {
+            uint32_t node = static_cast<uint32_t>(nodes.size());
+            nodes.push_back(Node{entry.first, entry.second, getNodePriority(entry.second), 1, 0, 0});
+            uint32_t last = 0;
+            while (!rightSpine.empty() && nodes[rightSpine.back()].priority < nodes[node].priority) {
+                last = rightSpine.back();
+                rightSpine.pop_back();
+            }
+
+            nodes[node].left = last;
+            if (!rightSpine.empty()) {
+                nodes[rightSpine.back()].right = node;
+            }
+            rightSpine.push_back(node);
+        }
+
+        if (!rightSpine.empty()) {
+            root = rightSpine.front();
+            buildSizes(root);
+        }
+    }
+
+    uint32_t countBefore(uint64_t points, uint32_t id) const {
+        uint32_t count = 0;
+        uint32_t node = root;
+        while (node != 0) {
+            const Node& current = nodes[node];
+            if (current.points > points || (current.points == points && current.id < id)) {
+                count += nodes[current.left].size + 1;
+                node = current.right;
+            } else {
+                node = current.left;
+            }
+        }
+        return count;
+    }
+
+    uint32_t at(uint32_t position) const {
+        uint32_t node = root;
+        while (node != 0) {
+            const Node& current = nodes[node];
+            uint32_t leftSize = nodes[current.left].size;
+            if (position < leftSize) {
+                node = current.left;
+            } else if (position == leftSize) {
+                return current.id;
+            } else {
+                position -= leftSize + 1;
+                node = current.right;
+            }
+        }
+        return 0;
+    }
+
+    size_t getMemory() const {
+        return nodes.capacity() * sizeof(Node);
+    }
+
+private:
+    struct Node
+    {
+        uint64_t points;
+        uint32_t id;
+        uint32_t priority;
+        uint32_t size;
+        uint32_t left;
+        uint32_t right;
+    };
+
+    void buildSizes(uint32_t node) {
+        Node& current = nodes[node];
+        if (current.left != 0) {
+            buildSizes(current.left);
+        }
+        if (current.right != 0) {
+            buildSizes(current.right);
+        }
+        current.size = nodes[current.left].size + nodes[current.right].size + 1;
+    }
+
+    std::vector<Node> nodes = std::vector<Node>(1, Node{0, 0, 0, 0, 0, 0});
+    uint32_t root = 0;
+};
+
+struct Character
+{
+    uint64_t points;
+    uint16_t group;
+};
+
+struct Request
+{
+    uint32_t page;
+    uint32_t id;
+};
+
+struct Result
+{
+    double build = 0;
+    double page = 0;
+    double position = 0;
+    size_t memory = 0;
+    uint64_t checksum = 0;
+};
+
+double since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<RankingEntry> getEntries(const std::vector<Character>& characters)
+{
+    std::vector<RankingEntry> entries;
+    entries.reserve(characters.size());
+    for (uint32_t id = 0; id < characters.size(); ++id) {
+        entries.emplace_back(characters[id].points, id + 1);
+    }
+    return entries;
+}
+
+// before: every request sorted the category and numbered the rows up to the ones it needed
+Result runSort(const std::vector<Character>& characters, const std::vector<Request>& requests)
+{
+    Result result;
+    auto start = std::chrono::steady_clock::now();
+    for (const Request& request : requests) {
+        std::vector<RankingEntry> entries = getEntries(characters);
+        std::sort(entries.begin(), entries.end(), isRankedBefore);
+        for (uint32_t position = (request.page - 1) * ENTRIES_PER_PAGE, last = position + ENTRIES_PER_PAGE; position < last; ++position) {
+            result.checksum += entries[position].second;
+        }
+    }
+    result.page = since(start) / requests.size();
+
+    start = std::chrono::steady_clock::now();
+    for (const Request& request : requests) {
+        std::vector<RankingEntry> entries = getEntries(characters);
+        std::sort(entries.begin(), entries.end(), isRankedBefore);
+        const RankingEntry entry(characters[request.id - 1].points, request.id);
+        result.checksum += std::lower_bound(entries.begin(), entries.end(), entry, isRankedBefore) - entries.begin();
+    }
+    result.position = since(start) / requests.size();
+    return result;
+}
+
+// after: the category is built once, into one tree over everybody and one per vocation group
+Result runTree(const std::vector<Character>& characters, const std::vector<Request>& requests)
+{
+    Result result;
+    RankingTree all;
+    std::vector<RankingTree> groups(VOCATION_GROUPS);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<RankingEntry> entries = getEntries(characters);
+    all.build(entries);
+    for (uint16_t group = 0; group < VOCATION_GROUPS; ++group) {
+        entries.clear();
+        for (uint32_t id = 0; id < characters.size(); ++id) {
+            if (characters[id].group == group) {
+                entries.emplace_back(characters[id].points, id + 1);
+            }
+        }
+        groups[group].build(entries);
+    }
+    result.build = since(start);
+
+    result.memory = all.getMemory();
+    for (const RankingTree& group : groups) {
+        result.memory += group.getMemory();
+    }
+
+    start = std::chrono::steady_clock::now();
+    for (const Request& request : requests) {
+        for (uint32_t position = (request.page - 1) * ENTRIES_PER_PAGE, last = position + ENTRIES_PER_PAGE; position < last; ++position) {
+            result.checksum += all.at(position);
+        }
+    }
+    result.page = since(start) / requests.size();
+
+    start = std::chrono::steady_clock::now();
+    for (const Request& request : requests) {
+        result.checksum += all.countBefore(characters[request.id - 1].points, request.id);
+    }
+    result.position = since(start) / requests.size();
+    return result;
+}
+
+void print(const char* name, const Result& result)
+{
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(3)
+        << std::setw(12) << result.build << std::setw(14) << result.page << std::setw(14) << result.position
+        << std::setw(12) << std::setprecision(1) << (result.memory / (1024.0 * 1024.0)) << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t count = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000);
+    const size_t requestCount = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200);
+    if (count < ENTRIES_PER_PAGE) {
+        std::cout << "at least " << ENTRIES_PER_PAGE << " characters are needed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // experience grows with the cube of the level, most characters are low level
+    std::mt19937 rng(1);
+    std::exponential_distribution<double> level(1.0 / 60);
+    std::uniform_int_distribution<uint16_t> group(0, VOCATION_GROUPS - 1);
+    std::vector<Character> characters(count);
+    for (Character& character : characters) {
+        const double l = 8 + level(rng);
+        character.points = static_cast<uint64_t>(50 * l * l * l / 3);
+        character.group = group(rng);
+    }
+
+    std::uniform_int_distribution<uint32_t> page(1, count / ENTRIES_PER_PAGE);
+    std::uniform_int_distribution<uint32_t> id(1, count);
+    std::vector<Request> requests(requestCount);
+    for (Request& request : requests) {
+        request.page = page(rng);
+        request.id = id(rng);
+    }
+
+    const Result before = runSort(characters, requests);
+    const Result after = runTree(characters, requests);
+    if (before.checksum != after.checksum) {
+        std::cout << "the rankings differ" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << count << " characters, " << requestCount << " requests of each kind" << std::endl;
+    std::cout << std::left << std::setw(16) << "ranking" << std::right
+        << std::setw(12) << "build ms" << std::setw(14) << "page ms" << std::setw(14) << "position ms"
+        << std::setw(12) << "MB" << std::endl;
+    print("sort per request", before);
+    print("ranking tree", after);
+    std::cout << "one category of trees takes " << std::setprecision(1) << (after.memory / (1024.0 * 1024.0))
+        << " MB, all " << HIGHSCORE_CATEGORY_COUNT << " of them took " << (HIGHSCORE_CATEGORY_COUNT * after.memory / (1024.0 * 1024.0)) << " MB" << std::endl;
+    return EXIT_SUCCESS;
+}
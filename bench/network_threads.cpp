@@ -0,0 +1,250 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Round trips per second of thousands of loopback clients against a server laid out like
+// ServiceManager and Connection: the acceptor on its own io_context, accepted sockets
+// handed round-robin to a pool of io_contexts with one thread each, and every handler of
+// a connection bound to its strand. Each client sends a packet, waits for the answer
+// and sends the next one; the server XTEA encrypts every answer like onSendMessage.
+//
+// The clients share the machine with the server, so the numbers only scale with the
+// network threads while there are cores left for both.
+//
+// usage: bench_network_threads [clients = 2000] [seconds = 3] [network threads = 1 2 4 ...]
+
+#include <asio.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t HEADER_LENGTH = 2;
+constexpr size_t PACKET_LENGTH = 64;
+
+// scalar XTEA over the answer, the work a network thread does per outgoing message
+void encrypt(uint8_t* buffer, size_t length)
+{
+    static constexpr uint32_t key[4] = {0x01234567, 0x89ABCDEF, 0xFEDCBA98, 0x76543210};
+    for (size_t pos = 0; pos + 8 <= length; pos += 8) {
+        uint32_t v[2];
+        memcpy(v, buffer + pos, 8);
+        uint32_t sum = 0;
+        for (int32_t i = 0; i < 32; ++i) {
+            v[0] += ((v[1] << 4 ^ v[1] >> 5) + v[1]) ^ (sum + key[sum & 3]);
+            sum -= 0x61C88647;
+            v[1] += ((v[0] << 4 ^ v[0] >> 5) + v[0]) ^ (sum + key[sum >> 11 & 3]);
+        }
+        memcpy(buffer + pos, v, 8);
+    }
+}
+
+class Connection : public std::enable_shared_from_this<Connection>
+{
+public:
+    explicit Connection(asio::io_context& io_context) : socket(io_context), strand(io_context.get_executor()) {}
+
+    void start() {
+        readHeader();
+    }
+
+    asio::ip::tcp::socket socket;
+
+private:
+    void readHeader() {
+        asio::async_read(socket, asio::buffer(buffer, HEADER_LENGTH), asio::bind_executor(strand, [self = shared_from_this()](const auto& error, size_t) {
+            if (!error) {
+                self->readBody();
+            }
+        }));
+    }
+
+    void readBody() {
+        uint16_t length;
+        memcpy(&length, buffer, HEADER_LENGTH);
+        asio::async_read(socket, asio::buffer(buffer + HEADER_LENGTH, length), asio::bind_executor(strand, [self = shared_from_this(), length](const auto& error, size_t) {
+            if (!error) {
+                self->reply(length);
+            }
+        }));
+    }
+
+    void reply(uint16_t length) {
+        encrypt(buffer + HEADER_LENGTH, length);
+        asio::async_write(socket, asio::buffer(buffer, HEADER_LENGTH + length), asio::bind_executor(strand, [self = shared_from_this()](const auto& error, size_t) {
+            if (!error) {
+                self->readHeader();
+            }
+        }));
+    }
+
+    asio::strand<asio::io_context::executor_type> strand;
+    uint8_t buffer[HEADER_LENGTH + PACKET_LENGTH];
+};
+
+class Server
+{
+public:
+    explicit Server(size_t threads) : acceptor(service, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0)) {
+        for (size_t i = 0; i < threads; ++i) {
+            networkServices.emplace_back(std::make_unique<asio::io_context>(1));
+            networkWork.emplace_back(asio::make_work_guard(*networkServices.back()));
+        }
+
+        accept();
+        for (auto& networkService : networkServices) {
+            networkThreads.emplace_back([networkService = networkService.get()] { networkService->run(); });
+        }
+        acceptorThread = std::thread([this] { service.run(); });
+    }
+
+    ~Server() {
+        service.stop();
+        for (auto& networkService : networkServices) {
+            networkService->stop();
+        }
+        acceptorThread.join();
+        for (std::thread& networkThread : networkThreads) {
+            networkThread.join();
+        }
+    }
+
+    asio::ip::tcp::endpoint getEndpoint() const {
+        return acceptor.local_endpoint();
+    }
+
+private:
+    void accept() {
+        asio::io_context& networkService = *networkServices[nextNetworkService];
+        if (++nextNetworkService == networkServices.size()) {
+            nextNetworkService = 0;
+        }
+
+        auto connection = std::make_shared<Connection>(networkService);
+        acceptor.async_accept(connection->socket, [this, connection](const auto& error) {
+            if (!error) {
+                connection->socket.set_option(asio::ip::tcp::no_delay(true));
+                connection->start();
+            }
+            accept();
+        });
+    }
+
+    asio::io_context service;
+    asio::ip::tcp::acceptor acceptor;
+    std::vector<std::unique_ptr<asio::io_context>> networkServices;
+    std::vector<asio::executor_work_guard<asio::io_context::executor_type>> networkWork;
+    std::vector<std::thread> networkThreads;
+    std::thread acceptorThread;
+    size_t nextNetworkService = 0;
+};
+
+class Client : public std::enable_shared_from_this<Client>
+{
+public:
+    Client(asio::io_context& io_context, std::atomic<uint64_t>& roundTrips) : socket(io_context), roundTrips(roundTrips) {
+        const uint16_t length = PACKET_LENGTH;
+        memcpy(buffer, &length, HEADER_LENGTH);
+        memset(buffer + HEADER_LENGTH, 0x5A, PACKET_LENGTH);
+    }
+
+    void start(const asio::ip::tcp::endpoint& endpoint) {
+        socket.async_connect(endpoint, [self = shared_from_this()](const auto& error) {
+            if (!error) {
+                self->socket.set_option(asio::ip::tcp::no_delay(true));
+                self->send();
+            }
+        });
+    }
+
+private:
+    void send() {
+        asio::async_write(socket, asio::buffer(buffer), [self = shared_from_this()](const auto& error, size_t) {
+            if (!error) {
+                self->receive();
+            }
+        });
+    }
+
+    void receive() {
+        asio::async_read(socket, asio::buffer(buffer), [self = shared_from_this()](const auto& error, size_t) {
+            if (!error) {
+                self->roundTrips.fetch_add(1, std::memory_order_relaxed);
+                self->send();
+            }
+        });
+    }
+
+    asio::ip::tcp::socket socket;
+    std::atomic<uint64_t>& roundTrips;
+    uint8_t buffer[HEADER_LENGTH + PACKET_LENGTH];
+};
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t clientCount = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000);
+    const double seconds = (argc > 2 ? std::strtod(argv[2], nullptr) : 3.0);
+    std::vector<size_t> threadCounts;
+    for (int i = 3; i < argc; ++i) {
+        threadCounts.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (threadCounts.empty()) {
+        threadCounts = {1, 2, 4};
+    }
+
+    std::cout << clientCount << " clients, " << std::thread::hardware_concurrency() << " cores" << std::endl;
+    std::cout << std::setw(16) << "network threads" << std::setw(16) << "round trips/s" << std::setw(14) << "avg us" << std::endl;
+    for (const size_t threads : threadCounts) {
+        Server server(threads);
+
+        asio::io_context clientService;
+        std::atomic<uint64_t> roundTrips{0};
+        for (size_t i = 0; i < clientCount; ++i) {
+            std::make_shared<Client>(clientService, roundTrips)->start(server.getEndpoint());
+        }
+
+        std::thread clientThread([&clientService] { clientService.run(); });
+
+        // let every client connect before counting
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        const uint64_t first = roundTrips.load();
+        const auto start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+        const uint64_t count = roundTrips.load() - first;
+        const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        clientService.stop();
+        clientThread.join();
+
+        const double perSecond = count / elapsed;
+        std::cout << std::setw(16) << threads << std::fixed << std::setprecision(0)
+            << std::setw(16) << perSecond << std::setw(14) << (clientCount * 1e6 / perSecond) << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,299 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// OutputMessagePool with one size class against a small class that gets promoted to a full
+// one when Protocol::getOutputBuffer needs more room, copying what was written so far.
+//
+// Every 10 ms autosend tick most players get a handful of small packets, some get a map
+// description after a teleport or floor change and a few log in. A message lives from the
+// first packet of the tick until its write completes, a tick later or up to 20 for slow
+// clients. Freed buffers go back to a LIFO free list of OUTPUTMESSAGE_FREE_LIST_CAPACITY.
+//
+// "resident" is what the pool keeps in memory: the pages every live or pooled buffer has
+// ever had written, the part the kernel backs. "copied" is what promotions copied.
+//
+// usage: bench_output_message_pool [seconds = 30] [players = 250 1000 ...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+// CLIENT_VERSION 1098
+constexpr size_t NETWORKMESSAGE_MAXSIZE = 65500;
+constexpr size_t INITIAL_BUFFER_POSITION = 8;
+constexpr size_t MAX_PROTOCOL_BODY_LENGTH = NETWORKMESSAGE_MAXSIZE - 2 - 4 - 8 - 8;
+constexpr size_t OUTPUTMESSAGE_FREE_LIST_CAPACITY = 2048;
+constexpr size_t PAGE_SIZE = 4096;
+constexpr int32_t TICKS_PER_SECOND = 100;
+
+struct Buffer
+{
+    explicit Buffer(size_t capacity) : data(new uint8_t[capacity]), capacity(capacity) {}
+
+    std::unique_ptr<uint8_t[]> data;
+    size_t capacity;
+    size_t touched = 0;
+};
+
+class SizeClass
+{
+public:
+    explicit SizeClass(size_t capacity) : capacity(capacity) {}
+    ~SizeClass() {
+        for (Buffer* buffer : freeList) {
+            delete buffer;
+        }
+    }
+
+    Buffer* allocate() {
+        if (freeList.empty()) {
+            ++allocations;
+            return new Buffer(capacity);
+        }
+
+        Buffer* buffer = freeList.back();
+        freeList.pop_back();
+        return buffer;
+    }
+
+    void deallocate(Buffer* buffer) {
+        if (freeList.size() < OUTPUTMESSAGE_FREE_LIST_CAPACITY) {
+            freeList.push_back(buffer);
+        } else {
+            delete buffer;
+        }
+    }
+
+    size_t getResident() const {
+        size_t resident = 0;
+        for (const Buffer* buffer : freeList) {
+            resident += pages(buffer->touched);
+        }
+        return resident;
+    }
+
+    static size_t pages(size_t bytes) {
+        return (bytes + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+    }
+
+    const size_t capacity;
+    uint64_t allocations = 0;
+
+private:
+    std::vector<Buffer*> freeList;
+};
+
+struct Message
+{
+    Buffer* buffer = nullptr;
+    size_t length = 0;
+};
+
+struct Result
+{
+    double seconds = 0;
+    uint64_t messages = 0;
+    uint64_t promoted = 0;
+    uint64_t copied = 0;
+    size_t resident = 0;
+    size_t peakResident = 0;
+};
+
+class Pool
+{
+public:
+    // smallCapacity = 0 keeps the single full size class
+    explicit Pool(size_t smallCapacity) : small(smallCapacity != 0 ? smallCapacity : NETWORKMESSAGE_MAXSIZE), large(NETWORKMESSAGE_MAXSIZE) {}
+
+    Message getOutputMessage() {
+        Message msg;
+        msg.buffer = small.allocate();
+        msg.length = 0;
+        return msg;
+    }
+
+    // Protocol::getOutputBuffer followed by OutputMessage::append
+    void append(Message& msg, const uint8_t* bytes, size_t size, Result& result) {
+        if (INITIAL_BUFFER_POSITION + msg.length + size > msg.buffer->capacity) {
+            Buffer* promoted = large.allocate();
+            memcpy(promoted->data.get(), msg.buffer->data.get(), INITIAL_BUFFER_POSITION + msg.length);
+            promoted->touched = std::max(promoted->touched, INITIAL_BUFFER_POSITION + msg.length);
+            release(msg.buffer);
+            msg.buffer = promoted;
+            ++result.promoted;
+            result.copied += msg.length;
+        }
+
+        memcpy(msg.buffer->data.get() + INITIAL_BUFFER_POSITION + msg.length, bytes, size);
+        msg.length += size;
+        msg.buffer->touched = std::max(msg.buffer->touched, INITIAL_BUFFER_POSITION + msg.length);
+    }
+
+    void release(Buffer* buffer) {
+        if (buffer->capacity == small.capacity) {
+            small.deallocate(buffer);
+        } else {
+            large.deallocate(buffer);
+        }
+    }
+
+    size_t getResident(const std::vector<std::vector<Message>>& inFlight) const {
+        size_t resident = small.getResident() + (small.capacity != large.capacity ? large.getResident() : 0);
+        for (const auto& messages : inFlight) {
+            for (const Message& msg : messages) {
+                resident += SizeClass::pages(msg.buffer->touched);
+            }
+        }
+        return resident;
+    }
+
+private:
+    SizeClass small;
+    SizeClass large;
+};
+
+Result run(size_t smallCapacity, size_t players, int32_t seconds)
+{
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int32_t> percent(0, 9999);
+    std::uniform_int_distribution<int32_t> packetSize(8, 60);
+    std::uniform_int_distribution<int32_t> packetCount(1, 12);
+    std::uniform_int_distribution<int32_t> mapSize(6000, 14000);
+    std::uniform_int_distribution<int32_t> loginSize(30000, 45000);
+    std::vector<uint8_t> source(MAX_PROTOCOL_BODY_LENGTH, 0x5A);
+
+    Pool pool(smallCapacity);
+    Result result;
+
+    // messages waiting for their write to complete, by the tick it completes
+    constexpr size_t MAX_WRITE_TICKS = 20;
+    std::vector<std::vector<Message>> inFlight(MAX_WRITE_TICKS + 1);
+    std::vector<Message> current(players);
+
+    auto write = [&](Message& msg, size_t size) {
+        while (size != 0) {
+            // a new message once the body is full, the way getOutputBuffer hands it off
+            const size_t chunk = std::min(size, MAX_PROTOCOL_BODY_LENGTH - msg.length);
+            if (chunk == 0) {
+                inFlight[1].push_back(msg);
+                msg = pool.getOutputMessage();
+                ++result.messages;
+                continue;
+            }
+            pool.append(msg, source.data(), chunk, result);
+            size -= chunk;
+        }
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    const int32_t ticks = seconds * TICKS_PER_SECOND;
+    for (int32_t tick = 0; tick < ticks; ++tick) {
+        for (Message& msg : inFlight[0]) {
+            pool.release(msg.buffer);
+        }
+        inFlight[0].clear();
+        std::rotate(inFlight.begin(), inFlight.begin() + 1, inFlight.end());
+
+        for (size_t player = 0; player < players; ++player) {
+            Message& msg = current[player];
+            const int32_t roll = percent(rng);
+            if (roll >= 9000) {
+                // nothing to send this tick
+                continue;
+            }
+
+            msg = pool.getOutputMessage();
+            ++result.messages;
+            const int32_t packets = packetCount(rng);
+            for (int32_t i = 0; i < packets; ++i) {
+                write(msg, packetSize(rng));
+            }
+            if (roll < 20) {
+                // teleport or floor change, every 5 seconds on average
+                write(msg, mapSize(rng));
+            }
+            if (roll == 20 && percent(rng) < 300) {
+                write(msg, loginSize(rng));
+            }
+
+            // OutputMessagePool::sendAll, slow clients take longer to drain
+            const size_t writeTicks = (percent(rng) < 500 ? 2 + percent(rng) % (MAX_WRITE_TICKS - 1) : 1);
+            inFlight[writeTicks].push_back(msg);
+            msg = Message();
+        }
+
+        if (tick % TICKS_PER_SECOND == 0) {
+            result.peakResident = std::max(result.peakResident, pool.getResident(inFlight));
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.resident = pool.getResident(inFlight);
+    result.peakResident = std::max(result.peakResident, result.resident);
+
+    for (auto& messages : inFlight) {
+        for (Message& msg : messages) {
+            pool.release(msg.buffer);
+        }
+    }
+    return result;
+}
+
+void print(size_t smallCapacity, const Result& result, int32_t seconds)
+{
+    std::cout << std::setw(10) << (smallCapacity != 0 ? std::to_string(smallCapacity) : "none") << std::fixed
+        << std::setw(10) << std::setprecision(1) << (result.seconds * 1e9 / result.messages)
+        << std::setw(11) << std::setprecision(2) << (100.0 * result.promoted / result.messages)
+        << std::setw(12) << std::setprecision(1) << (result.copied / 1024.0 / seconds)
+        << std::setw(13) << std::setprecision(1) << (result.resident / 1048576.0)
+        << std::setw(10) << std::setprecision(1) << (result.peakResident / 1048576.0) << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const int32_t seconds = (argc > 1 ? std::atoi(argv[1]) : 30);
+    std::vector<size_t> playerCounts;
+    for (int i = 2; i < argc; ++i) {
+        playerCounts.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (playerCounts.empty()) {
+        playerCounts = {250, 1000};
+    }
+
+    for (const size_t players : playerCounts) {
+        std::cout << players << " players, " << seconds << " seconds of 10 ms ticks" << std::endl;
+        std::cout << std::setw(10) << "small" << std::setw(10) << "ns/msg" << std::setw(11) << "promoted %"
+            << std::setw(12) << "copied KB/s" << std::setw(13) << "resident MB" << std::setw(10) << "peak MB" << std::endl;
+        for (const size_t smallCapacity : {0, 1024, 4096, 16384}) {
+            print(smallCapacity, run(smallCapacity, players, seconds), seconds);
+        }
+        std::cout << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
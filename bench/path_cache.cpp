@@ -0,0 +1,678 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// The hit rate of the path cache in Map::getPathTo with hunting parties of players chased
+// by monsters of a few types, flow fields off so every chase goes through the cache.
+//
+// per creature: the old key, the creature id, with paths dropped as soon as a creature
+// moves or an item changes in any sector they cross.
+// walk class: the key is the monster type, paths are only dropped when an item changes,
+// every tile on a path gets the rest of it and a hit checks the first steps for creatures.
+//
+// Every step of a player makes each chaser look for a new path, and so does a chaser
+// that took a step or walked into a creature, the way Creature::onCreatureMove and
+// Creature::onWalk update the follow path. Monsters that reach their player get killed
+// every now and then, which leaves a corpse, an item change in that sector, and another
+// one spawns a bit further away.
+//
+// usage: bench_path_cache [parties = 8] [monsters per party = 12] [seconds = 60]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr int32_t MAP_SIZE = 256;
+constexpr int32_t SECTOR_SIZE = 16;
+constexpr int32_t MAP_SECTORS = MAP_SIZE / SECTOR_SIZE;
+constexpr int32_t TICK_MS = 50;
+constexpr int32_t PLAYER_STEP_MS = 200;
+constexpr int32_t MONSTER_STEP_MS = 250;
+constexpr int32_t MONSTER_TYPES = 3;
+// a monster next to its player gets killed about this often per step, leaving a corpse,
+// and another one spawns this far away from the player
+constexpr int32_t KILL_PERCENT = 10;
+constexpr int32_t SPAWN_DISTANCE = 10;
+
+constexpr int32_t MAP_NORMALWALKCOST = 10;
+constexpr int32_t MAP_DIAGONALWALKCOST = 25;
+
+// pathfindingMaxNodes, pathfindingMaxClosedNodes and the maxSearchDist of a follow path
+constexpr int32_t PATHFINDING_MAX_NODES = 4096;
+constexpr int32_t PATHFINDING_MAX_CLOSED_NODES = 100;
+constexpr int32_t MAX_SEARCH_DIST = 12;
+
+constexpr size_t PATH_CACHE_MAX_SECTORS = 8;
+constexpr size_t PATH_CACHE_CHECKED_STEPS = 2;
+
+constexpr int32_t directionOffsets[8][2] = {
+    {0, -1}, {1, 0}, {0, 1}, {-1, 0}, {-1, 1}, {1, 1}, {-1, -1}, {1, -1}
+};
+
+int32_t getDirection(int32_t dx, int32_t dy)
+{
+    for (int32_t dir = 0; dir < 8; ++dir) {
+        if (directionOffsets[dir][0] == dx && directionOffsets[dir][1] == dy) {
+            return dir;
+        }
+    }
+    return -1;
+}
+
+struct Creature
+{
+    uint32_t id;
+    int32_t type;
+    int32_t x;
+    int32_t y;
+    std::deque<int32_t> path;
+    int32_t nextStep = 0;
+};
+
+struct Sector
+{
+    uint32_t creatureGeneration = 0;
+    uint32_t tileGeneration = 0;
+};
+
+class World
+{
+public:
+    explicit World(uint32_t seed) : walls(MAP_SIZE * MAP_SIZE, false), occupied(MAP_SIZE * MAP_SIZE, false), sectors(MAP_SECTORS * MAP_SECTORS) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int32_t> coordinate(0, MAP_SIZE - 1);
+        std::uniform_int_distribution<int32_t> length(4, 14);
+        std::uniform_int_distribution<int32_t> percent(0, 99);
+
+        for (int32_t i = 0; i < MAP_SIZE; ++i) {
+            walls[i] = walls[(MAP_SIZE - 1) * MAP_SIZE + i] = true;
+            walls[i * MAP_SIZE] = walls[i * MAP_SIZE + MAP_SIZE - 1] = true;
+        }
+
+        // scattered obstacles and wall segments monsters have to walk around
+        for (int32_t i = 0; i < MAP_SIZE * MAP_SIZE / 12; ++i) {
+            walls[coordinate(rng) * MAP_SIZE + coordinate(rng)] = true;
+        }
+        for (int32_t i = 0; i < MAP_SIZE * MAP_SIZE / 160; ++i) {
+            const int32_t x = coordinate(rng), y = coordinate(rng), wallLength = length(rng);
+            const bool horizontal = percent(rng) < 50;
+            for (int32_t j = 0; j < wallLength; ++j) {
+                const int32_t wallX = horizontal ? x + j : x, wallY = horizontal ? y : y + j;
+                if (wallX < MAP_SIZE && wallY < MAP_SIZE) {
+                    walls[wallY * MAP_SIZE + wallX] = true;
+                }
+            }
+        }
+    }
+
+    bool isWall(int32_t x, int32_t y) const {
+        return x < 0 || y < 0 || x >= MAP_SIZE || y >= MAP_SIZE || walls[y * MAP_SIZE + x];
+    }
+
+    // Map::canWalkTo for a monster, creatures block
+    bool canWalkTo(int32_t x, int32_t y) const {
+        return !isWall(x, y) && !occupied[y * MAP_SIZE + x];
+    }
+
+    const Sector& getSector(int32_t x, int32_t y) const {
+        return sectors[(y / SECTOR_SIZE) * MAP_SECTORS + x / SECTOR_SIZE];
+    }
+
+    // Map::invalidateSpectatorCache on both ends of a move
+    void place(Creature& creature, int32_t x, int32_t y) {
+        occupied[creature.y * MAP_SIZE + creature.x] = false;
+        ++getSector(creature.x, creature.y).creatureGeneration;
+        occupied[y * MAP_SIZE + x] = true;
+        ++getSector(x, y).creatureGeneration;
+        creature.x = x;
+        creature.y = y;
+    }
+
+    void add(const Creature& creature) {
+        occupied[creature.y * MAP_SIZE + creature.x] = true;
+        ++getSector(creature.x, creature.y).creatureGeneration;
+    }
+
+    // Map::invalidateTileState
+    void changeTile(int32_t x, int32_t y) {
+        ++getSector(x, y).tileGeneration;
+    }
+
+private:
+    Sector& getSector(int32_t x, int32_t y) {
+        return sectors[(y / SECTOR_SIZE) * MAP_SECTORS + x / SECTOR_SIZE];
+    }
+
+    std::vector<bool> walls;
+    std::vector<bool> occupied;
+    std::vector<Sector> sectors;
+};
+
+// Map::getPathMatchingCond with the follow path parameters
+class AStar
+{
+public:
+    AStar() : grid(MAP_SIZE * MAP_SIZE, GridCell{0, 0}), nodes(PATHFINDING_MAX_NODES), heapPositions(PATHFINDING_MAX_NODES) {
+        heap.reserve(PATHFINDING_MAX_NODES);
+    }
+
+    bool getPath(const World& world, int32_t startX, int32_t startY, int32_t targetX, int32_t targetY, std::deque<int32_t>& path) {
+        static constexpr int32_t allNeighbors[8][2] = {
+            {-1, 0}, {0, 1}, {1, 0}, {0, -1}, {-1, -1}, {1, -1}, {1, 1}, {-1, 1}
+        };
+
+        ++generation;
+        heap.clear();
+        nodeCount = 0;
+        closedNodes = 0;
+        createNode(-1, startX, startY, 0, 0);
+
+        const int32_t sX = std::abs(targetX - startX), sY = std::abs(targetY - startY);
+        int32_t found = -1;
+        do {
+            if (heap.empty()) {
+                return false;
+            }
+
+            const int32_t n = popBest();
+            const int32_t x = nodes[n].x, y = nodes[n].y;
+            if (std::max(std::abs(targetX - x), std::abs(targetY - y)) == 1) {
+                found = n;
+                break;
+            }
+
+            const int32_t f = nodes[n].f;
+            for (const auto& neighbor : allNeighbors) {
+                const int32_t nx = x + neighbor[0], ny = y + neighbor[1];
+                if (std::abs(nx - startX) > MAX_SEARCH_DIST || std::abs(ny - startY) > MAX_SEARCH_DIST) {
+                    continue;
+                }
+
+                const GridCell& cell = grid[ny * MAP_SIZE + nx];
+                const int32_t neighborNode = (cell.generation == generation ? cell.node : -1);
+                if (neighborNode == -1 && !world.canWalkTo(nx, ny)) {
+                    continue;
+                }
+
+                const int32_t newf = f + (std::abs(x - nx) + std::abs(y - ny) - 1) * MAP_DIAGONALWALKCOST + MAP_NORMALWALKCOST;
+                if (neighborNode != -1) {
+                    if (nodes[neighborNode].f <= newf) {
+                        continue;
+                    }
+                    nodes[neighborNode].f = newf;
+                    nodes[neighborNode].parent = n;
+                    if (heapPositions[neighborNode] == -1) {
+                        --closedNodes;
+                        push(neighborNode);
+                    } else {
+                        siftUp(heapPositions[neighborNode]);
+                    }
+                } else {
+                    const int32_t dX = std::abs(targetX - nx), dY = std::abs(targetY - ny);
+                    if (!createNode(n, nx, ny, newf, ((dX - sX) << 3) + ((dY - sY) << 3) + (std::max(dX, dY) << 3))) {
+                        return false;
+                    }
+                }
+            }
+            ++closedNodes;
+        } while (closedNodes < PATHFINDING_MAX_CLOSED_NODES);
+
+        if (found == -1) {
+            return false;
+        }
+
+        path.clear();
+        for (int32_t n = found; nodes[n].parent != -1; n = nodes[n].parent) {
+            const Node& parent = nodes[nodes[n].parent];
+            path.push_front(getDirection(nodes[n].x - parent.x, nodes[n].y - parent.y));
+        }
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        int32_t parent;
+        int32_t x;
+        int32_t y;
+        int32_t f;
+        int32_t g;
+    };
+
+    struct GridCell
+    {
+        uint32_t generation;
+        int32_t node;
+    };
+
+    bool createNode(int32_t parent, int32_t x, int32_t y, int32_t f, int32_t heuristic) {
+        if (nodeCount >= PATHFINDING_MAX_NODES) {
+            return false;
+        }
+
+        const int32_t node = nodeCount++;
+        nodes[node] = Node{parent, x, y, f, heuristic};
+        grid[y * MAP_SIZE + x] = GridCell{generation, node};
+        push(node);
+        return true;
+    }
+
+    bool isBefore(int32_t lhs, int32_t rhs) const {
+        const int32_t lhsCost = nodes[lhs].f + nodes[lhs].g, rhsCost = nodes[rhs].f + nodes[rhs].g;
+        return lhsCost < rhsCost || (lhsCost == rhsCost && lhs < rhs);
+    }
+
+    void push(int32_t node) {
+        heap.push_back(node);
+        siftUp(static_cast<int32_t>(heap.size()) - 1);
+    }
+
+    int32_t popBest() {
+        const int32_t best = heap.front();
+        heapPositions[best] = -1;
+        const int32_t last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap.front() = last;
+            heapPositions[last] = 0;
+            siftDown(0);
+        }
+        return best;
+    }
+
+    void siftUp(int32_t position) {
+        const int32_t node = heap[position];
+        while (position > 0) {
+            const int32_t parent = (position - 1) / 2;
+            if (!isBefore(node, heap[parent])) {
+                break;
+            }
+            heap[position] = heap[parent];
+            heapPositions[heap[position]] = position;
+            position = parent;
+        }
+        heap[position] = node;
+        heapPositions[node] = position;
+    }
+
+    void siftDown(int32_t position) {
+        const int32_t size = static_cast<int32_t>(heap.size());
+        const int32_t node = heap[position];
+        while (true) {
+            int32_t child = position * 2 + 1;
+            if (child >= size) {
+                break;
+            }
+            if (child + 1 < size && isBefore(heap[child + 1], heap[child])) {
+                ++child;
+            }
+            if (!isBefore(heap[child], node)) {
+                break;
+            }
+            heap[position] = heap[child];
+            heapPositions[heap[position]] = position;
+            position = child;
+        }
+        heap[position] = node;
+        heapPositions[node] = position;
+    }
+
+    std::vector<GridCell> grid;
+    std::vector<Node> nodes;
+    std::vector<int32_t> heap;
+    std::vector<int32_t> heapPositions;
+    uint32_t generation = 0;
+    int32_t nodeCount = 0;
+    int32_t closedNodes = 0;
+};
+
+enum class Keying
+{
+    PerCreature,
+    WalkClass,
+};
+
+struct Stats
+{
+    double seconds = 0;
+    uint64_t searches = 0;
+    uint64_t hits = 0;
+    uint64_t stale = 0;
+    uint64_t blocked = 0;
+    uint64_t failures = 0;
+    // steps of a cached path that turned out to be blocked once the chaser got there
+    uint64_t walkedIntoCreature = 0;
+};
+
+// Map::getPathTo, cachePath and isPathCacheValid
+template <Keying keying>
+class PathCache
+{
+public:
+    PathCache(size_t maxEntries, Stats& stats) : maxEntries(maxEntries), stats(stats) {}
+
+    bool getPath(const World& world, const Creature& creature, int32_t targetX, int32_t targetY, std::deque<int32_t>& path) {
+        ++stats.searches;
+        const Key key{creature.x, creature.y, targetX, targetY, (keying == Keying::PerCreature ? creature.id : static_cast<uint32_t>(creature.type))};
+        auto it = index.find(key);
+        if (it != index.end()) {
+            const auto entry = it->second;
+            if (!isValid(world, *entry)) {
+                ++stats.stale;
+                entries.erase(entry);
+                index.erase(it);
+            } else if (keying == Keying::WalkClass && !canWalkStart(world, *entry)) {
+                ++stats.blocked;
+            } else {
+                ++stats.hits;
+                entries.splice(entries.begin(), entries, entry);
+                path.assign(entry->path.begin(), entry->path.end());
+                return true;
+            }
+        }
+
+        if (!aStar.getPath(world, creature.x, creature.y, targetX, targetY, path)) {
+            ++stats.failures;
+            return false;
+        }
+        add(world, key, path);
+        return true;
+    }
+
+private:
+    struct Key
+    {
+        int32_t startX;
+        int32_t startY;
+        int32_t targetX;
+        int32_t targetY;
+        uint32_t walkClass;
+
+        bool operator==(const Key& other) const {
+            return startX == other.startX && startY == other.startY && targetX == other.targetX && targetY == other.targetY && walkClass == other.walkClass;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const {
+            uint64_t hash = (static_cast<uint64_t>(key.startX) << 16) | static_cast<uint64_t>(key.startY);
+            hash = hash * 0x9E3779B97F4A7C15ULL ^ ((static_cast<uint64_t>(key.targetX) << 16) | static_cast<uint64_t>(key.targetY));
+            hash = hash * 0x9E3779B97F4A7C15ULL ^ key.walkClass;
+            return static_cast<size_t>(hash ^ (hash >> 32));
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        std::vector<int32_t> path;
+        // sector, tile generation, creature generation
+        std::array<std::array<uint32_t, 3>, PATH_CACHE_MAX_SECTORS> sectors;
+        uint32_t sectorCount = 0;
+    };
+
+    void add(const World& world, const Key& key, const std::deque<int32_t>& path) {
+        Entry entry;
+        entry.key = key;
+
+        int32_t x = key.startX, y = key.startY;
+        for (size_t i = 0; ; ++i) {
+            const uint32_t sectorIndex = (y / SECTOR_SIZE) * MAP_SECTORS + x / SECTOR_SIZE;
+            const auto known = std::find_if(entry.sectors.begin(), entry.sectors.begin() + entry.sectorCount, [=](const std::array<uint32_t, 3>& sector) {
+                return sector[0] == sectorIndex;
+            });
+            if (known == entry.sectors.begin() + entry.sectorCount) {
+                if (entry.sectorCount == PATH_CACHE_MAX_SECTORS) {
+                    return;
+                }
+                const Sector& sector = world.getSector(x, y);
+                entry.sectors[entry.sectorCount++] = {sectorIndex, sector.tileGeneration, sector.creatureGeneration};
+            }
+
+            if (i == path.size()) {
+                break;
+            }
+            x += directionOffsets[path[i]][0];
+            y += directionOffsets[path[i]][1];
+        }
+
+        // the old cache only keeps the whole path, the new one every rest of it
+        const size_t suffixes = (keying == Keying::PerCreature ? 1 : path.size());
+        x = key.startX;
+        y = key.startY;
+        for (size_t i = 0; i < suffixes; ++i) {
+            entry.key.startX = x;
+            entry.key.startY = y;
+            entry.path.assign(path.begin() + i, path.end());
+
+            auto it = index.find(entry.key);
+            if (it != index.end()) {
+                entries.erase(it->second);
+                index.erase(it);
+            } else if (entries.size() >= maxEntries) {
+                index.erase(entries.back().key);
+                entries.pop_back();
+            }
+            entries.push_front(entry);
+            index[entry.key] = entries.begin();
+
+            x += directionOffsets[path[i]][0];
+            y += directionOffsets[path[i]][1];
+        }
+    }
+
+    bool isValid(const World& world, const Entry& entry) const {
+        for (uint32_t i = 0; i < entry.sectorCount; ++i) {
+            const auto& it = entry.sectors[i];
+            const Sector& sector = world.getSector((it[0] % MAP_SECTORS) * SECTOR_SIZE, (it[0] / MAP_SECTORS) * SECTOR_SIZE);
+            if (it[1] != sector.tileGeneration || (keying == Keying::PerCreature && it[2] != sector.creatureGeneration)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool canWalkStart(const World& world, const Entry& entry) const {
+        int32_t x = entry.key.startX, y = entry.key.startY;
+        const size_t steps = std::min<size_t>(entry.path.size(), PATH_CACHE_CHECKED_STEPS);
+        for (size_t i = 0; i < steps; ++i) {
+            x += directionOffsets[entry.path[i]][0];
+            y += directionOffsets[entry.path[i]][1];
+            if (!world.canWalkTo(x, y)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    AStar aStar;
+    std::list<Entry> entries;
+    std::unordered_map<Key, typename std::list<Entry>::iterator, KeyHash> index;
+    size_t maxEntries;
+    Stats& stats;
+};
+
+template <Keying keying>
+Stats run(size_t partyCount, size_t monstersPerParty, int32_t simulatedSeconds, size_t maxEntries)
+{
+    World world(1);
+    Stats stats;
+    PathCache<keying> cache(maxEntries, stats);
+
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int32_t> percent(0, 99);
+    std::uniform_int_distribution<int32_t> direction(0, 7);
+    std::uniform_int_distribution<int32_t> coordinate(48, MAP_SIZE - 48);
+
+    // parties spread over the map, every player chased by its own crowd of mixed types
+    uint32_t nextId = 1;
+    std::vector<Creature> players;
+    std::vector<std::vector<Creature>> chasers(partyCount);
+    for (size_t party = 0; party < partyCount; ++party) {
+        Creature player{nextId++, -1, coordinate(rng), coordinate(rng), {}, 0};
+        while (!world.canWalkTo(player.x, player.y)) {
+            ++player.x;
+        }
+        world.add(player);
+        players.push_back(player);
+
+        std::vector<Creature>& monsters = chasers[party];
+        for (int32_t radius = 2; monsters.size() < monstersPerParty; ++radius) {
+            for (int32_t y = player.y - radius; y <= player.y + radius && monsters.size() < monstersPerParty; ++y) {
+                for (int32_t x = player.x - radius; x <= player.x + radius && monsters.size() < monstersPerParty; ++x) {
+                    if (std::max(std::abs(x - player.x), std::abs(y - player.y)) == radius && world.canWalkTo(x, y)) {
+                        monsters.push_back(Creature{nextId++, static_cast<int32_t>(monsters.size()) % MONSTER_TYPES, x, y, {}, 0});
+                        world.add(monsters.back());
+                    }
+                }
+            }
+        }
+    }
+
+    auto findPath = [&](Creature& monster, const Creature& player) {
+        const auto start = std::chrono::steady_clock::now();
+        if (!cache.getPath(world, monster, player.x, player.y, monster.path)) {
+            monster.path.clear();
+        }
+        stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    std::vector<int32_t> playerDirs(partyCount, 1);
+    for (int32_t now = 0; now < simulatedSeconds * 1000; now += TICK_MS) {
+        for (size_t party = 0; party < partyCount; ++party) {
+            Creature& player = players[party];
+            if (now < player.nextStep) {
+                continue;
+            }
+            player.nextStep = now + PLAYER_STEP_MS;
+
+            // hunting players stand and fight about half of the time
+            if (percent(rng) < 50) {
+                continue;
+            }
+            if (percent(rng) < 15) {
+                playerDirs[party] = direction(rng) & 3;
+            }
+
+            for (int32_t attempt = 0; attempt < 8; ++attempt) {
+                const int32_t x = player.x + directionOffsets[playerDirs[party]][0], y = player.y + directionOffsets[playerDirs[party]][1];
+                if (world.canWalkTo(x, y) && x > 32 && y > 32 && x < MAP_SIZE - 32 && y < MAP_SIZE - 32) {
+                    world.place(player, x, y);
+                    for (Creature& monster : chasers[party]) {
+                        findPath(monster, player);
+                    }
+                    break;
+                }
+                playerDirs[party] = direction(rng) & 3;
+            }
+        }
+
+        for (size_t party = 0; party < partyCount; ++party) {
+            const Creature& player = players[party];
+            for (Creature& monster : chasers[party]) {
+                if (now < monster.nextStep) {
+                    continue;
+                }
+                monster.nextStep = now + MONSTER_STEP_MS;
+
+                if (std::max(std::abs(monster.x - player.x), std::abs(monster.y - player.y)) == 1) {
+                    if (percent(rng) < KILL_PERCENT) {
+                        world.changeTile(monster.x, monster.y);
+                        std::uniform_int_distribution<int32_t> offset(-SPAWN_DISTANCE, SPAWN_DISTANCE);
+                        for (int32_t attempt = 0; attempt < 32; ++attempt) {
+                            const int32_t x = player.x + offset(rng), y = player.y + offset(rng);
+                            if (std::max(std::abs(x - player.x), std::abs(y - player.y)) > SPAWN_DISTANCE / 2 && world.canWalkTo(x, y)) {
+                                world.place(monster, x, y);
+                                monster.path.clear();
+                                break;
+                            }
+                        }
+                    }
+                    continue;
+                }
+
+                if (monster.path.empty()) {
+                    findPath(monster, player);
+                    if (monster.path.empty()) {
+                        continue;
+                    }
+                }
+
+                int32_t x = monster.x + directionOffsets[monster.path.front()][0], y = monster.y + directionOffsets[monster.path.front()][1];
+                if (!world.canWalkTo(x, y)) {
+                    ++stats.walkedIntoCreature;
+                    findPath(monster, player);
+                    if (monster.path.empty()) {
+                        continue;
+                    }
+                    x = monster.x + directionOffsets[monster.path.front()][0];
+                    y = monster.y + directionOffsets[monster.path.front()][1];
+                    if (!world.canWalkTo(x, y)) {
+                        continue;
+                    }
+                }
+
+                monster.path.pop_front();
+                world.place(monster, x, y);
+                // the follow path is updated after every step
+                findPath(monster, player);
+            }
+        }
+    }
+    return stats;
+}
+
+void print(const char* name, const Stats& stats, int32_t simulatedSeconds)
+{
+    std::cout << std::left << std::setw(14) << name << std::right << std::fixed
+        << std::setw(10) << stats.searches
+        << std::setw(9) << std::setprecision(1) << (100.0 * stats.hits / stats.searches) << '%'
+        << std::setw(9) << std::setprecision(1) << (100.0 * stats.stale / stats.searches) << '%'
+        << std::setw(9) << std::setprecision(1) << (100.0 * stats.blocked / stats.searches) << '%'
+        << std::setw(10) << stats.walkedIntoCreature << std::setw(10) << stats.failures
+        << std::setw(12) << std::setprecision(3) << (stats.seconds * 1000 / simulatedSeconds) << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t partyCount = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8);
+    const size_t monstersPerParty = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 12);
+    const int32_t simulatedSeconds = (argc > 3 ? std::atoi(argv[3]) : 60);
+
+    std::cout << partyCount << " players chased by " << monstersPerParty << " monsters each for " << simulatedSeconds << " simulated seconds" << std::endl;
+    std::cout << std::left << std::setw(14) << "key" << std::right
+        << std::setw(10) << "searches" << std::setw(10) << "hits" << std::setw(10) << "stale" << std::setw(10) << "blocked"
+        << std::setw(10) << "walked in" << std::setw(12) << "cpu ms/s" << std::endl;
+    print("per creature", run<Keying::PerCreature>(partyCount, monstersPerParty, simulatedSeconds, 2048), simulatedSeconds);
+    print("walk class", run<Keying::WalkClass>(partyCount, monstersPerParty, simulatedSeconds, 4096), simulatedSeconds);
+    return EXIT_SUCCESS;
+}
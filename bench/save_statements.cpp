@@ -0,0 +1,368 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// What the server does on its side to send player saves and house tiles to the database,
+// without the database: building the request, its size on the wire and the number of
+// round trips. The database's own work is not part of it, but it parses every escaped
+// byte of the text requests and none of the bound ones.
+//
+// Player saves, over synthetic characters whose sections change at rates like a busy
+// server's background saves:
+// - escaped: the changed columns inlined and the blobs escaped into one plain query,
+//   what Database::formatStatement sent for statements that weren't reusable
+// - prepared: every column bound as binary, every section as a flag and either its
+//   data or NULL when it didn't change, so there is one statement text for all saves
+//
+// The bytes are what goes over the wire: the whole text for the escaped requests, the
+// parameters for the prepared ones plus each text once when it's prepared. Round trips
+// count the prepares as well.
+//
+// House tiles, every tile of the houses that changed:
+// - escaped: DBInsert rows with escaped blobs, split at max_allowed_packet
+// - prepared: INSERTs of HOUSE_TILE_BATCH rows and the rest in halving batches
+//
+// usage: bench_save_statements [saves = 20000] [house tiles = 20000]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t PLAYER_COLUMNS = 53;
+constexpr size_t HOUSE_TILE_BATCH = 256;
+constexpr size_t MAX_PACKET_SIZE = 64 * 1024 * 1024;
+
+struct SectionType
+{
+    const char* name;
+    size_t items;
+    // chance that the section changed since the last save
+    double changeRate;
+};
+
+// PLAYER_SAVE_CONDITIONS ... PLAYER_SAVE_SUPPLYSTASH, with a mid level character's sizes
+constexpr std::array<SectionType, 8> sectionTypes = {{
+    {"conditions", 4, 0.3},
+    {"spells", 30, 0.01},
+    {"storages", 300, 0.4},
+    {"items", 60, 0.6},
+    {"depotlockeritems", 800, 0.05},
+    {"depotitems", 800, 0.1},
+    {"inboxitems", 40, 0.1},
+    {"supplystash", 50, 0.05},
+}};
+
+// DBStatement, trimmed to what the saves bind
+struct Statement
+{
+    void addNumber(int64_t value) {
+        numbers.push_back(value);
+    }
+    void addBlob(const std::string& value) {
+        blobs.push_back(value);
+    }
+    void addNull() {
+        blobs.emplace_back();
+    }
+
+    // an execute only carries the parameters, the text goes out once when it's prepared
+    size_t getParameterSize() const {
+        size_t size = numbers.size() * sizeof(int64_t);
+        for (const std::string& blob : blobs) {
+            size += blob.length();
+        }
+        return size;
+    }
+
+    std::string query;
+    std::vector<int64_t> numbers;
+    std::vector<std::string> blobs;
+};
+
+// mysql_real_escape_string
+void escapeBlob(std::string& out, const std::string& blob)
+{
+    out.push_back('\'');
+    for (const char c : blob) {
+        switch (c) {
+            case '\0': out += "\\0"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\\': out += "\\\\"; break;
+            case '\'': out += "\\'"; break;
+            case '"': out += "\\\""; break;
+            case '\032': out += "\\Z"; break;
+            default: out.push_back(c); break;
+        }
+    }
+    out.push_back('\'');
+}
+
+// serialized items are mostly small little endian numbers, so they're full of zero bytes
+std::string makeItems(size_t count, std::mt19937& rng)
+{
+    std::uniform_int_distribution<uint32_t> id(100, 30000);
+    std::uniform_int_distribution<uint32_t> byte(0, 255);
+    std::bernoulli_distribution attributes(0.2);
+    std::string blob;
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t itemId = id(rng);
+        blob.push_back(static_cast<char>(itemId & 0xFF));
+        blob.push_back(static_cast<char>(itemId >> 8));
+        if (attributes(rng)) {
+            // an attribute id and a 32 bit value
+            blob.push_back(static_cast<char>(byte(rng) % 40));
+            blob.push_back(static_cast<char>(byte(rng)));
+            blob.append(3, '\0');
+        }
+        // ATTR_END
+        blob.push_back('\0');
+    }
+    return blob;
+}
+
+struct Save
+{
+    std::vector<int64_t> columns;
+    std::array<std::string, sectionTypes.size()> sections;
+    uint32_t changedSections;
+    uint32_t changedColumns;
+};
+
+struct Result
+{
+    double seconds = 0;
+    uint64_t bytes = 0;
+    uint64_t statements = 0;
+    size_t shapes = 0;
+};
+
+Result runEscapedSaves(const std::vector<Save>& saves)
+{
+    Result result;
+    const auto start = std::chrono::steady_clock::now();
+    std::string query;
+    for (const Save& save : saves) {
+        query.clear();
+        query += "UPDATE `players` SET ";
+        for (size_t column = 0; column < save.changedColumns; ++column) {
+            query += column == 0 ? "`column_" : ",`column_";
+            query += std::to_string(column);
+            query += "` = ";
+            query += std::to_string(save.columns[column]);
+        }
+        for (size_t section = 0; section < sectionTypes.size(); ++section) {
+            if ((save.changedSections & (1U << section)) != 0) {
+                query += ",`";
+                query += sectionTypes[section].name;
+                query += "` = ";
+                escapeBlob(query, save.sections[section]);
+            }
+        }
+        query += " WHERE `id` = 1";
+        result.bytes += query.length();
+        ++result.statements;
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+Result runPreparedSaves(const std::vector<Save>& saves)
+{
+    Result result;
+    std::set<std::string> shapes;
+    const auto start = std::chrono::steady_clock::now();
+    for (const Save& save : saves) {
+        Statement statement;
+        statement.query = "UPDATE `players` SET ";
+        for (size_t column = 0; column < save.columns.size(); ++column) {
+            statement.query += column == 0 ? "`column_" : ",`column_";
+            statement.query += std::to_string(column);
+            statement.query += "` = ?";
+            statement.addNumber(save.columns[column]);
+        }
+        for (size_t section = 0; section < sectionTypes.size(); ++section) {
+            const char* name = sectionTypes[section].name;
+            statement.query += ",`";
+            statement.query += name;
+            statement.query += "` = IF(?, ?, `";
+            statement.query += name;
+            statement.query += "`)";
+            if ((save.changedSections & (1U << section)) != 0) {
+                statement.addNumber(1);
+                statement.addBlob(save.sections[section]);
+            } else {
+                statement.addNumber(0);
+                statement.addNull();
+            }
+        }
+        statement.query += " WHERE `id` = ?";
+        statement.addNumber(1);
+        result.bytes += statement.getParameterSize();
+        ++result.statements;
+        // the connection prepares every text it hasn't seen yet once
+        if (shapes.insert(statement.query).second) {
+            result.bytes += statement.query.length();
+            ++result.statements;
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.shapes = shapes.size();
+    return result;
+}
+
+Result runEscapedTiles(const std::vector<std::string>& tiles)
+{
+    Result result;
+    const auto start = std::chrono::steady_clock::now();
+    const std::string insert = "INSERT INTO `tile_store` (`house_id`, `data`) VALUES ";
+    std::string values;
+    std::string row;
+    for (size_t i = 0; i < tiles.size(); ++i) {
+        row.clear();
+        row += std::to_string(i / 50 + 1);
+        row.push_back(',');
+        escapeBlob(row, tiles[i]);
+        if (insert.length() + values.length() + row.length() > MAX_PACKET_SIZE) {
+            result.bytes += insert.length() + values.length();
+            ++result.statements;
+            values.clear();
+        }
+        values += values.empty() ? "(" : ",(";
+        values += row;
+        values.push_back(')');
+    }
+    result.bytes += insert.length() + values.length();
+    ++result.statements;
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+Result runPreparedTiles(const std::vector<std::string>& tiles)
+{
+    Result result;
+    std::set<size_t> shapes;
+    const auto start = std::chrono::steady_clock::now();
+    size_t row = 0;
+    for (size_t batch = HOUSE_TILE_BATCH; batch > 0; batch /= 2) {
+        for (; tiles.size() - row >= batch; row += batch) {
+            Statement statement;
+            statement.query = "INSERT INTO `tile_store` (`house_id`, `data`) VALUES (?, ?)";
+            for (size_t i = 1; i < batch; ++i) {
+                statement.query += ", (?, ?)";
+            }
+            for (size_t i = row; i < row + batch; ++i) {
+                statement.addNumber(i / 50 + 1);
+                statement.addBlob(tiles[i]);
+            }
+            result.bytes += statement.getParameterSize();
+            ++result.statements;
+            if (shapes.insert(batch).second) {
+                result.bytes += statement.query.length();
+                ++result.statements;
+            }
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.shapes = shapes.size();
+    return result;
+}
+
+void print(const char* name, const Result& result, size_t count)
+{
+    std::cout << std::left << std::setw(12) << name << std::right << std::fixed
+        << std::setw(12) << std::setprecision(2) << (result.seconds * 1e6 / count)
+        << std::setw(14) << std::setprecision(0) << (count / result.seconds)
+        << std::setw(14) << std::setprecision(1) << (static_cast<double>(result.bytes) / count)
+        << std::setw(12) << result.statements
+        << std::setw(8) << result.shapes << std::endl;
+}
+
+void printHeader(const char* unit)
+{
+    std::cout << std::left << std::setw(12) << "request" << std::right
+        << std::setw(12) << "us each" << std::setw(14) << (std::string(unit) + "/s")
+        << std::setw(14) << "bytes each" << std::setw(12) << "round trips" << std::setw(8) << "shapes" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t saveCount = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000);
+    const size_t tileCount = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000);
+
+    std::mt19937 rng(1);
+    std::uniform_int_distribution<int64_t> value(0, 5000000);
+    std::uniform_int_distribution<uint32_t> changedColumns(4, 16);
+
+    // a few hundred characters saved over and over, each save changes some of their sections
+    std::vector<Save> characters(200);
+    for (Save& character : characters) {
+        character.columns.resize(PLAYER_COLUMNS);
+        for (int64_t& column : character.columns) {
+            column = value(rng);
+        }
+        for (size_t section = 0; section < sectionTypes.size(); ++section) {
+            character.sections[section] = makeItems(sectionTypes[section].items, rng);
+        }
+    }
+
+    std::vector<Save> saves(saveCount);
+    std::uniform_int_distribution<size_t> character(0, characters.size() - 1);
+    std::uniform_real_distribution<double> chance(0, 1);
+    for (Save& save : saves) {
+        save = characters[character(rng)];
+        save.changedSections = 0;
+        for (size_t section = 0; section < sectionTypes.size(); ++section) {
+            if (chance(rng) < sectionTypes[section].changeRate) {
+                save.changedSections |= 1U << section;
+            }
+        }
+        save.changedColumns = changedColumns(rng);
+    }
+
+    std::vector<std::string> tiles(tileCount);
+    std::uniform_int_distribution<size_t> tileItems(1, 12);
+    for (std::string& tile : tiles) {
+        // x, y, z and the item count in front of the items
+        tile = std::string("\x10\x04\x20\x03\x07\x02\x00\x00\x00", 9) + makeItems(tileItems(rng), rng);
+    }
+
+    std::cout << saveCount << " player saves" << std::endl;
+    printHeader("saves");
+    print("escaped", runEscapedSaves(saves), saveCount);
+    print("prepared", runPreparedSaves(saves), saveCount);
+    std::cout << std::endl;
+
+    std::cout << tileCount << " house tiles" << std::endl;
+    printHeader("tiles");
+    print("escaped", runEscapedTiles(tiles), tileCount);
+    print("prepared", runPreparedTiles(tiles), tileCount);
+    return EXIT_SUCCESS;
+}
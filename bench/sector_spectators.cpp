@@ -0,0 +1,274 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// The sector scan of Map::getSpectatorsInternal with a growing number of creatures per
+// sector. The old loop read the position from every Creature in the sector list, the
+// new one filters the x/y/z arrays SectorCreatureList keeps next to the list, either
+// four at a time with SSE2 or one at a time where SSE2 isn't available, and only
+// touches the creatures that match.
+//
+// Creatures are allocated one by one and about as big as the real ones, so the old
+// loop pays for a cache line per creature once the sectors stop fitting in the cache.
+// Queries are multifloor from the ground floor with creatures spread over three floors.
+//
+// usage: bench_sector_spectators [queries = 20000] [creatures per sector = 50 200 1000 ...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr int32_t SECTOR_SIZE = 16;
+constexpr int32_t SECTOR_MASK = SECTOR_SIZE - 1;
+constexpr int32_t MAP_SECTORS = 8;
+constexpr int32_t MAP_SIZE = MAP_SECTORS * SECTOR_SIZE;
+
+// Map::maxViewportX and Map::maxViewportY
+constexpr int32_t VIEWPORT_X = 10;
+constexpr int32_t VIEWPORT_Y = 8;
+// a multifloor query from the ground floor
+constexpr int32_t CENTER_Z = 7;
+constexpr int32_t MIN_RANGE_Z = 0;
+constexpr int32_t MAX_RANGE_Z = 7;
+
+struct Creature
+{
+    int32_t x;
+    int32_t y;
+    int32_t z;
+    // the rest of a Creature, which puts every creature on cache lines of its own
+    uint8_t state[1000];
+};
+
+struct Sector
+{
+    std::vector<Creature*> creatures;
+    // parallel to creatures
+    std::vector<int32_t> x;
+    std::vector<int32_t> y;
+    std::vector<int32_t> z;
+};
+
+enum class Filter
+{
+    Pointer,
+    Scalar,
+    Simd,
+};
+
+struct Query
+{
+    int32_t minX;
+    int32_t minY;
+    int32_t maxX;
+    int32_t maxY;
+};
+
+class World
+{
+public:
+    World(size_t creaturesPerSector, uint32_t seed) : sectors(MAP_SECTORS * MAP_SECTORS) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int32_t> coordinate(0, MAP_SIZE - 1);
+        std::uniform_int_distribution<int32_t> floor(CENTER_Z - 2, CENTER_Z);
+
+        const size_t count = creaturesPerSector * sectors.size();
+        creatures.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            creatures.emplace_back(new Creature{coordinate(rng), coordinate(rng), floor(rng), {}});
+        }
+
+        // added in a different order than allocated, like creatures spawning, dying and walking in
+        std::vector<Creature*> order;
+        order.reserve(count);
+        for (const auto& creature : creatures) {
+            order.push_back(creature.get());
+        }
+        std::shuffle(order.begin(), order.end(), rng);
+        for (Creature* creature : order) {
+            Sector& sector = sectors[(creature->y / SECTOR_SIZE) * MAP_SECTORS + creature->x / SECTOR_SIZE];
+            sector.creatures.push_back(creature);
+            sector.x.push_back(creature->x);
+            sector.y.push_back(creature->y);
+            sector.z.push_back(creature->z);
+        }
+    }
+
+    template <Filter filter>
+    void getSpectators(std::vector<Creature*>& spectators, const Query& query) const {
+        const int32_t min_x = query.minX, min_y = query.minY, max_x = query.maxX, max_y = query.maxY;
+        const auto width = static_cast<uint32_t>(max_x - min_x);
+        const auto height = static_cast<uint32_t>(max_y - min_y);
+        const auto depth = static_cast<uint32_t>(MAX_RANGE_Z - MIN_RANGE_Z);
+
+        const int32_t minoffset = CENTER_Z - MAX_RANGE_Z;
+        const int32_t x1 = std::max<int32_t>(0, min_x + minoffset);
+        const int32_t y1 = std::max<int32_t>(0, min_y + minoffset);
+        const int32_t maxoffset = CENTER_Z - MIN_RANGE_Z;
+        const int32_t x2 = std::min<int32_t>(MAP_SIZE - 1, max_x + maxoffset);
+        const int32_t y2 = std::min<int32_t>(MAP_SIZE - 1, max_y + maxoffset);
+
+        for (int32_t ny = y1 & ~SECTOR_MASK; ny <= y2; ny += SECTOR_SIZE) {
+            for (int32_t nx = x1 & ~SECTOR_MASK; nx <= x2; nx += SECTOR_SIZE) {
+                const Sector& sector = sectors[(ny / SECTOR_SIZE) * MAP_SECTORS + nx / SECTOR_SIZE];
+                const size_t count = sector.creatures.size();
+                size_t i = 0;
+                if (filter == Filter::Pointer) {
+                    for (Creature* creature : sector.creatures) {
+                        if (static_cast<uint32_t>(creature->z - MIN_RANGE_Z) <= depth) {
+                            const int32_t offsetZ = CENTER_Z - creature->z;
+                            if (static_cast<uint32_t>(creature->x - offsetZ - min_x) <= width && static_cast<uint32_t>(creature->y - offsetZ - min_y) <= height) {
+                                spectators.push_back(creature);
+                            }
+                        }
+                    }
+                    continue;
+                }
+
+#if defined(__SSE2__)
+                if (filter == Filter::Simd) {
+                    const __m128i minZ = _mm_set1_epi32(MIN_RANGE_Z);
+                    const __m128i maxZ = _mm_set1_epi32(MAX_RANGE_Z);
+                    const __m128i minX = _mm_set1_epi32(min_x + CENTER_Z);
+                    const __m128i maxX = _mm_set1_epi32(max_x + CENTER_Z);
+                    const __m128i minY = _mm_set1_epi32(min_y + CENTER_Z);
+                    const __m128i maxY = _mm_set1_epi32(max_y + CENTER_Z);
+                    for (; i + 4 <= count; i += 4) {
+                        const __m128i vz = _mm_loadu_si128(reinterpret_cast<const __m128i*>(sector.z.data() + i));
+                        const __m128i vx = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sector.x.data() + i)), vz);
+                        const __m128i vy = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(sector.y.data() + i)), vz);
+                        __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(minZ, vz), _mm_cmpgt_epi32(vz, maxZ));
+                        outside = _mm_or_si128(outside, _mm_or_si128(_mm_cmpgt_epi32(minX, vx), _mm_cmpgt_epi32(vx, maxX)));
+                        outside = _mm_or_si128(outside, _mm_or_si128(_mm_cmpgt_epi32(minY, vy), _mm_cmpgt_epi32(vy, maxY)));
+                        const int mask = ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0x0F;
+                        for (size_t lane = 0; lane < 4; ++lane) {
+                            if (mask & (1 << lane)) {
+                                spectators.push_back(sector.creatures[i + lane]);
+                            }
+                        }
+                    }
+                }
+#endif
+                for (; i < count; ++i) {
+                    const int32_t cz = sector.z[i];
+                    if (static_cast<uint32_t>(cz - MIN_RANGE_Z) <= depth) {
+                        const int32_t offsetZ = CENTER_Z - cz;
+                        if (static_cast<uint32_t>(sector.x[i] - offsetZ - min_x) <= width && static_cast<uint32_t>(sector.y[i] - offsetZ - min_y) <= height) {
+                            spectators.push_back(sector.creatures[i]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+private:
+    std::vector<Sector> sectors;
+    std::vector<std::unique_ptr<Creature>> creatures;
+};
+
+struct Result
+{
+    double seconds = 0;
+    uint64_t spectators = 0;
+};
+
+template <Filter filter>
+Result run(const World& world, const std::vector<Query>& queries)
+{
+    Result result;
+    std::vector<Creature*> spectators;
+    const auto start = std::chrono::steady_clock::now();
+    for (const Query& query : queries) {
+        spectators.clear();
+        world.getSpectators<filter>(spectators, query);
+        result.spectators += spectators.size();
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void print(const char* name, const Result& result, size_t queryCount)
+{
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed
+        << std::setw(12) << std::setprecision(1) << (result.seconds * 1e9 / queryCount)
+        << std::setw(12) << std::setprecision(3) << result.seconds
+        << std::setw(14) << std::setprecision(1) << (static_cast<double>(result.spectators) / queryCount) << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t queryCount = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000);
+    std::vector<size_t> sectorSizes;
+    for (int i = 2; i < argc; ++i) {
+        sectorSizes.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (sectorSizes.empty()) {
+        sectorSizes = {50, 200, 1000};
+    }
+
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int32_t> center(VIEWPORT_X + CENTER_Z, MAP_SIZE - VIEWPORT_X - CENTER_Z - 1);
+    std::vector<Query> queries(queryCount);
+    for (Query& query : queries) {
+        const int32_t x = center(rng), y = center(rng);
+        query = Query{x - VIEWPORT_X, y - VIEWPORT_Y, x + VIEWPORT_X, y + VIEWPORT_Y};
+    }
+
+    for (const size_t creaturesPerSector : sectorSizes) {
+        const World world(creaturesPerSector, 1);
+        const Result pointer = run<Filter::Pointer>(world, queries);
+        const Result scalar = run<Filter::Scalar>(world, queries);
+#if defined(__SSE2__)
+        const Result simd = run<Filter::Simd>(world, queries);
+#endif
+        if (pointer.spectators != scalar.spectators) {
+            std::cout << "the filters found different spectators" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << creaturesPerSector << " creatures per sector, " << queryCount << " queries" << std::endl;
+        std::cout << std::left << std::setw(16) << "filter" << std::right
+            << std::setw(12) << "ns/query" << std::setw(12) << "total s" << std::setw(14) << "spectators" << std::endl;
+        print("creature pointer", pointer, queryCount);
+        print("packed scalar", scalar, queryCount);
+#if defined(__SSE2__)
+        if (simd.spectators != pointer.spectators) {
+            std::cout << "the filters found different spectators" << std::endl;
+            return EXIT_FAILURE;
+        }
+        print("packed SSE2", simd, queryCount);
+#endif
+        std::cout << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,314 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Spectator cache hit rate and query time, clearing the whole cache on every creature
+// move (the old Map::clearSpectatorCache) against the per sector generations that
+// Map::getSpectators validates cached entries with now.
+//
+// Creatures live in small spawns on the ground floor of a synthetic map. Every tick
+// each of them looks for spectators around itself like a monster updating its
+// targets, and some of them take a step, which queries the old and the new position
+// the way Game::internalMoveCreature does. The run is repeated for several shares of
+// creatures walking per tick.
+//
+// usage: bench_spectator_cache [creatures = 2000] [ticks = 200]
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+constexpr int32_t SECTOR_SIZE = 16;
+constexpr int32_t SECTOR_MASK = SECTOR_SIZE - 1;
+constexpr int32_t MAP_SECTORS = 64;
+constexpr int32_t MAP_SIZE = MAP_SECTORS * SECTOR_SIZE;
+
+// Map::maxViewportX and Map::maxViewportY
+constexpr int32_t VIEWPORT_X = 10;
+constexpr int32_t VIEWPORT_Y = 8;
+// a multifloor query from the ground floor widens the sectors it scans by 7 tiles, one per floor above
+constexpr int32_t FLOOR_OFFSET = 7;
+
+constexpr int32_t SPAWN_SIZE = 5;
+constexpr int32_t SPAWN_RADIUS = 8;
+
+constexpr size_t SPECTATOR_CACHE_MAX_SECTORS = 16;
+constexpr size_t SPECTATOR_CACHE_MAX_ENTRIES = 32768;
+
+struct Sector;
+
+struct Creature
+{
+    int32_t x;
+    int32_t y;
+    int32_t spawnX;
+    int32_t spawnY;
+};
+
+using SpectatorVector = std::vector<Creature*>;
+
+struct Sector
+{
+    std::vector<Creature*> creatures;
+    uint32_t creatureGeneration = 0;
+};
+
+struct SpectatorCacheEntry
+{
+    SpectatorVector spectators;
+    std::array<std::pair<const Sector*, uint32_t>, SPECTATOR_CACHE_MAX_SECTORS> sectors;
+    uint32_t sectorCount = 0;
+};
+
+class World
+{
+public:
+    World(size_t creatureCount, uint32_t seed) : sectors(MAP_SECTORS * MAP_SECTORS), creatures(creatureCount) {
+        std::mt19937 rng(seed);
+        std::uniform_int_distribution<int32_t> spawnPos(SPAWN_RADIUS + VIEWPORT_X, MAP_SIZE - SPAWN_RADIUS - VIEWPORT_X - 1);
+        std::uniform_int_distribution<int32_t> offset(-SPAWN_RADIUS, SPAWN_RADIUS);
+
+        int32_t spawnX = 0, spawnY = 0;
+        for (size_t i = 0; i < creatures.size(); ++i) {
+            if (i % SPAWN_SIZE == 0) {
+                spawnX = spawnPos(rng);
+                spawnY = spawnPos(rng);
+            }
+
+            Creature& creature = creatures[i];
+            creature.spawnX = spawnX;
+            creature.spawnY = spawnY;
+            creature.x = spawnX + offset(rng);
+            creature.y = spawnY + offset(rng);
+            getSector(creature.x, creature.y).creatures.push_back(&creature);
+        }
+    }
+
+    Sector& getSector(int32_t x, int32_t y) {
+        return sectors[(y / SECTOR_SIZE) * MAP_SECTORS + (x / SECTOR_SIZE)];
+    }
+
+    // Map::getSpectatorsInternal for a multifloor query from the ground floor, every creature stands on it
+    void collect(SpectatorVector& spectators, int32_t centerX, int32_t centerY, SpectatorCacheEntry* cacheEntry) {
+        const int32_t minX = centerX - VIEWPORT_X, maxX = centerX + VIEWPORT_X;
+        const int32_t minY = centerY - VIEWPORT_Y, maxY = centerY + VIEWPORT_Y;
+        const int32_t endX = std::min(MAP_SIZE - 1, maxX);
+        const int32_t endY = std::min(MAP_SIZE - 1, maxY);
+        for (int32_t ny = std::max(0, minY - FLOOR_OFFSET) & ~SECTOR_MASK; ny <= endY; ny += SECTOR_SIZE) {
+            for (int32_t nx = std::max(0, minX - FLOOR_OFFSET) & ~SECTOR_MASK; nx <= endX; nx += SECTOR_SIZE) {
+                const Sector& sector = getSector(nx, ny);
+                if (cacheEntry) {
+                    if (cacheEntry->sectorCount < SPECTATOR_CACHE_MAX_SECTORS) {
+                        cacheEntry->sectors[cacheEntry->sectorCount] = std::make_pair(&sector, sector.creatureGeneration);
+                    }
+                    ++cacheEntry->sectorCount;
+                }
+
+                for (Creature* creature : sector.creatures) {
+                    if (creature->x >= minX && creature->x <= maxX && creature->y >= minY && creature->y <= maxY) {
+                        spectators.push_back(creature);
+                    }
+                }
+            }
+        }
+    }
+
+    void move(Creature& creature, int32_t x, int32_t y) {
+        Sector& from = getSector(creature.x, creature.y);
+        Sector& to = getSector(x, y);
+        ++from.creatureGeneration;
+        ++to.creatureGeneration;
+        if (&from != &to) {
+            from.creatures.erase(std::find(from.creatures.begin(), from.creatures.end(), &creature));
+            to.creatures.push_back(&creature);
+        }
+        creature.x = x;
+        creature.y = y;
+    }
+
+    std::vector<Sector> sectors;
+    std::vector<Creature> creatures;
+};
+
+uint64_t getCacheKey(int32_t x, int32_t y)
+{
+    return (static_cast<uint64_t>(7) << 32) | (static_cast<uint64_t>(y) << 16) | static_cast<uint64_t>(x);
+}
+
+// before: any creature entering or leaving a tile dropped every cached entry
+class ClearingCache
+{
+public:
+    bool getSpectators(World& world, SpectatorVector& spectators, int32_t x, int32_t y) {
+        const uint64_t key = getCacheKey(x, y);
+        const auto it = cache.find(key);
+        if (it != cache.end()) {
+            spectators = it->second;
+            return true;
+        }
+
+        world.collect(spectators, x, y, nullptr);
+        cache[key] = spectators;
+        return false;
+    }
+
+    void onMove() {
+        cache.clear();
+    }
+
+private:
+    std::map<uint64_t, SpectatorVector> cache;
+};
+
+// after: entries are checked against the generations of the sectors they were collected from
+class SectorCache
+{
+public:
+    bool getSpectators(World& world, SpectatorVector& spectators, int32_t x, int32_t y) {
+        const uint64_t key = getCacheKey(x, y);
+        const auto it = cache.find(key);
+        if (it != cache.end() && isValid(it->second)) {
+            spectators = it->second.spectators;
+            return true;
+        }
+
+        if (cache.size() >= SPECTATOR_CACHE_MAX_ENTRIES) {
+            cache.clear();
+        }
+
+        SpectatorCacheEntry& cacheEntry = cache[key];
+        cacheEntry.spectators.clear();
+        cacheEntry.sectorCount = 0;
+        world.collect(cacheEntry.spectators, x, y, &cacheEntry);
+        spectators = cacheEntry.spectators;
+        if (cacheEntry.sectorCount > SPECTATOR_CACHE_MAX_SECTORS) {
+            cache.erase(key);
+        }
+        return false;
+    }
+
+    void onMove() {}
+
+private:
+    static bool isValid(const SpectatorCacheEntry& cacheEntry) {
+        for (uint32_t i = 0; i < cacheEntry.sectorCount; ++i) {
+            const auto& it = cacheEntry.sectors[i];
+            if (it.second != it.first->creatureGeneration) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::unordered_map<uint64_t, SpectatorCacheEntry> cache;
+};
+
+struct Result
+{
+    uint64_t queries = 0;
+    uint64_t hits = 0;
+    uint64_t spectators = 0;
+    double seconds = 0;
+};
+
+template <typename Cache>
+Result run(size_t creatureCount, uint32_t ticks, int32_t walkingPercent)
+{
+    World world(creatureCount, 1);
+    Cache cache;
+    Result result;
+
+    std::mt19937 rng(2);
+    std::uniform_int_distribution<int32_t> chance(0, 99);
+    std::uniform_int_distribution<int32_t> step(-1, 1);
+
+    SpectatorVector spectators;
+    auto query = [&](int32_t x, int32_t y) {
+        spectators.clear();
+        result.hits += cache.getSpectators(world, spectators, x, y);
+        result.spectators += spectators.size();
+        ++result.queries;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t tick = 0; tick < ticks; ++tick) {
+        for (Creature& creature : world.creatures) {
+            query(creature.x, creature.y);
+            if (chance(rng) >= walkingPercent) {
+                continue;
+            }
+
+            const int32_t x = creature.x + step(rng);
+            const int32_t y = creature.y + step(rng);
+            if (std::abs(x - creature.spawnX) > SPAWN_RADIUS || std::abs(y - creature.spawnY) > SPAWN_RADIUS) {
+                continue;
+            }
+
+            query(creature.x, creature.y);
+            world.move(creature, x, y);
+            cache.onMove();
+            query(x, y);
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void print(const char* name, const Result& result)
+{
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed
+        << std::setw(10) << std::setprecision(1) << (100.0 * result.hits / result.queries) << '%'
+        << std::setw(14) << std::setprecision(1) << (result.seconds * 1e9 / result.queries)
+        << std::setw(14) << std::setprecision(3) << result.seconds
+        << std::setw(14) << std::setprecision(1) << (static_cast<double>(result.spectators) / result.queries) << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t creatures = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000);
+    const uint32_t ticks = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200);
+
+    std::cout << creatures << " creatures, " << ticks << " ticks" << std::endl;
+    for (const int32_t walkingPercent : {5, 25, 50}) {
+        const Result before = run<ClearingCache>(creatures, ticks, walkingPercent);
+        const Result after = run<SectorCache>(creatures, ticks, walkingPercent);
+        if (before.spectators != after.spectators) {
+            std::cout << "cached spectators differ between the two caches" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << std::endl << walkingPercent << "% walking per tick, " << before.queries << " queries" << std::endl;
+        std::cout << std::left << std::setw(20) << "cache" << std::right
+            << std::setw(11) << "hit rate" << std::setw(14) << "ns/query" << std::setw(14) << "total s" << std::setw(14) << "spectators" << std::endl;
+        print("clear on move", before);
+        print("sector generations", after);
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,279 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Game::internalCreatureSay in a mass PvP fight, every player casting a spell whose words
+// every other player sees. Each round every player speaks once to all the spectators.
+//
+// per spectator: ProtocolGame::sendCreatureSay, the packet is encoded into playermsg for
+// every spectator and copied into its output buffer.
+// fragment: ProtocolGame::encodeCreatureSay encodes it once into a PacketFragment and
+// ProtocolGame::sendBroadcast copies that into every output buffer.
+//
+// Output buffers are NETWORKMESSAGE_MAXSIZE like OutputMessage and get handed off when
+// full, the way Protocol::getOutputBuffer does. "encoded" counts the bytes written by
+// AddCreatureSay, "delivered" the bytes that ended up in output buffers.
+//
+// usage: bench_speech_broadcast [rounds = 200] [spectators = 50 200 500 ...]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+// CLIENT_VERSION 1098
+constexpr int32_t NETWORKMESSAGE_MAXSIZE = 65500;
+constexpr int32_t INITIAL_BUFFER_POSITION = 8;
+constexpr int32_t MAX_BODY_LENGTH = NETWORKMESSAGE_MAXSIZE - 2 - 4 - 8;
+constexpr int32_t MAX_PROTOCOL_BODY_LENGTH = MAX_BODY_LENGTH - 8;
+constexpr uint8_t TALKTYPE_MONSTER_SAY = 0x24;
+
+struct Position
+{
+    uint16_t x;
+    uint16_t y;
+    uint8_t z;
+};
+
+class NetworkMessage
+{
+public:
+    void reset() {
+        position = INITIAL_BUFFER_POSITION;
+        length = 0;
+    }
+
+    template<typename T>
+    void add(T value) {
+        if (!canAdd(sizeof(T))) {
+            return;
+        }
+
+        memcpy(buffer + position, &value, sizeof(T));
+        position += sizeof(T);
+        length += sizeof(T);
+    }
+
+    void addByte(uint8_t value) {
+        add<uint8_t>(value);
+    }
+
+    void addString(const std::string& value) {
+        const size_t stringLen = value.length();
+        if (!canAdd(stringLen + 2)) {
+            return;
+        }
+
+        add<uint16_t>(static_cast<uint16_t>(stringLen));
+        memcpy(buffer + position, value.c_str(), stringLen);
+        position += static_cast<int32_t>(stringLen);
+        length += static_cast<int32_t>(stringLen);
+    }
+
+    void addPosition(const Position& pos) {
+        add<uint16_t>(pos.x);
+        add<uint16_t>(pos.y);
+        addByte(pos.z);
+    }
+
+    void append(const uint8_t* bytes, int32_t size) {
+        memcpy(buffer + position, bytes, size);
+        position += size;
+        length += size;
+    }
+
+    const uint8_t* getBody() const {
+        return buffer + INITIAL_BUFFER_POSITION;
+    }
+
+    int32_t getLength() const {
+        return length;
+    }
+
+private:
+    bool canAdd(size_t size) const {
+        return size + position < MAX_BODY_LENGTH;
+    }
+
+    int32_t position = INITIAL_BUFFER_POSITION;
+    int32_t length = 0;
+    uint8_t buffer[NETWORKMESSAGE_MAXSIZE];
+};
+
+class PacketFragment
+{
+public:
+    explicit PacketFragment(const NetworkMessage& msg) : data(msg.getBody(), msg.getBody() + msg.getLength()) {}
+
+    const uint8_t* getBuffer() const {
+        return data.data();
+    }
+
+    int32_t getLength() const {
+        return static_cast<int32_t>(data.size());
+    }
+
+private:
+    std::vector<uint8_t> data;
+};
+
+struct Speaker
+{
+    std::string name;
+    std::string words;
+    uint16_t level;
+    Position position;
+};
+
+struct Counters
+{
+    uint64_t encoded = 0;
+    uint64_t delivered = 0;
+    uint64_t handedOff = 0;
+};
+
+NetworkMessage playermsg;
+
+// ProtocolGame::AddCreatureSay with GAME_FEATURE_MESSAGE_STATEMENT and GAME_FEATURE_MESSAGE_LEVEL
+void addCreatureSay(const Speaker& speaker, Counters& counters)
+{
+    static uint32_t statementId = 0;
+    const int32_t before = playermsg.getLength();
+    playermsg.addByte(0xAA);
+    playermsg.add<uint32_t>(++statementId);
+    playermsg.addString(speaker.name);
+    playermsg.add<uint16_t>(speaker.level);
+    playermsg.addByte(TALKTYPE_MONSTER_SAY);
+    playermsg.addPosition(speaker.position);
+    playermsg.addString(speaker.words);
+    counters.encoded += playermsg.getLength() - before;
+}
+
+class Spectator
+{
+public:
+    Spectator() : outputBuffer(new NetworkMessage) {
+        outputBuffer->reset();
+    }
+
+    // ProtocolGame::writeToOutputBuffer through Protocol::getOutputBuffer
+    void write(const uint8_t* bytes, int32_t size, Counters& counters) {
+        if (outputBuffer->getLength() + size > MAX_PROTOCOL_BODY_LENGTH) {
+            outputBuffer->reset();
+            ++counters.handedOff;
+        }
+        outputBuffer->append(bytes, size);
+        counters.delivered += size;
+    }
+
+private:
+    std::unique_ptr<NetworkMessage> outputBuffer;
+};
+
+struct Result
+{
+    double seconds = 0;
+    Counters counters;
+};
+
+template <bool fragment>
+Result run(const std::vector<Speaker>& speakers, size_t rounds)
+{
+    std::vector<Spectator> spectators(speakers.size());
+    Result result;
+    Counters& counters = result.counters;
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (const Speaker& speaker : speakers) {
+            if (fragment) {
+                playermsg.reset();
+                addCreatureSay(speaker, counters);
+                const auto encoded = std::make_shared<const PacketFragment>(playermsg);
+                for (Spectator& spectator : spectators) {
+                    spectator.write(encoded->getBuffer(), encoded->getLength(), counters);
+                }
+            } else {
+                for (Spectator& spectator : spectators) {
+                    playermsg.reset();
+                    addCreatureSay(speaker, counters);
+                    spectator.write(playermsg.getBody(), playermsg.getLength(), counters);
+                }
+            }
+        }
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+void print(const char* name, const Result& result, size_t broadcasts)
+{
+    std::cout << std::left << std::setw(14) << name << std::right << std::fixed
+        << std::setw(12) << std::setprecision(1) << (result.seconds * 1e9 / broadcasts)
+        << std::setw(14) << std::setprecision(1) << (static_cast<double>(result.counters.encoded) / broadcasts)
+        << std::setw(14) << std::setprecision(1) << (result.counters.encoded / result.seconds / 1e6)
+        << std::setw(14) << std::setprecision(1) << (result.counters.delivered / result.seconds / 1e6)
+        << std::setw(10) << result.counters.handedOff << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t rounds = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200);
+    std::vector<size_t> spectatorCounts;
+    for (int i = 2; i < argc; ++i) {
+        spectatorCounts.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (spectatorCounts.empty()) {
+        spectatorCounts = {50, 200, 500};
+    }
+
+    const std::vector<std::string> spells = {"exura vita", "exori gran", "exevo gran mas vis", "utani hur", "exevo mas san", "utamo vita"};
+    for (const size_t spectatorCount : spectatorCounts) {
+        // everybody fighting sees everybody else
+        std::vector<Speaker> speakers;
+        for (size_t i = 0; i < spectatorCount; ++i) {
+            speakers.push_back(Speaker{"Player Number " + std::to_string(i), spells[i % spells.size()],
+                static_cast<uint16_t>(100 + i % 400), Position{static_cast<uint16_t>(1000 + i % 18), static_cast<uint16_t>(1000 + i % 14), 7}});
+        }
+
+        const size_t broadcasts = rounds * speakers.size();
+        const Result perSpectator = run<false>(speakers, rounds);
+        const Result fragment = run<true>(speakers, rounds);
+        if (perSpectator.counters.delivered != fragment.counters.delivered) {
+            std::cout << "the broadcasts delivered different amounts" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << spectatorCount << " players speaking to each other, " << rounds << " rounds" << std::endl;
+        std::cout << std::left << std::setw(14) << "encoding" << std::right
+            << std::setw(12) << "ns/bcast" << std::setw(14) << "encoded/bcast" << std::setw(14) << "encoded MB/s"
+            << std::setw(14) << "deliver MB/s" << std::setw(10) << "handoffs" << std::endl;
+        print("per spectator", perSpectator, broadcasts);
+        print("fragment", fragment, broadcasts);
+        std::cout << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
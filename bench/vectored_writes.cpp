@@ -0,0 +1,251 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// Loopback flood of small messages from one producer thread, standing in for the
+// dispatcher, to clients that only read. Connection::send queues the messages on the
+// connection's strand and Connection::internalSend writes them either one at a time,
+// as it used to, or up to CONNECTION_SEND_BATCH_SIZE of them in one vectored write.
+// The writes are counted per write_some call, which is one sendmsg each.
+//
+// usage: bench_vectored_writes [clients = 200] [messages per client = 10000] [message bytes = 40]
+
+#include <asio.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr size_t CONNECTION_SEND_QUEUE_SIZE = 512;
+constexpr size_t CONNECTION_SEND_BATCH_SIZE = 64;
+// messages the producer sends to a client before moving on to the next one, like one dispatcher cycle
+constexpr size_t MESSAGES_PER_BURST = 8;
+
+using Message = std::shared_ptr<const std::vector<uint8_t>>;
+
+std::atomic<uint64_t> writes{0};
+
+class Connection : public std::enable_shared_from_this<Connection>
+{
+public:
+    Connection(asio::io_context& io_context, bool vectored) : socket(io_context), strand(io_context.get_executor()), vectored(vectored) {}
+
+    // any thread, returns false while the queue has no room
+    bool send(const Message& msg) {
+        if (queued.load(std::memory_order_relaxed) >= CONNECTION_SEND_QUEUE_SIZE - MESSAGES_PER_BURST) {
+            return false;
+        }
+
+        queued.fetch_add(1, std::memory_order_relaxed);
+        asio::dispatch(strand, [self = shared_from_this(), msg] {
+            self->messageQueue[(self->messageQueueHead + self->messageQueueSize) & (CONNECTION_SEND_QUEUE_SIZE - 1)] = msg;
+            if (++self->messageQueueSize == 1) {
+                self->internalSend();
+            }
+        });
+        return true;
+    }
+
+    asio::ip::tcp::socket socket;
+
+private:
+    void internalSend() {
+        writeBatchSize = (vectored ? std::min<size_t>(messageQueueSize, CONNECTION_SEND_BATCH_SIZE) : 1);
+        writeBuffers.clear();
+        for (size_t i = 0; i < writeBatchSize; ++i) {
+            const Message& msg = messageQueue[(messageQueueHead + i) & (CONNECTION_SEND_QUEUE_SIZE - 1)];
+            writeBuffers.emplace_back(msg->data(), msg->size());
+        }
+        writeSome();
+    }
+
+    // asio::async_write, spelled out to count the write_some calls
+    void writeSome() {
+        ++writeCalls;
+        socket.async_write_some(writeBuffers, asio::bind_executor(strand, [self = shared_from_this()](const auto& error, size_t bytes) {
+            if (error) {
+                return;
+            }
+
+            auto& buffers = self->writeBuffers;
+            size_t consumed = 0;
+            while (consumed < buffers.size() && bytes >= buffers[consumed].size()) {
+                bytes -= buffers[consumed].size();
+                ++consumed;
+            }
+            buffers.erase(buffers.begin(), buffers.begin() + consumed);
+            if (!buffers.empty()) {
+                buffers.front() += bytes;
+                self->writeSome();
+                return;
+            }
+            self->onWriteOperation();
+        }));
+    }
+
+    void onWriteOperation() {
+        for (size_t i = 0; i < writeBatchSize; ++i) {
+            messageQueue[messageQueueHead].reset();
+            messageQueueHead = (messageQueueHead + 1) & (CONNECTION_SEND_QUEUE_SIZE - 1);
+        }
+        messageQueueSize -= writeBatchSize;
+        queued.fetch_sub(writeBatchSize, std::memory_order_relaxed);
+        writes.fetch_add(writeCalls, std::memory_order_relaxed);
+        writeCalls = 0;
+
+        if (messageQueueSize != 0) {
+            internalSend();
+        }
+    }
+
+    asio::strand<asio::io_context::executor_type> strand;
+    std::array<Message, CONNECTION_SEND_QUEUE_SIZE> messageQueue;
+    std::vector<asio::const_buffer> writeBuffers;
+    std::atomic<size_t> queued{0};
+    size_t messageQueueHead = 0;
+    size_t messageQueueSize = 0;
+    size_t writeBatchSize = 0;
+    uint64_t writeCalls = 0;
+    const bool vectored;
+};
+
+class Reader : public std::enable_shared_from_this<Reader>
+{
+public:
+    Reader(asio::io_context& io_context, size_t expected, std::atomic<size_t>& finished) : socket(io_context), expected(expected), finished(finished) {}
+
+    void start() {
+        socket.async_read_some(asio::buffer(buffer), [self = shared_from_this()](const auto& error, size_t bytes) {
+            if (error) {
+                return;
+            }
+
+            self->received += bytes;
+            if (self->received >= self->expected) {
+                self->finished.fetch_add(1);
+                return;
+            }
+            self->start();
+        });
+    }
+
+    asio::ip::tcp::socket socket;
+
+private:
+    std::array<uint8_t, 65536> buffer;
+    size_t received = 0;
+    const size_t expected;
+    std::atomic<size_t>& finished;
+};
+
+struct Result
+{
+    double seconds;
+    uint64_t writes;
+};
+
+Result run(size_t clientCount, size_t messageCount, size_t messageLength, bool vectored)
+{
+    asio::io_context serverService(1);
+    asio::io_context clientService(1);
+    asio::ip::tcp::acceptor acceptor(serverService, asio::ip::tcp::endpoint(asio::ip::address_v4::loopback(), 0));
+
+    std::atomic<size_t> finished{0};
+    std::vector<std::shared_ptr<Connection>> connections;
+    std::vector<std::shared_ptr<Reader>> readers;
+    for (size_t i = 0; i < clientCount; ++i) {
+        auto reader = std::make_shared<Reader>(clientService, messageCount * messageLength, finished);
+        reader->socket.connect(acceptor.local_endpoint());
+        auto connection = std::make_shared<Connection>(serverService, vectored);
+        acceptor.accept(connection->socket);
+        connection->socket.set_option(asio::ip::tcp::no_delay(true));
+        reader->start();
+        readers.push_back(std::move(reader));
+        connections.push_back(std::move(connection));
+    }
+
+    auto serverWork = asio::make_work_guard(serverService);
+    std::thread serverThread([&serverService] { serverService.run(); });
+    std::thread clientThread([&clientService] { clientService.run(); });
+
+    writes = 0;
+    const Message msg = std::make_shared<const std::vector<uint8_t>>(messageLength, 0x5A);
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<size_t> sent(clientCount, 0);
+    size_t done = 0;
+    while (done < clientCount) {
+        bool queued = false;
+        for (size_t i = 0; i < clientCount; ++i) {
+            for (size_t burst = 0; burst < MESSAGES_PER_BURST && sent[i] < messageCount && connections[i]->send(msg); ++burst) {
+                queued = true;
+                if (++sent[i] == messageCount) {
+                    ++done;
+                }
+            }
+        }
+
+        if (!queued) {
+            // every queue is full, leave the core to the network threads
+            std::this_thread::yield();
+        }
+    }
+    clientThread.join();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // the last write handlers may still be running, the service returns once they are done
+    serverWork.reset();
+    serverThread.join();
+    return {seconds, writes.load()};
+}
+
+void print(const char* name, const Result& result, size_t totalMessages, size_t messageLength)
+{
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed
+        << std::setw(12) << std::setprecision(3) << result.seconds
+        << std::setw(14) << std::setprecision(0) << (totalMessages / result.seconds)
+        << std::setw(10) << std::setprecision(1) << (totalMessages * messageLength / result.seconds / (1024 * 1024))
+        << std::setw(12) << result.writes
+        << std::setw(14) << std::setprecision(1) << (static_cast<double>(totalMessages) / result.writes) << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t clientCount = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200);
+    const size_t messageCount = (argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10000);
+    const size_t messageLength = (argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 40);
+    const size_t totalMessages = clientCount * messageCount;
+
+    std::cout << clientCount << " clients, " << messageCount << " messages of " << messageLength << " bytes each" << std::endl;
+    std::cout << std::left << std::setw(20) << "writes" << std::right
+        << std::setw(12) << "seconds" << std::setw(14) << "messages/s" << std::setw(10) << "MB/s"
+        << std::setw(12) << "sendmsg" << std::setw(14) << "msgs/sendmsg" << std::endl;
+    print("one per message", run(clientCount, messageCount, messageLength, false), totalMessages, messageLength);
+    print("vectored", run(clientCount, messageCount, messageLength, true), totalMessages, messageLength);
+    return EXIT_SUCCESS;
+}
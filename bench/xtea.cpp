@@ -0,0 +1,312 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// XTEA encryption of outgoing messages from 16 bytes to 64 KB, one session per message:
+// - schedule per call: round keys derived on every message, as Protocol::XTEA_encrypt used to
+// - cached schedule: round keys derived once per session in Protocol::setXTEAKey
+// - batched: messages encrypted together by Protocol::XTEA_encryptBatch, one message per SSE2
+//   lane; shown up to 64 bytes, the server only batches messages of up to 24 bytes since the
+//   per message vector paths are faster from 32 bytes on
+//
+// The server batches the messages one connection writes together in Connection::internalSend,
+// the second table has 1 to 8 short messages per write to find how many it takes to pay off.
+// Lanes load their round keys the same way whether the messages share a session or not.
+//
+// The per message encryptor is the SSE2 path of Protocol::XTEA_encrypt. AVX2 and AVX-512
+// builds of the server run wider loops over long messages, which the change left alone.
+//
+// usage: bench_xtea [sessions = 64]
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// the batched column is left out from this size on
+constexpr size_t BATCH_COLUMN_MAX_LENGTH = 128;
+// every size is encrypted this many bytes over, split among the sessions
+constexpr size_t BYTES_PER_SIZE = 64 * 1024 * 1024;
+
+using XTEASchedule = uint32_t[32][2];
+
+void makeSchedule(const uint32_t* key, XTEASchedule& schedule)
+{
+    const uint32_t delta = 0x61C88647;
+
+    uint32_t sum = 0;
+    for (auto& i : schedule) {
+        i[0] = sum + key[sum & 3];
+        sum -= delta;
+        i[1] = sum + key[sum >> 11 & 3];
+    }
+}
+
+void encrypt(uint8_t* buffer, size_t length, const XTEASchedule& precachedControlSum)
+{
+    int32_t messageLength = static_cast<int32_t>(length);
+    int32_t readPos = 0;
+#if defined(__SSE2__)
+    messageLength -= 64;
+    while (readPos <= messageLength) {
+        const __m128i data0 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + readPos)), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i data1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + readPos + 16)), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i data3 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + readPos + 32)), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i data4 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + readPos + 48)), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i vdata0 = _mm_unpacklo_epi64(data0, data1);
+        __m128i vdata1 = _mm_unpackhi_epi64(data0, data1);
+        __m128i vdata3 = _mm_unpacklo_epi64(data3, data4);
+        __m128i vdata4 = _mm_unpackhi_epi64(data3, data4);
+        for (int32_t i = 0; i < 32; ++i) {
+            vdata0 = _mm_add_epi32(vdata0, _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(vdata1, 4), _mm_srli_epi32(vdata1, 5)), vdata1), _mm_set1_epi32(precachedControlSum[i][0])));
+            vdata1 = _mm_add_epi32(vdata1, _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(vdata0, 4), _mm_srli_epi32(vdata0, 5)), vdata0), _mm_set1_epi32(precachedControlSum[i][1])));
+            vdata3 = _mm_add_epi32(vdata3, _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(vdata4, 4), _mm_srli_epi32(vdata4, 5)), vdata4), _mm_set1_epi32(precachedControlSum[i][0])));
+            vdata4 = _mm_add_epi32(vdata4, _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(vdata3, 4), _mm_srli_epi32(vdata3, 5)), vdata3), _mm_set1_epi32(precachedControlSum[i][1])));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer + readPos), _mm_unpacklo_epi32(vdata0, vdata1));
+        readPos += 16;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer + readPos), _mm_unpackhi_epi32(vdata0, vdata1));
+        readPos += 16;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer + readPos), _mm_unpacklo_epi32(vdata3, vdata4));
+        readPos += 16;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer + readPos), _mm_unpackhi_epi32(vdata3, vdata4));
+        readPos += 16;
+    }
+    messageLength += 32;
+
+    if (readPos <= messageLength) {
+        const __m128i data0 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + readPos)), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i data1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(buffer + readPos + 16)), _MM_SHUFFLE(3, 1, 2, 0));
+        __m128i vdata0 = _mm_unpacklo_epi64(data0, data1);
+        __m128i vdata1 = _mm_unpackhi_epi64(data0, data1);
+        for (auto& i : precachedControlSum) {
+            vdata0 = _mm_add_epi32(vdata0, _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(vdata1, 4), _mm_srli_epi32(vdata1, 5)), vdata1), _mm_set1_epi32(i[0])));
+            vdata1 = _mm_add_epi32(vdata1, _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(vdata0, 4), _mm_srli_epi32(vdata0, 5)), vdata0), _mm_set1_epi32(i[1])));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer + readPos), _mm_unpacklo_epi32(vdata0, vdata1));
+        readPos += 16;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer + readPos), _mm_unpackhi_epi32(vdata0, vdata1));
+        readPos += 16;
+    }
+    messageLength += 32;
+#endif
+    while (readPos < messageLength) {
+        uint32_t vData[2];
+        memcpy(vData, buffer + readPos, 8);
+        for (auto& i : precachedControlSum) {
+            vData[0] += ((vData[1] << 4 ^ vData[1] >> 5) + vData[1]) ^ i[0];
+            vData[1] += ((vData[0] << 4 ^ vData[0] >> 5) + vData[0]) ^ i[1];
+        }
+        memcpy(buffer + readPos, vData, 8);
+        readPos += 8;
+    }
+}
+
+struct Session
+{
+    uint32_t key[4];
+    XTEASchedule schedule;
+    std::vector<uint8_t> message;
+};
+
+// Protocol::XTEA_encryptBatch without the message bookkeeping
+void encryptBatch(std::vector<Session>& sessions)
+{
+#if defined(__SSE2__)
+    struct XTEALane
+    {
+        uint8_t* buffer;
+        size_t blocks;
+    };
+
+    alignas(16) uint32_t schedule[32][2][4];
+    uint8_t scratch[8] = {};
+    XTEALane lanes[4];
+    size_t nextStream = 0;
+    int32_t activeLanes = 0;
+
+    auto refillLane = [&](const size_t lane) {
+        if (nextStream == sessions.size()) {
+            lanes[lane] = { scratch, 0 };
+            return;
+        }
+
+        Session& session = sessions[nextStream++];
+        lanes[lane] = { session.message.data(), session.message.size() / 8 };
+        for (size_t i = 0; i < 32; ++i) {
+            schedule[i][0][lane] = session.schedule[i][0];
+            schedule[i][1][lane] = session.schedule[i][1];
+        }
+        ++activeLanes;
+    };
+
+    for (size_t lane = 0; lane < 4; ++lane) {
+        refillLane(lane);
+    }
+
+    while (activeLanes > 0) {
+        alignas(16) uint32_t data0[4];
+        alignas(16) uint32_t data1[4];
+        for (size_t lane = 0; lane < 4; ++lane) {
+            memcpy(&data0[lane], lanes[lane].buffer, 4);
+            memcpy(&data1[lane], lanes[lane].buffer + 4, 4);
+        }
+
+        __m128i vdata0 = _mm_load_si128(reinterpret_cast<const __m128i*>(data0));
+        __m128i vdata1 = _mm_load_si128(reinterpret_cast<const __m128i*>(data1));
+        for (auto& i : schedule) {
+            vdata0 = _mm_add_epi32(vdata0, _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(vdata1, 4), _mm_srli_epi32(vdata1, 5)), vdata1), _mm_load_si128(reinterpret_cast<const __m128i*>(i[0]))));
+            vdata1 = _mm_add_epi32(vdata1, _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(vdata0, 4), _mm_srli_epi32(vdata0, 5)), vdata0), _mm_load_si128(reinterpret_cast<const __m128i*>(i[1]))));
+        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(data0), vdata0);
+        _mm_store_si128(reinterpret_cast<__m128i*>(data1), vdata1);
+
+        for (size_t lane = 0; lane < 4; ++lane) {
+            XTEALane& current = lanes[lane];
+            if (current.blocks == 0) {
+                continue;
+            }
+
+            memcpy(current.buffer, &data0[lane], 4);
+            memcpy(current.buffer + 4, &data1[lane], 4);
+            current.buffer += 8;
+            if (--current.blocks == 0) {
+                --activeLanes;
+                refillLane(lane);
+            }
+        }
+    }
+#else
+    for (Session& session : sessions) {
+        encrypt(session.message.data(), session.message.size(), session.schedule);
+    }
+#endif
+}
+
+std::vector<Session> makeSessions(size_t count, size_t length)
+{
+    std::mt19937 rng(1);
+    std::vector<Session> sessions(count);
+    for (Session& session : sessions) {
+        for (uint32_t& k : session.key) {
+            k = rng();
+        }
+        makeSchedule(session.key, session.schedule);
+        session.message.resize(length);
+        for (uint8_t& byte : session.message) {
+            byte = static_cast<uint8_t>(rng());
+        }
+    }
+    return sessions;
+}
+
+template <typename Encrypt>
+double measure(std::vector<Session>& sessions, size_t rounds, Encrypt encryptAll)
+{
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        encryptAll(sessions);
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / (rounds * sessions.size());
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const size_t sessionCount = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64);
+
+    std::cout << sessionCount << " sessions, ns per message and MB/s" << std::endl;
+    std::cout << std::setw(8) << "bytes"
+        << std::setw(22) << "schedule per call" << std::setw(22) << "cached schedule" << std::setw(22) << "batched" << std::endl;
+
+    for (size_t length = 16; length <= 64 * 1024; length *= 2) {
+        const size_t rounds = std::max<size_t>(1, BYTES_PER_SIZE / (length * sessionCount));
+
+        auto perCall = makeSessions(sessionCount, length);
+        const double perCallTime = measure(perCall, rounds, [length](std::vector<Session>& sessions) {
+            for (Session& session : sessions) {
+                XTEASchedule schedule;
+                makeSchedule(session.key, schedule);
+                encrypt(session.message.data(), length, schedule);
+            }
+        });
+
+        auto cached = makeSessions(sessionCount, length);
+        const double cachedTime = measure(cached, rounds, [length](std::vector<Session>& sessions) {
+            for (Session& session : sessions) {
+                encrypt(session.message.data(), length, session.schedule);
+            }
+        });
+
+        std::cout << std::setw(8) << length << std::fixed << std::setprecision(1)
+            << std::setw(12) << perCallTime << std::setw(10) << (length * 1e3 / perCallTime)
+            << std::setw(12) << cachedTime << std::setw(10) << (length * 1e3 / cachedTime);
+
+        if (length < BATCH_COLUMN_MAX_LENGTH) {
+            auto batched = makeSessions(sessionCount, length);
+            const double batchedTime = measure(batched, rounds, encryptBatch);
+            for (size_t i = 0; i < sessionCount; ++i) {
+                if (batched[i].message != cached[i].message) {
+                    std::cout << std::endl << "batched ciphertext differs from the per message one" << std::endl;
+                    return EXIT_FAILURE;
+                }
+            }
+            std::cout << std::setw(12) << batchedTime << std::setw(10) << (length * 1e3 / batchedTime);
+        }
+        std::cout << std::endl;
+    }
+
+    const std::vector<size_t> writeSizes = {1, 2, 3, 4, 8};
+    std::cout << std::endl << "short messages written together, ns per message cached / batched" << std::endl;
+    std::cout << std::setw(8) << "bytes";
+    for (const size_t messages : writeSizes) {
+        std::cout << std::setw(13) << messages;
+    }
+    std::cout << std::endl;
+
+    for (size_t length = 8; length <= 24; length += 8) {
+        std::cout << std::setw(8) << length << std::fixed << std::setprecision(0);
+        for (const size_t messages : writeSizes) {
+            const size_t rounds = BYTES_PER_SIZE / (64 * messages);
+            auto cached = makeSessions(messages, length);
+            const double cachedTime = measure(cached, rounds, [length](std::vector<Session>& sessions) {
+                for (Session& session : sessions) {
+                    encrypt(session.message.data(), length, session.schedule);
+                }
+            });
+
+            auto batched = makeSessions(messages, length);
+            const double batchedTime = measure(batched, rounds, encryptBatch);
+            std::cout << std::setw(7) << cachedTime << " /" << std::setw(4) << batchedTime;
+        }
+        std::cout << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -15,11 +15,13 @@ expFromPlayersLevelRange = 75
 
 -- Connection Config
 -- NOTE: maxPlayers set to 0 means no limit
+-- NOTE: networkThreads set to 0 means one thread per cpu core
 ip = '127.0.0.1'
 bindOnlyGlobalAddress = false
 loginProtocolPort = 7171
 gameProtocolPort = 7172
 statusProtocolPort = 7171
+networkThreads = 1
 maxPlayers = 0
 motd = 'Welcome to The Forgotten Server!'
 onePlayerOnlinePerAccount = true
@@ -34,6 +36,15 @@ maxPacketsPerSecond = 25
 -- levels: 0(off), 1(best speed) - 9(best compression)
 packetCompressionLevel = 6
 
+-- Pathfinding
+-- NOTE: pathfindingMaxNodes is how many tiles a single path search may look at,
+-- pathfindingMaxClosedNodes is how many of them it expands before giving up on
+-- searches without a distance limit, playerPathfindingMaxClosedNodes is the same
+-- limit for player auto walk
+pathfindingMaxNodes = 4096
+pathfindingMaxClosedNodes = 100
+playerPathfindingMaxClosedNodes = 1000
+
 -- Party List limitations
 -- max distance in which players in party list are visible
 -- NOTE partyListMaxDistance set to 0 means no limit
@@ -66,17 +77,23 @@ checkExpiredMarketOffersEachMinutes = 60
 maxMarketOffersAtATimePerPlayer = 100
 
 -- MySQL
+-- NOTE: databaseThreads is the number of connections background queries are spread over
 mysqlHost = '127.0.0.1'
 mysqlUser = 'root'
 mysqlPass = ''
 mysqlDatabase = 'forgottenserver-optimized'
 mysqlPort = 3306
 mysqlSock = ''
+databaseThreads = 4
 
 -- Misc.
 -- NOTE: classicAttackSpeed set to true makes players constantly attack at regular
 -- intervals regardless of other actions such as item (potion) use. This setting
 -- may cause high CPU usage with many players and potentially affect performance!
+-- NOTE: monsterFlowFields set to true makes melee monsters of the same type chasing
+-- the same target share one precomputed path field instead of searching a path each.
+-- NOTE: monsterHibernation set to true stops monsters from thinking while no player
+-- is in or near their map region, they are woken together once one gets close.
 -- forceMonsterTypesOnLoad server loads all monster types on startup for debugging purposes, you can change to false if all of your monster files don't throw errors to save up memory.
 allowChangeOutfit = true
 freePremium = false
@@ -90,6 +107,8 @@ showOnlineStatusInCharlist = false
 yellMinimumLevel = 2
 yellAlwaysAllowPremium = false
 forceMonsterTypesOnLoad = true
+monsterFlowFields = false
+monsterHibernation = false
 
 -- Server Save
 -- NOTE: serverSaveNotifyDuration in minutes
@@ -64,7 +64,7 @@ bool IOBan::isAccountBanned(const uint32_t accountId, BanInfo& banInfo)
     std::stringExtended query(256);
     query << "SELECT `reason`, `expires_at`, `banned_at`, `banned_by`, (SELECT `name` FROM `players` WHERE `id` = `banned_by`) AS `name` FROM `account_bans` WHERE `account_id` = " << accountId << " LIMIT 1";
 
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return false;
     }
@@ -73,7 +73,7 @@ bool IOBan::isAccountBanned(const uint32_t accountId, BanInfo& banInfo)
     if (expiresAt != 0 && time(nullptr) > expiresAt) {
         // Move the ban to history if it has expired
         query.clear();
-        query << "INSERT INTO `account_ban_history` (`account_id`, `reason`, `banned_at`, `expired_at`, `banned_by`) VALUES (" << accountId << ',' << g_database.escapeString(result->getString("reason")) << ',' << result->getNumber<time_t>("banned_at") << ',' << expiresAt << ',' << result->getNumber<uint32_t>("banned_by") << ')';
+        query << "INSERT INTO `account_ban_history` (`account_id`, `reason`, `banned_at`, `expired_at`, `banned_by`) VALUES (" << accountId << ',' << Database::getInstance().escapeString(result->getString("reason")) << ',' << result->getNumber<time_t>("banned_at") << ',' << expiresAt << ',' << result->getNumber<uint32_t>("banned_by") << ')';
         g_databaseTasks.addTask(query);
 
         query.clear();
@@ -97,7 +97,7 @@ bool IOBan::isIpBanned(const uint32_t clientIP, BanInfo& banInfo)
     std::stringExtended query(140);
     query << "SELECT `reason`, `expires_at`, (SELECT `name` FROM `players` WHERE `id` = `banned_by`) AS `name` FROM `ip_bans` WHERE `ip` = " << clientIP << " LIMIT 1";
 
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return false;
     }
@@ -120,16 +120,16 @@ bool IOBan::isPlayerNamelocked(const uint32_t playerId)
 {
     std::stringExtended query(128);
     query << "SELECT 1 FROM `player_namelocks` WHERE `player_id` = " << playerId << " LIMIT 1";
-    return g_database.storeQuery(query).get() != nullptr;
+    return Database::getInstance().storeQuery(query).get() != nullptr;
 }
 
 uint32_t IOBan::getAccountID(const std::string& playerName)
 {
-    const std::string& escapedName = g_database.escapeString(playerName);
+    const std::string& escapedName = Database::getInstance().escapeString(playerName);
     std::stringExtended query(escapedName.length() + 64);
     query << "SELECT `account_id` FROM `players` WHERE `name` = " << escapedName << " LIMIT 1";
 
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return 0;
     }
@@ -138,11 +138,11 @@ uint32_t IOBan::getAccountID(const std::string& playerName)
 
 uint32_t IOBan::getAccountLastIP(const std::string& playerName)
 {
-    const std::string& escapedName = g_database.escapeString(playerName);
+    const std::string& escapedName = Database::getInstance().escapeString(playerName);
     std::stringExtended query(escapedName.length() + 64);
     query << "SELECT `lastip` FROM `players` WHERE `name` = " << escapedName << " LIMIT 1";
 
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return 0;
     }
@@ -23,6 +23,7 @@
 #include "bed.h"
 #include "game.h"
 #include "iologindata.h"
+#include "iomap.h"
 #include "tasks.h"
 
 BedItem::BedItem(const uint16_t id) : Item(id)
@@ -30,6 +31,16 @@ BedItem::BedItem(const uint16_t id) : Item(id)
     internalRemoveSleeper();
 }
 
+void BedItem::loadSleeper(const uint32_t guid)
+{
+    const std::string name = IOLoginData::getNameByGuid(guid);
+    if (!name.empty()) {
+        setSpecialDescription(name + " is sleeping there.");
+        g_game.setBedSleeper(this, guid);
+        sleeperGUID = guid;
+    }
+}
+
 Attr_ReadValue BedItem::readAttr(const AttrTypes_t attr, PropStream& propStream)
 {
     switch (attr) {
@@ -40,11 +51,10 @@ Attr_ReadValue BedItem::readAttr(const AttrTypes_t attr, PropStream& propStream)
             }
 
             if (guid != 0) {
-                const std::string name = IOLoginData::getNameByGuid(guid);
-                if (!name.empty()) {
-                    setSpecialDescription(name + " is sleeping there.");
-                    g_game.setBedSleeper(this, guid);
-                    sleeperGUID = guid;
+                if (IOMap::deferredActions) {
+                    IOMap::deferredActions->emplace_back(MAPLOAD_ACTION_SLEEPER, this, guid);
+                } else {
+                    loadSleeper(guid);
                 }
             }
             return ATTR_READ_CONTINUE;
@@ -186,6 +196,7 @@ void BedItem::wakeUp(Player* player)
     if (sleeperGUID != 0) {
         if (!player) {
             Player regenPlayer(nullptr);
+            IOLoginData::waitForPendingSaves(sleeperGUID);
             if (IOLoginData::loadPlayerById(&regenPlayer, sleeperGUID)) {
                 regeneratePlayer(&regenPlayer);
                 IOLoginData::savePlayer(&regenPlayer);
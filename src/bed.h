@@ -48,6 +48,7 @@ public:
     uint32_t getSleeper() const {
         return sleeperGUID;
     }
+    void loadSleeper(uint32_t guid);
 
     void setHouse(House* h) {
         house = h;
@@ -886,6 +886,34 @@ bool ConditionRegeneration::setParam(const ConditionParam_t param, const int32_t
     }
 }
 
+bool ConditionRegeneration::executeElapsed(Creature* creature, const int32_t interval)
+{
+    if (creature->getZone() == ZONE_PROTECTION) {
+        return executeCondition(creature, interval);
+    }
+
+    //every gain that fell into the interval is applied as one total, without the heal messages of a regular tick,
+    //but only as far as the condition lasted
+    const int32_t elapsed = (ticks != -1 ? std::min<int32_t>(interval, ticks) : interval);
+    const uint64_t healthTotal = static_cast<uint64_t>(internalHealthTicks) + static_cast<uint32_t>(elapsed);
+    const uint64_t healthRounds = healthTicks != 0 ? healthTotal / healthTicks : 1;
+    internalHealthTicks = healthTicks != 0 ? static_cast<uint32_t>(healthTotal % healthTicks) : 0;
+    if (healthRounds != 0 && healthGain != 0) {
+        creature->changeHealth(static_cast<int32_t>(std::min<uint64_t>(healthRounds * healthGain, std::numeric_limits<int32_t>::max())));
+    }
+
+    const uint64_t manaTotal = static_cast<uint64_t>(internalManaTicks) + static_cast<uint32_t>(elapsed);
+    const uint64_t manaRounds = manaTicks != 0 ? manaTotal / manaTicks : 1;
+    internalManaTicks = manaTicks != 0 ? static_cast<uint32_t>(manaTotal % manaTicks) : 0;
+    if (manaRounds != 0 && manaGain != 0) {
+        if (Player* player = creature->getPlayer()) {
+            player->changeMana(static_cast<int32_t>(std::min<uint64_t>(manaRounds * manaGain, std::numeric_limits<int32_t>::max())));
+        }
+    }
+
+    return ConditionGeneric::executeCondition(creature, interval);
+}
+
 void ConditionSoul::addCondition(Creature*, const Condition* condition)
 {
     if (updateCondition(condition)) {
@@ -1183,6 +1211,58 @@ bool ConditionDamage::executeCondition(Creature* creature, int32_t interval)
     return Condition::executeCondition(creature, interval);
 }
 
+bool ConditionDamage::executeElapsed(Creature* creature, int32_t interval)
+{
+    //every damage tick that fell into the interval is dealt as one hit, but only as far as the condition lasted
+    int64_t damage = 0;
+    if (periodDamage != 0) {
+        const int64_t elapsed = static_cast<int64_t>(periodDamageTick) + (ticks != -1 ? std::min<int32_t>(interval, ticks) : interval);
+        if (tickInterval > 0) {
+            damage = static_cast<int64_t>(periodDamage) * (elapsed / tickInterval);
+            periodDamageTick = static_cast<int32_t>(elapsed % tickInterval);
+        } else {
+            damage = periodDamage;
+            periodDamageTick = 0;
+        }
+    } else if (!damageList.empty()) {
+        bool bRemove = ticks != -1;
+        creature->onTickCondition(getType(), bRemove);
+
+        int64_t remaining = interval;
+        while (!damageList.empty() && remaining > 0) {
+            IntervalInfo& damageInfo = damageList.front();
+            if (damageInfo.timeLeft > remaining) {
+                damageInfo.timeLeft -= static_cast<int32_t>(remaining);
+                break;
+            }
+
+            remaining -= damageInfo.timeLeft;
+            damage += damageInfo.value;
+            if (bRemove) {
+                damageList.pop_front();
+            } else if (damageInfo.interval > 0) {
+                //endless damage repeats the same entry, the remaining rounds are counted at once
+                damage += static_cast<int64_t>(damageInfo.value) * (remaining / damageInfo.interval);
+                damageInfo.timeLeft = damageInfo.interval - static_cast<int32_t>(remaining % damageInfo.interval);
+                break;
+            } else {
+                damageInfo.timeLeft = damageInfo.interval;
+                break;
+            }
+        }
+
+        if (!bRemove) {
+            interval = 0;
+        }
+    }
+
+    if (damage != 0) {
+        damage = std::max<int64_t>(std::min<int64_t>(damage, std::numeric_limits<int32_t>::max()), std::numeric_limits<int32_t>::min());
+        doDamage(creature, static_cast<int32_t>(damage));
+    }
+    return Condition::executeCondition(creature, interval);
+}
+
 bool ConditionDamage::getNextDamage(int32_t& damage)
 {
     if (periodDamage != 0) {
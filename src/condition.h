@@ -83,6 +83,10 @@ public:
 
     virtual bool startCondition(Creature* creature);
     virtual bool executeCondition(Creature* creature, int32_t interval);
+    // applies a long interval in one step (e.g. the time a creature spent hibernated) instead of think by think
+    virtual bool executeElapsed(Creature* creature, int32_t interval) {
+        return executeCondition(creature, interval);
+    }
     virtual void endCondition(Creature* creature) = 0;
     virtual void addCondition(Creature* creature, const Condition* condition) = 0;
     virtual uint32_t getIcons() const;
@@ -201,6 +205,7 @@ public:
 #endif
     void addCondition(Creature* creature, const Condition* condition) override;
     bool executeCondition(Creature* creature, int32_t interval) override;
+    bool executeElapsed(Creature* creature, int32_t interval) override;
 
     bool setParam(ConditionParam_t param, int32_t value) override;
 
@@ -272,6 +277,7 @@ public:
 
     bool startCondition(Creature* creature) override;
     bool executeCondition(Creature* creature, int32_t interval) override;
+    bool executeElapsed(Creature* creature, int32_t interval) override;
     void endCondition(Creature* creature) override;
     void addCondition(Creature* creature, const Condition* condition) override;
     uint32_t getIcons() const override;
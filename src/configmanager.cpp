@@ -125,6 +125,8 @@ bool ConfigManager::load()
         integer[GAME_PORT] = getGlobalNumber(L, "gameProtocolPort", 7172);
         integer[LOGIN_PORT] = getGlobalNumber(L, "loginProtocolPort", 7171);
         integer[STATUS_PORT] = getGlobalNumber(L, "statusProtocolPort", 7171);
+        integer[NETWORK_THREADS] = getGlobalNumber(L, "networkThreads", 1);
+        integer[DATABASE_THREADS] = getGlobalNumber(L, "databaseThreads", 4);
 
         integer[MARKET_OFFER_DURATION] = getGlobalNumber(L, "marketOfferDuration", 30 * 24 * 60 * 60);
     }
@@ -145,6 +147,8 @@ bool ConfigManager::load()
     boolean[CLASSIC_EQUIPMENT_SLOTS] = getGlobalBoolean(L, "classicEquipmentSlots", false);
     boolean[CLASSIC_ATTACK_SPEED] = getGlobalBoolean(L, "classicAttackSpeed", false);
     boolean[SCRIPTS_CONSOLE_LOGS] = getGlobalBoolean(L, "showScriptsLogInConsole", true);
+    boolean[MONSTER_FLOW_FIELDS] = getGlobalBoolean(L, "monsterFlowFields", false);
+    boolean[MONSTER_HIBERNATION] = getGlobalBoolean(L, "monsterHibernation", false);
 
     string[DEFAULT_PRIORITY] = getGlobalString(L, "defaultPriority", "high");
     string[SERVER_NAME] = getGlobalString(L, "serverName", "");
@@ -185,6 +189,9 @@ bool ConfigManager::load()
     integer[MAX_MARKET_OFFERS_AT_A_TIME_PER_PLAYER] = getGlobalNumber(L, "maxMarketOffersAtATimePerPlayer", 100);
     integer[MAX_PACKETS_PER_SECOND] = getGlobalNumber(L, "maxPacketsPerSecond", 25);
     integer[COMPRESSION_LEVEL] = getGlobalNumber(L, "packetCompressionLevel", 6);
+    integer[PATHFINDING_MAX_NODES] = std::max<int32_t>(getGlobalNumber(L, "pathfindingMaxNodes", 4096), 64);
+    integer[PATHFINDING_MAX_CLOSED_NODES] = std::max<int32_t>(getGlobalNumber(L, "pathfindingMaxClosedNodes", 100), 1);
+    integer[PLAYER_PATHFINDING_MAX_CLOSED_NODES] = std::max<int32_t>(getGlobalNumber(L, "playerPathfindingMaxClosedNodes", 1000), 1);
 #if GAME_FEATURE_STORE > 0
     integer[STORE_COIN_PACKAGES] = getGlobalNumber(L, "storeCoinPackages", 25);
 #endif
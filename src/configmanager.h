@@ -44,6 +44,8 @@ public:
         CLASSIC_EQUIPMENT_SLOTS,
         CLASSIC_ATTACK_SPEED,
         SCRIPTS_CONSOLE_LOGS,
+        MONSTER_FLOW_FIELDS,
+        MONSTER_HIBERNATION,
 
         LAST_BOOLEAN_CONFIG /* this must be the last one */
     };
@@ -101,6 +103,8 @@ public:
         GAME_PORT,
         LOGIN_PORT,
         STATUS_PORT,
+        NETWORK_THREADS,
+        DATABASE_THREADS,
         STAIRHOP_DELAY,
         MARKET_OFFER_DURATION,
         CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES,
@@ -108,6 +112,9 @@ public:
         EXP_FROM_PLAYERS_LEVEL_RANGE,
         MAX_PACKETS_PER_SECOND,
         COMPRESSION_LEVEL,
+        PATHFINDING_MAX_NODES,
+        PATHFINDING_MAX_CLOSED_NODES,
+        PLAYER_PATHFINDING_MAX_CLOSED_NODES,
 #if GAME_FEATURE_STORE > 0
         STORE_COIN_PACKAGES,
 #endif
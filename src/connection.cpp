@@ -51,34 +51,41 @@ void ConnectionManager::closeAll()
     std::lock_guard<std::mutex> lockClass(connectionManagerLock);
 
     for (const auto& connection : connections) {
-        try {
-            std::error_code error;
-            connection->socket.shutdown(asio::ip::tcp::socket::shutdown_both, error);
-            connection->socket.close(error);
-        } catch (std::system_error&) {
-        }
+        asio::post(connection->strand, [connection] {
+            try {
+                std::error_code error;
+                connection->socket.shutdown(asio::ip::tcp::socket::shutdown_both, error);
+                connection->socket.close(error);
+            } catch (std::system_error&) {
+            }
+        });
     }
     connections.clear();
 }
 
 // Connection
 
+ConnectionWriteStats Connection::writeStats;
+
 void Connection::close(const bool force)
 {
     //any thread
     ConnectionManager::getInstance().releaseConnection(shared_from_this());
+    asio::dispatch(strand, [thisPtr = shared_from_this(), force] { thisPtr->internalClose(force); });
+}
 
-    std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
+void Connection::internalClose(const bool force)
+{
     if (connectionState == CONNECTION_STATE_CLOSED) {
         return;
     }
     connectionState = CONNECTION_STATE_CLOSED;
 
     if (protocol) {
-        g_dispatcher.addTask([this] { protocol->release(); });
+        g_dispatcher.addTask([protocol = protocol] { protocol->release(); });
     }
 
-    if (messageQueue.empty() || force) {
+    if (messageQueueSize == 0 || force) {
         closeSocket();
     } else {
         //will be closed by the destructor or onWriteOperation
@@ -105,21 +112,34 @@ Connection::~Connection()
     closeSocket();
 }
 
+void Connection::updateIP()
+{
+    // IP-address is expressed in network byte order
+    std::error_code error;
+    const asio::ip::tcp::endpoint endpoint = socket.remote_endpoint(error);
+    if (error) {
+        ip = 0;
+        return;
+    }
+
+    ip = htonl(endpoint.address().to_v4().to_ulong());
+}
+
 void Connection::accept(const Protocol_ptr& protocol)
 {
+    //acceptor thread, nothing else knows about the connection yet
     this->connectionState = CONNECTION_STATE_IDENTIFYING;
     this->protocol = protocol;
     g_dispatcher.addTask([protocol] { protocol->onConnect(); });
 
-    std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
     try {
         readTimer.expires_from_now(asio::chrono::seconds(CONNECTION_READ_TIMEOUT));
-        readTimer.async_wait([capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
+        readTimer.async_wait(asio::bind_executor(strand, [capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
             return Connection::handleTimeout(capture0, std::forward<decltype(PH1)>(PH1));
-        });
+        }));
 
         // Read header bytes to identify if it is proxy identification
-        asio::async_read(socket, asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH), std::bind(&Connection::parseProxyIdentification, shared_from_this(), std::placeholders::_1));
+        asio::async_read(socket, asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH), asio::bind_executor(strand, std::bind(&Connection::parseProxyIdentification, shared_from_this(), std::placeholders::_1)));
     } catch (std::system_error& e) {
         std::cout << "[Network error - Connection::accept] " << e.what() << std::endl;
         close(FORCE_CLOSE);
@@ -128,15 +148,15 @@ void Connection::accept(const Protocol_ptr& protocol)
 
 void Connection::accept()
 {
-    std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
+    //acceptor thread, nothing else knows about the connection yet
     try {
         readTimer.expires_from_now(asio::chrono::seconds(CONNECTION_READ_TIMEOUT));
-        readTimer.async_wait([capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
+        readTimer.async_wait(asio::bind_executor(strand, [capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
             return Connection::handleTimeout(capture0, std::forward<decltype(PH1)>(PH1));
-        });
+        }));
 
         // Read size of the first packet
-        asio::async_read(socket, asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH), std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
+        asio::async_read(socket, asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH), asio::bind_executor(strand, std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1)));
     } catch (std::system_error& e) {
         std::cout << "[Network error - Connection::accept] " << e.what() << std::endl;
         close(FORCE_CLOSE);
@@ -145,7 +165,6 @@ void Connection::accept()
 
 void Connection::parseProxyIdentification(const std::error_code& error)
 {
-    std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
     readTimer.cancel();
 
     if (error) {
@@ -170,12 +189,12 @@ void Connection::parseProxyIdentification(const std::error_code& error)
             connectionState = CONNECTION_STATE_READINGS;
             try {
                 readTimer.expires_from_now(asio::chrono::seconds(CONNECTION_READ_TIMEOUT));
-                readTimer.async_wait([capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
+                readTimer.async_wait(asio::bind_executor(strand, [capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
                     return Connection::handleTimeout(capture0, std::forward<decltype(PH1)>(PH1));
-                });
+                }));
 
                 // Read the remainder of proxy identification
-                asio::async_read(socket, asio::buffer(msg.getBuffer(), remainder), std::bind(&Connection::parseProxyIdentification, shared_from_this(), std::placeholders::_1));
+                asio::async_read(socket, asio::buffer(msg.getBuffer(), remainder), asio::bind_executor(strand, std::bind(&Connection::parseProxyIdentification, shared_from_this(), std::placeholders::_1)));
             } catch (std::system_error& e) {
                 std::cout << "[Network error - Connection::parseProxyIdentification] " << e.what() << std::endl;
                 close(FORCE_CLOSE);
@@ -195,12 +214,12 @@ void Connection::parseProxyIdentification(const std::error_code& error)
 
     try {
         readTimer.expires_from_now(asio::chrono::seconds(CONNECTION_READ_TIMEOUT));
-        readTimer.async_wait([capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
+        readTimer.async_wait(asio::bind_executor(strand, [capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
             return Connection::handleTimeout(capture0, std::forward<decltype(PH1)>(PH1));
-        });
+        }));
 
         // Wait to the next packet
-        asio::async_read(socket, asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH), std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
+        asio::async_read(socket, asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH), asio::bind_executor(strand, std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1)));
     } catch (std::system_error& e) {
         std::cout << "[Network error - Connection::parseProxyIdentification] " << e.what() << std::endl;
         close(FORCE_CLOSE);
@@ -209,7 +228,6 @@ void Connection::parseProxyIdentification(const std::error_code& error)
 
 void Connection::parseHeader(const std::error_code& error)
 {
-    std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
     readTimer.cancel();
 
     if (error) {
@@ -240,13 +258,13 @@ void Connection::parseHeader(const std::error_code& error)
 
     try {
         readTimer.expires_from_now(asio::chrono::seconds(CONNECTION_READ_TIMEOUT));
-        readTimer.async_wait([capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
+        readTimer.async_wait(asio::bind_executor(strand, [capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
             return Connection::handleTimeout(capture0, std::forward<decltype(PH1)>(PH1));
-        });
+        }));
 
         // Read packet content
         msg.setLength(size + NetworkMessage::HEADER_LENGTH);
-        asio::async_read(socket, asio::buffer(msg.getBodyBuffer(), size), std::bind(&Connection::parsePacket, shared_from_this(), std::placeholders::_1));
+        asio::async_read(socket, asio::buffer(msg.getBodyBuffer(), size), asio::bind_executor(strand, std::bind(&Connection::parsePacket, shared_from_this(), std::placeholders::_1)));
     } catch (std::system_error& e) {
         std::cout << "[Network error - Connection::parseHeader] " << e.what() << std::endl;
         close(FORCE_CLOSE);
@@ -255,7 +273,6 @@ void Connection::parseHeader(const std::error_code& error)
 
 void Connection::parsePacket(const std::error_code& error)
 {
-    std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
     readTimer.cancel();
 
     if (error) {
@@ -307,13 +324,13 @@ void Connection::parsePacket(const std::error_code& error)
 
     try {
         readTimer.expires_from_now(asio::chrono::seconds(CONNECTION_READ_TIMEOUT));
-        readTimer.async_wait([capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
+        readTimer.async_wait(asio::bind_executor(strand, [capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
             return Connection::handleTimeout(capture0, std::forward<decltype(PH1)>(PH1));
-        });
+        }));
 
         if (!skipReadingNextPacket) {
             // Wait to the next packet
-            asio::async_read(socket, asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH), std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
+            asio::async_read(socket, asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH), asio::bind_executor(strand, std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1)));
         }
     } catch (std::system_error& e) {
         std::cout << "[Network error - Connection::parsePacket] " << e.what() << std::endl;
@@ -323,99 +340,102 @@ void Connection::parsePacket(const std::error_code& error)
 
 void Connection::resumeWork()
 {
-    std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
+    //dispatcher thread
+    asio::post(strand, [thisPtr = shared_from_this()] {
+        if (thisPtr->connectionState == CONNECTION_STATE_CLOSED) {
+            return;
+        }
 
-    try {
-        // Wait to the next packet
-        asio::async_read(socket, asio::buffer(msg.getBuffer(), NetworkMessage::HEADER_LENGTH), std::bind(&Connection::parseHeader, shared_from_this(), std::placeholders::_1));
-    } catch (std::system_error& e) {
-        std::cout << "[Network error - Connection::parsePacket] " << e.what() << std::endl;
-        close(FORCE_CLOSE);
-    }
+        try {
+            // Wait to the next packet
+            asio::async_read(thisPtr->socket, asio::buffer(thisPtr->msg.getBuffer(), NetworkMessage::HEADER_LENGTH), asio::bind_executor(thisPtr->strand, std::bind(&Connection::parseHeader, thisPtr, std::placeholders::_1)));
+        } catch (std::system_error& e) {
+            std::cout << "[Network error - Connection::resumeWork] " << e.what() << std::endl;
+            thisPtr->close(FORCE_CLOSE);
+        }
+    });
 }
 
 void Connection::send(const OutputMessage_ptr& msg)
 {
-    std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
-    if (connectionState == CONNECTION_STATE_CLOSED) {
-        return;
-    }
+    //any thread, the xtea encryption in onSendMessage runs on the network thread of the connection
+    asio::dispatch(strand, [thisPtr = shared_from_this(), msg] {
+        if (thisPtr->connectionState == CONNECTION_STATE_CLOSED) {
+            return;
+        }
 
-    const bool noPendingWrite = messageQueue.empty();
-    messageQueue.emplace_back(msg);
-    if (noPendingWrite) {
-        // Make asio thread handle xtea encryption instead of dispatcher
-        try {
-            asio::post([capture0 = shared_from_this()] { capture0->internalWorker(); });
-        } catch (std::system_error& e) {
-            std::cout << "[Network error - Connection::send] " << e.what() << std::endl;
-            messageQueue.clear();
-            close(FORCE_CLOSE);
+        if (thisPtr->messageQueueSize == CONNECTION_SEND_QUEUE_SIZE) {
+            //the client stopped reading long before the write timeout would notice
+            writeStats.overflows.fetch_add(1, std::memory_order_relaxed);
+            thisPtr->close(FORCE_CLOSE);
+            return;
         }
-    }
+
+        thisPtr->messageQueue[(thisPtr->messageQueueHead + thisPtr->messageQueueSize) & (CONNECTION_SEND_QUEUE_SIZE - 1)] = msg;
+        if (++thisPtr->messageQueueSize == 1) {
+            thisPtr->internalSend();
+        }
+    });
 }
 
-void Connection::internalWorker()
+void Connection::internalSend()
 {
-    std::unique_lock<std::recursive_mutex> lockClass(connectionLock);
-    if (!messageQueue.empty()) {
-        const OutputMessage_ptr& msg = messageQueue.front();
-        lockClass.unlock();
+    //everything queued so far leaves in one vectored write, timed as a whole
+    writeBatchSize = std::min<size_t>(messageQueueSize, CONNECTION_SEND_BATCH_SIZE);
+    writeBuffers.clear();
+
+    std::array<OutputMessage*, CONNECTION_SEND_BATCH_SIZE> batch;
+    for (size_t i = 0; i < writeBatchSize; ++i) {
+        batch[i] = messageQueue[(messageQueueHead + i) & (CONNECTION_SEND_QUEUE_SIZE - 1)].get();
+    }
+    protocol->XTEA_encryptBatch(batch.data(), writeBatchSize);
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < writeBatchSize; ++i) {
+        const OutputMessage_ptr& msg = messageQueue[(messageQueueHead + i) & (CONNECTION_SEND_QUEUE_SIZE - 1)];
         protocol->onSendMessage(msg);
-        lockClass.lock();
-        internalSend(msg);
-    } else if (connectionState == CONNECTION_STATE_CLOSED) {
-        closeSocket();
+        writeBuffers.emplace_back(msg->getOutputBuffer(), msg->getLength());
+        bytes += msg->getLength();
     }
-}
 
-void Connection::internalSend(const OutputMessage_ptr& msg)
-{
+    writeStats.writes.fetch_add(1, std::memory_order_relaxed);
+    writeStats.messages.fetch_add(writeBatchSize, std::memory_order_relaxed);
+    writeStats.bytes.fetch_add(bytes, std::memory_order_relaxed);
+
     try {
         writeTimer.expires_from_now(asio::chrono::seconds(CONNECTION_WRITE_TIMEOUT));
-        writeTimer.async_wait([capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
+        writeTimer.async_wait(asio::bind_executor(strand, [capture0 = std::weak_ptr<Connection>(shared_from_this())](auto&& PH1) {
             return Connection::handleTimeout(capture0, std::forward<decltype(PH1)>(PH1));
-        });
+        }));
 
-        asio::async_write(socket, asio::buffer(msg->getOutputBuffer(), msg->getLength()), std::bind(&Connection::onWriteOperation, shared_from_this(), std::placeholders::_1));
+        asio::async_write(socket, writeBuffers, asio::bind_executor(strand, std::bind(&Connection::onWriteOperation, shared_from_this(), std::placeholders::_1)));
     } catch (std::system_error& e) {
         std::cout << "[Network error - Connection::internalSend] " << e.what() << std::endl;
         close(FORCE_CLOSE);
     }
 }
 
-uint32_t Connection::getIP()
+void Connection::onWriteOperation(const std::error_code& error)
 {
-    std::lock_guard<std::recursive_mutex> lockClass(connectionLock);
-
-    // IP-address is expressed in network byte order
-    std::error_code error;
-    const asio::ip::tcp::endpoint endpoint = socket.remote_endpoint(error);
+    writeTimer.cancel();
     if (error) {
-        return 0;
+        writeBatchSize = messageQueueSize;
     }
 
-    return htonl(endpoint.address().to_v4().to_ulong());
-}
-
-void Connection::onWriteOperation(const std::error_code& error)
-{
-    std::unique_lock<std::recursive_mutex> lockClass(connectionLock);
-    writeTimer.cancel();
-    messageQueue.pop_front();
+    for (size_t i = 0; i < writeBatchSize; ++i) {
+        messageQueue[messageQueueHead].reset();
+        messageQueueHead = (messageQueueHead + 1) & (CONNECTION_SEND_QUEUE_SIZE - 1);
+    }
+    messageQueueSize -= writeBatchSize;
+    writeBatchSize = 0;
 
     if (error) {
-        messageQueue.clear();
         close(FORCE_CLOSE);
         return;
     }
 
-    if (!messageQueue.empty()) {
-        const OutputMessage_ptr& msg = messageQueue.front();
-        lockClass.unlock();
-        protocol->onSendMessage(msg);
-        lockClass.lock();
-        internalSend(msg);
+    if (messageQueueSize != 0) {
+        internalSend();
     } else if (connectionState == CONNECTION_STATE_CLOSED) {
         closeSocket();
     }
@@ -28,10 +28,18 @@
 static constexpr int32_t CONNECTION_WRITE_TIMEOUT = 30;
 static constexpr int32_t CONNECTION_READ_TIMEOUT = 30;
 
+// output messages a connection may have queued, a client falling further behind is disconnected
+static constexpr size_t CONNECTION_SEND_QUEUE_SIZE = 512;
+// queued messages flushed by a single vectored write, asio hands at most 64 buffers to one sendmsg
+static constexpr size_t CONNECTION_SEND_BATCH_SIZE = 64;
+static_assert((CONNECTION_SEND_QUEUE_SIZE & (CONNECTION_SEND_QUEUE_SIZE - 1)) == 0, "CONNECTION_SEND_QUEUE_SIZE must be a power of two");
+
 class Protocol;
 using Protocol_ptr = std::shared_ptr<Protocol>;
 class OutputMessage;
 using OutputMessage_ptr = std::shared_ptr<OutputMessage>;
+class PacketFragment;
+using PacketFragment_ptr = std::shared_ptr<const PacketFragment>;
 class Connection;
 using Connection_ptr = std::shared_ptr<Connection>;
 using ConnectionWeak_ptr = std::weak_ptr<Connection>;
@@ -41,6 +49,14 @@ class ServicePort;
 using ServicePort_ptr = std::shared_ptr<ServicePort>;
 using ConstServicePort_ptr = std::shared_ptr<const ServicePort>;
 
+struct ConnectionWriteStats
+{
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> overflows{0};
+};
+
 class ConnectionManager
 {
 public:
@@ -79,6 +95,7 @@ public:
 
     Connection(asio::io_service& io_service,
         ConstServicePort_ptr service_port) :
+        strand(io_service.get_executor()),
         readTimer(io_service),
         writeTimer(io_service),
         service_port(std::move(service_port)),
@@ -96,7 +113,13 @@ public:
     void resumeWork();
     void send(const OutputMessage_ptr& msg);
 
-    uint32_t getIP();
+    uint32_t getIP() const {
+        return ip;
+    }
+
+    static const ConnectionWriteStats& getWriteStats() {
+        return writeStats;
+    }
 
 private:
     void parseProxyIdentification(const std::error_code& error);
@@ -108,8 +131,9 @@ private:
     static void handleTimeout(const ConnectionWeak_ptr& connectionWeak, const std::error_code& error);
 
     void closeSocket();
-    void internalWorker();
-    void internalSend(const OutputMessage_ptr& msg);
+    void internalClose(bool force);
+    void internalSend();
+    void updateIP();
 
     asio::ip::tcp::socket& getSocket() {
         return socket;
@@ -118,12 +142,20 @@ private:
 
     NetworkMessage msg;
 
+    //every handler of the connection runs through its strand, so the state below needs no lock
+    asio::strand<asio::io_service::executor_type> strand;
+
     asio::high_resolution_timer readTimer;
     asio::high_resolution_timer writeTimer;
 
-    std::recursive_mutex connectionLock;
+    static ConnectionWriteStats writeStats;
 
-    std::list<OutputMessage_ptr> messageQueue;
+    //ring of queued messages, the first writeBatchSize of them are being written
+    std::array<OutputMessage_ptr, CONNECTION_SEND_QUEUE_SIZE> messageQueue;
+    std::vector<asio::const_buffer> writeBuffers;
+    size_t messageQueueHead = 0;
+    size_t messageQueueSize = 0;
+    size_t writeBatchSize = 0;
 
     ConstServicePort_ptr service_port;
     Protocol_ptr protocol;
@@ -132,6 +164,7 @@ private:
 
     time_t timeConnected;
     uint32_t packetsSent = 0;
+    uint32_t ip = 0;
 
     std::underlying_type_t<ConnectionState_t> connectionState = CONNECTION_STATE_OPEN;
     bool receivedFirst = false;
@@ -231,6 +231,8 @@ bool Container::isHoldingItem(const Item* item) const
 
 void Container::onAddContainerItem(const Item* item) const
 {
+    markHouseDirty();
+
     SpectatorVector spectators;
     g_game.map.getSpectators(spectators, getPosition(), false, true, 2, 2, 2, 2);
 
@@ -247,6 +249,8 @@ void Container::onAddContainerItem(const Item* item) const
 
 void Container::onUpdateContainerItem(const uint32_t index, const Item* oldItem, const Item* newItem) const
 {
+    markHouseDirty();
+
     SpectatorVector spectators;
     g_game.map.getSpectators(spectators, getPosition(), false, true, 2, 2, 2, 2);
 
@@ -263,6 +267,8 @@ void Container::onUpdateContainerItem(const uint32_t index, const Item* oldItem,
 
 void Container::onRemoveContainerItem(const uint32_t index, const Item* item) const
 {
+    markHouseDirty();
+
     SpectatorVector spectators;
     g_game.map.getSpectators(spectators, getPosition(), false, true, 2, 2, 2, 2);
 
@@ -912,7 +912,14 @@ void Creature::goToFollowCreature()
             }
         } else {
             listWalkDir.clear();
-            if (getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
+
+            //melee chasers of the same kind share one flow field towards their target
+            bool flowFieldPath = false;
+            if (monster && fpp.minTargetDist == 1 && fpp.maxTargetDist == 1 && !fpp.keepDistance && !fpp.clearSight && g_config.getBoolean(ConfigManager::MONSTER_FLOW_FIELDS)) {
+                flowFieldPath = g_game.map.getFlowFieldPath(*monster, *followCreature, listWalkDir);
+            }
+
+            if (flowFieldPath || getPathTo(followCreature->getPosition(), listWalkDir, fpp)) {
                 hasFollowPath = true;
                 startAutoWalk();
             } else {
@@ -1312,6 +1319,33 @@ void Creature::executeConditions(const uint32_t interval)
     }
 }
 
+void Creature::executeElapsedConditions(const uint32_t interval)
+{
+    const auto elapsed = static_cast<int32_t>(std::min<uint32_t>(interval, std::numeric_limits<int32_t>::max()));
+    size_t it = 0;
+    while (it < conditions.size()) {
+        Condition* condition = conditions[it];
+        if (condition->getType() == CONDITION_NONE) {
+            conditions[it] = conditions.back();
+            conditions.pop_back();
+
+            delete condition;
+            continue;
+        }
+
+        if (!condition->executeElapsed(this, elapsed)) {
+            conditions[it] = conditions.back();
+            conditions.pop_back();
+
+            condition->endCondition(this);
+            onEndCondition(condition->getType());
+            delete condition;
+            continue;
+        }
+        ++it;
+    }
+}
+
 bool Creature::hasCondition(const ConditionType_t type, const uint32_t subId/* = 0*/) const
 {
     if (isSuppress(type)) {
@@ -1604,10 +1638,7 @@ bool Creature::isInvisible() const
 
 bool Creature::getPathTo(const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp) const
 {
-    if (fpp.maxSearchDist != 0 || fpp.keepDistance) {
-        return g_game.map.getPathMatchingCond(*this, targetPos, dirList, FrozenPathingConditionCall(targetPos), fpp);
-    }
-    return g_game.map.getPathMatching(*this, targetPos, dirList, FrozenPathingConditionCall(targetPos), fpp);
+    return g_game.map.getPathTo(*this, targetPos, dirList, fpp);
 }
 
 bool Creature::getPathTo(const Position& targetPos, std::vector<Direction>& dirList, const int32_t minTargetDist, const int32_t maxTargetDist, const bool fullPathSearch /*= true*/, const bool clearSight /*= true*/, const int32_t maxSearchDist /*= 0*/) const
@@ -1618,6 +1649,10 @@ bool Creature::getPathTo(const Position& targetPos, std::vector<Direction>& dirL
     fpp.clearSight = clearSight;
     fpp.minTargetDist = minTargetDist;
     fpp.maxTargetDist = maxTargetDist;
+    if (getPlayer()) {
+        //player auto walk, may go further than monsters chasing a target
+        fpp.maxClosedNodes = g_config.getNumber(ConfigManager::PLAYER_PATHFINDING_MAX_CLOSED_NODES);
+    }
     return getPathTo(targetPos, dirList, fpp);
 }
 
@@ -68,6 +68,7 @@ struct FindPathParams
     int32_t maxSearchDist = 0;
     int32_t minTargetDist = -1;
     int32_t maxTargetDist = -1;
+    int32_t maxClosedNodes = 0; // 0 uses pathfindingMaxClosedNodes
 };
 
 class Map;
@@ -349,6 +350,7 @@ public:
     Condition* getCondition(ConditionType_t type) const;
     Condition* getCondition(ConditionType_t type, ConditionId_t conditionId, uint32_t subId = 0) const;
     void executeConditions(uint32_t interval);
+    void executeElapsedConditions(uint32_t interval);
     bool hasCondition(ConditionType_t type, uint32_t subId = 0) const;
     virtual bool isImmune(ConditionType_t type) const;
     virtual bool isImmune(CombatType_t type) const;
@@ -533,6 +535,12 @@ protected:
     uint64_t eventWalk = 0;
 
     uint64_t lastStep = 0;
+    // when the creature was put to sleep with its region, 0 while awake
+    int64_t hibernationTime = 0;
+    uint32_t hibernationRegion = 0;
+    // positions in the creature and player lists of the sector it stands in
+    uint32_t sectorIndex = 0;
+    uint32_t playerSectorIndex = 0;
     uint32_t referenceCounter = 0;
     uint32_t id = 0;
     uint32_t scriptEventsBitField = 0;
@@ -609,6 +617,7 @@ protected:
 
     friend class Game;
     friend class Map;
+    friend struct SectorCreatureList;
     friend class LuaScriptInterface;
 };
 
@@ -39,6 +39,13 @@
 
 extern ConfigManager g_config;
 
+thread_local Database* Database::threadInstance = nullptr;
+
+Database& Database::getInstance()
+{
+    return threadInstance ? *threadInstance : g_database;
+}
+
 bool Database::init()
 {
     if (mysql_library_init(0, nullptr, nullptr) != 0) {
@@ -72,8 +79,8 @@ bool Database::connect()
     const bool reconnect = true;
     mysql_options(handle, MYSQL_OPT_RECONNECT, &reconnect);
 
-    // connects to database
-    if (!mysql_real_connect(handle, g_config.getString(ConfigManager::MYSQL_HOST).c_str(), g_config.getString(ConfigManager::MYSQL_USER).c_str(), g_config.getString(ConfigManager::MYSQL_PASS).c_str(), g_config.getString(ConfigManager::MYSQL_DB).c_str(), g_config.getNumber(ConfigManager::SQL_PORT), g_config.getString(ConfigManager::MYSQL_SOCK).c_str(), 0)) {
+    // connects to database, affected rows count the rows an update matched even if it didn't change them
+    if (!mysql_real_connect(handle, g_config.getString(ConfigManager::MYSQL_HOST).c_str(), g_config.getString(ConfigManager::MYSQL_USER).c_str(), g_config.getString(ConfigManager::MYSQL_PASS).c_str(), g_config.getString(ConfigManager::MYSQL_DB).c_str(), g_config.getNumber(ConfigManager::SQL_PORT), g_config.getString(ConfigManager::MYSQL_SOCK).c_str(), CLIENT_FOUND_ROWS)) {
         std::cout << std::endl << "MySQL Error Message: " << mysql_error(handle) << std::endl;
         return false;
     }
@@ -87,6 +94,11 @@ bool Database::connect()
 
 void Database::disconnect()
 {
+    for (auto& it : statements) {
+        mysql_stmt_close(it.second);
+    }
+    statements.clear();
+
     if (handle != nullptr) {
         mysql_close(handle);
         handle = nullptr;
@@ -124,6 +136,11 @@ bool Database::commit() const
     return true;
 }
 
+static bool isConnectionError(const unsigned int error)
+{
+    return error == CR_SERVER_LOST || error == CR_SERVER_GONE_ERROR || error == CR_CONN_HOST_ERROR || error == 1053/*ER_SERVER_SHUTDOWN*/ || error == CR_CONNECTION_ERROR;
+}
+
 bool Database::executeQuery(const std::string& query) const
 {
     bool success = true;
@@ -132,7 +149,7 @@ bool Database::executeQuery(const std::string& query) const
     while (mysql_real_query(handle, query.c_str(), query.length()) != 0) {
         std::cout << "[Error - mysql_real_query] Query: " << query.substr(0, 256) << std::endl << "Message: " << mysql_error(handle) << std::endl;
         const auto error = mysql_errno(handle);
-        if (error != CR_SERVER_LOST && error != CR_SERVER_GONE_ERROR && error != CR_CONN_HOST_ERROR && error != 1053/*ER_SERVER_SHUTDOWN*/ && error != CR_CONNECTION_ERROR) {
+        if (!isConnectionError(error)) {
             success = false;
             break;
         }
@@ -153,7 +170,7 @@ retry:
     while (mysql_real_query(handle, query.c_str(), query.length()) != 0) {
         std::cout << "[Error - mysql_real_query] Query: " << query << std::endl << "Message: " << mysql_error(handle) << std::endl;
         const auto error = mysql_errno(handle);
-        if (error != CR_SERVER_LOST && error != CR_SERVER_GONE_ERROR && error != CR_CONN_HOST_ERROR && error != 1053/*ER_SERVER_SHUTDOWN*/ && error != CR_CONNECTION_ERROR) {
+        if (!isConnectionError(error)) {
             break;
         }
         std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -165,7 +182,7 @@ retry:
     if (res == nullptr) {
         std::cout << "[Error - mysql_store_result] Query: " << query << std::endl << "Message: " << mysql_error(handle) << std::endl;
         const auto error = mysql_errno(handle);
-        if (error != CR_SERVER_LOST && error != CR_SERVER_GONE_ERROR && error != CR_CONN_HOST_ERROR && error != 1053/*ER_SERVER_SHUTDOWN*/ && error != CR_CONNECTION_ERROR) {
+        if (!isConnectionError(error)) {
             return nullptr;
         }
         goto retry;
@@ -179,6 +196,97 @@ retry:
     return result;
 }
 
+bool Database::executeStatement(const DBStatement& statement, uint64_t* affectedRows/* = nullptr*/) const
+{
+    const std::string& query = statement.getQuery();
+
+    std::vector<MYSQL_BIND> binds(statement.parameters.size());
+    for (size_t i = 0, end = binds.size(); i < end; ++i) {
+        const DBStatement::Parameter& parameter = statement.parameters[i];
+        MYSQL_BIND& bind = binds[i];
+        bind.buffer_type = parameter.type;
+        if (parameter.type == MYSQL_TYPE_LONGLONG) {
+            bind.buffer = const_cast<int64_t*>(&parameter.number);
+            bind.is_unsigned = parameter.isUnsigned;
+        } else if (parameter.type != MYSQL_TYPE_NULL) {
+            //length is left unset so the client library sends buffer_length bytes
+            bind.buffer = const_cast<char*>(parameter.data.data());
+            bind.buffer_length = static_cast<unsigned long>(parameter.data.length());
+        }
+    }
+
+    while (true) {
+        unsigned int error;
+        MYSQL_STMT* stmt = getStatement(query, error);
+        if (stmt) {
+            if (mysql_stmt_param_count(stmt) != binds.size()) {
+                std::cout << "[Error - mysql_stmt_bind_param] Query: " << query.substr(0, 256) << std::endl << "Message: expected " << mysql_stmt_param_count(stmt) << " parameters, got " << binds.size() << std::endl;
+                return false;
+            }
+
+            if (mysql_stmt_bind_param(stmt, binds.data()) == 0 && mysql_stmt_execute(stmt) == 0) {
+                if (affectedRows) {
+                    *affectedRows = mysql_stmt_affected_rows(stmt);
+                }
+                return true;
+            }
+
+            std::cout << "[Error - mysql_stmt_execute] Query: " << query.substr(0, 256) << std::endl << "Message: " << mysql_stmt_error(stmt) << std::endl;
+            error = mysql_stmt_errno(stmt);
+            if (!isConnectionError(error) && error != 1243/*ER_UNKNOWN_STMT_HANDLER*/ && error != CR_NO_PREPARE_STMT) {
+                return false;
+            }
+
+            //the handle doesn't survive a reconnect, it gets prepared again on the next try
+            dropStatement(query);
+        } else if (!isConnectionError(error)) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+}
+
+MYSQL_STMT* Database::getStatement(const std::string& query, unsigned int& error) const
+{
+    const auto it = statements.find(query);
+    if (it != statements.end()) {
+        return it->second;
+    }
+
+    MYSQL_STMT* stmt = mysql_stmt_init(handle);
+    if (!stmt) {
+        std::cout << "[Error - mysql_stmt_init] Message: " << mysql_error(handle) << std::endl;
+        error = mysql_errno(handle);
+        return nullptr;
+    }
+
+    if (mysql_stmt_prepare(stmt, query.c_str(), query.length()) != 0) {
+        std::cout << "[Error - mysql_stmt_prepare] Query: " << query.substr(0, 256) << std::endl << "Message: " << mysql_stmt_error(stmt) << std::endl;
+        error = mysql_stmt_errno(stmt);
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+
+    if (statements.size() >= STATEMENT_CACHE_SIZE) {
+        //only a safety net, the texts built per call (player saves, house tile batches) come in a handful of shapes
+        auto victim = statements.begin();
+        mysql_stmt_close(victim->second);
+        statements.erase(victim);
+    }
+
+    statements.emplace(query, stmt);
+    return stmt;
+}
+
+void Database::dropStatement(const std::string& query) const
+{
+    const auto it = statements.find(query);
+    if (it != statements.end()) {
+        mysql_stmt_close(it->second);
+        statements.erase(it);
+    }
+}
+
 std::string Database::escapeString(const std::string& s) const
 {
     return escapeBlob(s.c_str(), s.length());
@@ -274,6 +382,40 @@ bool DBResult::next()
     return row != nullptr;
 }
 
+void DBStatement::addNumber(const int64_t value)
+{
+    parameters.emplace_back(MYSQL_TYPE_LONGLONG, value, false);
+}
+
+void DBStatement::addUnsigned(const uint64_t value)
+{
+    parameters.emplace_back(MYSQL_TYPE_LONGLONG, static_cast<int64_t>(value), true);
+}
+
+void DBStatement::addString(const std::string& value)
+{
+    parameters.emplace_back(MYSQL_TYPE_STRING, value);
+}
+
+void DBStatement::addBlob(const char* data, const size_t length)
+{
+    parameters.emplace_back(MYSQL_TYPE_BLOB, std::string(data, length));
+}
+
+void DBStatement::addNull()
+{
+    parameters.emplace_back(MYSQL_TYPE_NULL, 0, false);
+}
+
+size_t DBStatement::getSize() const
+{
+    size_t size = query.length();
+    for (const Parameter& parameter : parameters) {
+        size += parameter.type == MYSQL_TYPE_LONGLONG ? sizeof(int64_t) : parameter.data.length();
+    }
+    return size;
+}
+
 DBInsert::DBInsert(Database* dtb, std::string query) : query(std::move(query))
 {
     this->dtb = dtb;
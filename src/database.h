@@ -39,6 +39,7 @@
 
 class DBResult;
 using DBResult_ptr = std::shared_ptr<DBResult>;
+class DBStatement;
 
 class Database
 {
@@ -96,6 +97,19 @@ public:
      */
     DBResult_ptr storeQuery(const std::string& query) const;
 
+    /**
+     * Executes prepared statement.
+     *
+     * Executes statement which doesn't generates results, parameters are sent
+     * in the binary protocol. The prepared handle is cached per connection and
+     * reused by every later statement with the same query text.
+     *
+     * @param statement query and its parameters
+     * @param affectedRows if set, receives the number of rows the statement matched
+     * @return true on success, false on error
+     */
+    bool executeStatement(const DBStatement& statement, uint64_t* affectedRows = nullptr) const;
+
     /**
      * Escapes string for query.
      *
@@ -139,6 +153,19 @@ public:
         return maxPacketSize;
     }
 
+    /**
+     * Connection of the calling thread.
+     *
+     * Threads owning their own connection register it with setThreadInstance,
+     * every other thread shares g_database with the dispatcher.
+     *
+     * @return connection to be used by the calling thread
+     */
+    static Database& getInstance();
+    static void setThreadInstance(Database* database) {
+        threadInstance = database;
+    }
+
 private:
     /**
      * Transaction related methods.
@@ -151,6 +178,14 @@ private:
     bool rollback() const;
     bool commit() const;
 
+    MYSQL_STMT* getStatement(const std::string& query, unsigned int& error) const;
+    void dropStatement(const std::string& query) const;
+
+    static constexpr size_t STATEMENT_CACHE_SIZE = 128;
+
+    static thread_local Database* threadInstance;
+
+    mutable std::unordered_map<std::string, MYSQL_STMT*> statements;
     MYSQL* handle = nullptr;
     uint64_t maxPacketSize = 1048576;
 
@@ -207,6 +242,57 @@ private:
     friend class Database;
 };
 
+/**
+ * Prepared statement.
+ *
+ * Query with '?' placeholders, parameters are added in placeholder order.
+ * It doesn't depend on a connection, so it can be built on one thread and
+ * executed by another one.
+ */
+class DBStatement
+{
+public:
+    DBStatement() = default;
+    explicit DBStatement(const char* query) {
+        this->query << query;
+    }
+
+    std::stringExtended& getQuery() {
+        return query;
+    }
+    const std::string& getQuery() const {
+        return query;
+    }
+
+    void addNumber(int64_t value);
+    void addUnsigned(uint64_t value);
+    void addString(const std::string& value);
+    void addBlob(const char* data, size_t length);
+    void addNull();
+
+    //size of the query and its parameters as sent to the server
+    size_t getSize() const;
+
+private:
+    struct Parameter
+    {
+        Parameter(const enum_field_types type, const int64_t number, const bool isUnsigned) :
+            type(type), number(number), isUnsigned(isUnsigned) {}
+        Parameter(const enum_field_types type, std::string data) :
+            type(type), data(std::move(data)) {}
+
+        enum_field_types type;
+        int64_t number = 0;
+        std::string data;
+        bool isUnsigned = false;
+    };
+
+    std::stringExtended query;
+    std::vector<Parameter> parameters;
+
+    friend class Database;
+};
+
 /**
  * INSERT statement.
  */
@@ -17,61 +17,164 @@
  * with this program; if not, write to the Free Software Foundation, Inc.,
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
-
 #include "otpch.h"
 
 #include "databasetasks.h"
+#include "configmanager.h"
 #include "tasks.h"
 
-void DatabaseTasks::threadMain()
+extern ConfigManager g_config;
+
+void DatabaseTasks::start()
 {
-    std::unique_lock<std::mutex> taskLockUnique(taskLock, std::defer_lock);
-    db.connect();
+    const size_t threads = static_cast<size_t>(std::max<int32_t>(1, g_config.getNumber(ConfigManager::DATABASE_THREADS)));
 
-    while (getState() != THREAD_STATE_TERMINATED) {
-        taskLockUnique.lock();
-        if (tasks.empty()) {
-            if (flushTasks) {
-                flushSignal.notify_one();
+    std::lock_guard<std::mutex> guard(taskLock);
+    state = THREAD_STATE_RUNNING;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+
+    for (auto& worker : workers) {
+        worker->thread = std::thread(&DatabaseTasks::threadMain, this, std::ref(*worker));
+    }
+}
+
+void DatabaseTasks::stop()
+{
+    //tasks already queued still run, new ones are refused
+    std::lock_guard<std::mutex> guard(taskLock);
+    state = THREAD_STATE_CLOSING;
+}
+
+void DatabaseTasks::threadMain(Worker& worker)
+{
+    worker.db.connect();
+    Database::setThreadInstance(&worker.db);
+
+    std::unique_lock<std::mutex> taskLockUnique(taskLock);
+    while (true) {
+        if (worker.tasks.empty()) {
+            if (state == THREAD_STATE_TERMINATED) {
+                break;
             }
-            taskSignal.wait(taskLockUnique);
+            worker.taskSignal.wait(taskLockUnique);
+            continue;
         }
 
-        if (!tasks.empty()) {
-            DatabaseTask task = std::move(tasks.front());
-            tasks.pop_front();
-            taskLockUnique.unlock();
-            runTask(task);
-        } else {
-            taskLockUnique.unlock();
+        DatabaseTask task = std::move(worker.tasks.front());
+        worker.tasks.pop_front();
+        worker.busy = true;
+        taskLockUnique.unlock();
+
+        const auto start = std::chrono::steady_clock::now();
+        runTask(worker.db, task);
+        const auto end = std::chrono::steady_clock::now();
+
+        taskLockUnique.lock();
+        worker.busy = false;
+
+        DatabaseWorkerStats& stats = worker.stats;
+        const auto waitTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(start - task.queued).count());
+        const auto runTime = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+        ++stats.executed;
+        stats.waitTime += waitTime;
+        stats.maxWaitTime = std::max<uint64_t>(stats.maxWaitTime, waitTime);
+        stats.runTime += runTime;
+        stats.maxRunTime = std::max<uint64_t>(stats.maxRunTime, runTime);
+
+        if (worker.tasks.empty()) {
+            flushSignal.notify_all();
         }
     }
+    taskLockUnique.unlock();
+
+    Database::setThreadInstance(nullptr);
+    worker.db.disconnect();
+}
+
+void DatabaseTasks::addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback/* = nullptr*/, const bool store/* = false*/, const uint32_t key/* = 0*/)
+{
+    addTask(DatabaseTask(std::move(query), std::move(callback), store), key);
+}
+
+void DatabaseTasks::addTask(DBStatement statement, std::function<void(DBResult_ptr, bool)> callback/* = nullptr*/, const uint32_t key/* = 0*/)
+{
+    addTask(DatabaseTask(std::move(statement), std::move(callback)), key);
+}
 
-    db.disconnect();
+void DatabaseTasks::addAsyncTask(std::function<void(void)> action, const uint32_t key/* = 0*/)
+{
+    addTask(DatabaseTask(std::move(action)), key);
+}
+
+void DatabaseTasks::addBarrierTask(std::function<void(void)> action)
+{
+    //every connection gets a marker, the last one to reach it runs the action
+    auto remaining = std::make_shared<std::atomic<size_t>>();
+    auto sharedAction = std::make_shared<std::function<void(void)>>(std::move(action));
+
+    std::lock_guard<std::mutex> guard(taskLock);
+    if (state != THREAD_STATE_RUNNING) {
+        return;
+    }
+
+    remaining->store(workers.size(), std::memory_order_relaxed);
+    for (auto& worker : workers) {
+        if (pushTask(*worker, DatabaseTask([remaining, sharedAction]() {
+            if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                (*sharedAction)();
+            }
+        }))) {
+            worker->taskSignal.notify_one();
+        }
+    }
 }
 
-void DatabaseTasks::addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback/* = nullptr*/, bool store/* = false*/)
+void DatabaseTasks::addTask(DatabaseTask&& task, const uint32_t key)
 {
+    Worker* worker = nullptr;
     bool signal = false;
     taskLock.lock();
-    if (getState() == THREAD_STATE_RUNNING) {
-        signal = tasks.empty();
-        tasks.emplace_back(std::move(query), std::move(callback), store);
+    if (state == THREAD_STATE_RUNNING) {
+        worker = workers[key % workers.size()].get();
+        signal = pushTask(*worker, std::move(task));
     }
     taskLock.unlock();
 
     if (signal) {
-        taskSignal.notify_one();
+        worker->taskSignal.notify_one();
     }
 }
 
-void DatabaseTasks::runTask(const DatabaseTask& task) const
+bool DatabaseTasks::pushTask(Worker& worker, DatabaseTask&& task)
 {
+    //taskLock is held by the caller
+    const bool signal = worker.tasks.empty();
+    task.queued = std::chrono::steady_clock::now();
+    worker.tasks.push_back(std::move(task));
+
+    DatabaseWorkerStats& stats = worker.stats;
+    stats.maxQueued = std::max<uint32_t>(stats.maxQueued, static_cast<uint32_t>(worker.tasks.size()));
+    return signal;
+}
+
+void DatabaseTasks::runTask(const Database& db, const DatabaseTask& task)
+{
+    if (task.action) {
+        task.action();
+        return;
+    }
+
     bool success;
     DBResult_ptr result;
     if (task.store) {
         result = db.storeQuery(task.query);
         success = true;
+    } else if (task.query.empty()) {
+        result = nullptr;
+        success = db.executeStatement(task.statement);
     } else {
         result = nullptr;
         success = db.executeQuery(task.query);
@@ -82,19 +185,63 @@ void DatabaseTasks::runTask(const DatabaseTask& task) const
     }
 }
 
+bool DatabaseTasks::isIdle() const
+{
+    for (const auto& worker : workers) {
+        if (worker->busy || !worker->tasks.empty()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void DatabaseTasks::flush()
 {
     std::unique_lock<std::mutex> guard{ taskLock };
-    if (!tasks.empty()) {
-        flushTasks = true;
-        flushSignal.wait(guard);
-        flushTasks = false;
+    flushSignal.wait(guard, [this]() { return isIdle(); });
+}
+
+void DatabaseTasks::flush(const uint32_t key)
+{
+    std::unique_lock<std::mutex> guard{ taskLock };
+    if (workers.empty()) {
+        return;
     }
+
+    const Worker& worker = *workers[key % workers.size()];
+    flushSignal.wait(guard, [&worker]() { return !worker.busy && worker.tasks.empty(); });
 }
 
 void DatabaseTasks::shutdown()
 {
     flush();
-    setState(THREAD_STATE_TERMINATED);
-    taskSignal.notify_one();
-}
\ No newline at end of file
+
+    taskLock.lock();
+    state = THREAD_STATE_TERMINATED;
+    taskLock.unlock();
+
+    for (auto& worker : workers) {
+        worker->taskSignal.notify_one();
+    }
+}
+
+void DatabaseTasks::join()
+{
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+std::vector<DatabaseWorkerStats> DatabaseTasks::getStats()
+{
+    std::vector<DatabaseWorkerStats> stats;
+    std::lock_guard<std::mutex> guard(taskLock);
+    stats.reserve(workers.size());
+    for (const auto& worker : workers) {
+        stats.push_back(worker->stats);
+        stats.back().queued = static_cast<uint32_t>(worker->tasks.size());
+    }
+    return stats;
+}
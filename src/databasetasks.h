@@ -17,43 +17,98 @@
  * with this program; if not, write to the Free Software Foundation, Inc.,
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
-
 #ifndef FS_DATABASETASKS_H_9CBA08E9F5FEBA7275CCEE6560059576
 #define FS_DATABASETASKS_H_9CBA08E9F5FEBA7275CCEE6560059576
 
 #include <condition_variable>
-#include "thread_holder_base.h"
 #include "database.h"
+#include "enums.h"
 
 struct DatabaseTask
 {
     DatabaseTask(std::string&& query, std::function<void(DBResult_ptr, bool)>&& callback, const bool store) :
         query(std::move(query)), callback(std::move(callback)), store(store) {}
+    DatabaseTask(DBStatement&& statement, std::function<void(DBResult_ptr, bool)>&& callback) :
+        callback(std::move(callback)), statement(std::move(statement)), store(false) {}
+    explicit DatabaseTask(std::function<void(void)>&& action) : action(std::move(action)), store(false) {}
 
     std::string query;
     std::function<void(DBResult_ptr, bool)> callback;
+    // runs on the database thread itself, Database::getInstance() resolves to its connection
+    std::function<void(void)> action;
+    DBStatement statement;
+    std::chrono::steady_clock::time_point queued;
     bool store;
 };
 
-class DatabaseTasks : public ThreadHolder<DatabaseTasks>
+struct DatabaseWorkerStats
+{
+    uint64_t executed = 0;
+    // microseconds tasks spent in the queue and running
+    uint64_t waitTime = 0;
+    uint64_t maxWaitTime = 0;
+    uint64_t runTime = 0;
+    uint64_t maxRunTime = 0;
+    uint32_t queued = 0;
+    uint32_t maxQueued = 0;
+};
+
+/**
+ * Background queries, spread over a pool of connections each run by its own thread.
+ *
+ * Tasks queued with the same key run on the same connection in the order they were
+ * queued, tasks with different keys may run in parallel. Key 0 is used by everything
+ * that doesn't care, so those tasks keep running one after another.
+ */
+class DatabaseTasks
 {
 public:
+    // logins are authenticated off key 0, so long jobs queued there (highscore scans) don't hold them up
+    static constexpr uint32_t AUTHENTICATION_KEY = 1;
+
     DatabaseTasks() = default;
+
+    // non-copyable
+    DatabaseTasks(const DatabaseTasks&) = delete;
+    DatabaseTasks& operator=(const DatabaseTasks&) = delete;
+
+    void start();
+    void stop();
     void flush();
+    // waits only for the connection that runs the tasks of key
+    void flush(uint32_t key);
     void shutdown();
+    void join();
+
+    void addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback = nullptr, bool store = false, uint32_t key = 0);
+    void addTask(DBStatement statement, std::function<void(DBResult_ptr, bool)> callback = nullptr, uint32_t key = 0);
+    void addAsyncTask(std::function<void(void)> action, uint32_t key = 0);
+    // runs once every task queued before it finished, whatever its key
+    void addBarrierTask(std::function<void(void)> action);
 
-    void addTask(std::string query, std::function<void(DBResult_ptr, bool)> callback = nullptr, bool store = false);
+    std::vector<DatabaseWorkerStats> getStats();
 
-    void threadMain();
 private:
-    void runTask(const DatabaseTask& task) const;
+    struct Worker
+    {
+        Database db;
+        std::list<DatabaseTask> tasks;
+        std::condition_variable taskSignal;
+        std::thread thread;
+        DatabaseWorkerStats stats;
+        bool busy = false;
+    };
+
+    void threadMain(Worker& worker);
+    void addTask(DatabaseTask&& task, uint32_t key);
+    static bool pushTask(Worker& worker, DatabaseTask&& task);
+    static void runTask(const Database& db, const DatabaseTask& task);
+    bool isIdle() const;
 
-    Database db;
-    std::list<DatabaseTask> tasks;
+    std::vector<std::unique_ptr<Worker>> workers;
     std::mutex taskLock;
-    std::condition_variable taskSignal;
     std::condition_variable flushSignal;
-    bool flushTasks = false;
+    ThreadState state = THREAD_STATE_TERMINATED;
 };
 
 extern DatabaseTasks g_databaseTasks;
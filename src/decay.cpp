@@ -25,6 +25,12 @@
 
 Decay g_decay;
 
+static int64_t getDecayTick(const int64_t timestamp)
+{
+    //round up so that an item never decays before its timestamp
+    return (timestamp + DECAY_BUCKET_INTERVAL - 1) / DECAY_BUCKET_INTERVAL;
+}
+
 void Decay::startDecay(Item* item, const int32_t duration)
 {
     if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP)) {
@@ -32,80 +38,75 @@ void Decay::startDecay(Item* item, const int32_t duration)
     }
 
     const int64_t timestamp = OTSYS_TIME() + static_cast<int64_t>(duration);
-    if (decayMap.empty()) {
-        eventId = g_dispatcher.addEvent(std::max<int32_t>(SERVER_BEAT_MILISECONDS, duration), [this] { checkDecay(); });
-    } else {
-        if (timestamp < decayMap.begin()->first) {
-            g_dispatcher.stopEvent(eventId);
-            eventId = g_dispatcher.addEvent(std::max<int32_t>(SERVER_BEAT_MILISECONDS, duration),
-                                            [this] { checkDecay(); });
-        }
+    if (eventId == 0) {
+        lastTick = OTSYS_TIME() / DECAY_BUCKET_INTERVAL;
+        eventId = g_dispatcher.addEvent(DECAY_BUCKET_INTERVAL, [this] { checkDecay(); });
     }
 
     item->incrementReferenceCounter();
     item->setDecaying(DECAYING_TRUE);
     item->setDurationTimestamp(timestamp);
-    decayMap[timestamp].push_back(item);
+
+    const int64_t tick = getDecayTick(timestamp);
+    std::vector<DecayEntry>& bucket = buckets[tick % DECAY_BUCKET_COUNT];
+    item->attributes->decayIndex = static_cast<uint32_t>(bucket.size());
+    bucket.push_back({item, tick});
+    ++decayingItems;
 }
 
 void Decay::stopDecay(Item* item, const int64_t timestamp)
 {
-    const auto it = decayMap.find(timestamp);
-    if (it != decayMap.end()) {
-        std::vector<Item*>& decayItems = it->second;
-
-        size_t i = 0;
-        const size_t end = decayItems.size();
-        if (end == 1) {
-            if (item == decayItems[i]) {
-                if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
-                    //Incase we removed duration attribute don't assign new duration
-                    item->setDuration(item->getDuration());
-                }
-                item->removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
-                g_game.ReleaseItem(item);
-
-                decayMap.erase(it);
-            }
-            return;
-        }
-        while (i < end) {
-            if (item == decayItems[i]) {
-                if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
-                    //Incase we removed duration attribute don't assign new duration
-                    item->setDuration(item->getDuration());
-                }
-                item->removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
-                g_game.ReleaseItem(item);
-
-                decayItems[i] = decayItems.back();
-                decayItems.pop_back();
-                return;
-            }
-            ++i;
-        }
+    std::vector<DecayEntry>& bucket = buckets[getDecayTick(timestamp) % DECAY_BUCKET_COUNT];
+
+    //the back-index can be stale when the item already left the wheel
+    const uint32_t index = item->attributes->decayIndex;
+    if (index >= bucket.size() || bucket[index].item != item) {
+        return;
     }
+
+    if (item->hasAttribute(ITEM_ATTRIBUTE_DURATION)) {
+        //Incase we removed duration attribute don't assign new duration
+        item->setDuration(item->getDuration());
+    }
+    item->removeAttribute(ITEM_ATTRIBUTE_DECAYSTATE);
+    g_game.ReleaseItem(item);
+
+    removeEntry(bucket, index);
+}
+
+void Decay::removeEntry(std::vector<DecayEntry>& bucket, const uint32_t index)
+{
+    if (index + 1 != bucket.size()) {
+        bucket[index] = bucket.back();
+        bucket[index].item->attributes->decayIndex = index;
+    }
+    bucket.pop_back();
+    --decayingItems;
 }
 
 void Decay::checkDecay()
 {
-    const int64_t timestamp = OTSYS_TIME();
+    const int64_t currentTick = OTSYS_TIME() / DECAY_BUCKET_INTERVAL;
 
     std::vector<Item*> tempItems;
     tempItems.reserve(32);// Small preallocation
 
-    auto it = decayMap.begin();
-    const auto end = decayMap.end();
-    while (it != end) {
-        if (it->first > timestamp) {
-            break;
-        }
+    // Iterating the buckets while decaying is unsafe so let's copy our items into temporary vector,
+    // a late tick catches up on every bucket it skipped but never walks the wheel more than once
+    const int64_t firstTick = std::max<int64_t>(lastTick + 1, currentTick - static_cast<int64_t>(DECAY_BUCKET_COUNT) + 1);
+    for (int64_t tick = firstTick; tick <= currentTick; ++tick) {
+        std::vector<DecayEntry>& bucket = buckets[tick % DECAY_BUCKET_COUNT];
+        for (uint32_t index = 0; index < bucket.size();) {
+            if (bucket[index].tick > currentTick) {
+                ++index;
+                continue;
+            }
 
-        // Iterating here is unsafe so let's copy our items into temporary vector
-        std::vector<Item*>& decayItems = it->second;
-        tempItems.insert(tempItems.end(), decayItems.begin(), decayItems.end());
-        it = decayMap.erase(it);
+            tempItems.push_back(bucket[index].item);
+            removeEntry(bucket, index);
+        }
     }
+    lastTick = std::max<int64_t>(lastTick, currentTick);
 
     for (Item* item : tempItems) {
         if (!item->canDecay()) {
@@ -119,8 +120,9 @@ void Decay::checkDecay()
         g_game.ReleaseItem(item);
     }
 
-    if (it != end) {
-        eventId = g_dispatcher.addEvent(std::max<int32_t>(SERVER_BEAT_MILISECONDS, static_cast<int32_t>(it->first - timestamp)),
-                                        [this] { checkDecay(); });
+    if (decayingItems != 0) {
+        eventId = g_dispatcher.addEvent(DECAY_BUCKET_INTERVAL, [this] { checkDecay(); });
+    } else {
+        eventId = 0;
     }
-}
\ No newline at end of file
+}
@@ -22,6 +22,9 @@
 
 #include "item.h"
 
+static constexpr int32_t DECAY_BUCKET_INTERVAL = 100;
+static constexpr size_t DECAY_BUCKET_COUNT = 1024;
+
 class Decay
 {
 public:
@@ -29,10 +32,21 @@ public:
     void stopDecay(Item* item, int64_t timestamp);
 
 private:
+    struct DecayEntry
+    {
+        Item* item;
+        int64_t tick;
+    };
+
     void checkDecay();
+    void removeEntry(std::vector<DecayEntry>& bucket, uint32_t index);
 
+    //hashed timing wheel, every bucket covers DECAY_BUCKET_INTERVAL ms and items
+    //due more than one lap ahead simply stay in their bucket until their lap comes
+    std::array<std::vector<DecayEntry>, DECAY_BUCKET_COUNT> buckets;
     uint64_t eventId{ 0 };
-    std::map<int64_t, std::vector<Item*>> decayMap;
+    int64_t lastTick = 0;
+    size_t decayingItems = 0;
 };
 
 extern Decay g_decay;
@@ -680,7 +680,9 @@ enum HighscoreCategories_t : uint8_t
     HIGHSCORE_CATEGORY_DISTANCE_FIGHTING,
     HIGHSCORE_CATEGORY_SHIELDING,
     HIGHSCORE_CATEGORY_FISHING,
-    HIGHSCORE_CATEGORY_MAGIC_LEVEL
+    HIGHSCORE_CATEGORY_MAGIC_LEVEL,
+
+    HIGHSCORE_CATEGORY_LAST = HIGHSCORE_CATEGORY_MAGIC_LEVEL
 };
 
 struct HighscoreCategory
@@ -330,4 +330,18 @@
 //that require item movement scripts
 #define GAME_FEATURE_FASTER_CLEAN 1
 
+//Dispatcher instrumentation - queue latency and execution time histograms per call site and the longest stalls
+//available through Game.getDispatcherStats() and Game.dumpDispatcherStats(fileName), every task gets timed so keep it disabled on production
+#define GAME_FEATURE_DISPATCHER_STATS 0
+
+//Decode otbm tile areas on all hardware threads, the result is the same as the serial loader
+#define GAME_FEATURE_PARALLEL_MAP_LOADING 1
+
+//Decode every tile area a second time on the loading thread like the serial loader does and compare tiles and items
+//with what the workers built, loading fails on the first difference - doubles the loading time so it's for debugging only
+#define GAME_FEATURE_PARALLEL_MAP_LOADING_CHECK 0
+
+//Keep the parsed items.otb and items.xml in data/world.cache and load them from there while both files stay unchanged
+#define GAME_FEATURE_WORLD_CACHE 0
+
 #endif
@@ -99,6 +99,8 @@ namespace OTB {
         if (size == 0) {
             return false;
         }
+
+        static thread_local std::vector<char> propBuffer;
         if (propBuffer.size() < size) {
             propBuffer.resize(size);
         }
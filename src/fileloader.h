@@ -74,9 +74,9 @@ namespace OTB {
     {
         MappedFile     fileContents;
         Node              root;
-        std::vector<char> propBuffer;
     public:
         Loader(const std::string& fileName, const Identifier& acceptedIdentifier);
+        // safe to call from several threads at once, every thread unescapes into its own buffer
         bool getProps(const Node& node, PropStream& props);
         const Node& parseTree();
     };
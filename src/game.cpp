@@ -89,6 +89,9 @@ void Game::start(ServiceManager* manager)
 
     g_dispatcher.addEvent(EVENT_LIGHTINTERVAL, [this] { checkLight(); });
     g_dispatcher.addEvent(EVENT_CREATURE_THINK_INTERVAL, [this] { checkCreatures(0); });
+#if GAME_FEATURE_HIGHSCORES > 0
+    highscores.start();
+#endif
 }
 
 GameState_t Game::getGameState() const
@@ -191,14 +194,31 @@ void Game::saveGameState()
 
     std::cout << "Saving server..." << std::endl;
 
+    //players are only snapshotted here, the database thread writes them while the world keeps running
+    const auto start = std::chrono::steady_clock::now();
     for (const auto& it : players) {
         it.second->loginPosition = it.second->getPosition();
-        IOLoginData::savePlayer(it.second);
+        IOLoginData::savePlayerAsync(it.second);
     }
 
     Map::save();
 
-    g_databaseTasks.flush();
+    const auto stall = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    ++serverSaveStats.saves;
+    serverSaveStats.lastStall = stall;
+    serverSaveStats.maxStall = std::max<uint64_t>(serverSaveStats.maxStall, stall);
+    serverSaveStats.lastPlayers = static_cast<uint32_t>(players.size());
+
+    //runs once every snapshot of this save was written, whichever connection it went to
+    g_databaseTasks.addBarrierTask([start] {
+        const auto write = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+        g_dispatcher.addTask([write] {
+            ServerSaveStats& stats = g_game.serverSaveStats;
+            stats.lastWrite = write;
+            stats.maxWrite = std::max<uint64_t>(stats.maxWrite, write);
+            std::cout << "> Saved players in: " << write / 1000000. << " s" << std::endl;
+        });
+    });
 
     if (gameState == GAME_STATE_MAINTAIN) {
         setGameState(GAME_STATE_NORMAL);
@@ -3243,6 +3263,7 @@ void Game::playerWriteItem(Player* player, const uint32_t windowTextId, const st
         writeItem->resetWriter();
         writeItem->resetDate();
     }
+    writeItem->markHouseDirty();
 
     const uint16_t newId = Item::items[writeItem->getID()].writeOnceItemId;
     if (newId != 0) {
@@ -4332,10 +4353,20 @@ bool Game::internalCreatureSay(Creature* creature, const SpeakClasses type, cons
     }
 
     //send to client + event method
+    //the packet doesn't depend on the receiver, so it's encoded once for everyone;
+    //a null fragment means the talk type has no client form and nobody gets it
+    PacketFragment_ptr fragment;
+    bool encoded = false;
     for (Creature* spectator : spectators) {
         if (const Player* tmpPlayer = spectator->getPlayer()) {
             if (!ghostMode || tmpPlayer->canSeeCreature(creature)) {
-                tmpPlayer->sendCreatureSay(creature, type, text, pos);
+                if (!encoded) {
+                    fragment = ProtocolGame::encodeCreatureSay(creature, type, text, pos);
+                    encoded = true;
+                }
+                if (fragment) {
+                    tmpPlayer->sendCreatureSay(fragment);
+                }
             }
         }
 
@@ -4372,6 +4403,24 @@ void Game::checkCreatureAttack(const uint32_t creatureId)
 void Game::addCreatureCheck(Creature* creature)
 {
     creature->creatureCheck = true;
+    if (creature->hibernationTime != 0) {
+        // something needs it before its region wakes up
+        auto it = hibernatedRegions.find(creature->hibernationRegion);
+        if (it != hibernatedRegions.end()) {
+            auto& creatures = it->second;
+            auto iter = std::find(creatures.begin(), creatures.end(), creature);
+            if (iter != creatures.end()) {
+                *iter = creatures.back();
+                creatures.pop_back();
+            }
+            if (creatures.empty()) {
+                hibernatedRegions.erase(it);
+            }
+        }
+        wakeCreature(creature);
+        return;
+    }
+
     if (creature->inCheckCreaturesVector) {
         // already in a vector
         return;
@@ -4395,12 +4444,26 @@ void Game::checkCreatures(const size_t index)
         checkCreatures(capture0);
     });
 
+    const bool hibernation = g_config.getBoolean(ConfigManager::MONSTER_HIBERNATION);
+    if (index == 0) {
+        checkHibernatedRegions();
+    }
+
     auto& checkCreatureList = checkCreatureLists[index];
     size_t it = 0;
     size_t end = checkCreatureList.size();
     while (it < end) {
         Creature* creature = checkCreatureList[it];
         if (creature->creatureCheck) {
+            if (hibernation && creature->getHealth() > 0 && creature->getMonster() && !map.isRegionAwake(Map::getRegionKey(creature->getPosition()))) {
+                // the check list reference moves along with the creature
+                hibernateCreature(creature);
+                checkCreatureList[it] = checkCreatureList.back();
+                checkCreatureList.pop_back();
+                --end;
+                continue;
+            }
+
             if (creature->getHealth() > 0) {
                 creature->onThink(EVENT_CREATURE_THINK_INTERVAL);
                 creature->onAttacking(EVENT_CREATURE_THINK_INTERVAL);
@@ -4421,6 +4484,61 @@ void Game::checkCreatures(const size_t index)
     cleanup();
 }
 
+void Game::checkHibernatedRegions()
+{
+    const bool hibernation = g_config.getBoolean(ConfigManager::MONSTER_HIBERNATION);
+    for (auto it = hibernatedRegions.begin(); it != hibernatedRegions.end();) {
+        auto& creatures = it->second;
+        if (!hibernation || map.isRegionAwake(it->first)) {
+            for (Creature* creature : creatures) {
+                wakeCreature(creature);
+            }
+            it = hibernatedRegions.erase(it);
+            continue;
+        }
+
+        // creatures that went idle, got removed or died meanwhile go back so the check lists deal with them
+        size_t i = 0;
+        while (i < creatures.size()) {
+            Creature* creature = creatures[i];
+            if (!creature->creatureCheck || creature->getHealth() <= 0) {
+                creatures[i] = creatures.back();
+                creatures.pop_back();
+                wakeCreature(creature);
+            } else {
+                ++i;
+            }
+        }
+
+        if (creatures.empty()) {
+            it = hibernatedRegions.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void Game::hibernateCreature(Creature* creature)
+{
+    creature->hibernationTime = OTSYS_TIME();
+    creature->hibernationRegion = Map::getRegionKey(creature->getPosition());
+    hibernatedRegions[creature->hibernationRegion].push_back(creature);
+}
+
+void Game::wakeCreature(Creature* creature)
+{
+    // cleared first, ending conditions below may call addCreatureCheck which must see it awake
+    const int64_t hibernationTime = creature->hibernationTime;
+    creature->hibernationTime = 0;
+    checkCreatureLists[uniform_random(0, EVENT_CREATURECOUNT - 1)].push_back(creature);
+
+    if (creature->creatureCheck && creature->getHealth() > 0) {
+        // conditions did not tick while asleep, each of them catches up on the whole time in one step
+        const int64_t elapsed = OTSYS_TIME() - hibernationTime;
+        creature->executeElapsedConditions(static_cast<uint32_t>(std::min<int64_t>(elapsed, std::numeric_limits<int32_t>::max())));
+    }
+}
+
 void Game::changeSpeed(Creature* creature, const int32_t varSpeedDelta)
 {
     int32_t varSpeed = creature->getSpeed() - creature->getBaseSpeed();
@@ -4431,8 +4549,13 @@ void Game::changeSpeed(Creature* creature, const int32_t varSpeedDelta)
     //send to clients
     SpectatorVector spectators;
     map.getSpectators(spectators, creature->getPosition(), false, true);
+    if (spectators.empty()) {
+        return;
+    }
+
+    const PacketFragment_ptr fragment = ProtocolGame::encodeChangeSpeed(creature, creature->getStepSpeed());
     for (Creature* spectator : spectators) {
-        spectator->getPlayer()->sendChangeSpeed(creature, creature->getStepSpeed());
+        spectator->getPlayer()->sendChangeSpeed(fragment);
     }
 }
 
@@ -4451,8 +4574,13 @@ void Game::internalCreatureChangeOutfit(Creature* creature, const Outfit_t& outf
     //send to clients
     SpectatorVector spectators;
     map.getSpectators(spectators, creature->getPosition(), true, true);
+    if (spectators.empty()) {
+        return;
+    }
+
+    const PacketFragment_ptr fragment = ProtocolGame::encodeCreatureOutfit(creature, outfit);
     for (Creature* spectator : spectators) {
-        spectator->getPlayer()->sendCreatureChangeOutfit(creature, outfit);
+        spectator->getPlayer()->sendCreatureChangeOutfit(creature, fragment);
     }
 }
 
@@ -5166,9 +5294,13 @@ void Game::addCreatureHealth(const SpectatorVector& spectators, const Creature*
     }
 #endif
 
+    PacketFragment_ptr fragment;
     for (Creature* spectator : spectators) {
         if (const Player* tmpPlayer = spectator->getPlayer()) {
-            tmpPlayer->sendCreatureHealth(target, healthPercent);
+            if (!fragment) {
+                fragment = ProtocolGame::encodeCreatureHealth(target, healthPercent);
+            }
+            tmpPlayer->sendCreatureHealth(target, healthPercent, fragment);
         }
     }
 }
@@ -5212,9 +5344,13 @@ void Game::addMagicEffect(const Position& pos, const uint8_t effect)
 
 void Game::addMagicEffect(const SpectatorVector& spectators, const Position& pos, const uint8_t effect)
 {
+    PacketFragment_ptr fragment;
     for (Creature* spectator : spectators) {
         if (const Player* tmpPlayer = spectator->getPlayer()) {
-            tmpPlayer->sendMagicEffect(pos, effect);
+            if (!fragment) {
+                fragment = ProtocolGame::encodeMagicEffect(pos, effect);
+            }
+            tmpPlayer->sendMagicEffect(pos, fragment);
         }
     }
 }
@@ -5250,9 +5386,13 @@ void Game::addDistanceEffect(const Position& fromPos, const Position& toPos, con
 
 void Game::addDistanceEffect(const SpectatorVector& spectators, const Position& fromPos, const Position& toPos, const uint8_t effect)
 {
+    PacketFragment_ptr fragment;
     for (Creature* spectator : spectators) {
         if (const Player* tmpPlayer = spectator->getPlayer()) {
-            tmpPlayer->sendDistanceShoot(fromPos, toPos, effect);
+            if (!fragment) {
+                fragment = ProtocolGame::encodeDistanceShoot(fromPos, toPos, effect);
+            }
+            tmpPlayer->sendDistanceShoot(fragment);
         }
     }
 }
@@ -5958,105 +6098,32 @@ void Game::playerCyclopediaCharacterInfo(Player* player, uint32_t characterID, C
 #if GAME_FEATURE_HIGHSCORES > 0
 void Game::playerHighscores(Player* player, HighscoreType_t type, uint8_t category, uint32_t vocation, const std::string&, uint16_t page, uint8_t entriesPerPage)
 {
-    if (player->hasAsyncOngoingTask(PlayerAsyncTask_Highscore)) {
+    if (!highscores.isLoaded() || entriesPerPage == 0) {
+        player->sendHighscoresNoData();
         return;
     }
 
-    std::string categoryName;
-    switch (category) {
-        case HIGHSCORE_CATEGORY_FIST_FIGHTING: categoryName = "skill_fist"; break;
-        case HIGHSCORE_CATEGORY_CLUB_FIGHTING: categoryName = "skill_club"; break;
-        case HIGHSCORE_CATEGORY_SWORD_FIGHTING: categoryName = "skill_sword"; break;
-        case HIGHSCORE_CATEGORY_AXE_FIGHTING: categoryName = "skill_axe"; break;
-        case HIGHSCORE_CATEGORY_DISTANCE_FIGHTING: categoryName = "skill_dist"; break;
-        case HIGHSCORE_CATEGORY_SHIELDING: categoryName = "skill_shielding"; break;
-        case HIGHSCORE_CATEGORY_FISHING: categoryName = "skill_fishing"; break;
-        case HIGHSCORE_CATEGORY_MAGIC_LEVEL: categoryName = "maglevel"; break;
-        default: {
-            category = HIGHSCORE_CATEGORY_EXPERIENCE;
-            categoryName = "experience";
-            break;
-        }
+    if (category > HIGHSCORE_CATEGORY_LAST) {
+        category = HIGHSCORE_CATEGORY_EXPERIENCE;
     }
 
-    std::stringExtended query(1024);
-    if (type == HIGHSCORE_GETENTRIES) {
-        uint32_t startPage = (static_cast<uint32_t>(page - 1) * static_cast<uint32_t>(entriesPerPage));
-        uint32_t endPage = startPage + static_cast<uint32_t>(entriesPerPage);
-        query << "SELECT *, @row AS `entries`, " << page << " AS `page` FROM (SELECT *, (@row := @row + 1) AS `rn` FROM (SELECT `id`, `name`, `level`, `vocation`, `" << categoryName << "` AS `points`, @curRank := IF(@prevRank = `" << categoryName << "`, @curRank, IF(@prevRank := `" << categoryName << "`, @curRank + 1, @curRank + 1)) AS `rank` FROM `players` `p`, (SELECT @curRank := 0, @prevRank := NULL, @row := 0) `r` ORDER BY `" << categoryName << "` DESC) `t`";
-        if (vocation != 0xFFFFFFFF) {
-            bool firstVocation = true;
-
-            const auto& vocationsMap = g_vocations.getVocations();
-            for (const auto& it : vocationsMap) {
-                const Vocation& voc = it.second;
-                if (voc.getFromVocation() == vocation) {
-                    if (firstVocation) {
-                        query << " WHERE `vocation` = " << voc.getId();
-                        firstVocation = false;
-                    } else {
-                        query << " OR `vocation` = " << voc.getId();
-                    }
-                }
-            }
-        }
-        query << ") `T` WHERE `rn` > " << startPage << " AND `rn` <= " << endPage;
-    } else if (type == HIGHSCORE_OURRANK) {
-        std::string entriesStr = std::to_string(entriesPerPage);
-        query << "SELECT *, @row AS `entries`, (@ourRow DIV " << entriesStr << ") + 1 AS `page` FROM (SELECT *, (@row := @row + 1) AS `rn`, @ourRow := IF(`id` = " << player->getGUID() << ", @row - 1, @ourRow) AS `rw` FROM (SELECT `id`, `name`, `level`, `vocation`, `" << categoryName << "` AS `points`, @curRank := IF(@prevRank = `" << categoryName << "`, @curRank, IF(@prevRank := `" << categoryName << "`, @curRank + 1, @curRank + 1)) AS `rank` FROM `players` `p`, (SELECT @curRank := 0, @prevRank := NULL, @row := 0, @ourRow := 0) `r` ORDER BY `" << categoryName << "` DESC) `t`";
-        if (vocation != 0xFFFFFFFF) {
-            bool firstVocation = true;
-
-            const auto& vocationsMap = g_vocations.getVocations();
-            for (const auto& it : vocationsMap) {
-                const Vocation& voc = it.second;
-                if (voc.getFromVocation() == vocation) {
-                    if (firstVocation) {
-                        query << " WHERE `vocation` = " << voc.getId();
-                        firstVocation = false;
-                    } else {
-                        query << " OR `vocation` = " << voc.getId();
-                    }
-                }
-            }
-        }
-        query << ") `T` WHERE `rn` > ((@ourRow DIV " << entriesStr << ") * " << entriesStr << ") AND `rn` <= (((@ourRow DIV " << entriesStr << ") * " << entriesStr << ") + " << entriesStr << ")";
+    highscores.updatePlayer(player);
+    if (type == HIGHSCORE_OURRANK) {
+        int64_t position = highscores.getPosition(category, vocation, player->getGUID());
+        page = (position >= 0 ? static_cast<uint16_t>(position / entriesPerPage + 1) : 1);
+    } else if (page == 0) {
+        page = 1;
     }
 
-    uint32_t playerID = player->getID();
-    std::function<void(DBResult_ptr, bool)> callback = [playerID, category, vocation, entriesPerPage](DBResult_ptr result, bool) {
-        Player* player = g_game.getPlayerByID(playerID);
-        if (!player) {
-            return;
-        }
-
-        player->resetAsyncOngoingTask(PlayerAsyncTask_Highscore);
-        if (!result) {
-            player->sendHighscoresNoData();
-            return;
-        }
-
-        uint16_t page = result->getNumber<uint16_t>("page");
-        uint32_t pages = result->getNumber<uint32_t>("entries");
-        pages += entriesPerPage - 1;
-        pages /= entriesPerPage;
+    std::vector<HighscoreCharacter> characters;
+    uint32_t entries = highscores.getPage(category, vocation, page, entriesPerPage, characters);
+    if (characters.empty()) {
+        player->sendHighscoresNoData();
+        return;
+    }
 
-        std::vector<HighscoreCharacter> characters;
-        characters.reserve(result->countResults());
-        do {
-            uint8_t characterVocation;
-            Vocation* voc = g_vocations.getVocation(result->getNumber<uint16_t>("vocation"));
-            if (voc) {
-                characterVocation = voc->getClientId();
-            } else {
-                characterVocation = 0;
-            }
-            characters.emplace_back(std::move(result->getString("name")), result->getNumber<uint64_t>("points"), result->getNumber<uint32_t>("id"), result->getNumber<uint32_t>("rank"), result->getNumber<uint16_t>("level"), characterVocation);
-        } while (result->next());
-        player->sendHighscores(characters, category, vocation, page, static_cast<uint16_t>(pages));
-    };
-    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)), callback, true);
-    player->addAsyncOngoingTask(PlayerAsyncTask_Highscore);
+    uint32_t pages = (entries + entriesPerPage - 1) / entriesPerPage;
+    player->sendHighscores(characters, category, vocation, page, static_cast<uint16_t>(pages));
 }
 #endif
 
@@ -6144,9 +6211,18 @@ void Game::playerBrowseMarketOwnHistory(const Player * player)
         return;
     }
 
-    const HistoryMarketOfferList& buyOffers = IOMarket::getOwnHistory(MARKETACTION_BUY, player->getGUID());
-    const HistoryMarketOfferList& sellOffers = IOMarket::getOwnHistory(MARKETACTION_SELL, player->getGUID());
-    player->sendMarketBrowseOwnHistory(buyOffers, sellOffers);
+    //history inserts are queued on the player's key, reading on the same key sees every row written so far
+    const uint32_t guid = player->getGUID();
+    g_databaseTasks.addAsyncTask([playerId = player->getID(), guid]() {
+        auto buyOffers = std::make_shared<HistoryMarketOfferList>(IOMarket::getOwnHistory(MARKETACTION_BUY, guid));
+        auto sellOffers = std::make_shared<HistoryMarketOfferList>(IOMarket::getOwnHistory(MARKETACTION_SELL, guid));
+        g_dispatcher.addTask([playerId, buyOffers, sellOffers]() {
+            Player* player = g_game.getPlayerByID(playerId);
+            if (player && player->isInMarket()) {
+                player->sendMarketBrowseOwnHistory(*buyOffers, *sellOffers);
+            }
+        });
+    }, guid);
 }
 
 void Game::playerCreateMarketOffer(Player * player, uint8_t type, const uint16_t spriteId, const uint16_t amount, const uint32_t price, const bool anonymous)
@@ -6234,7 +6310,7 @@ void Game::playerCreateMarketOffer(Player * player, uint8_t type, const uint16_t
         player->bankBalance -= totalPrice;
     }
 
-    IOMarket::createOffer(player->getGUID(), static_cast<MarketAction_t>(type), it.id, amount, price, anonymous);
+    IOMarket::createOffer(player->getGUID(), player->getName(), static_cast<MarketAction_t>(type), it.id, amount, price, anonymous);
 
     player->sendMarketEnter(player->getLastDepotId());
     const MarketOfferList& buyOffers = IOMarket::getActiveOffers(MARKETACTION_BUY, it.id);
@@ -6334,6 +6410,8 @@ void Game::playerAcceptMarketOffer(Player* player, const uint32_t timestamp, con
 
         Player* buyerPlayer = getPlayerByGUID(offer.playerId);
         if (!buyerPlayer) {
+            //an earlier delivery to the same buyer may still be on its way to the database
+            IOLoginData::waitForPendingSaves(offer.playerId);
             buyerPlayer = new Player(nullptr);
             if (!IOLoginData::loadPlayerById(buyerPlayer, offer.playerId)) {
                 delete buyerPlayer;
@@ -6389,7 +6467,8 @@ void Game::playerAcceptMarketOffer(Player* player, const uint32_t timestamp, con
         }
 
         if (buyerPlayer->isOffline()) {
-            IOLoginData::savePlayer(buyerPlayer);
+            //written behind on the buyer's key, a later login of the buyer reads it back
+            IOLoginData::savePlayerAsync(buyerPlayer);
             delete buyerPlayer;
         } else {
             buyerPlayer->onReceiveMail();
@@ -6626,6 +6705,7 @@ void Game::addPlayer(Player* player)
     mappedPlayerNames[lowercase_name] = player;
     wildcardTree.insert(lowercase_name);
     players[player->getID()] = player;
+    ++playersGeneration;
 }
 
 void Game::removePlayer(const Player* player)
@@ -6634,6 +6714,7 @@ void Game::removePlayer(const Player* player)
     mappedPlayerNames.erase(lowercase_name);
     wildcardTree.remove(lowercase_name);
     players.erase(player->getID());
+    ++playersGeneration;
 }
 
 void Game::addNpc(Npc* npc)
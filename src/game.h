@@ -24,6 +24,7 @@
 #include "account.h"
 #include "combat.h"
 #include "groups.h"
+#include "highscores.h"
 #include "map.h"
 #include "position.h"
 #include "item.h"
@@ -103,6 +104,18 @@ struct RuleViolation
   * This class is responsible to control everything that happens
   */
 
+// stall is the time the dispatcher spent taking the snapshot, write the time until the database thread
+// finished writing it, both in microseconds
+struct ServerSaveStats
+{
+    uint64_t saves = 0;
+    uint64_t lastStall = 0;
+    uint64_t maxStall = 0;
+    uint64_t lastWrite = 0;
+    uint64_t maxWrite = 0;
+    uint32_t lastPlayers = 0;
+};
+
 class Game
 {
 public:
@@ -252,6 +265,10 @@ public:
     uint32_t getPlayersRecord() const {
         return playersRecord;
     }
+    //bumped on every login and logout, also when one replaces the other
+    uint32_t getPlayersGeneration() const {
+        return playersGeneration;
+    }
 
     LightInfo getWorldLightInfo() const;
 
@@ -517,12 +534,18 @@ public:
     GameState_t getGameState() const;
     void setGameState(GameState_t newState);
     void saveGameState();
+    const ServerSaveStats& getServerSaveStats() const {
+        return serverSaveStats;
+    }
 
     //Events
     void checkCreatureWalk(uint32_t creatureId);
     void updateCreatureWalk(uint32_t creatureId);
     void checkCreatureAttack(uint32_t creatureId);
     void checkCreatures(size_t index);
+    void checkHibernatedRegions();
+    void hibernateCreature(Creature* creature);
+    void wakeCreature(Creature* creature);
     void checkLight();
 
     bool combatBlockHit(CombatDamage& damage, Creature* attacker, Creature* target, bool checkDefense, bool checkArmor, bool field);
@@ -611,6 +634,9 @@ public:
     Mounts mounts;
     Raids raids;
     Quests quests;
+#if GAME_FEATURE_HIGHSCORES > 0
+    Highscores highscores;
+#endif
 
 private:
     bool playerSaySpell(Player* player, SpeakClasses type, const std::string& text) const;
@@ -631,6 +657,8 @@ private:
     std::map<uint32_t, uint32_t> stages;
 
     std::vector<Creature*> checkCreatureLists[EVENT_CREATURECOUNT];
+    // creatures taken off the check lists while nobody is near their region, keyed by Map::getRegionKey
+    std::unordered_map<uint32_t, std::vector<Creature*>> hibernatedRegions;
     std::vector<Creature*> ToReleaseCreatures;
     std::vector<Item*> ToReleaseItems;
 
@@ -663,10 +691,13 @@ private:
 
     void updatePlayersRecord() const;
     uint32_t playersRecord = 0;
+    uint32_t playersGeneration = 0;
 
     std::string motdHash;
     uint32_t motdNum = 0;
 
+    ServerSaveStats serverSaveStats;
+
     uint32_t lastStageLevel = 0;
     bool stagesEnabled = false;
     bool useLastStageLevel = false;
@@ -0,0 +1,491 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "highscores.h"
+
+#include "databasetasks.h"
+#include "game.h"
+#include "tasks.h"
+#include "vocation.h"
+
+#if GAME_FEATURE_HIGHSCORES > 0
+extern Game g_game;
+extern Vocations g_vocations;
+
+namespace {
+
+// characters whose vocation isn't known only show up in the unfiltered rankings,
+// which are keyed by this group
+constexpr uint16_t HIGHSCORE_NO_GROUP = std::numeric_limits<uint16_t>::max();
+
+const std::string highscoreColumns[HIGHSCORE_CATEGORY_COUNT] = {
+    "experience", "skill_fist", "skill_club", "skill_sword", "skill_axe",
+    "skill_dist", "skill_shielding", "skill_fishing", "maglevel"
+};
+
+uint32_t getRankingKey(uint8_t category, uint16_t group)
+{
+    return (static_cast<uint32_t>(category) << 16) | group;
+}
+
+uint32_t getNodePriority(uint32_t id)
+{
+    id *= 0x9E3779B1U;
+    id ^= id >> 16;
+    id *= 0x85EBCA6BU;
+    id ^= id >> 13;
+    return id;
+}
+
+}
+
+void RankingTree::build(std::vector<std::pair<uint64_t, uint32_t>>& entries)
+{
+    std::sort(entries.begin(), entries.end(), [](const std::pair<uint64_t, uint32_t>& lhs, const std::pair<uint64_t, uint32_t>& rhs) {
+        return lhs.first > rhs.first || (lhs.first == rhs.first && lhs.second < rhs.second);
+    });
+
+    nodes.resize(1);
+    nodes.reserve(entries.size() + 1);
+    freeNodes.clear();
+    root = 0;
+
+    //entries are sorted, so the treap is put together along its right spine in linear time
+    std::vector<uint32_t> rightSpine;
+    for (const auto& entry : entries) {
+        uint32_t node = createNode(entry.first, entry.second);
+        uint32_t last = 0;
+        while (!rightSpine.empty() && nodes[rightSpine.back()].priority < nodes[node].priority) {
+            last = rightSpine.back();
+            rightSpine.pop_back();
+        }
+
+        nodes[node].left = last;
+        if (!rightSpine.empty()) {
+            nodes[rightSpine.back()].right = node;
+        }
+        rightSpine.push_back(node);
+    }
+
+    if (!rightSpine.empty()) {
+        root = rightSpine.front();
+        buildSizes(root);
+    }
+}
+
+void RankingTree::insert(uint64_t points, uint32_t id)
+{
+    uint32_t node = createNode(points, id);
+    uint32_t left, right;
+    split(root, points, id, left, right);
+    root = merge(merge(left, node), right);
+}
+
+void RankingTree::erase(uint64_t points, uint32_t id)
+{
+    root = erase(root, points, id);
+}
+
+uint32_t RankingTree::countBefore(uint64_t points, uint32_t id) const
+{
+    uint32_t count = 0;
+    uint32_t node = root;
+    while (node != 0) {
+        const Node& current = nodes[node];
+        if (isBefore(current, points, id)) {
+            count += nodes[current.left].size + 1;
+            node = current.right;
+        } else {
+            node = current.left;
+        }
+    }
+    return count;
+}
+
+uint32_t RankingTree::at(uint32_t position) const
+{
+    uint32_t node = root;
+    while (node != 0) {
+        const Node& current = nodes[node];
+        uint32_t leftSize = nodes[current.left].size;
+        if (position < leftSize) {
+            node = current.left;
+        } else if (position == leftSize) {
+            return current.id;
+        } else {
+            position -= leftSize + 1;
+            node = current.right;
+        }
+    }
+    return 0;
+}
+
+uint32_t RankingTree::createNode(uint64_t points, uint32_t id)
+{
+    uint32_t node;
+    if (!freeNodes.empty()) {
+        node = freeNodes.back();
+        freeNodes.pop_back();
+    } else {
+        node = static_cast<uint32_t>(nodes.size());
+        nodes.emplace_back();
+    }
+
+    nodes[node] = Node{points, id, getNodePriority(id), 1, 0, 0};
+    return node;
+}
+
+void RankingTree::buildSizes(uint32_t node)
+{
+    Node& current = nodes[node];
+    if (current.left != 0) {
+        buildSizes(current.left);
+    }
+    if (current.right != 0) {
+        buildSizes(current.right);
+    }
+    updateSize(node);
+}
+
+void RankingTree::updateSize(uint32_t node)
+{
+    Node& current = nodes[node];
+    current.size = nodes[current.left].size + nodes[current.right].size + 1;
+}
+
+void RankingTree::split(uint32_t node, uint64_t points, uint32_t id, uint32_t& left, uint32_t& right)
+{
+    if (node == 0) {
+        left = right = 0;
+        return;
+    }
+
+    Node& current = nodes[node];
+    if (isBefore(current, points, id)) {
+        split(current.right, points, id, current.right, right);
+        left = node;
+    } else {
+        split(current.left, points, id, left, current.left);
+        right = node;
+    }
+    updateSize(node);
+}
+
+uint32_t RankingTree::merge(uint32_t left, uint32_t right)
+{
+    if (left == 0 || right == 0) {
+        return (left != 0 ? left : right);
+    }
+
+    if (nodes[left].priority > nodes[right].priority) {
+        nodes[left].right = merge(nodes[left].right, right);
+        updateSize(left);
+        return left;
+    }
+
+    nodes[right].left = merge(left, nodes[right].left);
+    updateSize(right);
+    return right;
+}
+
+uint32_t RankingTree::erase(uint32_t node, uint64_t points, uint32_t id)
+{
+    if (node == 0) {
+        return 0;
+    }
+
+    Node& current = nodes[node];
+    if (current.points == points && current.id == id) {
+        uint32_t replacement = merge(current.left, current.right);
+        freeNodes.push_back(node);
+        return replacement;
+    }
+
+    if (isBefore(current, points, id)) {
+        current.right = erase(current.right, points, id);
+    } else {
+        current.left = erase(current.left, points, id);
+    }
+    updateSize(node);
+    return node;
+}
+
+void HighscoreIndex::insert(uint32_t id, const HighscoreRecord& record)
+{
+    for (auto& it : rankings) {
+        const uint16_t group = static_cast<uint16_t>(it.first);
+        if (group == HIGHSCORE_NO_GROUP || group == record.group) {
+            it.second.insert(record.points[it.first >> 16], id);
+        }
+    }
+}
+
+void HighscoreIndex::erase(uint32_t id, const HighscoreRecord& record)
+{
+    for (auto& it : rankings) {
+        const uint16_t group = static_cast<uint16_t>(it.first);
+        if (group == HIGHSCORE_NO_GROUP || group == record.group) {
+            it.second.erase(record.points[it.first >> 16], id);
+        }
+    }
+}
+
+RankingTree& HighscoreIndex::buildRanking(uint32_t key)
+{
+    const size_t category = key >> 16;
+    const uint16_t group = static_cast<uint16_t>(key);
+
+    std::vector<std::pair<uint64_t, uint32_t>> entries;
+    if (group == HIGHSCORE_NO_GROUP) {
+        entries.reserve(records.size());
+    }
+
+    for (const auto& it : records) {
+        const HighscoreRecord& record = it.second;
+        if (group == HIGHSCORE_NO_GROUP || record.group == group) {
+            entries.emplace_back(record.points[category], it.first);
+        }
+    }
+
+    RankingTree& ranking = rankings[key];
+    ranking.build(entries);
+    return ranking;
+}
+
+void Highscores::start()
+{
+    rebuild();
+    g_dispatcher.addEvent(CHECK_INTERVAL, [this]() { check(); });
+}
+
+void Highscores::rebuild()
+{
+    //dispatcher thread
+    if (rebuilding) {
+        return;
+    }
+
+    //vocations can be reloaded meanwhile, so the database thread gets its own copy
+    std::unordered_map<uint16_t, uint16_t> vocationGroups;
+    for (const auto& it : g_vocations.getVocations()) {
+        vocationGroups[it.first] = static_cast<uint16_t>(it.second.getFromVocation());
+    }
+
+    //only the rankings that were requested so far are built again
+    std::vector<uint32_t> rankingKeys;
+    rankingKeys.reserve(index->rankings.size());
+    for (const auto& it : index->rankings) {
+        rankingKeys.push_back(it.first);
+    }
+
+    rebuilding = true;
+    g_databaseTasks.addAsyncTask([this, vocationGroups = std::move(vocationGroups), rankingKeys = std::move(rankingKeys)]() {
+        std::shared_ptr<HighscoreIndex> newIndex = std::make_shared<HighscoreIndex>();
+        loadIndex(*newIndex, vocationGroups, rankingKeys);
+        g_dispatcher.addTask([this, newIndex]() {
+            index = newIndex;
+            loaded = true;
+            rebuilding = false;
+
+            //the scan only sees what was saved, online characters are usually ahead of it
+            for (const auto& it : g_game.getPlayers()) {
+                updatePlayer(it.second);
+            }
+        });
+    });
+}
+
+void Highscores::loadIndex(HighscoreIndex& index, const std::unordered_map<uint16_t, uint16_t>& vocationGroups, const std::vector<uint32_t>& rankingKeys)
+{
+    //database thread
+    std::stringExtended query(256);
+    query << "SELECT `id`, `name`, `level`, `vocation`";
+    for (const std::string& column : highscoreColumns) {
+        query << ", `" << column << '`';
+    }
+    query << " FROM `players`";
+
+    DBResult_ptr result = Database::getInstance().storeQuery(query);
+    if (!result) {
+        return;
+    }
+
+    index.records.reserve(result->countResults());
+    do {
+        HighscoreRecord& record = index.records[result->getNumber<uint32_t>("id")];
+        record.name = result->getString("name");
+        record.level = result->getNumber<uint32_t>("level");
+        record.vocation = result->getNumber<uint16_t>("vocation");
+
+        auto it = vocationGroups.find(record.vocation);
+        record.group = (it != vocationGroups.end() ? it->second : HIGHSCORE_NO_GROUP);
+        for (size_t category = 0; category < HIGHSCORE_CATEGORY_COUNT; ++category) {
+            record.points[category] = result->getNumber<uint64_t>(highscoreColumns[category]);
+        }
+    } while (result->next());
+
+    for (uint32_t key : rankingKeys) {
+        index.buildRanking(key);
+    }
+}
+
+void Highscores::updatePlayer(const Player* player)
+{
+    //dispatcher thread
+    if (!loaded) {
+        return;
+    }
+
+    HighscoreRecord record;
+    record.name = player->getName();
+    record.level = player->getLevel();
+    record.vocation = player->getVocationId();
+    record.group = static_cast<uint16_t>(player->getVocation()->getFromVocation());
+    record.points[HIGHSCORE_CATEGORY_EXPERIENCE] = player->getExperience();
+    for (uint8_t skill = SKILL_FIRST; skill <= SKILL_LAST; ++skill) {
+        record.points[HIGHSCORE_CATEGORY_FIST_FIGHTING + skill] = player->getBaseSkill(skill);
+    }
+    record.points[HIGHSCORE_CATEGORY_MAGIC_LEVEL] = player->getBaseMagicLevel();
+
+    const uint32_t guid = player->getGUID();
+    auto it = index->records.find(guid);
+    if (it == index->records.end()) {
+        index->insert(guid, index->records.emplace(guid, std::move(record)).first->second);
+        return;
+    }
+
+    HighscoreRecord& current = it->second;
+    if (current.group == record.group && std::equal(std::begin(current.points), std::end(current.points), std::begin(record.points))) {
+        current.name = std::move(record.name);
+        current.level = record.level;
+        current.vocation = record.vocation;
+        return;
+    }
+
+    index->erase(guid, current);
+    current = std::move(record);
+    index->insert(guid, current);
+}
+
+uint32_t Highscores::getPage(uint8_t category, uint32_t vocation, uint32_t page, uint8_t entriesPerPage, std::vector<HighscoreCharacter>& characters)
+{
+    const RankingTree* ranking = getRanking(category, vocation);
+    if (!ranking) {
+        return 0;
+    }
+
+    uint32_t entries = ranking->size();
+    uint32_t first = (page - 1) * entriesPerPage;
+    uint32_t last = std::min<uint32_t>(entries, first + entriesPerPage);
+    if (first >= last) {
+        return entries;
+    }
+
+    characters.reserve(last - first);
+
+    uint64_t lastPoints = 0;
+    uint32_t rank = 0;
+    for (uint32_t position = first; position < last; ++position) {
+        uint32_t id = ranking->at(position);
+        auto it = index->records.find(id);
+        if (it == index->records.end()) {
+            continue;
+        }
+
+        //characters with the same points share the rank of the first of them
+        const HighscoreRecord& record = it->second;
+        uint64_t points = record.points[category];
+        if (rank == 0 || points != lastPoints) {
+            rank = ranking->countBefore(points, 0) + 1;
+            lastPoints = points;
+        }
+
+        uint8_t characterVocation;
+        Vocation* voc = g_vocations.getVocation(record.vocation);
+        if (voc) {
+            characterVocation = voc->getClientId();
+        } else {
+            characterVocation = 0;
+        }
+        characters.emplace_back(record.name, points, id, rank, static_cast<uint16_t>(record.level), characterVocation);
+    }
+    return entries;
+}
+
+int64_t Highscores::getPosition(uint8_t category, uint32_t vocation, uint32_t id)
+{
+    const RankingTree* ranking = getRanking(category, vocation);
+    if (!ranking) {
+        return -1;
+    }
+
+    auto it = index->records.find(id);
+    if (it == index->records.end()) {
+        return -1;
+    }
+
+    const HighscoreRecord& record = it->second;
+    if (vocation != 0xFFFFFFFF && record.group != vocation) {
+        return -1;
+    }
+    return ranking->countBefore(record.points[category], id);
+}
+
+void Highscores::check()
+{
+    g_dispatcher.addEvent(CHECK_INTERVAL, [this]() { check(); });
+
+    //a rebuild reapplies the online characters once it's done
+    if (++checks >= CHECKS_PER_REBUILD) {
+        checks = 0;
+        rebuild();
+        return;
+    }
+
+    for (const auto& it : g_game.getPlayers()) {
+        updatePlayer(it.second);
+    }
+}
+
+const RankingTree* Highscores::getRanking(uint8_t category, uint32_t vocation)
+{
+    if (category > HIGHSCORE_CATEGORY_LAST) {
+        return nullptr;
+    }
+
+    uint16_t group = HIGHSCORE_NO_GROUP;
+    if (vocation != 0xFFFFFFFF) {
+        //the client picks the vocation, don't build rankings for ones that don't exist
+        if (vocation >= HIGHSCORE_NO_GROUP || !g_vocations.getVocation(static_cast<uint16_t>(vocation))) {
+            return nullptr;
+        }
+        group = static_cast<uint16_t>(vocation);
+    }
+
+    const uint32_t key = getRankingKey(category, group);
+    auto it = index->rankings.find(key);
+    if (it != index->rankings.end()) {
+        return &it->second;
+    }
+    return &index->buildRanking(key);
+}
+#endif
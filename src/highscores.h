@@ -0,0 +1,137 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019  Mark Samman <mark.samman@gmail.com>
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef FS_HIGHSCORES_H_5E0F3A9C27D84B61A1C9F26E8D43B7A0
+#define FS_HIGHSCORES_H_5E0F3A9C27D84B61A1C9F26E8D43B7A0
+
+#include "enums.h"
+
+#if GAME_FEATURE_HIGHSCORES > 0
+class Player;
+
+static constexpr size_t HIGHSCORE_CATEGORY_COUNT = HIGHSCORE_CATEGORY_LAST + 1;
+
+/**
+ * Order-statistic treap keeping one ranking, highest points first and ties by id.
+ * Nodes live in a single vector, index 0 is the empty subtree.
+ */
+class RankingTree
+{
+public:
+    void build(std::vector<std::pair<uint64_t, uint32_t>>& entries);
+    void insert(uint64_t points, uint32_t id);
+    void erase(uint64_t points, uint32_t id);
+
+    // how many entries are ranked ahead of (points, id)
+    uint32_t countBefore(uint64_t points, uint32_t id) const;
+    // id of the entry at the zero-based position
+    uint32_t at(uint32_t position) const;
+
+    uint32_t size() const {
+        return nodes[root].size;
+    }
+
+private:
+    struct Node
+    {
+        uint64_t points;
+        uint32_t id;
+        uint32_t priority;
+        uint32_t size;
+        uint32_t left;
+        uint32_t right;
+    };
+
+    static bool isBefore(const Node& node, uint64_t points, uint32_t id) {
+        return node.points > points || (node.points == points && node.id < id);
+    }
+
+    uint32_t createNode(uint64_t points, uint32_t id);
+    void buildSizes(uint32_t node);
+    void updateSize(uint32_t node);
+    void split(uint32_t node, uint64_t points, uint32_t id, uint32_t& left, uint32_t& right);
+    uint32_t merge(uint32_t left, uint32_t right);
+    uint32_t erase(uint32_t node, uint64_t points, uint32_t id);
+
+    std::vector<Node> nodes = std::vector<Node>(1, Node{0, 0, 0, 0, 0, 0});
+    std::vector<uint32_t> freeNodes;
+    uint32_t root = 0;
+};
+
+struct HighscoreRecord
+{
+    std::string name;
+    uint64_t points[HIGHSCORE_CATEGORY_COUNT];
+    uint32_t level;
+    uint16_t vocation;
+    // vocation the rankings are filtered by, the one this vocation was promoted from
+    uint16_t group;
+};
+
+struct HighscoreIndex
+{
+    void insert(uint32_t id, const HighscoreRecord& record);
+    void erase(uint32_t id, const HighscoreRecord& record);
+    RankingTree& buildRanking(uint32_t key);
+
+    std::unordered_map<uint32_t, HighscoreRecord> records;
+    // only the rankings somebody asked for, keyed by category and group
+    std::map<uint32_t, RankingTree> rankings;
+};
+
+/**
+ * Highscore rankings served from memory instead of sorting the players table per request.
+ *
+ * The whole index is rebuilt from one scan of the players table on a database thread
+ * every now and then, online players are reapplied in between so their own entries
+ * stay current. A ranking is built the first time it's requested and from then on
+ * rebuilt along with the index, the ones nobody looks at never take any memory.
+ */
+class Highscores
+{
+public:
+    void start();
+    void rebuild();
+    void updatePlayer(const Player* player);
+
+    // fills one page of the ranking and returns the number of entries in it
+    uint32_t getPage(uint8_t category, uint32_t vocation, uint32_t page, uint8_t entriesPerPage, std::vector<HighscoreCharacter>& characters);
+    // zero-based position of the character in the ranking, -1 if it isn't ranked
+    int64_t getPosition(uint8_t category, uint32_t vocation, uint32_t id);
+
+    bool isLoaded() const {
+        return loaded;
+    }
+
+private:
+    void check();
+    const RankingTree* getRanking(uint8_t category, uint32_t vocation);
+    static void loadIndex(HighscoreIndex& index, const std::unordered_map<uint16_t, uint16_t>& vocationGroups, const std::vector<uint32_t>& rankingKeys);
+
+    static constexpr int32_t CHECK_INTERVAL = 60 * 1000;
+    static constexpr uint32_t CHECKS_PER_REBUILD = 30;
+
+    std::shared_ptr<HighscoreIndex> index = std::make_shared<HighscoreIndex>();
+    uint32_t checks = 0;
+    bool loaded = false;
+    bool rebuilding = false;
+};
+#endif
+
+#endif
@@ -224,6 +224,7 @@ bool House::transferToDepot() const
         transferToDepot(player);
     } else {
         Player tmpPlayer(nullptr);
+        IOLoginData::waitForPendingSaves(owner);
         if (!IOLoginData::loadPlayerById(&tmpPlayer, owner)) {
             return false;
         }
@@ -701,6 +702,7 @@ void Houses::payHouses(const RentPeriod_t rentPeriod) const
         }
 
         Player player(nullptr);
+        IOLoginData::waitForPendingSaves(ownerId);
         if (!IOLoginData::loadPlayerById(&player, ownerId)) {
             // Player doesn't exist, reset house owner
             house->setOwner(0);
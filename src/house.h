@@ -202,6 +202,17 @@ public:
         return id;
     }
 
+    //set whenever an item on one of the house tiles changes, cleared once the items were written
+    void setItemsDirty() {
+        itemsDirty = true;
+    }
+    void resetItemsDirty() {
+        itemsDirty = false;
+    }
+    bool isItemsDirty() const {
+        return itemsDirty;
+    }
+
     void addDoor(Door* door);
     void removeDoor(Door* door);
     Door* getDoorByNumber(uint32_t doorId) const;
@@ -257,6 +268,7 @@ private:
     Position posEntry = {};
 
     bool isLoaded = false;
+    bool itemsDirty = false;
 };
 
 using HouseMap = std::map<uint32_t, House>;
@@ -25,7 +25,10 @@
 #include "game.h"
 
 HouseTile::HouseTile(const int32_t x, const int32_t y, const int32_t z, House* house) :
-    DynamicTile(x, y, z), house(house) {}
+    DynamicTile(x, y, z), house(house)
+{
+    setFlag(TILESTATE_HOUSE);
+}
 
 void HouseTile::addThing(const int32_t index, Thing* thing)
 {
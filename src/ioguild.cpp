@@ -28,12 +28,12 @@ Guild* IOGuild::loadGuild(const uint32_t guildId)
 {
     std::stringExtended query(128);
     query << "SELECT `name` FROM `guilds` WHERE `id` = " << guildId << " LIMIT 1";
-    if (DBResult_ptr result = g_database.storeQuery(query)) {
+    if (DBResult_ptr result = Database::getInstance().storeQuery(query)) {
         const auto guild = new Guild(guildId, std::move(result->getString("name")));
 
         query.clear();
         query << "SELECT `id`, `name`, `level` FROM `guild_ranks` WHERE `guild_id` = " << guildId;
-        if ((result = g_database.storeQuery(query))) {
+        if ((result = Database::getInstance().storeQuery(query))) {
             do {
                 guild->addRank(result->getNumber<uint32_t>("id"), result->getString("name"), result->getNumber<uint16_t>("level"));
             } while (result->next());
@@ -45,11 +45,11 @@ Guild* IOGuild::loadGuild(const uint32_t guildId)
 
 uint32_t IOGuild::getGuildIdByName(const std::string& name)
 {
-    const std::string& escapedName = g_database.escapeString(name);
+    const std::string& escapedName = Database::getInstance().escapeString(name);
     std::stringExtended query(escapedName.length() + static_cast<size_t>(64));
     query << "SELECT `id` FROM `guilds` WHERE `name` = " << escapedName << " LIMIT 1";
 
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return 0;
     }
@@ -61,7 +61,7 @@ void IOGuild::getWarList(const uint32_t guildId, GuildWarVector& guildWarVector)
     std::stringExtended query(140);
     query << "SELECT `guild1`, `guild2` FROM `guild_wars` WHERE (`guild1` = " << guildId << " OR `guild2` = " << guildId << ") AND `ended` = 0 AND `status` = 1";
 
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return;
     }
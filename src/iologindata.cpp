@@ -24,16 +24,87 @@
 #include "iologindata.h"
 #include "configmanager.h"
 #include "game.h"
+#include "bed.h"
+#include "tasks.h"
 
 extern ConfigManager g_config;
 
+//background writes (saves, bank deposits) queued per player guid, counted down by the database thread as soon as they ran
+struct PendingPlayerSaves
+{
+    uint32_t queued = 0;
+    // a background save failed and the dispatcher hasn't reset the player's save state yet
+    bool failed = false;
+};
+
+static std::mutex pendingPlayerSavesLock;
+static std::unordered_map<uint32_t, PendingPlayerSaves> pendingPlayerSaves;
+
+static void addPendingSave(const uint32_t guid)
+{
+    std::lock_guard<std::mutex> lockClass(pendingPlayerSavesLock);
+    ++pendingPlayerSaves[guid].queued;
+}
+
+static void finishPendingSave(const uint32_t guid, const bool failed = false)
+{
+    //database thread
+    std::lock_guard<std::mutex> lockClass(pendingPlayerSavesLock);
+    const auto it = pendingPlayerSaves.find(guid);
+    if (it == pendingPlayerSaves.end()) {
+        return;
+    }
+
+    PendingPlayerSaves& pending = it->second;
+    --pending.queued;
+    pending.failed = pending.failed || failed;
+    if (pending.queued == 0 && !pending.failed) {
+        pendingPlayerSaves.erase(it);
+    }
+}
+
+static bool takeFailedSave(const uint32_t guid)
+{
+    std::lock_guard<std::mutex> lockClass(pendingPlayerSavesLock);
+    const auto it = pendingPlayerSaves.find(guid);
+    if (it == pendingPlayerSaves.end() || !it->second.failed) {
+        return false;
+    }
+
+    it->second.failed = false;
+    if (it->second.queued == 0) {
+        pendingPlayerSaves.erase(it);
+    }
+    return true;
+}
+
+//characters read by a login that isn't placed yet, flagged when an offline change was saved meanwhile, dispatcher thread
+static std::unordered_map<uint32_t, bool> loginsInFlight;
+
+static void markLoginInFlightChanged(const uint32_t guid)
+{
+    const auto it = loginsInFlight.find(guid);
+    if (it != loginsInFlight.end()) {
+        it->second = true;
+    }
+}
+
+static void startItemDecay(Item* item)
+{
+    if (IOMap::deferredActions) {
+        IOMap::deferredActions->emplace_back(MAPLOAD_ACTION_DECAY, item);
+    } else {
+        item->startDecaying();
+    }
+}
+
 Account IOLoginData::loadAccount(const uint32_t accno)
 {
     Account account;
 
     std::stringExtended query(128);
     query << "SELECT `id`, `name`, `password`, `type`, `premdays`, `lastday` FROM `accounts` WHERE `id` = " << accno << " LIMIT 1";
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return account;
     }
@@ -50,7 +121,7 @@ bool IOLoginData::saveAccount(const Account& acc)
 {
     std::stringExtended query(128);
     query << "UPDATE `accounts` SET `premdays` = " << acc.premiumDays << ", `lastday` = " << acc.lastDay << " WHERE `id` = " << acc.id;
-    return g_database.executeQuery(query);
+    return Database::getInstance().executeQuery(query);
 }
 
 std::string decodeSecret(const std::string& secret)
@@ -85,10 +156,10 @@ std::string decodeSecret(const std::string& secret)
 
 bool IOLoginData::loginserverAuthentication(const std::string& name, const std::string& password, Account& account)
 {
-    const std::string& escapedName = g_database.escapeString(name);
+    const std::string& escapedName = Database::getInstance().escapeString(name);
     std::stringExtended query(escapedName.length() + static_cast<size_t>(128));
     query << "SELECT `id`, `name`, `password`, `secret`, `type`, `premdays`, `lastday` FROM `accounts` WHERE `name` = " << escapedName << " LIMIT 1";
-    DBResult_ptr result = g_database.storeQuery(query);
+    DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return false;
     }
@@ -106,7 +177,7 @@ bool IOLoginData::loginserverAuthentication(const std::string& name, const std::
 
     query.clear();
     query << "SELECT `name`, `deletion` FROM `players` WHERE `account_id` = " << account.id;
-    result = g_database.storeQuery(query);
+    result = Database::getInstance().storeQuery(query);
     if (result) {
         account.characters.reserve(result->countResults());
         do {
@@ -125,8 +196,8 @@ uint32_t IOLoginData::gameworldAuthentication(const std::string& accountName, co
 uint32_t IOLoginData::gameworldAuthentication(const std::string& accountName, const std::string& password, std::string& characterName)
 #endif
 {
-    const std::string& escapedAccountName = g_database.escapeString(accountName);
-    const std::string& escapedCharacterName = g_database.escapeString(characterName);
+    const std::string& escapedAccountName = Database::getInstance().escapeString(accountName);
+    const std::string& escapedCharacterName = Database::getInstance().escapeString(characterName);
     std::stringExtended query(std::max<size_t>(escapedAccountName.length(), escapedCharacterName.length()) + static_cast<size_t>(128));
 
 #if GAME_FEATURE_SESSIONKEY > 0
@@ -134,7 +205,7 @@ uint32_t IOLoginData::gameworldAuthentication(const std::string& accountName, co
 #else
     query << "SELECT `id`, `password` FROM `accounts` WHERE `name` = " << escapedAccountName << " LIMIT 1";
 #endif
-    DBResult_ptr result = g_database.storeQuery(query);
+    DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return 0;
     }
@@ -161,7 +232,7 @@ uint32_t IOLoginData::gameworldAuthentication(const std::string& accountName, co
 
     query.clear();
     query << "SELECT `account_id`, `name`, `deletion` FROM `players` WHERE `name` = " << escapedCharacterName << " LIMIT 1";
-    result = g_database.storeQuery(query);
+    result = Database::getInstance().storeQuery(query);
     if (!result) {
         return 0;
     }
@@ -177,7 +248,7 @@ AccountType_t IOLoginData::getAccountType(const uint32_t accountId)
 {
     std::stringExtended query(64);
     query << "SELECT `type` FROM `accounts` WHERE `id` = " << accountId << " LIMIT 1";
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return ACCOUNT_TYPE_NORMAL;
     }
@@ -188,7 +259,7 @@ void IOLoginData::setAccountType(const uint32_t accountId, const AccountType_t a
 {
     std::stringExtended query(128);
     query << "UPDATE `accounts` SET `type` = " << accountType << " WHERE `id` = " << accountId;
-    g_database.executeQuery(query);
+    Database::getInstance().executeQuery(query);
 }
 
 void IOLoginData::updateOnlineStatus(const uint32_t guid, const bool login)
@@ -203,12 +274,12 @@ void IOLoginData::updateOnlineStatus(const uint32_t guid, const bool login)
     } else {
         query << "DELETE FROM `players_online` WHERE `player_id` = " << guid;
     }
-    g_database.executeQuery(query);
+    Database::getInstance().executeQuery(query);
 }
 
-bool IOLoginData::preloadPlayer(Player* player, const std::string& name)
+bool IOLoginData::preloadPlayer(Player* player, const std::string& name, DeferredPlayerLoad* deferred/* = nullptr*/)
 {
-    const std::string& escapedName = g_database.escapeString(name);
+    const std::string& escapedName = Database::getInstance().escapeString(name);
     std::stringExtended query(escapedName.length() + static_cast<size_t>(280));
 
     query << "SELECT `id`, `account_id`, `group_id`, `deletion`, (SELECT `type` FROM `accounts` WHERE `accounts`.`id` = `account_id`) AS `account_type`";
@@ -216,7 +287,7 @@ bool IOLoginData::preloadPlayer(Player* player, const std::string& name)
         query << ", (SELECT `premdays` FROM `accounts` WHERE `accounts`.`id` = `account_id`) AS `premium_days`";
     }
     query << " FROM `players` WHERE `name` = " << escapedName << " LIMIT 1";
-    DBResult_ptr result = g_database.storeQuery(query);
+    DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return false;
     }
@@ -242,11 +313,37 @@ bool IOLoginData::preloadPlayer(Player* player, const std::string& name)
 
     query.clear();
     query << "SELECT `guild_id`, `rank_id`, `nick` FROM `guild_membership` WHERE `player_id` = " << player->getGUID() << " LIMIT 1";
-    if ((result = g_database.storeQuery(query))) {
+    if ((result = Database::getInstance().storeQuery(query))) {
         const auto guildId = result->getNumber<uint32_t>("guild_id");
         const auto playerRankId = result->getNumber<uint32_t>("rank_id");
         player->guildNick = std::move(result->getString("nick"));
 
+        if (deferred) {
+            //the guild map belongs to the dispatcher, load our own copy and let applyDeferredLoad pick the registered one
+            deferred->guild.reset(IOGuild::loadGuild(guildId));
+            deferred->guildRankId = playerRankId;
+
+            Guild* guild = deferred->guild.get();
+            if (guild) {
+                if (!guild->getRankById(playerRankId)) {
+                    query.clear();
+                    query << "SELECT `id`, `name`, `level` FROM `guild_ranks` WHERE `id` = " << playerRankId << " LIMIT 1";
+                    if ((result = Database::getInstance().storeQuery(query))) {
+                        guild->addRank(result->getNumber<uint32_t>("id"), result->getString("name"), result->getNumber<uint16_t>("level"));
+                    }
+                }
+
+                IOGuild::getWarList(guildId, player->guildWarVector);
+
+                query.clear();
+                query << "SELECT COUNT(*) AS `members` FROM `guild_membership` WHERE `guild_id` = " << guildId << " LIMIT 1";
+                if ((result = Database::getInstance().storeQuery(query))) {
+                    guild->setMemberCount(result->getNumber<uint32_t>("members"));
+                }
+            }
+            return true;
+        }
+
         Guild* guild = g_game.getGuild(guildId);
         if (!guild) {
             guild = IOGuild::loadGuild(guildId);
@@ -260,7 +357,7 @@ bool IOLoginData::preloadPlayer(Player* player, const std::string& name)
             if (!rank) {
                 query.clear();
                 query << "SELECT `id`, `name`, `level` FROM `guild_ranks` WHERE `id` = " << playerRankId << " LIMIT 1";
-                if ((result = g_database.storeQuery(query))) {
+                if ((result = Database::getInstance().storeQuery(query))) {
                     guild->addRank(result->getNumber<uint32_t>("id"), result->getString("name"), result->getNumber<uint16_t>("level"));
                 }
 
@@ -276,7 +373,7 @@ bool IOLoginData::preloadPlayer(Player* player, const std::string& name)
 
             query.clear();
             query << "SELECT COUNT(*) AS `members` FROM `guild_membership` WHERE `guild_id` = " << guildId << " LIMIT 1";
-            if ((result = g_database.storeQuery(query))) {
+            if ((result = Database::getInstance().storeQuery(query))) {
                 guild->setMemberCount(result->getNumber<uint32_t>("members"));
             }
         }
@@ -284,19 +381,66 @@ bool IOLoginData::preloadPlayer(Player* player, const std::string& name)
     return true;
 }
 
-bool IOLoginData::loadPlayerById(Player* player, const uint32_t id)
+void IOLoginData::applyDeferredLoad(Player* player, DeferredPlayerLoad& deferred)
+{
+    //dispatcher thread
+    if (deferred.guild) {
+        Guild* guild = g_game.getGuild(deferred.guild->getId());
+        if (guild) {
+            if (!guild->getRankById(deferred.guildRankId)) {
+                const GuildRank* rank = deferred.guild->getRankById(deferred.guildRankId);
+                if (rank) {
+                    guild->addRank(rank->id, rank->name, rank->level);
+                }
+            }
+            guild->setMemberCount(deferred.guild->getMemberCount());
+            deferred.guild.reset();
+        } else {
+            guild = deferred.guild.release();
+            g_game.addGuild(guild);
+        }
+
+        player->guild = guild;
+        player->guildRank = guild->getRankById(deferred.guildRankId);
+        if (!player->guildRank) {
+            player->guild = nullptr;
+        }
+    }
+
+    for (const MapLoadAction& action : deferred.itemActions) {
+        switch (action.type) {
+            case MAPLOAD_ACTION_UNIQUEID:
+                action.item->setUniqueId(static_cast<uint16_t>(action.value));
+                break;
+
+            case MAPLOAD_ACTION_SLEEPER:
+                static_cast<BedItem*>(action.item)->loadSleeper(action.value);
+                break;
+
+            case MAPLOAD_ACTION_DECAY:
+                action.item->startDecaying();
+                break;
+
+            default:
+                break;
+        }
+    }
+    deferred.itemActions.clear();
+}
+
+bool IOLoginData::loadPlayerById(Player* player, const uint32_t id, const bool loadVIPs)
 {
     std::stringExtended query(1024);
     query << "SELECT `id`, `name`, `account_id`, `group_id`, `sex`, `vocation`, `experience`, `level`, `maglevel`, `health`, `healthmax`, `blessings`, `mana`, `manamax`, `manaspent`, `soul`, `lookbody`, `lookfeet`, `lookhead`, `looklegs`, `looktype`, `lookaddons`, `lookmountbody`, `lookmountfeet`, `lookmounthead`, `lookmountlegs`, `posx`, `posy`, `posz`, `cap`, `lastlogin`, `lastlogout`, `lastip`, `conditions`, `spells`, `storages`, `skulltime`, `skull`, `town_id`, `balance`, `offlinetraining_time`, `offlinetraining_skill`, `stamina`, `skill_fist`, `skill_fist_tries`, `skill_club`, `skill_club_tries`, `skill_sword`, `skill_sword_tries`, `skill_axe`, `skill_axe_tries`, `skill_dist`, `skill_dist_tries`, `skill_shielding`, `skill_shielding_tries`, `skill_fishing`, `skill_fishing_tries`, `direction` FROM `players` WHERE `id` = " << id << " LIMIT 1";
-    return loadPlayer(player, g_database.storeQuery(query));
+    return loadPlayer(player, Database::getInstance().storeQuery(query), loadVIPs);
 }
 
 bool IOLoginData::loadPlayerByName(Player* player, const std::string& name)
 {
-    const std::string& escapedName = g_database.escapeString(name);
+    const std::string& escapedName = Database::getInstance().escapeString(name);
     std::stringExtended query(escapedName.length() + static_cast<size_t>(1024));
     query << "SELECT `id`, `name`, `account_id`, `group_id`, `sex`, `vocation`, `experience`, `level`, `maglevel`, `health`, `healthmax`, `blessings`, `mana`, `manamax`, `manaspent`, `soul`, `lookbody`, `lookfeet`, `lookhead`, `looklegs`, `looktype`, `lookaddons`, `lookmountbody`, `lookmountfeet`, `lookmounthead`, `lookmountlegs`, `posx`, `posy`, `posz`, `cap`, `lastlogin`, `lastlogout`, `lastip`, `conditions`, `spells`, `storages`, `skulltime`, `skull`, `town_id`, `balance`, `offlinetraining_time`, `offlinetraining_skill`, `stamina`, `skill_fist`, `skill_fist_tries`, `skill_club`, `skill_club_tries`, `skill_sword`, `skill_sword_tries`, `skill_axe`, `skill_axe_tries`, `skill_dist`, `skill_dist_tries`, `skill_shielding`, `skill_shielding_tries`, `skill_fishing`, `skill_fishing_tries`, `direction` FROM `players` WHERE `name` = " << escapedName << " LIMIT 1";
-    return loadPlayer(player, g_database.storeQuery(query));
+    return loadPlayer(player, Database::getInstance().storeQuery(query));
 }
 
 bool IOLoginData::loadContainer(PropStream& propStream, Container* mainContainer)
@@ -368,7 +512,7 @@ void IOLoginData::loadItems(ItemBlockList& itemMap, const DBResult_ptr& /*result
     }
 }
 
-bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
+bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result, const bool loadVIPs)
 {
     if (!result) {
         return false;
@@ -555,7 +699,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 
     std::stringExtended query(128);
     query << "SELECT `items` FROM `players` WHERE `id` = " << player->getGUID() << " LIMIT 1";
-    if ((result = g_database.storeQuery(query))) {
+    if ((result = Database::getInstance().storeQuery(query))) {
         attr = result->getStream("items", attrSize);
         propStream.init(attr, attrSize);
         loadItems(itemMap, result, propStream);
@@ -568,7 +712,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
             if (pid >= 1 && pid <= 10) {
 #endif
                 player->internalAddThing(pid, item);
-                item->startDecaying();
+                startItemDecay(item);
             }
             }
         }
@@ -588,7 +732,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 
     query.clear();
     query << "SELECT `depotlockeritems` FROM `players` WHERE `id` = " << player->getGUID() << " LIMIT 1";
-    if ((result = g_database.storeQuery(query))) {
+    if ((result = Database::getInstance().storeQuery(query))) {
         attr = result->getStream("depotlockeritems", attrSize);
         propStream.init(attr, attrSize);
         loadItems(itemMap, result, propStream);
@@ -599,7 +743,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
                 DepotLocker* depotLocker = player->getDepotLocker(pid);
                 if (depotLocker) {
                     depotLocker->internalAddThing(item);
-                    item->startDecaying();
+                    startItemDecay(item);
                 } else {
                     std::cout << "[Error - IOLoginData::loadPlayer " << item->getID() << "] Cannot load depot locker " << pid << " for player " << player->name << std::endl;
                 }
@@ -612,7 +756,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 
     query.clear();
     query << "SELECT `depotitems` FROM `players` WHERE `id` = " << player->getGUID() << " LIMIT 1";
-    if ((result = g_database.storeQuery(query))) {
+    if ((result = Database::getInstance().storeQuery(query))) {
         attr = result->getStream("depotitems", attrSize);
         propStream.init(attr, attrSize);
         loadItems(itemMap, result, propStream);
@@ -623,7 +767,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
                 DepotChest* depotChest = player->getDepotChest(pid, true);
                 if (depotChest) {
                     depotChest->internalAddThing(item);
-                    item->startDecaying();
+                    startItemDecay(item);
                 } else {
                     std::cout << "[Error - IOLoginData::loadPlayer " << item->getID() << "] Cannot load depot " << pid << " for player " << player->name << std::endl;
                 }
@@ -637,14 +781,14 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 
     query.clear();
     query << "SELECT `inboxitems` FROM `players` WHERE `id` = " << player->getGUID() << " LIMIT 1";
-    if ((result = g_database.storeQuery(query))) {
+    if ((result = Database::getInstance().storeQuery(query))) {
         attr = result->getStream("inboxitems", attrSize);
         propStream.init(attr, attrSize);
         loadItems(itemMap, result, propStream);
         for (const auto& it : itemMap) {
             Item* item = it.second;
             player->getInbox()->internalAddThing(item);
-            item->startDecaying();
+            startItemDecay(item);
         }
     }
 #endif
@@ -653,7 +797,7 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
     //load stash items
     query.clear();
     query << "SELECT `supplystash` FROM `players` WHERE `id` = " << player->getGUID() << " LIMIT 1";
-    if ((result = g_database.storeQuery(query))) {
+    if ((result = Database::getInstance().storeQuery(query))) {
         attr = result->getStream("supplystash", attrSize);
         propStream.init(attr, attrSize);
 
@@ -666,12 +810,8 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
 #endif
 
     //load vip
-    query.clear();
-    query << "SELECT `player_id` FROM `account_viplist` WHERE `account_id` = " << player->getAccount();
-    if ((result = g_database.storeQuery(query))) {
-        do {
-            player->addVIPInternal(result->getNumber<uint32_t>("player_id"));
-        } while (result->next());
+    if (loadVIPs) {
+        loadVIPList(player);
     }
 
     player->updateBaseSpeed();
@@ -680,6 +820,17 @@ bool IOLoginData::loadPlayer(Player* player, DBResult_ptr result)
     return true;
     }
 
+void IOLoginData::loadVIPList(Player* player)
+{
+    std::stringExtended query(128);
+    query << "SELECT `player_id` FROM `account_viplist` WHERE `account_id` = " << player->getAccount();
+    if (DBResult_ptr result = Database::getInstance().storeQuery(query)) {
+        do {
+            player->addVIPInternal(result->getNumber<uint32_t>("player_id"));
+        } while (result->next());
+    }
+}
+
 void IOLoginData::saveItem(PropWriteStream & stream, const Item * item)
 {
     const Container* container = item->getContainer();
@@ -733,7 +884,7 @@ void IOLoginData::saveItem(PropWriteStream & stream, const Item * item)
     }
 }
 
-bool IOLoginData::saveItems(const Player * player, const ItemBlockList & itemList, std::stringExtended & query, PropWriteStream & propWriteStream, const std::string & table)
+void IOLoginData::saveItems(const ItemBlockList& itemList, PropWriteStream& propWriteStream)
 {
     for (const auto& it : itemList) {
         const int32_t pid = it.first;
@@ -742,85 +893,334 @@ bool IOLoginData::saveItems(const Player * player, const ItemBlockList & itemLis
         propWriteStream.write<int32_t>(pid);
         saveItem(propWriteStream, item);
     }
+}
 
-    size_t attributesSize;
-    const char* attributes = propWriteStream.getStream(attributesSize);
-    if (attributesSize > 0) {
-        query << "UPDATE `players` SET `" << table << "` = " << g_database.escapeBlob(attributes, attributesSize) << " WHERE `id` = " << player->getGUID();
-        if (!g_database.executeQuery(query)) {
-            return false;
+static uint64_t hashSaveSection(const char* data, const size_t size)
+{
+    //FNV-1a
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(data[i]);
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+void IOLoginData::countPlayerSave(const size_t bytes)
+{
+    PlayerSaveStats& stats = getSaveStats();
+    ++stats.saves;
+    stats.bytes += bytes;
+    stats.lastBytes = bytes;
+}
+
+void IOLoginData::waitForPendingSaves(const uint32_t guid)
+{
+    //dispatcher thread, a background write of this player may still be queued,
+    //it has to land before the player gets loaded or saved directly
+    {
+        std::lock_guard<std::mutex> lockClass(pendingPlayerSavesLock);
+        const auto it = pendingPlayerSaves.find(guid);
+        if (it == pendingPlayerSaves.end() || it->second.queued == 0) {
+            return;
         }
-    } else {
-        query << "UPDATE `players` SET `" << table << "` = NULL WHERE `id` = " << player->getGUID();
-        if (!g_database.executeQuery(query)) {
-            return false;
+    }
+
+    ++getSaveStats().waits;
+    g_databaseTasks.flush(guid);
+}
+
+void IOLoginData::waitForPendingSaves()
+{
+    //for loads by name, the guid isn't known before the load
+    {
+        std::lock_guard<std::mutex> lockClass(pendingPlayerSavesLock);
+        if (std::none_of(pendingPlayerSaves.begin(), pendingPlayerSaves.end(), [](const auto& it) { return it.second.queued != 0; })) {
+            return;
         }
     }
+
+    ++getSaveStats().waits;
+    g_databaseTasks.flush();
+}
+
+void IOLoginData::addLoginInFlight(const uint32_t guid)
+{
+    loginsInFlight[guid] = false;
+}
+
+bool IOLoginData::removeLoginInFlight(const uint32_t guid)
+{
+    const auto it = loginsInFlight.find(guid);
+    if (it == loginsInFlight.end()) {
+        return false;
+    }
+
+    const bool changed = it->second;
+    loginsInFlight.erase(it);
+    return changed;
+}
+
+bool IOLoginData::savePlayer(Player* player)
+{
+    //a background save of this player may still be queued, it must not land after this one
+    waitForPendingSaves(player->getGUID());
+
+    //the save state was advanced when a background save was queued, if that save failed it's ahead of the database
+    if (takeFailedSave(player->getGUID())) {
+        player->saveState = PlayerSaveState();
+    }
+
+    DBStatement statement;
+    PlayerSaveState saveState;
+    if (!preparePlayerSave(player, statement, saveState)) {
+        ++getSaveStats().unchanged;
+        return true;
+    }
+
+    switch (executePlayerSave(player->getGUID(), statement, player->lastLoginSaved, player->lastIP)) {
+        case SAVE_RESULT_FAILED:
+            ++getSaveStats().failed;
+            return false;
+
+        case SAVE_RESULT_DISABLED:
+            //nothing of the diff was written, the next save starts over
+            player->saveState = PlayerSaveState();
+            return true;
+
+        default:
+            break;
+    }
+
+    countPlayerSave(statement.getSize());
+    player->saveState = std::move(saveState);
+    //a login of this character may have read it before this save
+    markLoginInFlightChanged(player->getGUID());
     return true;
 }
 
-bool IOLoginData::savePlayer(Player * player)
+void IOLoginData::savePlayerAsync(Player* player)
 {
-    if (player->getHealth() <= 0) {
-        player->changeHealth(1);
+    //dispatcher thread, the statement built here is the snapshot of the player the database thread writes
+    PlayerSaveState saveState;
+    DBStatement statement;
+    if (!preparePlayerSave(player, statement, saveState)) {
+        ++getSaveStats().unchanged;
+        return;
     }
 
-    std::stringExtended query(2048);
-    query << "SELECT `save` FROM `players` WHERE `id` = " << player->getGUID() << " LIMIT 1";
-    const DBResult_ptr result = g_database.storeQuery(query);
-    if (!result) {
-        return false;
+    //saves of a guid run in queue order, so the next save diffs against this one rather than the last one that landed
+    player->saveState = std::move(saveState);
+
+    const uint32_t guid = player->getGUID();
+    const time_t lastLogin = player->lastLoginSaved;
+    const uint32_t lastIP = player->lastIP;
+    addPendingSave(guid);
+    g_databaseTasks.addAsyncTask([guid, statement = std::move(statement), lastLogin, lastIP]() {
+        const PlayerSaveResult_t result = executePlayerSave(guid, statement, lastLogin, lastIP);
+        finishPendingSave(guid, result != SAVE_RESULT_WRITTEN);
+        g_dispatcher.addTask([guid, bytes = statement.getSize(), result]() {
+            if (result == SAVE_RESULT_WRITTEN) {
+                countPlayerSave(bytes);
+                return;
+            }
+
+            if (result == SAVE_RESULT_FAILED) {
+                ++getSaveStats().failed;
+            }
+
+            //saves queued after this one were diffed against it, so the next save writes everything,
+            //unless a synchronous save already took the failure and wrote everything
+            if (!takeFailedSave(guid)) {
+                return;
+            }
+
+            Player* player = g_game.getPlayerByGUID(guid);
+            if (player) {
+                player->saveState = PlayerSaveState();
+            }
+        });
+    }, guid);
+}
+
+IOLoginData::PlayerSaveResult_t IOLoginData::executePlayerSave(const uint32_t guid, const DBStatement& statement, const time_t lastLogin, const uint32_t lastIP)
+{
+    //the save only matches a row whose save flag is set, so turning it off in the database also stops saving characters that are online
+    Database& db = Database::getInstance();
+    uint64_t affectedRows;
+    if (!db.executeStatement(statement, &affectedRows)) {
+        return SAVE_RESULT_FAILED;
     }
 
-    if (result->getNumber<uint16_t>("save") == 0) {
-        query.clear();
-        query << "UPDATE `players` SET `lastlogin` = " << player->lastLoginSaved << ", `lastip` = " << player->lastIP << " WHERE `id` = " << player->getGUID();
-        return g_database.executeQuery(query);
+    if (affectedRows != 0) {
+        return SAVE_RESULT_WRITTEN;
     }
 
-    //First, an UPDATE query to write the player itself
-    query.clear();
+    DBStatement loginStatement("UPDATE `players` SET `lastlogin` = ?, `lastip` = ? WHERE `id` = ?");
+    loginStatement.addNumber(lastLogin);
+    loginStatement.addNumber(lastIP);
+    loginStatement.addNumber(guid);
+    return (db.executeStatement(loginStatement) ? SAVE_RESULT_DISABLED : SAVE_RESULT_FAILED);
+}
+
+bool IOLoginData::preparePlayerSave(Player* player, DBStatement& statement, PlayerSaveState& saveState)
+{
+    if (player->getHealth() <= 0) {
+        player->changeHealth(1);
+    }
+
+    //Every column is written and only the sections that differ from the last queued save are sent, but the
+    //query text stays the same from save to save, so it's prepared once per connection and the blobs are bound.
+    //The columns are only compared to skip saves where nothing changed at all,
+    //the caller commits saveState to the player once the update is queued or went through
+    saveState = player->saveState;
+
+    std::stringExtended& query = statement.getQuery();
+    query.reserve(1024);
     query << "UPDATE `players` SET ";
-    query << "`level` = " << player->level;
-    query << ",`group_id` = " << player->group->id;
-    query << ",`vocation` = " << player->getVocationId();
-    query << ",`health` = " << player->health;
-    query << ",`healthmax` = " << player->healthMax;
-    query << ",`experience` = " << player->experience;
-    query << ",`lookbody` = " << player->defaultOutfit.lookBody;
-    query << ",`lookfeet` = " << player->defaultOutfit.lookFeet;
-    query << ",`lookhead` = " << player->defaultOutfit.lookHead;
-    query << ",`looklegs` = " << player->defaultOutfit.lookLegs;
-    query << ",`looktype` = " << player->defaultOutfit.lookType;
-    query << ",`lookaddons` = " << player->defaultOutfit.lookAddons;
+
+    const size_t emptyLength = query.length();
+    size_t column = 0;
+    bool changed = false;
+    auto addColumn = [&](const char* name, const auto value) {
+        const size_t index = column++;
+        if (index >= saveState.columns.size()) {
+            saveState.columns.resize(index + 1);
+        }
+
+        std::optional<int64_t>& savedValue = saveState.columns[index];
+        if (!savedValue || *savedValue != static_cast<int64_t>(value)) {
+            savedValue = static_cast<int64_t>(value);
+            changed = true;
+        }
+
+        if (query.length() != emptyLength) {
+            query << ',';
+        }
+        query << '`' << name << "` = ?";
+        statement.addNumber(static_cast<int64_t>(value));
+    };
+    auto skipColumn = [&]() {
+        const size_t index = column++;
+        if (index < saveState.columns.size() && saveState.columns[index]) {
+            saveState.columns[index].reset();
+            changed = true;
+        }
+    };
+    //sections are always in the query, a flag picks between the bound data and what the row already has
+    auto keepSection = [&](const char* name) {
+        query << ",`" << name << "` = IF(?, ?, `" << name << "`)";
+        statement.addNumber(0);
+        statement.addNull();
+    };
+    auto addSection = [&](const PlayerSaveSection_t section, const char* name, const PropWriteStream& propWriteStream, const bool nullIfEmpty) {
+        size_t attributesSize;
+        const char* attributes = propWriteStream.getStream(attributesSize);
+
+        const uint64_t hash = hashSaveSection(attributes, attributesSize);
+        const uint16_t sectionBit = 1U << section;
+        if ((saveState.savedSections & sectionBit) != 0 && saveState.sections[section] == hash) {
+            keepSection(name);
+            return;
+        }
+
+        saveState.savedSections |= sectionBit;
+        saveState.sections[section] = hash;
+        changed = true;
+
+        query << ",`" << name << "` = IF(?, ?, `" << name << "`)";
+        statement.addNumber(1);
+        if (attributesSize > 0 || !nullIfEmpty) {
+            statement.addBlob(attributes, attributesSize);
+        } else {
+            statement.addNull();
+        }
+    };
+
+    addColumn("level", player->level);
+    addColumn("group_id", player->group->id);
+    addColumn("vocation", player->getVocationId());
+    addColumn("health", player->health);
+    addColumn("healthmax", player->healthMax);
+    addColumn("experience", player->experience);
+    addColumn("lookbody", player->defaultOutfit.lookBody);
+    addColumn("lookfeet", player->defaultOutfit.lookFeet);
+    addColumn("lookhead", player->defaultOutfit.lookHead);
+    addColumn("looklegs", player->defaultOutfit.lookLegs);
+    addColumn("looktype", player->defaultOutfit.lookType);
+    addColumn("lookaddons", player->defaultOutfit.lookAddons);
 #if GAME_FEATURE_MOUNT_COLORS > 0
-    query << ",`lookmountbody` = " << player->defaultOutfit.lookMountBody;
-    query << ",`lookmountfeet` = " << player->defaultOutfit.lookMountFeet;
-    query << ",`lookmounthead` = " << player->defaultOutfit.lookMountHead;
-    query << ",`lookmountlegs` = " << player->defaultOutfit.lookMountLegs;
+    addColumn("lookmountbody", player->defaultOutfit.lookMountBody);
+    addColumn("lookmountfeet", player->defaultOutfit.lookMountFeet);
+    addColumn("lookmounthead", player->defaultOutfit.lookMountHead);
+    addColumn("lookmountlegs", player->defaultOutfit.lookMountLegs);
 #endif
-    query << ",`maglevel` = " << player->magLevel;
-    query << ",`mana` = " << player->mana;
-    query << ",`manamax` = " << player->manaMax;
-    query << ",`manaspent` = " << player->manaSpent;
-    query << ",`soul` = " << player->soul;
-    query << ",`town_id` = " << player->town->getID();
+    addColumn("maglevel", player->magLevel);
+    addColumn("mana", player->mana);
+    addColumn("manamax", player->manaMax);
+    addColumn("manaspent", player->manaSpent);
+    addColumn("soul", player->soul);
+    addColumn("town_id", player->town->getID());
 
     const Position& loginPosition = player->getLoginPosition();
-    query << ",`posx` = " << loginPosition.getX();
-    query << ",`posy` = " << loginPosition.getY();
-    query << ",`posz` = " << loginPosition.getZ();
+    addColumn("posx", loginPosition.getX());
+    addColumn("posy", loginPosition.getY());
+    addColumn("posz", loginPosition.getZ());
 
-    query << ",`cap` = " << player->capacity / 100;
-    query << ",`sex` = " << player->sex;
+    addColumn("cap", player->capacity / 100);
+    addColumn("sex", player->sex);
     if (player->lastLoginSaved != 0) {
-        query << ",`lastlogin` = " << player->lastLoginSaved;
+        addColumn("lastlogin", player->lastLoginSaved);
+    } else {
+        skipColumn();
     }
 
     if (player->lastIP != 0) {
-        query << ",`lastip` = " << player->lastIP;
+        addColumn("lastip", player->lastIP);
+    } else {
+        skipColumn();
     }
 
+    if (g_game.getWorldType() != WORLD_TYPE_PVP_ENFORCED) {
+        int64_t skullTime = 0;
+        if (player->skullTicks > 0) {
+            skullTime = time(nullptr) + player->skullTicks;
+        }
+        addColumn("skulltime", skullTime);
+
+        Skulls_t skull = SKULL_NONE;
+        if (player->skull == SKULL_RED || player->skull == SKULL_BLACK) {
+            skull = player->skull;
+        }
+        addColumn("skull", skull);
+    } else {
+        skipColumn();
+        skipColumn();
+    }
+
+    addColumn("lastlogout", player->getLastLogout());
+    addColumn("balance", player->bankBalance);
+    addColumn("offlinetraining_time", player->getOfflineTrainingTime() / 1000);
+    addColumn("offlinetraining_skill", player->getOfflineTrainingSkill());
+    addColumn("stamina", player->getStaminaMinutes());
+
+    addColumn("skill_fist", player->skills[SKILL_FIST].level);
+    addColumn("skill_fist_tries", player->skills[SKILL_FIST].tries);
+    addColumn("skill_club", player->skills[SKILL_CLUB].level);
+    addColumn("skill_club_tries", player->skills[SKILL_CLUB].tries);
+    addColumn("skill_sword", player->skills[SKILL_SWORD].level);
+    addColumn("skill_sword_tries", player->skills[SKILL_SWORD].tries);
+    addColumn("skill_axe", player->skills[SKILL_AXE].level);
+    addColumn("skill_axe_tries", player->skills[SKILL_AXE].tries);
+    addColumn("skill_dist", player->skills[SKILL_DISTANCE].level);
+    addColumn("skill_dist_tries", player->skills[SKILL_DISTANCE].tries);
+    addColumn("skill_shielding", player->skills[SKILL_SHIELD].level);
+    addColumn("skill_shielding_tries", player->skills[SKILL_SHIELD].tries);
+    addColumn("skill_fishing", player->skills[SKILL_FISHING].level);
+    addColumn("skill_fishing_tries", player->skills[SKILL_FISHING].tries);
+    addColumn("direction", player->getDirection());
+    addColumn("blessings", player->blessings);
+
     //serialize conditions
     PropWriteStream propWriteStream;
     for (Condition* condition : player->conditions) {
@@ -829,24 +1229,14 @@ bool IOLoginData::savePlayer(Player * player)
             propWriteStream.write<uint8_t>(CONDITIONATTR_END);
         }
     }
-
-    size_t attributesSize;
-    const char* attributes = propWriteStream.getStream(attributesSize);
-
-    query << ",`conditions` = " << g_database.escapeBlob(attributes, attributesSize);
+    addSection(PLAYER_SAVE_CONDITIONS, "conditions", propWriteStream, false);
 
     // learned spells
     propWriteStream.clear();
     for (const auto& learnedSpell : player->learnedInstantSpellList) {
         propWriteStream.writeString(learnedSpell);
     }
-
-    attributes = propWriteStream.getStream(attributesSize);
-    if (attributesSize > 0) {
-        query << ",`spells` = " << g_database.escapeBlob(attributes, attributesSize);
-    } else {
-        query << ",`spells` = NULL";
-    }
+    addSection(PLAYER_SAVE_SPELLS, "spells", propWriteStream, true);
 
     // storages
     player->genReservedStorageRange();
@@ -856,66 +1246,9 @@ bool IOLoginData::savePlayer(Player * player)
         propWriteStream.write<uint32_t>(it.first);
         propWriteStream.write<int32_t>(it.second);
     }
-
-    attributes = propWriteStream.getStream(attributesSize);
-    if (attributesSize > 0) {
-        query << ",`storages` = " << g_database.escapeBlob(attributes, attributesSize);
-    } else {
-        query << ",`storages` = NULL";
-    }
-
-    if (g_game.getWorldType() != WORLD_TYPE_PVP_ENFORCED) {
-        int64_t skullTime = 0;
-        if (player->skullTicks > 0) {
-            skullTime = time(nullptr) + player->skullTicks;
-        }
-        query << ",`skulltime` = " << skullTime;
-
-        Skulls_t skull = SKULL_NONE;
-        if (player->skull == SKULL_RED || player->skull == SKULL_BLACK) {
-            skull = player->skull;
-        }
-        query << ",`skull` = " << skull;
-    }
-
-    query << ",`lastlogout` = " << player->getLastLogout();
-    query << ",`balance` = " << player->bankBalance;
-    query << ",`offlinetraining_time` = " << player->getOfflineTrainingTime() / 1000;
-    query << ",`offlinetraining_skill` = " << player->getOfflineTrainingSkill();
-    query << ",`stamina` = " << player->getStaminaMinutes();
-
-    query << ",`skill_fist` = " << player->skills[SKILL_FIST].level;
-    query << ",`skill_fist_tries` = " << player->skills[SKILL_FIST].tries;
-    query << ",`skill_club` = " << player->skills[SKILL_CLUB].level;
-    query << ",`skill_club_tries` = " << player->skills[SKILL_CLUB].tries;
-    query << ",`skill_sword` = " << player->skills[SKILL_SWORD].level;
-    query << ",`skill_sword_tries` = " << player->skills[SKILL_SWORD].tries;
-    query << ",`skill_axe` = " << player->skills[SKILL_AXE].level;
-    query << ",`skill_axe_tries` = " << player->skills[SKILL_AXE].tries;
-    query << ",`skill_dist` = " << player->skills[SKILL_DISTANCE].level;
-    query << ",`skill_dist_tries` = " << player->skills[SKILL_DISTANCE].tries;
-    query << ",`skill_shielding` = " << player->skills[SKILL_SHIELD].level;
-    query << ",`skill_shielding_tries` = " << player->skills[SKILL_SHIELD].tries;
-    query << ",`skill_fishing` = " << player->skills[SKILL_FISHING].level;
-    query << ",`skill_fishing_tries` = " << player->skills[SKILL_FISHING].tries;
-    query << ",`direction` = " << player->getDirection();
-    if (!player->isOffline()) {
-        query << ",`onlinetime` = `onlinetime` + " << time(nullptr) - player->lastLoginSaved;
-    }
-    query << ",`blessings` = " << player->blessings;
-    query << " WHERE `id` = " << player->getGUID();
-
-    DBTransaction transaction(&g_database);
-    if (!transaction.begin()) {
-        return false;
-    }
-
-    if (!g_database.executeQuery(query)) {
-        return false;
-    }
+    addSection(PLAYER_SAVE_STORAGES, "storages", propWriteStream, true);
 
     //item saving
-    query.clear();
     ItemBlockList itemList;
 #if GAME_FEATURE_STORE_INBOX > 0 || GAME_FEATURE_PURSE_SLOT > 0
     for (int32_t slotId = 1; slotId <= 11; ++slotId) {
@@ -929,13 +1262,11 @@ bool IOLoginData::savePlayer(Player * player)
     }
 
     propWriteStream.clear();
-    if (!saveItems(player, itemList, query, propWriteStream, "items")) {
-        return false;
-    }
+    saveItems(itemList, propWriteStream);
+    addSection(PLAYER_SAVE_ITEMS, "items", propWriteStream, true);
 
     if (player->lastDepotId != -1) {
         //save depot lockers
-        query.clear();
         itemList.clear();
         for (const auto& it : player->depotLockerMap) {
             const DepotLocker* depotLocker = it.second;
@@ -951,16 +1282,14 @@ bool IOLoginData::savePlayer(Player * player)
                     continue;
                 }
                 itemList.emplace_back(static_cast<int32_t>(it.first), *item);
-                }
-                }
+            }
+        }
 
         propWriteStream.clear();
-        if (!saveItems(player, itemList, query, propWriteStream, "depotlockeritems")) {
-            return false;
-        }
+        saveItems(itemList, propWriteStream);
+        addSection(PLAYER_SAVE_DEPOTLOCKERITEMS, "depotlockeritems", propWriteStream, true);
 
         //save depot items
-        query.clear();
         itemList.clear();
         for (const auto& it : player->depotChests) {
             const DepotChest* depotChest = it.second;
@@ -970,23 +1299,23 @@ bool IOLoginData::savePlayer(Player * player)
         }
 
         propWriteStream.clear();
-        if (!saveItems(player, itemList, query, propWriteStream, "depotitems")) {
-            return false;
-        }
-            }
+        saveItems(itemList, propWriteStream);
+        addSection(PLAYER_SAVE_DEPOTITEMS, "depotitems", propWriteStream, true);
+    } else {
+        keepSection("depotlockeritems");
+        keepSection("depotitems");
+    }
 
 #if GAME_FEATURE_MARKET > 0
     //save inbox items
-    query.clear();
     itemList.clear();
     for (auto item = player->getInbox()->getReversedItems(), end = player->getInbox()->getReversedEnd(); item != end; ++item) {
         itemList.emplace_back(0, *item);
     }
 
     propWriteStream.clear();
-    if (!saveItems(player, itemList, query, propWriteStream, "inboxitems")) {
-        return false;
-    }
+    saveItems(itemList, propWriteStream);
+    addSection(PLAYER_SAVE_INBOXITEMS, "inboxitems", propWriteStream, true);
 #endif
 
 #if GAME_FEATURE_STASH > 0
@@ -996,30 +1325,36 @@ bool IOLoginData::savePlayer(Player * player)
         propWriteStream.write<uint16_t>(it.first);
         propWriteStream.write<uint32_t>(it.second);
     }
+    addSection(PLAYER_SAVE_SUPPLYSTASH, "supplystash", propWriteStream, true);
+#endif
 
-    attributes = propWriteStream.getStream(attributesSize);
-    query.clear();
-    if (attributesSize > 0) {
-        query << "UPDATE `players` SET `supplystash` = " << g_database.escapeBlob(attributes, attributesSize);
-    } else {
-        query << "UPDATE `players` SET `supplystash` = NULL";
+    //onlinetime is accumulated by the database so it is written on every save
+    if (!player->isOffline()) {
+        query << ",`onlinetime` = `onlinetime` + ?";
+        statement.addNumber(time(nullptr) - player->lastLoginSaved);
+        changed = true;
     }
-    query << " WHERE `id` = " << player->getGUID();
 
-    if (!g_database.executeQuery(query)) {
+    if (!changed) {
         return false;
     }
-#endif
 
-    //End the transaction
-    return transaction.commit();
-        }
+    query << " WHERE `id` = ? AND `save` = 1";
+    statement.addNumber(player->getGUID());
+    return true;
+}
+
+IOLoginData::PlayerSaveStats& IOLoginData::getSaveStats()
+{
+    static PlayerSaveStats stats;
+    return stats;
+}
 
 std::string IOLoginData::getNameByGuid(const uint32_t guid)
 {
     std::stringExtended query(64);
     query << "SELECT `name` FROM `players` WHERE `id` = " << guid << " LIMIT 1";
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return {};
     }
@@ -1028,10 +1363,10 @@ std::string IOLoginData::getNameByGuid(const uint32_t guid)
 
 uint32_t IOLoginData::getGuidByName(const std::string & name)
 {
-    const std::string& escapedName = g_database.escapeString(name);
+    const std::string& escapedName = Database::getInstance().escapeString(name);
     std::stringExtended query(escapedName.length() + static_cast<size_t>(64));
     query << "SELECT `id` FROM `players` WHERE `name` = " << escapedName << " LIMIT 1";
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return 0;
     }
@@ -1040,10 +1375,10 @@ uint32_t IOLoginData::getGuidByName(const std::string & name)
 
 bool IOLoginData::getGuidByNameEx(uint32_t & guid, bool& specialVip, std::string & name)
 {
-    const std::string& escapedName = g_database.escapeString(name);
+    const std::string& escapedName = Database::getInstance().escapeString(name);
     std::stringExtended query(escapedName.length() + static_cast<size_t>(128));
     query << "SELECT `name`, `id`, `group_id`, `account_id` FROM `players` WHERE `name` = " << escapedName << " LIMIT 1";
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return false;
     }
@@ -1065,11 +1400,11 @@ bool IOLoginData::getGuidByNameEx(uint32_t & guid, bool& specialVip, std::string
 
 bool IOLoginData::formatPlayerName(std::string & name)
 {
-    const std::string& escapedName = g_database.escapeString(name);
+    const std::string& escapedName = Database::getInstance().escapeString(name);
     std::stringExtended query(escapedName.length() + static_cast<size_t>(64));
     query << "SELECT `name` FROM `players` WHERE `name` = " << escapedName << " LIMIT 1";
 
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return false;
     }
@@ -1082,51 +1417,56 @@ void IOLoginData::increaseBankBalance(const uint32_t guid, const uint64_t bankBa
 {
     std::stringExtended query(128);
     query << "UPDATE `players` SET `balance` = `balance` + " << bankBalance << " WHERE `id` = " << guid;
-    g_database.executeQuery(query);
+    addPendingSave(guid);
+    markLoginInFlightChanged(guid);
+    g_databaseTasks.addAsyncTask([guid, query = std::move(static_cast<std::string&>(query))]() {
+        Database::getInstance().executeQuery(query);
+        finishPendingSave(guid);
+    }, guid);
 }
 
 bool IOLoginData::hasBiddedOnHouse(const uint32_t guid)
 {
     std::stringExtended query(128);
     query << "SELECT `id` FROM `houses` WHERE `highest_bidder` = " << guid << " LIMIT 1";
-    return g_database.storeQuery(query).get() != nullptr;
+    return Database::getInstance().storeQuery(query).get() != nullptr;
 }
 
 void IOLoginData::addVIPEntry(const uint32_t accountId, const uint32_t guid, const std::string & description, const uint32_t icon, const bool notify)
 {
-    const std::string& escapedDescription = g_database.escapeString(description);
+    const std::string& escapedDescription = Database::getInstance().escapeString(description);
     std::stringExtended query(escapedDescription.length() + static_cast<size_t>(256));
     query << "INSERT IGNORE INTO `account_viplist` (`account_id`, `player_id`, `description`, `icon`, `notify`) VALUES (" << accountId << ',' << guid << ',';
     query << escapedDescription << ',' << icon << ',' << (notify ? "1" : "0") << ')';
-    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)));
+    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)), nullptr, false, accountId);
 }
 
 void IOLoginData::editVIPEntry(const uint32_t accountId, const uint32_t guid, const std::string & description, const uint32_t icon, const bool notify)
 {
-    const std::string& escapedDescription = g_database.escapeString(description);
+    const std::string& escapedDescription = Database::getInstance().escapeString(description);
     std::stringExtended query(escapedDescription.length() + static_cast<size_t>(256));
     query << "UPDATE `account_viplist` SET `description` = " << escapedDescription << ", `icon` = " << icon << ", `notify` = " << (notify ? "1" : "0");
     query << " WHERE `account_id` = " << accountId << " AND `player_id` = " << guid;
-    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)));
+    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)), nullptr, false, accountId);
 }
 
 void IOLoginData::removeVIPEntry(const uint32_t accountId, const uint32_t guid)
 {
     std::stringExtended query(128);
     query << "DELETE FROM `account_viplist` WHERE `account_id` = " << accountId << " AND `player_id` = " << guid;
-    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)));
+    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)), nullptr, false, accountId);
 }
 
 void IOLoginData::addPremiumDays(const uint32_t accountId, const int32_t addDays)
 {
     std::stringExtended query(128);
     query << "UPDATE `accounts` SET `premdays` = `premdays` + " << addDays << " WHERE `id` = " << accountId;
-    g_database.executeQuery(query);
+    Database::getInstance().executeQuery(query);
 }
 
 void IOLoginData::removePremiumDays(const uint32_t accountId, const int32_t removeDays)
 {
     std::stringExtended query(128);
     query << "UPDATE `accounts` SET `premdays` = `premdays` - " << removeDays << " WHERE `id` = " << accountId;
-    g_database.executeQuery(query);
+    Database::getInstance().executeQuery(query);
 }
\ No newline at end of file
@@ -24,12 +24,34 @@
 #include "account.h"
 #include "player.h"
 #include "database.h"
+#include "guild.h"
+#include "iomap.h"
 
 using ItemBlockList = std::vector<std::pair<int32_t, Item*>>;
 
+// Shared state touched by a player load running on the database thread,
+// IOLoginData::applyDeferredLoad hands it over to the game on the dispatcher
+struct DeferredPlayerLoad
+{
+    MapLoadActions itemActions;
+    std::unique_ptr<Guild> guild;
+    uint32_t guildRankId = 0;
+};
+
 class IOLoginData
 {
 public:
+    struct PlayerSaveStats
+    {
+        uint64_t saves = 0;
+        uint64_t unchanged = 0;
+        uint64_t bytes = 0;
+        uint64_t lastBytes = 0;
+        uint64_t failed = 0;
+        // synchronous saves that had to wait for a background save of the same player
+        uint64_t waits = 0;
+    };
+
     static Account loadAccount(uint32_t accno);
     static bool saveAccount(const Account& acc);
 
@@ -43,12 +65,21 @@ public:
     static AccountType_t getAccountType(uint32_t accountId);
     static void setAccountType(uint32_t accountId, AccountType_t accountType);
     static void updateOnlineStatus(uint32_t guid, bool login);
-    static bool preloadPlayer(Player* player, const std::string& name);
+    static bool preloadPlayer(Player* player, const std::string& name, DeferredPlayerLoad* deferred = nullptr);
+    static void applyDeferredLoad(Player* player, DeferredPlayerLoad& deferred);
 
-    static bool loadPlayerById(Player* player, uint32_t id);
+    static bool loadPlayerById(Player* player, uint32_t id, bool loadVIPs = true);
     static bool loadPlayerByName(Player* player, const std::string& name);
-    static bool loadPlayer(Player* player, DBResult_ptr result);
+    static bool loadPlayer(Player* player, DBResult_ptr result, bool loadVIPs = true);
+    static void loadVIPList(Player* player);
     static bool savePlayer(Player* player);
+    static void savePlayerAsync(Player* player);
+    static void waitForPendingSaves(uint32_t guid);
+    static void waitForPendingSaves();
+    // logins between admission and placement, the flag tells whether the character was saved meanwhile
+    static void addLoginInFlight(uint32_t guid);
+    static bool removeLoginInFlight(uint32_t guid);
+    static PlayerSaveStats& getSaveStats();
     static uint32_t getGuidByName(const std::string& name);
     static bool getGuidByNameEx(uint32_t& guid, bool& specialVip, std::string& name);
     static std::string getNameByGuid(uint32_t guid);
@@ -64,10 +95,21 @@ public:
     static void removePremiumDays(uint32_t accountId, int32_t removeDays);
 
 private:
+    enum PlayerSaveResult_t
+    {
+        SAVE_RESULT_FAILED,
+        SAVE_RESULT_WRITTEN,
+        // the character has saving turned off, only its login was written
+        SAVE_RESULT_DISABLED,
+    };
+
     static bool loadContainer(PropStream& propStream, Container* container);
     static void loadItems(ItemBlockList& itemMap, const DBResult_ptr& result, PropStream& stream);
     static void saveItem(PropWriteStream& stream, const Item* item);
-    static bool saveItems(const Player* player, const ItemBlockList& itemList, std::stringExtended& query, PropWriteStream& stream, const std::string& table);
+    static void saveItems(const ItemBlockList& itemList, PropWriteStream& stream);
+    static bool preparePlayerSave(Player* player, DBStatement& statement, PlayerSaveState& saveState);
+    static PlayerSaveResult_t executePlayerSave(uint32_t guid, const DBStatement& statement, time_t lastLogin, uint32_t lastIP);
+    static void countPlayerSave(size_t bytes);
 };
 
 #endif
@@ -22,6 +22,10 @@
 
 #include "iomap.h"
 #include "bed.h"
+#include "game.h"
+
+#include <atomic>
+#include <condition_variable>
 
 #ifdef __cpp_lib_filesystem
 #include <filesystem>
@@ -55,6 +59,181 @@ namespace fs = boost::filesystem;
     |--- OTBM_ITEM_DEF (not implemented)
 */
 
+thread_local MapLoadActions* IOMap::deferredActions = nullptr;
+
+static void startItemDecay(Item* item)
+{
+    if (IOMap::deferredActions) {
+        IOMap::deferredActions->emplace_back(MAPLOAD_ACTION_DECAY, item);
+    } else {
+        item->startDecaying();
+    }
+}
+
+//items don't unregister their unique id or sleeper when deleted, drop them before they're left dangling
+static void deleteItem(Item* item)
+{
+    std::vector<Item*> items{item};
+    for (size_t i = 0; i < items.size(); ++i) {
+        Item* current = items[i];
+        if (current->hasAttribute(ITEM_ATTRIBUTE_UNIQUEID)) {
+            g_game.removeUniqueItem(current->getUniqueId());
+        }
+
+        BedItem* bed = current->getBed();
+        if (bed && bed->getSleeper() != 0 && g_game.getBedBySleeper(bed->getSleeper()) == bed) {
+            g_game.removeBedSleeper(bed->getSleeper());
+        }
+
+        if (const Container* container = current->getContainer()) {
+            items.insert(items.end(), container->getItemList().begin(), container->getItemList().end());
+        }
+    }
+    delete item;
+}
+
+static void releaseItem(Item* item)
+{
+    if (!item) {
+        return;
+    }
+
+    if (IOMap::deferredActions) {
+        //the item might still have a pending unique id registration
+        IOMap::deferredActions->emplace_back(MAPLOAD_ACTION_RELEASE, item);
+    } else {
+        deleteItem(item);
+    }
+}
+
+//frees what a tile area batch still owns when it won't be merged into the map
+static void releaseTileArea(const MapLoadActions& actions, const size_t first)
+{
+    for (size_t i = first; i < actions.size(); ++i) {
+        const MapLoadAction& action = actions[i];
+        if (action.type == MAPLOAD_ACTION_SETTILE) {
+            delete action.tile;
+        } else if (action.type == MAPLOAD_ACTION_RELEASE) {
+            deleteItem(action.item);
+        }
+    }
+}
+
+#if GAME_FEATURE_PARALLEL_MAP_LOADING_CHECK > 0
+static bool isSameItem(const Item* first, const Item* second, const bool attributes)
+{
+    if (!first || !second) {
+        return first == second;
+    }
+
+    if (first->getID() != second->getID()) {
+        return false;
+    }
+
+    if (attributes) {
+        PropWriteStream firstStream;
+        PropWriteStream secondStream;
+        first->serializeAttr(firstStream);
+        second->serializeAttr(secondStream);
+
+        size_t firstSize;
+        size_t secondSize;
+        const char* firstData = firstStream.getStream(firstSize);
+        const char* secondData = secondStream.getStream(secondSize);
+        if (firstSize != secondSize || !std::equal(firstData, firstData + firstSize, secondData)) {
+            return false;
+        }
+    }
+
+    const Container* firstContainer = first->getContainer();
+    const Container* secondContainer = second->getContainer();
+    if (!firstContainer || !secondContainer) {
+        return firstContainer == secondContainer;
+    }
+
+    const ItemDeque& firstItems = firstContainer->getItemList();
+    const ItemDeque& secondItems = secondContainer->getItemList();
+    if (firstItems.size() != secondItems.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < firstItems.size(); ++i) {
+        if (!isSameItem(firstItems[i], secondItems[i], attributes)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool isSameTile(const Tile* first, const Tile* second, const bool attributes)
+{
+    if (!first || !second) {
+        return first == second;
+    }
+
+    if (first->getPosition() != second->getPosition() || !isSameItem(first->getGround(), second->getGround(), attributes)) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < 32; ++i) {
+        if (first->hasFlag(1U << i) != second->hasFlag(1U << i)) {
+            return false;
+        }
+    }
+
+    const TileItemVector* firstItems = first->getItemList();
+    const TileItemVector* secondItems = second->getItemList();
+    const size_t firstCount = firstItems ? firstItems->size() : 0;
+    const size_t secondCount = secondItems ? secondItems->size() : 0;
+    if (firstCount != secondCount) {
+        return false;
+    }
+
+    for (size_t i = 0; i < firstCount; ++i) {
+        if (!isSameItem((*firstItems)[i], (*secondItems)[i], attributes)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool isSameTileArea(const MapLoadActions& first, const MapLoadActions& second)
+{
+    if (first.size() != second.size()) {
+        return false;
+    }
+
+    for (size_t i = 0; i < first.size(); ++i) {
+        const MapLoadAction& firstAction = first[i];
+        const MapLoadAction& secondAction = second[i];
+        if (firstAction.type != secondAction.type || firstAction.value != secondAction.value) {
+            return false;
+        }
+
+        switch (firstAction.type) {
+            case MAPLOAD_ACTION_SETTILE:
+                if (!isSameTile(firstAction.tile, secondAction.tile, true)) {
+                    return false;
+                }
+                break;
+
+            case MAPLOAD_ACTION_HOUSETILE:
+                if (firstAction.node != secondAction.node) {
+                    return false;
+                }
+                break;
+
+            default:
+                if (!isSameItem(firstAction.item, secondAction.item, true)) {
+                    return false;
+                }
+                break;
+        }
+    }
+    return true;
+}
+#endif
+
 Tile* IOMap::createTile(Item*& ground, const Item* item, const uint16_t x, const uint16_t y, const uint8_t z)
 {
     if (!ground) {
@@ -69,7 +248,7 @@ Tile* IOMap::createTile(Item*& ground, const Item* item, const uint16_t x, const
     }
 
     tile->internalAddThing(ground);
-    ground->startDecaying();
+    startItemDecay(ground);
     ground = nullptr;
     return tile;
 }
@@ -126,6 +305,11 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
         return false;
     }
 
+    #if GAME_FEATURE_PARALLEL_MAP_LOADING > 0
+    if (!parseTileAreas(loader, mapNode, *map, headerVersion)) {
+        return false;
+    }
+    #else
     for (auto& mapDataNode : mapNode.children) {
         if (mapDataNode.type == OTBM_TILE_AREA) {
             if (!parseTileArea(loader, mapDataNode, *map, headerVersion == 0)) {
@@ -144,6 +328,7 @@ bool IOMap::loadMap(Map* map, const std::string& fileName)
             return false;
         }
     }
+    #endif
 
     std::cout << "> Map loading time: " << (OTSYS_TIME() - start) / 1000. << " seconds." << std::endl;
     return true;
@@ -222,178 +407,391 @@ bool IOMap::parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Ma
             return false;
         }
 
-        if (!loader.getProps(tileNode, propStream)) {
-            setLastErrorString("Could not read node data.");
-            return false;
+        if (deferredActions && tileNode.type == OTBM_HOUSETILE) {
+            //houses are shared between tile areas so their tiles get parsed when the area is applied
+            deferredActions->emplace_back(&tileNode);
+            continue;
         }
 
-        OTBM_Tile_coords tile_coord;
-        if (!propStream.read(tile_coord)) {
-            setLastErrorString("Could not read tile position.");
+        if (!parseTile(loader, tileNode, map, _legacy, base_x, base_y, z)) {
             return false;
         }
+    }
+    return true;
+}
 
-        uint16_t x = base_x + tile_coord.x;
-        uint16_t y = base_y + tile_coord.y;
-
-        bool isHouseTile = false;
-        House* house = nullptr;
-        Tile* tile = nullptr;
-        Item* ground_item = nullptr;
-        uint32_t tileflags = TILESTATE_NONE;
+bool IOMap::parseTile(OTB::Loader& loader, const OTB::Node& tileNode, Map& map, bool _legacy, const uint16_t base_x, const uint16_t base_y, const uint16_t z)
+{
+    PropStream propStream;
+    if (!loader.getProps(tileNode, propStream)) {
+        setLastErrorString("Could not read node data.");
+        return false;
+    }
 
-        if (tileNode.type == OTBM_HOUSETILE) {
-            uint32_t houseId;
-            if (!propStream.read<uint32_t>(houseId)) {
-                std::stringExtended ss(128);
-                ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not read house id.";
-                setLastErrorString(std::move(static_cast<std::string&>(ss)));
-                return false;
-            }
+    OTBM_Tile_coords tile_coord;
+    if (!propStream.read(tile_coord)) {
+        setLastErrorString("Could not read tile position.");
+        return false;
+    }
 
-            house = map.houses.addHouse(houseId);
-            if (!house) {
-                std::stringExtended ss(128);
-                ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not create house id: " << houseId;
-                setLastErrorString(std::move(static_cast<std::string&>(ss)));
-                return false;
-            }
+    uint16_t x = base_x + tile_coord.x;
+    uint16_t y = base_y + tile_coord.y;
+
+    bool isHouseTile = false;
+    House* house = nullptr;
+    Tile* tile = nullptr;
+    Item* ground_item = nullptr;
+    uint32_t tileflags = TILESTATE_NONE;
+
+    if (tileNode.type == OTBM_HOUSETILE) {
+        uint32_t houseId;
+        if (!propStream.read<uint32_t>(houseId)) {
+            std::stringExtended ss(128);
+            ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not read house id.";
+            setLastErrorString(std::move(static_cast<std::string&>(ss)));
+            return false;
+        }
 
-            tile = new HouseTile(x, y, z, house);
-            house->addTile(static_cast<HouseTile*>(tile));
-            isHouseTile = true;
-        }
-
-        uint8_t attribute;
-        //read tile attributes
-        while (propStream.read<uint8_t>(attribute)) {
-            switch (attribute) {
-                case OTBM_ATTR_TILE_FLAGS: {
-                    uint32_t flags;
-                    if (!propStream.read<uint32_t>(flags)) {
-                        std::stringExtended ss(128);
-                        ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to read tile flags.";
-                        setLastErrorString(std::move(static_cast<std::string&>(ss)));
-                        return false;
-                    }
+        house = map.houses.addHouse(houseId);
+        if (!house) {
+            std::stringExtended ss(128);
+            ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Could not create house id: " << houseId;
+            setLastErrorString(std::move(static_cast<std::string&>(ss)));
+            return false;
+        }
 
-                    if ((flags & OTBM_TILEFLAG_PROTECTIONZONE) != 0) {
-                        tileflags |= TILESTATE_PROTECTIONZONE;
-                    } else if ((flags & OTBM_TILEFLAG_NOPVPZONE) != 0) {
-                        tileflags |= TILESTATE_NOPVPZONE;
-                    } else if ((flags & OTBM_TILEFLAG_PVPZONE) != 0) {
-                        tileflags |= TILESTATE_PVPZONE;
-                    }
+        tile = new HouseTile(x, y, z, house);
+        house->addTile(static_cast<HouseTile*>(tile));
+        isHouseTile = true;
+    }
 
-                    if ((flags & OTBM_TILEFLAG_NOLOGOUT) != 0) {
-                        tileflags |= TILESTATE_NOLOGOUT;
-                    }
-                    break;
+    uint8_t attribute;
+    //read tile attributes
+    while (propStream.read<uint8_t>(attribute)) {
+        switch (attribute) {
+            case OTBM_ATTR_TILE_FLAGS: {
+                uint32_t flags;
+                if (!propStream.read<uint32_t>(flags)) {
+                    std::stringExtended ss(128);
+                    ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to read tile flags.";
+                    setLastErrorString(std::move(static_cast<std::string&>(ss)));
+                    return false;
                 }
 
-                case OTBM_ATTR_ITEM: {
-                    Item* item = _legacy ? Item::CreateItem_legacy(propStream) : Item::CreateItem(propStream);
-                    if (!item) {
-                        std::stringExtended ss(128);
-                        ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
-                        setLastErrorString(std::move(static_cast<std::string&>(ss)));
-                        return false;
-                    }
+                if ((flags & OTBM_TILEFLAG_PROTECTIONZONE) != 0) {
+                    tileflags |= TILESTATE_PROTECTIONZONE;
+                } else if ((flags & OTBM_TILEFLAG_NOPVPZONE) != 0) {
+                    tileflags |= TILESTATE_NOPVPZONE;
+                } else if ((flags & OTBM_TILEFLAG_PVPZONE) != 0) {
+                    tileflags |= TILESTATE_PVPZONE;
+                }
 
-                    if (isHouseTile && item->isMoveable()) {
-                        std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;
-                        delete item;
-                    } else {
-                        if (item->getItemCount() == 0) {
-                            item->setItemCount(1);
-                        }
-
-                        if (tile) {
-                            tile->internalAddThing(item);
-                            item->startDecaying();
-                            item->setLoadedFromMap(true);
-                        } else if (item->isGroundTile()) {
-                            delete ground_item;
-                            ground_item = item;
-                        } else {
-                            tile = createTile(ground_item, item, x, y, z);
-                            tile->internalAddThing(item);
-                            item->startDecaying();
-                            item->setLoadedFromMap(true);
-                        }
-                    }
-                    break;
+                if ((flags & OTBM_TILEFLAG_NOLOGOUT) != 0) {
+                    tileflags |= TILESTATE_NOLOGOUT;
                 }
+                break;
+            }
 
-                default:
+            case OTBM_ATTR_ITEM: {
+                Item* item = _legacy ? Item::CreateItem_legacy(propStream) : Item::CreateItem(propStream);
+                if (!item) {
                     std::stringExtended ss(128);
-                    ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown tile attribute.";
+                    ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
                     setLastErrorString(std::move(static_cast<std::string&>(ss)));
                     return false;
+                }
+
+                if (isHouseTile && item->isMoveable()) {
+                    std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;
+                    releaseItem(item);
+                } else {
+                    if (item->getItemCount() == 0) {
+                        item->setItemCount(1);
+                    }
+
+                    if (tile) {
+                        tile->internalAddThing(item);
+                        startItemDecay(item);
+                        item->setLoadedFromMap(true);
+                    } else if (item->isGroundTile()) {
+                        releaseItem(ground_item);
+                        ground_item = item;
+                    } else {
+                        tile = createTile(ground_item, item, x, y, z);
+                        tile->internalAddThing(item);
+                        startItemDecay(item);
+                        item->setLoadedFromMap(true);
+                    }
+                }
+                break;
             }
-        }
 
-        for (auto& itemNode : tileNode.children) {
-            if (itemNode.type != OTBM_ITEM) {
+            default:
                 std::stringExtended ss(128);
-                ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown node type.";
+                ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown tile attribute.";
                 setLastErrorString(std::move(static_cast<std::string&>(ss)));
                 return false;
+        }
+    }
+
+    for (auto& itemNode : tileNode.children) {
+        if (itemNode.type != OTBM_ITEM) {
+            std::stringExtended ss(128);
+            ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Unknown node type.";
+            setLastErrorString(std::move(static_cast<std::string&>(ss)));
+            return false;
+        }
+
+        PropStream stream;
+        if (!loader.getProps(itemNode, stream)) {
+            setLastErrorString("Invalid item node.");
+            return false;
+        }
+
+        Item* item = _legacy ? Item::CreateItem_legacy(stream) : Item::CreateItem(stream);
+        if (!item) {
+            std::stringExtended ss(128);
+            ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
+            setLastErrorString(std::move(static_cast<std::string&>(ss)));
+            return false;
+        }
+
+        if (!item->unserializeItemNode(loader, itemNode, stream, _legacy)) {
+            std::stringExtended ss(128);
+            ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to load item " << item->getID() << '.';
+            setLastErrorString(std::move(static_cast<std::string&>(ss)));
+            releaseItem(item);
+            return false;
+        }
+
+        if (isHouseTile && item->isMoveable()) {
+            std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;
+            releaseItem(item);
+        } else {
+            if (item->getItemCount() == 0) {
+                item->setItemCount(1);
             }
 
-            PropStream stream;
-            if (!loader.getProps(itemNode, stream)) {
-                setLastErrorString("Invalid item node.");
-                return false;
+            if (tile) {
+                tile->internalAddThing(item);
+                startItemDecay(item);
+                item->setLoadedFromMap(true);
+            } else if (item->isGroundTile()) {
+                releaseItem(ground_item);
+                ground_item = item;
+            } else {
+                tile = createTile(ground_item, item, x, y, z);
+                tile->internalAddThing(item);
+                startItemDecay(item);
+                item->setLoadedFromMap(true);
             }
+        }
+    }
 
-            Item* item = _legacy ? Item::CreateItem_legacy(stream) : Item::CreateItem(stream);
-            if (!item) {
-                std::stringExtended ss(128);
-                ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to create item.";
-                setLastErrorString(std::move(static_cast<std::string&>(ss)));
-                return false;
+    if (!tile) {
+        tile = createTile(ground_item, nullptr, x, y, z);
+    }
+
+    tile->setFlag(tileflags);
+
+    if (deferredActions) {
+        deferredActions->emplace_back(tile);
+    } else {
+        map.setTile(x, y, z, tile);
+    }
+    return true;
+}
+
+bool IOMap::parseTileAreas(OTB::Loader& loader, const OTB::Node& mapNode, Map& map, const uint32_t headerVersion)
+{
+    const bool legacy = headerVersion == 0;
+
+    //first pass - index the tile areas so they can be decoded on worker threads
+    std::vector<MapTileArea> areas;
+    for (auto& mapDataNode : mapNode.children) {
+        if (mapDataNode.type == OTBM_TILE_AREA) {
+            areas.emplace_back(&mapDataNode);
+        }
+    }
+
+    std::mutex areasLock;
+    std::condition_variable areasSignal;
+    std::atomic<size_t> nextArea(0);
+    std::atomic<bool> stopped(false);
+
+    //second pass - workers decode whole areas into batches of tiles and deferred actions
+    auto decodeAreas = [&]() {
+        IOMap areaLoader;
+        while (!stopped.load(std::memory_order_relaxed)) {
+            const size_t index = nextArea.fetch_add(1, std::memory_order_relaxed);
+            if (index >= areas.size()) {
+                break;
             }
 
-            if (!item->unserializeItemNode(loader, itemNode, stream, _legacy)) {
-                std::stringExtended ss(128);
-                ss << "[x:" << x << ", y:" << y << ", z:" << z << "] Failed to load item " << item->getID() << '.';
-                setLastErrorString(std::move(static_cast<std::string&>(ss)));
-                delete item;
-                return false;
+            MapTileArea& area = areas[index];
+            deferredActions = &area.actions;
+            if (!areaLoader.parseTileArea(loader, *area.node, map, legacy)) {
+                area.error = areaLoader.getLastErrorString();
             }
+            deferredActions = nullptr;
 
-            if (isHouseTile && item->isMoveable()) {
-                std::cout << "[Warning - IOMap::loadMap] Moveable item with ID: " << item->getID() << ", in house: " << house->getId() << ", at position [x: " << x << ", y: " << y << ", z: " << z << "]." << std::endl;
-                delete item;
-            } else {
-                if (item->getItemCount() == 0) {
-                    item->setItemCount(1);
+            std::lock_guard<std::mutex> lockGuard(areasLock);
+            area.done = true;
+            areasSignal.notify_one();
+        }
+    };
+
+    const size_t threads = std::min<size_t>(std::max<uint32_t>(std::thread::hardware_concurrency(), 1), areas.size());
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back(decodeAreas);
+    }
+
+#if GAME_FEATURE_PARALLEL_MAP_LOADING_CHECK > 0
+    //the same areas decoded by the serial loader, kept until the merged map got compared against them
+    std::vector<MapTileArea> checkAreas;
+    checkAreas.reserve(areas.size());
+#endif
+
+    //batches are merged into the map in file order while the workers keep decoding
+    bool success = true;
+    size_t areaIndex = 0;
+    for (auto& mapDataNode : mapNode.children) {
+        if (mapDataNode.type == OTBM_TILE_AREA) {
+            MapTileArea& area = areas[areaIndex];
+            {
+                std::unique_lock<std::mutex> lockGuard(areasLock);
+                areasSignal.wait(lockGuard, [&area]() { return area.done; });
+            }
+
+#if GAME_FEATURE_PARALLEL_MAP_LOADING_CHECK > 0
+            MapTileArea& checkArea = checkAreas.emplace_back(area.node);
+            deferredActions = &checkArea.actions;
+            if (!parseTileArea(loader, *area.node, map, legacy)) {
+                checkArea.error = getLastErrorString();
+            }
+            deferredActions = nullptr;
+
+            if (checkArea.error != area.error || !isSameTileArea(area.actions, checkArea.actions)) {
+                std::cout << "[Error - IOMap::loadMap] Tile area " << areaIndex << " decoded by the workers differs from the serial loader." << std::endl;
+                setLastErrorString("Parallel map loading check failed.");
+                success = false;
+                break;
+            }
+#endif
+
+            ++areaIndex;
+            success = applyTileArea(loader, area, map, legacy);
+            MapLoadActions().swap(area.actions);
+        } else if (mapDataNode.type == OTBM_TOWNS) {
+            success = parseTowns(loader, mapDataNode, map);
+        } else if (mapDataNode.type == OTBM_WAYPOINTS && headerVersion > 1) {
+            success = parseWaypoints(loader, mapDataNode, map);
+        } else {
+            setLastErrorString("Unknown map node.");
+            success = false;
+        }
+
+        if (!success) {
+            break;
+        }
+    }
+
+    stopped.store(true, std::memory_order_relaxed);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+
+    if (!success) {
+        //batches that never got merged still own their tiles and items
+        for (size_t i = areaIndex; i < areas.size(); ++i) {
+            releaseTileArea(areas[i].actions, 0);
+        }
+    }
+
+#if GAME_FEATURE_PARALLEL_MAP_LOADING_CHECK > 0
+    //merged tiles got their unique ids and decay applied meanwhile, so only the item ids are compared
+    if (success) {
+        for (const MapTileArea& checkArea : checkAreas) {
+            for (const MapLoadAction& action : checkArea.actions) {
+                if (action.type != MAPLOAD_ACTION_SETTILE) {
+                    continue;
                 }
 
-                if (tile) {
-                    tile->internalAddThing(item);
-                    item->startDecaying();
-                    item->setLoadedFromMap(true);
-                } else if (item->isGroundTile()) {
-                    delete ground_item;
-                    ground_item = item;
-                } else {
-                    tile = createTile(ground_item, item, x, y, z);
-                    tile->internalAddThing(item);
-                    item->startDecaying();
-                    item->setLoadedFromMap(true);
+                const Position& tilePos = action.tile->getPosition();
+                if (!isSameTile(map.getTile(tilePos), action.tile, false)) {
+                    std::cout << "[Error - IOMap::loadMap] Merged tile at " << tilePos << " differs from the serial loader." << std::endl;
+                    setLastErrorString("Parallel map loading check failed.");
+                    success = false;
+                    break;
                 }
             }
-        }
 
-        if (!tile) {
-            tile = createTile(ground_item, nullptr, x, y, z);
+            if (!success) {
+                break;
+            }
         }
+    }
 
-        tile->setFlag(tileflags);
+    for (const MapTileArea& checkArea : checkAreas) {
+        releaseTileArea(checkArea.actions, 0);
+    }
+#endif
+    return success;
+}
 
-        map.setTile(x, y, z, tile);
+bool IOMap::applyTileArea(OTB::Loader& loader, const MapTileArea& area, Map& map, bool _legacy)
+{
+    OTBM_Destination_coords area_coord = {};
+    bool hasAreaCoord = false;
+    for (const MapLoadAction& action : area.actions) {
+        switch (action.type) {
+            case MAPLOAD_ACTION_UNIQUEID:
+                action.item->setUniqueId(static_cast<uint16_t>(action.value));
+                break;
+
+            case MAPLOAD_ACTION_SLEEPER:
+                static_cast<BedItem*>(action.item)->loadSleeper(action.value);
+                break;
+
+            case MAPLOAD_ACTION_DECAY:
+                action.item->startDecaying();
+                break;
+
+            case MAPLOAD_ACTION_RELEASE:
+                deleteItem(action.item);
+                break;
+
+            case MAPLOAD_ACTION_SETTILE: {
+                const Position& tilePos = action.tile->getPosition();
+                map.setTile(tilePos.x, tilePos.y, tilePos.z, action.tile);
+                break;
+            }
+
+            case MAPLOAD_ACTION_HOUSETILE: {
+                if (!hasAreaCoord) {
+                    //the worker already validated the area properties
+                    PropStream propStream;
+                    loader.getProps(*area.node, propStream);
+                    propStream.read(area_coord);
+                    hasAreaCoord = true;
+                }
+
+                if (!parseTile(loader, *action.node, map, _legacy, area_coord.x, area_coord.y, area_coord.z)) {
+                    releaseTileArea(area.actions, static_cast<size_t>(&action - area.actions.data()) + 1);
+                    return false;
+                }
+                break;
+            }
+
+            default: break;
+        }
+    }
+
+    if (!area.error.empty()) {
+        setLastErrorString(area.error);
+        return false;
     }
     return true;
 }
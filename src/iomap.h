@@ -109,6 +109,45 @@ struct OTBM_Tile_coords
 
 #pragma pack()
 
+enum MapLoadAction_t : uint8_t
+{
+    MAPLOAD_ACTION_UNIQUEID,
+    MAPLOAD_ACTION_SLEEPER,
+    MAPLOAD_ACTION_DECAY,
+    MAPLOAD_ACTION_RELEASE,
+    MAPLOAD_ACTION_SETTILE,
+    MAPLOAD_ACTION_HOUSETILE,
+};
+
+// Side effect of decoding a tile on a loader worker that touches shared state,
+// replayed on the loading thread in file order
+struct MapLoadAction
+{
+    MapLoadAction(MapLoadAction_t type, Item* item, uint32_t value = 0) : item(item), value(value), type(type) {}
+    explicit MapLoadAction(Tile* tile) : tile(tile), value(0), type(MAPLOAD_ACTION_SETTILE) {}
+    explicit MapLoadAction(const OTB::Node* node) : node(node), value(0), type(MAPLOAD_ACTION_HOUSETILE) {}
+
+    union {
+        Item* item;
+        Tile* tile;
+        const OTB::Node* node;
+    };
+    uint32_t value;
+    MapLoadAction_t type;
+};
+
+using MapLoadActions = std::vector<MapLoadAction>;
+
+struct MapTileArea
+{
+    explicit MapTileArea(const OTB::Node* node) : node(node) {}
+
+    const OTB::Node* node;
+    MapLoadActions actions;
+    std::string error;
+    bool done = false;
+};
+
 class IOMap
 {
     static Tile* createTile(Item*& ground, const Item* item, uint16_t x, uint16_t y, uint8_t z);
@@ -116,6 +155,10 @@ class IOMap
 public:
     bool loadMap(Map* map, const std::string& fileName);
 
+    // Set while a worker thread decodes a tile area, item code records its
+    // global side effects here instead of applying them
+    static thread_local MapLoadActions* deferredActions;
+
     /* Load the spawns
      * \param map pointer to the Map class
      * \returns Returns true if the spawns were loaded successfully
@@ -159,6 +202,9 @@ private:
     bool parseWaypoints(OTB::Loader& loader, const OTB::Node& waypointsNode, Map& map);
     bool parseTowns(OTB::Loader& loader, const OTB::Node& townsNode, Map& map);
     bool parseTileArea(OTB::Loader& loader, const OTB::Node& tileAreaNode, Map& map, bool _legacy);
+    bool parseTile(OTB::Loader& loader, const OTB::Node& tileNode, Map& map, bool _legacy, uint16_t base_x, uint16_t base_y, uint16_t z);
+    bool parseTileAreas(OTB::Loader& loader, const OTB::Node& mapNode, Map& map, uint32_t headerVersion);
+    bool applyTileArea(OTB::Loader& loader, const MapTileArea& area, Map& map, bool _legacy);
     std::string errorString;
 };
 
@@ -61,6 +61,11 @@ void IOMapSerialize::loadHouseItems(const Map* map)
             loadItem(propStream, tile);
         }
     } while (result->next());
+
+    //loading went through the regular item paths, what is on the tiles now matches the database
+    for (auto& it : g_game.map.houses.getHouses()) {
+        it.second.resetItemsDirty();
+    }
     std::cout << "> Loaded house items in: " << (OTSYS_TIME() - start) / 1000. << " s" << std::endl;
 }
 
@@ -68,49 +73,131 @@ bool IOMapSerialize::saveHouseItems()
 {
     const int64_t start = OTSYS_TIME();
 
+    //only houses whose items changed since the last save are rewritten, the rows of the others stay as they are
+    std::vector<House*> dirtyHouses;
+    uint32_t skipped = 0;
+    for (auto& it : g_game.map.houses.getHouses()) {
+        House* house = &it.second;
+        if (house->isItemsDirty()) {
+            dirtyHouses.push_back(house);
+        } else {
+            ++skipped;
+        }
+    }
+
+    //rows of houses that were removed from the map since they were saved are never rewritten,
+    //the first save of the process drops them along with the changed houses
+    static bool orphanedRowsRemoved = false;
+
+    HouseSaveStats& stats = getHouseSaveStats();
+    if (dirtyHouses.empty() && orphanedRowsRemoved) {
+        ++stats.saves;
+        stats.lastWritten = 0;
+        stats.lastSkipped = skipped;
+        stats.skipped += skipped;
+        std::cout << "> Saved house items in: " << (OTSYS_TIME() - start) / 1000. << " s (0 written, " << skipped << " unchanged)" << std::endl;
+        return true;
+    }
+
     //Start the transaction
     DBTransaction transaction(&g_database);
     if (!transaction.begin()) {
         return false;
     }
 
-    //clear old tile data
-    if (!g_database.executeQuery("DELETE FROM `tile_store`")) {
-        return false;
+    std::stringExtended query(1024);
+    if (!orphanedRowsRemoved) {
+        query << "DELETE FROM `tile_store`";
+        if (!g_game.map.houses.getHouses().empty()) {
+            query << " WHERE `house_id` NOT IN (";
+            for (const auto& it : g_game.map.houses.getHouses()) {
+                query << it.first << ',';
+            }
+            query[query.length() - 1] = ')';
+        }
+        if (!g_database.executeQuery(query)) {
+            return false;
+        }
+        query.clear();
     }
 
-    DBInsert stmt(&g_database, "INSERT INTO `tile_store` (`house_id`, `data`) VALUES ");
+    if (!dirtyHouses.empty()) {
+        //tile_store keeps one row per tile, so the rows of the changed houses are replaced as a whole
+        query << "DELETE FROM `tile_store` WHERE `house_id` IN (";
+        for (const House* house : dirtyHouses) {
+            query << house->getId() << ',';
+        }
+        query[query.length() - 1] = ')';
+        if (!g_database.executeQuery(query)) {
+            return false;
+        }
+    }
 
-    std::stringExtended query(1024);
+    std::vector<std::pair<uint32_t, std::string>> rows;
     PropWriteStream stream;
-    for (auto& it : g_game.map.houses.getHouses()) {
+    for (const House* house : dirtyHouses) {
         //save house items
-        const House* house = &it.second;
         for (const HouseTile* tile : house->getTiles()) {
             saveTile(stream, tile);
 
             size_t attributesSize;
             const char* attributes = stream.getStream(attributesSize);
             if (attributesSize > 0) {
-                query.clear();
-                query << house->getId() << ',' << g_database.escapeBlob(attributes, attributesSize);
-                if (!stmt.addRow(query)) {
-                    return false;
-                }
+                rows.emplace_back(house->getId(), std::string(attributes, attributesSize));
                 stream.clear();
             }
         }
     }
 
-    if (!stmt.execute()) {
-        return false;
+    //the tile data is bound as binary instead of being escaped into the query, and since the batches
+    //only come in the sizes HOUSE_TILE_BATCH, HOUSE_TILE_BATCH / 2, ..., 1 each of them is prepared once
+    size_t row = 0;
+    for (size_t batch = HOUSE_TILE_BATCH; batch > 0; batch /= 2) {
+        for (; rows.size() - row >= batch; row += batch) {
+            DBStatement statement("INSERT INTO `tile_store` (`house_id`, `data`) VALUES (?, ?)");
+            for (size_t i = 1; i < batch; ++i) {
+                statement.getQuery() << ", (?, ?)";
+            }
+
+            for (size_t i = row; i < row + batch; ++i) {
+                statement.addNumber(rows[i].first);
+                statement.addBlob(rows[i].second.data(), rows[i].second.length());
+            }
+
+            if (!g_database.executeStatement(statement)) {
+                return false;
+            }
+        }
     }
 
     //End the transaction
-    const bool success = transaction.commit();
-    std::cout << "> Saved house items in: " <<
-        (OTSYS_TIME() - start) / 1000. << " s" << std::endl;
-    return success;
+    if (!transaction.commit()) {
+        return false;
+    }
+
+    //changes made while writing are still dispatcher-side, so it's safe to clear the flags only now,
+    //the remaining duration of decaying items is saved too so their houses are written again next time
+    orphanedRowsRemoved = true;
+    for (House* house : dirtyHouses) {
+        if (!hasDecayingItems(house)) {
+            house->resetItemsDirty();
+        }
+    }
+
+    const auto written = static_cast<uint32_t>(dirtyHouses.size());
+    ++stats.saves;
+    stats.lastWritten = written;
+    stats.lastSkipped = skipped;
+    stats.written += written;
+    stats.skipped += skipped;
+    std::cout << "> Saved house items in: " << (OTSYS_TIME() - start) / 1000. << " s (" << written << " written, " << skipped << " unchanged)" << std::endl;
+    return true;
+}
+
+IOMapSerialize::HouseSaveStats& IOMapSerialize::getHouseSaveStats()
+{
+    static HouseSaveStats stats;
+    return stats;
 }
 
 bool IOMapSerialize::loadContainer(PropStream& propStream, Container* mainContainer)
@@ -296,6 +383,36 @@ void IOMapSerialize::saveItem(PropWriteStream& stream, const Item* item)
     }
 }
 
+bool IOMapSerialize::hasDecayingItems(const House* house)
+{
+    auto isDecaying = [](const Item* item) {
+        const ItemDecayState_t decayState = item->getDecaying();
+        return decayState == DECAYING_TRUE || decayState == DECAYING_STOPPING;
+    };
+
+    for (const HouseTile* tile : house->getTiles()) {
+        const TileItemVector* tileItems = tile->getItemList();
+        if (!tileItems) {
+            continue;
+        }
+
+        for (const Item* item : *tileItems) {
+            if (isDecaying(item)) {
+                return true;
+            }
+
+            if (const Container* container = item->getContainer()) {
+                for (ContainerIterator it = container->iterator(); it.hasNext(); it.advance()) {
+                    if (isDecaying(*it)) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
 void IOMapSerialize::saveTile(PropWriteStream& stream, const Tile* tile)
 {
     const TileItemVector* tileItems = tile->getItemList();
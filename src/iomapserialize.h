@@ -26,14 +26,29 @@
 class IOMapSerialize
 {
 public:
+    struct HouseSaveStats
+    {
+        uint64_t saves = 0;
+        uint64_t written = 0;
+        uint64_t skipped = 0;
+        uint32_t lastWritten = 0;
+        uint32_t lastSkipped = 0;
+    };
+
+    static HouseSaveStats& getHouseSaveStats();
+
     static void loadHouseItems(const Map* map);
     static bool saveHouseItems();
     static bool loadHouseInfo();
     static bool saveHouseInfo();
 
 private:
+    // rows of tile_store sent per prepared INSERT, the rest goes out in halving batches
+    static constexpr size_t HOUSE_TILE_BATCH = 256;
+
     static void saveItem(PropWriteStream& stream, const Item* item);
     static void saveTile(PropWriteStream& stream, const Tile* tile);
+    static bool hasDecayingItems(const House* house);
 
     static bool loadContainer(PropStream& propStream, Container* mainContainer);
     static bool loadItem(PropStream& propStream, Cylinder* parent);
@@ -31,32 +31,87 @@
 extern ConfigManager g_config;
 
 #if GAME_FEATURE_MARKET > 0
+void IOMarket::loadOffers()
+{
+    IOMarket& market = getInstance();
+
+    const DBResult_ptr result = g_database.storeQuery("SELECT `market_offers`.`id`, `player_id`, `sale`, `itemtype`, `amount`, `price`, `created`, `anonymous`, `players`.`name` AS `player_name` FROM `market_offers` LEFT JOIN `players` ON `players`.`id` = `market_offers`.`player_id`");
+    if (!result) {
+        return;
+    }
+
+    do {
+        MarketOrder order;
+        order.id = result->getNumber<uint32_t>("id");
+        order.playerId = result->getNumber<uint32_t>("player_id");
+        order.type = static_cast<MarketAction_t>(result->getNumber<uint16_t>("sale"));
+        order.itemId = result->getNumber<uint16_t>("itemtype");
+        order.amount = result->getNumber<uint16_t>("amount");
+        order.price = result->getNumber<uint32_t>("price");
+        order.created = result->getNumber<uint32_t>("created");
+        order.anonymous = result->getNumber<uint16_t>("anonymous") != 0;
+        order.playerName = std::move(result->getString("player_name"));
+        market.nextOrderId = std::max<uint32_t>(market.nextOrderId, order.id + 1);
+        market.addOrder(std::move(order));
+    } while (result->next());
+}
+
+void IOMarket::addOrder(MarketOrder&& order)
+{
+    const uint32_t id = order.id;
+    itemOrders[order.itemId].insert(id);
+    playerOrders[order.playerId].insert(id);
+    expiryOrders.emplace(order.created, id);
+    orders.emplace(id, std::move(order));
+}
+
+void IOMarket::removeOrder(const std::map<uint32_t, MarketOrder>::iterator it)
+{
+    const MarketOrder& order = it->second;
+
+    auto itemIt = itemOrders.find(order.itemId);
+    if (itemIt != itemOrders.end()) {
+        itemIt->second.erase(order.id);
+        if (itemIt->second.empty()) {
+            itemOrders.erase(itemIt);
+        }
+    }
+
+    auto playerIt = playerOrders.find(order.playerId);
+    if (playerIt != playerOrders.end()) {
+        playerIt->second.erase(order.id);
+        if (playerIt->second.empty()) {
+            playerOrders.erase(playerIt);
+        }
+    }
+
+    expiryOrders.erase(std::make_pair(order.created, order.id));
+    orders.erase(it);
+}
+
 MarketOfferList IOMarket::getActiveOffers(const MarketAction_t action, const uint16_t itemId)
 {
     MarketOfferList offerList;
 
-    std::stringExtended query(256);
-    query << "SELECT `id`, `amount`, `price`, `created`, `anonymous`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers` WHERE `sale` = " << action << " AND `itemtype` = " << itemId;
-
-    const DBResult_ptr result = g_database.storeQuery(query);
-    if (!result) {
+    const IOMarket& market = getInstance();
+    const auto itemIt = market.itemOrders.find(itemId);
+    if (itemIt == market.itemOrders.end()) {
         return offerList;
     }
 
     const int32_t marketOfferDuration = g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
 
-    offerList.reserve(result->countResults());
-    do {
-        auto price = result->getNumber<uint32_t>("price");
-        uint32_t timestamp = result->getNumber<uint32_t>("created") + marketOfferDuration;
-        auto amount = result->getNumber<uint16_t>("amount");
-        uint16_t counter = result->getNumber<uint32_t>("id") & 0xFFFF;
-        if (result->getNumber<uint16_t>("anonymous") == 0) {
-            offerList.emplace_back(price, timestamp, amount, counter, static_cast<uint16_t>(0), std::move(result->getString("player_name")));
-        } else {
-            offerList.emplace_back(price, timestamp, amount, counter, static_cast<uint16_t>(0), "Anonymous");
+    offerList.reserve(itemIt->second.size());
+    for (const uint32_t id : itemIt->second) {
+        const MarketOrder& order = market.orders.at(id);
+        if (order.type != action) {
+            continue;
         }
-    } while (result->next());
+
+        const uint32_t timestamp = order.created + marketOfferDuration;
+        const uint16_t counter = order.id & 0xFFFF;
+        offerList.emplace_back(order.price, timestamp, order.amount, counter, static_cast<uint16_t>(0), order.anonymous ? "Anonymous" : order.playerName);
+    }
     return offerList;
 }
 
@@ -64,25 +119,25 @@ MarketOfferList IOMarket::getOwnOffers(const MarketAction_t action, const uint32
 {
     MarketOfferList offerList;
 
+    const IOMarket& market = getInstance();
+    const auto playerIt = market.playerOrders.find(playerId);
+    if (playerIt == market.playerOrders.end()) {
+        return offerList;
+    }
+
     const int32_t marketOfferDuration = g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
 
-    std::stringExtended query(256);
-    query << "SELECT `id`, `amount`, `price`, `created`, `itemtype` FROM `market_offers` WHERE `player_id` = " << playerId << " AND `sale` = " << action;
+    offerList.reserve(playerIt->second.size());
+    for (const uint32_t id : playerIt->second) {
+        const MarketOrder& order = market.orders.at(id);
+        if (order.type != action) {
+            continue;
+        }
 
-    const DBResult_ptr result = g_database.storeQuery(query);
-    if (!result) {
-        return offerList;
+        const uint32_t timestamp = order.created + marketOfferDuration;
+        const uint16_t counter = order.id & 0xFFFF;
+        offerList.emplace_back(order.price, timestamp, order.amount, counter, order.itemId, "");
     }
-
-    offerList.reserve(result->countResults());
-    do {
-        auto price = result->getNumber<uint32_t>("price");
-        uint32_t timestamp = result->getNumber<uint32_t>("created") + marketOfferDuration;
-        auto amount = result->getNumber<uint16_t>("amount");
-        uint16_t counter = result->getNumber<uint32_t>("id") & 0xFFFF;
-        auto itemId = result->getNumber<uint16_t>("itemtype");
-        offerList.emplace_back(price, timestamp, amount, counter, itemId, "");
-    } while (result->next());
     return offerList;
 }
 
@@ -93,7 +148,7 @@ HistoryMarketOfferList IOMarket::getOwnHistory(const MarketAction_t action, cons
     std::stringExtended query(256);
     query << "SELECT `itemtype`, `amount`, `price`, `expires_at`, `state` FROM `market_history` WHERE `player_id` = " << playerId << " AND `sale` = " << action;
 
-    const DBResult_ptr result = g_database.storeQuery(query);
+    const DBResult_ptr result = Database::getInstance().storeQuery(query);
     if (!result) {
         return offerList;
     }
@@ -115,87 +170,91 @@ HistoryMarketOfferList IOMarket::getOwnHistory(const MarketAction_t action, cons
     return offerList;
 }
 
-void IOMarket::processExpiredOffers(const DBResult_ptr& result, bool)
+void IOMarket::processExpiredOffer(const MarketOrder& order)
 {
-    if (!result) {
-        return;
-    }
-
-    do {
-        if (!moveOfferToHistory(result->getNumber<uint32_t>("id"), OFFERSTATE_EXPIRED)) {
-            continue;
+    if (order.type == MARKETACTION_SELL) {
+        const ItemType& itemType = Item::items[order.itemId];
+        if (itemType.id == 0) {
+            return;
         }
 
-        const auto playerId = result->getNumber<uint32_t>("player_id");
-        const auto amount = result->getNumber<uint16_t>("amount");
-        if (result->getNumber<uint16_t>("sale") == 1) {
-            const ItemType& itemType = Item::items[result->getNumber<uint16_t>("itemtype")];
-            if (itemType.id == 0) {
-                continue;
+        Player* player = g_game.getPlayerByGUID(order.playerId);
+        if (!player) {
+            //an earlier delivery to the same player may still be on its way to the database
+            IOLoginData::waitForPendingSaves(order.playerId);
+            player = new Player(nullptr);
+            if (!IOLoginData::loadPlayerById(player, order.playerId)) {
+                delete player;
+                return;
             }
+        }
 
-            Player* player = g_game.getPlayerByGUID(playerId);
-            if (!player) {
-                player = new Player(nullptr);
-                if (!IOLoginData::loadPlayerById(player, playerId)) {
-                    delete player;
-                    continue;
+        if (itemType.stackable) {
+            uint16_t tmpAmount = order.amount;
+            while (tmpAmount > 0) {
+                const uint16_t stackCount = std::min<uint16_t>(100, tmpAmount);
+                Item* item = Item::CreateItem(itemType.id, stackCount);
+                if (g_game.internalAddItem(player->getInbox(), item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
+                    delete item;
+                    break;
                 }
-            }
 
-            if (itemType.stackable) {
-                uint16_t tmpAmount = amount;
-                while (tmpAmount > 0) {
-                    const uint16_t stackCount = std::min<uint16_t>(100, tmpAmount);
-                    Item* item = Item::CreateItem(itemType.id, stackCount);
-                    if (g_game.internalAddItem(player->getInbox(), item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
-                        delete item;
-                        break;
-                    }
-
-                    tmpAmount -= stackCount;
-                }
+                tmpAmount -= stackCount;
+            }
+        } else {
+            int32_t subType;
+            if (itemType.charges != 0) {
+                subType = itemType.charges;
             } else {
-                int32_t subType;
-                if (itemType.charges != 0) {
-                    subType = itemType.charges;
-                } else {
-                    subType = -1;
-                }
+                subType = -1;
+            }
 
-                for (uint16_t i = 0; i < amount; ++i) {
-                    Item* item = Item::CreateItem(itemType.id, subType);
-                    if (g_game.internalAddItem(player->getInbox(), item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
-                        delete item;
-                        break;
-                    }
+            for (uint16_t i = 0; i < order.amount; ++i) {
+                Item* item = Item::CreateItem(itemType.id, subType);
+                if (g_game.internalAddItem(player->getInbox(), item, INDEX_WHEREEVER, FLAG_NOLIMIT) != RETURNVALUE_NOERROR) {
+                    delete item;
+                    break;
                 }
             }
+        }
 
-            if (player->isOffline()) {
-                IOLoginData::savePlayer(player);
-                delete player;
-            }
-        } else {
-            const uint64_t totalPrice = result->getNumber<uint64_t>("price") * amount;
+        if (player->isOffline()) {
+            IOLoginData::savePlayerAsync(player);
+            delete player;
+        }
+    } else {
+        const uint64_t totalPrice = static_cast<uint64_t>(order.price) * order.amount;
 
-            Player* player = g_game.getPlayerByGUID(playerId);
-            if (player) {
-                player->setBankBalance(player->getBankBalance() + totalPrice);
-            } else {
-                IOLoginData::increaseBankBalance(playerId, totalPrice);
-            }
+        Player* player = g_game.getPlayerByGUID(order.playerId);
+        if (player) {
+            player->setBankBalance(player->getBankBalance() + totalPrice);
+        } else {
+            IOLoginData::increaseBankBalance(order.playerId, totalPrice);
         }
-    } while (result->next());
+    }
 }
 
 void IOMarket::checkExpiredOffers()
 {
-    const time_t lastExpireDate = time(nullptr) - g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
+    const auto lastExpireDate = static_cast<uint32_t>(time(nullptr) - g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION));
+
+    IOMarket& market = getInstance();
+    while (!market.expiryOrders.empty()) {
+        const auto expired = market.expiryOrders.begin();
+        if (expired->first > lastExpireDate) {
+            break;
+        }
 
-    std::stringExtended query(128);
-    query << "SELECT `id`, `amount`, `price`, `itemtype`, `player_id`, `sale` FROM `market_offers` WHERE `created` <= " << lastExpireDate;
-    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)), processExpiredOffers, true);
+        const auto it = market.orders.find(expired->second);
+        if (it == market.orders.end()) {
+            market.expiryOrders.erase(expired);
+            continue;
+        }
+
+        const MarketOrder order = it->second;
+        moveOfferToHistory(order.id, OFFERSTATE_EXPIRED);
+        processExpiredOffer(order);
+    }
 
     const int32_t checkExpiredMarketOffersEachMinutes = g_config.getNumber(ConfigManager::CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES);
     if (checkExpiredMarketOffersEachMinutes <= 0) {
@@ -207,110 +266,128 @@ void IOMarket::checkExpiredOffers()
 
 uint32_t IOMarket::getPlayerOfferCount(const uint32_t playerId)
 {
-    std::stringExtended query(128);
-    query << "SELECT COUNT(*) AS `count` FROM `market_offers` WHERE `player_id` = " << playerId << " LIMIT 1";
-
-    const DBResult_ptr result = g_database.storeQuery(query);
-    if (!result) {
+    const IOMarket& market = getInstance();
+    const auto playerIt = market.playerOrders.find(playerId);
+    if (playerIt == market.playerOrders.end()) {
         return 0;
     }
-    return result->getNumber<int32_t>("count");
+    return static_cast<uint32_t>(playerIt->second.size());
 }
 
 MarketOfferEx IOMarket::getOfferByCounter(const uint32_t timestamp, const uint16_t counter)
 {
     MarketOfferEx offer;
+    offer.id = 0;
+    offer.playerId = 0;
 
-    const int32_t created = timestamp - g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
+    const auto created = static_cast<uint32_t>(timestamp - g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION));
 
-    std::stringExtended query(256);
-    query << "SELECT `id`, `sale`, `itemtype`, `amount`, `created`, `price`, `player_id`, `anonymous`, (SELECT `name` FROM `players` WHERE `id` = `player_id`) AS `player_name` FROM `market_offers` WHERE `created` = " << created << " AND (`id` & 65535) = " << counter << " LIMIT 1";
-
-    const DBResult_ptr result = g_database.storeQuery(query);
-    if (!result) {
-        offer.id = 0;
-        offer.playerId = 0;
-        return offer;
-    }
+    const IOMarket& market = getInstance();
+    for (auto it = market.expiryOrders.lower_bound(std::make_pair(created, 0U)); it != market.expiryOrders.end() && it->first == created; ++it) {
+        if ((it->second & 0xFFFF) != counter) {
+            continue;
+        }
 
-    offer.id = result->getNumber<uint32_t>("id");
-    offer.type = static_cast<MarketAction_t>(result->getNumber<uint16_t>("sale"));
-    offer.amount = result->getNumber<uint16_t>("amount");
-    offer.counter = result->getNumber<uint32_t>("id") & 0xFFFF;
-    offer.timestamp = result->getNumber<uint32_t>("created");
-    offer.price = result->getNumber<uint32_t>("price");
-    offer.itemId = result->getNumber<uint16_t>("itemtype");
-    offer.playerId = result->getNumber<uint32_t>("player_id");
-    if (result->getNumber<uint16_t>("anonymous") == 0) {
-        offer.playerName = std::move(result->getString("player_name"));
-    } else {
-        offer.playerName = "Anonymous";
+        const MarketOrder& order = market.orders.at(it->second);
+        offer.id = order.id;
+        offer.type = order.type;
+        offer.amount = order.amount;
+        offer.counter = order.id & 0xFFFF;
+        offer.timestamp = order.created;
+        offer.price = order.price;
+        offer.itemId = order.itemId;
+        offer.playerId = order.playerId;
+        offer.playerName = order.anonymous ? "Anonymous" : order.playerName;
+        break;
     }
     return offer;
 }
 
-void IOMarket::createOffer(const uint32_t playerId, const MarketAction_t action, const uint32_t itemId, const uint16_t amount, const uint32_t price, const bool anonymous)
+void IOMarket::createOffer(const uint32_t playerId, const std::string& playerName, const MarketAction_t action, const uint32_t itemId, const uint16_t amount, const uint32_t price, const bool anonymous)
 {
-    std::stringExtended query(256);
-    query << "INSERT INTO `market_offers` (`player_id`, `sale`, `itemtype`, `amount`, `price`, `created`, `anonymous`) VALUES (";
-    query << playerId << ',';
-    query << action << ',';
-    query << itemId << ',';
-    query << amount << ',';
-    query << price << ',';
-    query << time(nullptr) << ',';
-    query << (anonymous ? "1" : "0") << ')';
-    g_database.executeQuery(query);
+    IOMarket& market = getInstance();
+
+    MarketOrder order;
+    order.id = market.nextOrderId++;
+    order.playerId = playerId;
+    order.type = action;
+    order.itemId = static_cast<uint16_t>(itemId);
+    order.amount = amount;
+    order.price = price;
+    order.created = static_cast<uint32_t>(time(nullptr));
+    order.anonymous = anonymous;
+    order.playerName = playerName;
+
+    //every write of an offer row is keyed by its id, so they land in order
+    DBStatement statement("INSERT INTO `market_offers` (`id`, `player_id`, `sale`, `itemtype`, `amount`, `price`, `created`, `anonymous`) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    statement.addNumber(order.id);
+    statement.addNumber(playerId);
+    statement.addNumber(action);
+    statement.addNumber(itemId);
+    statement.addNumber(amount);
+    statement.addNumber(price);
+    statement.addNumber(order.created);
+    statement.addNumber(anonymous ? 1 : 0);
+    g_databaseTasks.addTask(std::move(statement), nullptr, order.id);
+
+    market.addOrder(std::move(order));
 }
 
 void IOMarket::acceptOffer(const uint32_t offerId, const uint16_t amount)
 {
-    std::stringExtended query(128);
-    query << "UPDATE `market_offers` SET `amount` = `amount` - " << amount << " WHERE `id` = " << offerId;
-    g_database.executeQuery(query);
+    IOMarket& market = getInstance();
+    const auto it = market.orders.find(offerId);
+    if (it == market.orders.end()) {
+        return;
+    }
+
+    MarketOrder& order = it->second;
+    order.amount -= std::min<uint16_t>(order.amount, amount);
+
+    DBStatement statement("UPDATE `market_offers` SET `amount` = ? WHERE `id` = ?");
+    statement.addNumber(order.amount);
+    statement.addNumber(offerId);
+    g_databaseTasks.addTask(std::move(statement), nullptr, offerId);
 }
 
 void IOMarket::deleteOffer(const uint32_t offerId)
 {
-    std::stringExtended query(64);
-    query << "DELETE FROM `market_offers` WHERE `id` = " << offerId;
-    g_database.executeQuery(query);
+    IOMarket& market = getInstance();
+    const auto it = market.orders.find(offerId);
+    if (it != market.orders.end()) {
+        market.removeOrder(it);
+    }
+
+    DBStatement statement("DELETE FROM `market_offers` WHERE `id` = ?");
+    statement.addNumber(offerId);
+    g_databaseTasks.addTask(std::move(statement), nullptr, offerId);
 }
 
 void IOMarket::appendHistory(const uint32_t playerId, const MarketAction_t type, const uint16_t itemId, const uint16_t amount, const uint32_t price, const time_t timestamp, const MarketOfferState_t state)
 {
-    std::stringExtended query(256);
-    query << "INSERT INTO `market_history` (`player_id`, `sale`, `itemtype`, `amount`, `price`, `expires_at`, `inserted`, `state`) VALUES (";
-    query << playerId << ',';
-    query << type << ',';
-    query << itemId << ',';
-    query << amount << ',';
-    query << price << ',';
-    query << timestamp << ',';
-    query << time(nullptr) << ',';
-    query << state << ')';
-    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)));
+    DBStatement statement("INSERT INTO `market_history` (`player_id`, `sale`, `itemtype`, `amount`, `price`, `expires_at`, `inserted`, `state`) VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+    statement.addNumber(playerId);
+    statement.addNumber(type);
+    statement.addNumber(itemId);
+    statement.addNumber(amount);
+    statement.addNumber(price);
+    statement.addNumber(timestamp);
+    statement.addNumber(time(nullptr));
+    statement.addNumber(state);
+    g_databaseTasks.addTask(std::move(statement), nullptr, playerId);
 }
 
 bool IOMarket::moveOfferToHistory(const uint32_t offerId, const MarketOfferState_t state)
 {
-    const int32_t marketOfferDuration = g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION);
-
-    std::stringExtended query(128);
-    query << "SELECT `player_id`, `sale`, `itemtype`, `amount`, `price`, `created` FROM `market_offers` WHERE `id` = " << offerId << " LIMIT 1";
-
-    const DBResult_ptr result = g_database.storeQuery(query);
-    if (!result) {
-        return false;
-    }
-
-    query.clear();
-    query << "DELETE FROM `market_offers` WHERE `id` = " << offerId;
-    if (!g_database.executeQuery(query)) {
+    IOMarket& market = getInstance();
+    const auto it = market.orders.find(offerId);
+    if (it == market.orders.end()) {
         return false;
     }
 
-    appendHistory(result->getNumber<uint32_t>("player_id"), static_cast<MarketAction_t>(result->getNumber<uint16_t>("sale")), result->getNumber<uint16_t>("itemtype"), result->getNumber<uint16_t>("amount"), result->getNumber<uint32_t>("price"), result->getNumber<uint32_t>("created") + marketOfferDuration, state);
+    const MarketOrder& order = it->second;
+    appendHistory(order.playerId, order.type, order.itemId, order.amount, order.price, order.created + g_config.getNumber(ConfigManager::MARKET_OFFER_DURATION), state);
+    deleteOffer(offerId);
     return true;
 }
 
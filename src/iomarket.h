@@ -21,10 +21,25 @@
 #ifndef FS_IOMARKET_H_B981E52C218C42D3B9EF726EBF0E92C9
 #define FS_IOMARKET_H_B981E52C218C42D3B9EF726EBF0E92C9
 
+#include <set>
+
 #include "enums.h"
 #include "database.h"
 
 #if GAME_FEATURE_MARKET > 0
+struct MarketOrder
+{
+    std::string playerName;
+    uint32_t id;
+    uint32_t playerId;
+    uint32_t created;
+    uint32_t price;
+    uint16_t amount;
+    uint16_t itemId;
+    MarketAction_t type;
+    bool anonymous;
+};
+
 class IOMarket
 {
 public:
@@ -33,17 +48,20 @@ public:
         return instance;
     }
 
+    //active offers live in memory, browsing never touches the database
+    //and every change is written behind through the database tasks
+    static void loadOffers();
+
     static MarketOfferList getActiveOffers(MarketAction_t action, uint16_t itemId);
     static MarketOfferList getOwnOffers(MarketAction_t action, uint32_t playerId);
     static HistoryMarketOfferList getOwnHistory(MarketAction_t action, uint32_t playerId);
 
-    static void processExpiredOffers(const DBResult_ptr& result, bool);
     static void checkExpiredOffers();
 
     static uint32_t getPlayerOfferCount(uint32_t playerId);
     static MarketOfferEx getOfferByCounter(uint32_t timestamp, uint16_t counter);
 
-    static void createOffer(uint32_t playerId, MarketAction_t action, uint32_t itemId, uint16_t amount, uint32_t price, bool anonymous);
+    static void createOffer(uint32_t playerId, const std::string& playerName, MarketAction_t action, uint32_t itemId, uint16_t amount, uint32_t price, bool anonymous);
     static void acceptOffer(uint32_t offerId, uint16_t amount);
     static void deleteOffer(uint32_t offerId);
 
@@ -61,8 +79,21 @@ public:
 private:
     IOMarket() = default;
 
+    static void processExpiredOffer(const MarketOrder& order);
+
+    void addOrder(MarketOrder&& order);
+    void removeOrder(std::map<uint32_t, MarketOrder>::iterator it);
+
     std::map<uint16_t, MarketStatistics> purchaseStatistics;
     std::map<uint16_t, MarketStatistics> saleStatistics;
+
+    std::map<uint32_t, MarketOrder> orders;
+    std::unordered_map<uint16_t, std::set<uint32_t>> itemOrders;
+    std::unordered_map<uint32_t, std::set<uint32_t>> playerOrders;
+    //offers expire in creation order, (created, id)
+    std::set<std::pair<uint32_t, uint32_t>> expiryOrders;
+    //ids are handed out here so an offer is usable before its row is written
+    uint32_t nextOrderId = 1;
 };
 #endif
 
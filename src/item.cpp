@@ -30,6 +30,7 @@
 #include "house.h"
 #include "game.h"
 #include "bed.h"
+#include "iomap.h"
 
 #include "actions.h"
 #include "spells.h"
@@ -334,6 +335,18 @@ const Tile* Item::getTile() const
     return dynamic_cast<const Tile*>(cylinder);
 }
 
+void Item::markHouseDirty() const
+{
+    const Cylinder* topParent = getTopParent();
+    if (!topParent || topParent->getCreature()) {
+        return;
+    }
+
+    if (const Tile* tile = topParent->getTile()) {
+        tile->markHouseDirty();
+    }
+}
+
 uint16_t Item::getSubType() const
 {
     const ItemType& it = items[id];
@@ -1995,6 +2008,11 @@ void Item::setUniqueId(const uint16_t n)
         return;
     }
 
+    if (IOMap::deferredActions) {
+        IOMap::deferredActions->emplace_back(MAPLOAD_ACTION_UNIQUEID, this, n);
+        return;
+    }
+
     if (g_game.addUniqueItem(n, this)) {
         getAttributes()->setUniqueId(n);
     }
@@ -453,6 +453,8 @@ private:
 
     std::vector<Attribute> attributes;
     std::underlying_type_t<itemAttrTypes> attributeBits = 0;
+    //position inside the decay bucket, fits into the padding after attributeBits
+    uint32_t decayIndex = 0;
 
     const std::string& getStrAttr(itemAttrTypes type) const;
     void setStrAttr(itemAttrTypes type, const std::string& value);
@@ -578,6 +580,7 @@ public:
     }
 
     friend class Item;
+    friend class Decay;
 };
 
 class Item : virtual public Thing
@@ -783,6 +786,7 @@ public:
 
     void setCharges(const uint16_t n) {
         setIntAttr(ITEM_ATTRIBUTE_CHARGES, n);
+        markHouseDirty();
     }
     uint16_t getCharges() const {
         if (!attributes) {
@@ -821,11 +825,14 @@ public:
         return getIntAttr(ITEM_ATTRIBUTE_CORPSEOWNER);
     }
 
+    //the saved duration and charges of house items change without the tile being updated
     void setDuration(const int32_t time) {
         setIntAttr(ITEM_ATTRIBUTE_DURATION, std::max<int32_t>(0, time));
+        markHouseDirty();
     }
     void setDurationTimestamp(const int64_t timestamp) {
         setIntAttr(ITEM_ATTRIBUTE_DURATION_TIMESTAMP, timestamp);
+        markHouseDirty();
     }
     int32_t getDuration() const {
         const ItemDecayState_t decayState = getDecaying();
@@ -840,6 +847,7 @@ public:
         if (decayState == DECAYING_FALSE) {
             removeAttribute(ITEM_ATTRIBUTE_DURATION_TIMESTAMP);
         }
+        markHouseDirty();
     }
     ItemDecayState_t getDecaying() const {
         if (!attributes) {
@@ -1093,6 +1101,8 @@ public:
     const Cylinder* getTopParent() const;
     Tile* getTile() override;
     const Tile* getTile() const override;
+    //flags the house the item is stored in (directly or inside containers) for the next house items save
+    void markHouseDirty() const;
     bool isRemoved() const override {
         return !parent || parent->isRemoved();
     }
@@ -1868,6 +1868,246 @@ void Items::parseItemNode(const pugi::xml_node& itemNode, uint16_t id)
     }
 }
 
+static void serializeItemType(const ItemType& it, PropWriteStream& propWriteStream)
+{
+    propWriteStream.write(it.group);
+    propWriteStream.write(it.type);
+    propWriteStream.write(it.id);
+    propWriteStream.write(it.clientId);
+    propWriteStream.write(it.stackable);
+    propWriteStream.write(it.isAnimation);
+    propWriteStream.write(it.isPodium);
+
+    propWriteStream.writeString(it.name);
+    propWriteStream.writeString(it.article);
+    propWriteStream.writeString(it.pluralName);
+    propWriteStream.writeString(it.description);
+    propWriteStream.writeString(it.runeSpellName);
+    propWriteStream.writeString(it.vocationString);
+
+    propWriteStream.write<uint8_t>(it.abilities ? 1 : 0);
+    if (it.abilities) {
+        propWriteStream.write<Abilities>(*it.abilities);
+    }
+
+    propWriteStream.write<uint8_t>(it.conditionDamage ? 1 : 0);
+    if (it.conditionDamage) {
+        //serialized ticks include the damage intervals which get added again on unserialize
+        propWriteStream.write<int32_t>(it.conditionDamage->getTicks());
+        it.conditionDamage->serialize(propWriteStream);
+        propWriteStream.write<uint8_t>(CONDITIONATTR_END);
+    }
+
+    propWriteStream.write(it.weight);
+    propWriteStream.write(it.levelDoor);
+    propWriteStream.write(it.decayTime);
+    propWriteStream.write(it.wieldInfo);
+    propWriteStream.write(it.minReqLevel);
+    propWriteStream.write(it.minReqMagicLevel);
+    propWriteStream.write(it.charges);
+    propWriteStream.write(it.maxHitChance);
+    propWriteStream.write(it.decayTo);
+    propWriteStream.write(it.attack);
+    propWriteStream.write(it.defense);
+    propWriteStream.write(it.extraDefense);
+    propWriteStream.write(it.armor);
+    propWriteStream.write(it.runeMagLevel);
+    propWriteStream.write(it.runeLevel);
+    propWriteStream.write(it.combatType);
+
+    propWriteStream.write(it.rotateTo);
+    propWriteStream.write(it.wrapableTo);
+    propWriteStream.write(it.transformToOnUse[0]);
+    propWriteStream.write(it.transformToOnUse[1]);
+    propWriteStream.write(it.transformToFree);
+    propWriteStream.write(it.destroyTo);
+    propWriteStream.write(it.maxTextLen);
+    propWriteStream.write(it.writeOnceItemId);
+    propWriteStream.write(it.transformEquipTo);
+    propWriteStream.write(it.transformDeEquipTo);
+    propWriteStream.write(it.maxItems);
+    propWriteStream.write(it.slotPosition);
+    propWriteStream.write(it.speed);
+    propWriteStream.write(it.wareId);
+
+    propWriteStream.write(it.magicEffect);
+    propWriteStream.write(it.bedPartnerDir);
+    propWriteStream.write(it.weaponType);
+    propWriteStream.write(it.ammoType);
+    propWriteStream.write(it.shootType);
+    propWriteStream.write(it.corpseType);
+    propWriteStream.write(it.fluidSource);
+
+    propWriteStream.write(it.floorChange);
+    propWriteStream.write(it.alwaysOnTopOrder);
+    propWriteStream.write(it.lightLevel);
+    propWriteStream.write(it.lightColor);
+    propWriteStream.write(it.shootRange);
+    propWriteStream.write(it.hitChance);
+
+    const bool flags[] = {
+        it.forceUse, it.forceSerialize, it.hasHeight, it.walkStack, it.blockSolid, it.blockPickupable, it.blockProjectile,
+        it.blockPathFind, it.allowPickupable, it.showDuration, it.showCharges, it.showAttributes, it.replaceable, it.pickupable,
+        it.rotatable, it.useable, it.moveable, it.alwaysOnTop, it.canReadText, it.canWriteText, it.isVertical, it.isHorizontal,
+        it.isHangable, it.allowDistRead, it.lookThrough, it.stopTime, it.showCount
+    };
+    uint32_t flagBits = 0;
+    for (size_t i = 0; i < std::size(flags); ++i) {
+        if (flags[i]) {
+            flagBits |= (1U << i);
+        }
+    }
+    propWriteStream.write<uint32_t>(flagBits);
+}
+
+static bool unserializeItemType(ItemType& it, PropStream& propStream)
+{
+    if (!propStream.read(it.group) || !propStream.read(it.type) || !propStream.read(it.id) || !propStream.read(it.clientId) ||
+        !propStream.read(it.stackable) || !propStream.read(it.isAnimation) || !propStream.read(it.isPodium)) {
+        return false;
+    }
+
+    if (!propStream.readString(it.name) || !propStream.readString(it.article) || !propStream.readString(it.pluralName) ||
+        !propStream.readString(it.description) || !propStream.readString(it.runeSpellName) || !propStream.readString(it.vocationString)) {
+        return false;
+    }
+
+    uint8_t hasAbilities;
+    if (!propStream.read<uint8_t>(hasAbilities)) {
+        return false;
+    }
+
+    if (hasAbilities != 0 && !propStream.read<Abilities>(it.getAbilities())) {
+        return false;
+    }
+
+    uint8_t hasConditionDamage;
+    if (!propStream.read<uint8_t>(hasConditionDamage)) {
+        return false;
+    }
+
+    if (hasConditionDamage != 0) {
+        int32_t ticks;
+        if (!propStream.read<int32_t>(ticks)) {
+            return false;
+        }
+
+        Condition* condition = Condition::createCondition(propStream);
+        if (!condition) {
+            return false;
+        }
+
+        const ConditionType_t conditionType = condition->getType();
+        if (conditionType != CONDITION_FIRE && conditionType != CONDITION_ENERGY && conditionType != CONDITION_POISON &&
+            conditionType != CONDITION_DROWN && conditionType != CONDITION_BLEEDING) {
+            delete condition;
+            return false;
+        }
+
+        it.conditionDamage.reset(static_cast<ConditionDamage*>(condition));
+
+        if (!condition->unserialize(propStream)) {
+            return false;
+        }
+
+        //same parameters as the field attribute of items.xml
+        condition->setParam(CONDITION_PARAM_TICKS, ticks);
+        condition->setParam(CONDITION_PARAM_FIELD, 1);
+        if (it.conditionDamage->getTotalDamage() > 0) {
+            condition->setParam(CONDITION_PARAM_FORCEUPDATE, 1);
+        }
+    }
+
+    if (!propStream.read(it.weight) || !propStream.read(it.levelDoor) || !propStream.read(it.decayTime) || !propStream.read(it.wieldInfo) ||
+        !propStream.read(it.minReqLevel) || !propStream.read(it.minReqMagicLevel) || !propStream.read(it.charges) || !propStream.read(it.maxHitChance) ||
+        !propStream.read(it.decayTo) || !propStream.read(it.attack) || !propStream.read(it.defense) || !propStream.read(it.extraDefense) ||
+        !propStream.read(it.armor) || !propStream.read(it.runeMagLevel) || !propStream.read(it.runeLevel) || !propStream.read(it.combatType)) {
+        return false;
+    }
+
+    if (!propStream.read(it.rotateTo) || !propStream.read(it.wrapableTo) || !propStream.read(it.transformToOnUse[0]) || !propStream.read(it.transformToOnUse[1]) ||
+        !propStream.read(it.transformToFree) || !propStream.read(it.destroyTo) || !propStream.read(it.maxTextLen) || !propStream.read(it.writeOnceItemId) ||
+        !propStream.read(it.transformEquipTo) || !propStream.read(it.transformDeEquipTo) || !propStream.read(it.maxItems) || !propStream.read(it.slotPosition) ||
+        !propStream.read(it.speed) || !propStream.read(it.wareId)) {
+        return false;
+    }
+
+    if (!propStream.read(it.magicEffect) || !propStream.read(it.bedPartnerDir) || !propStream.read(it.weaponType) || !propStream.read(it.ammoType) ||
+        !propStream.read(it.shootType) || !propStream.read(it.corpseType) || !propStream.read(it.fluidSource)) {
+        return false;
+    }
+
+    if (!propStream.read(it.floorChange) || !propStream.read(it.alwaysOnTopOrder) || !propStream.read(it.lightLevel) || !propStream.read(it.lightColor) ||
+        !propStream.read(it.shootRange) || !propStream.read(it.hitChance)) {
+        return false;
+    }
+
+    uint32_t flagBits;
+    if (!propStream.read<uint32_t>(flagBits)) {
+        return false;
+    }
+
+    bool* flags[] = {
+        &it.forceUse, &it.forceSerialize, &it.hasHeight, &it.walkStack, &it.blockSolid, &it.blockPickupable, &it.blockProjectile,
+        &it.blockPathFind, &it.allowPickupable, &it.showDuration, &it.showCharges, &it.showAttributes, &it.replaceable, &it.pickupable,
+        &it.rotatable, &it.useable, &it.moveable, &it.alwaysOnTop, &it.canReadText, &it.canWriteText, &it.isVertical, &it.isHorizontal,
+        &it.isHangable, &it.allowDistRead, &it.lookThrough, &it.stopTime, &it.showCount
+    };
+    for (size_t i = 0; i < std::size(flags); ++i) {
+        *flags[i] = (flagBits & (1U << i)) != 0;
+    }
+    return true;
+}
+
+bool Items::loadFromCache(PropStream& propStream)
+{
+    if (!propStream.read<uint32_t>(majorVersion) || !propStream.read<uint32_t>(minorVersion) || !propStream.read<uint32_t>(buildNumber)) {
+        return false;
+    }
+
+    uint32_t reverseItemCount;
+    if (!propStream.read<uint32_t>(reverseItemCount)) {
+        return false;
+    }
+
+    reverseItemMap.resize(reverseItemCount);
+    for (uint16_t& serverId : reverseItemMap) {
+        if (!propStream.read<uint16_t>(serverId)) {
+            return false;
+        }
+    }
+
+    uint32_t itemCount;
+    if (!propStream.read<uint32_t>(itemCount)) {
+        return false;
+    }
+
+    items.resize(itemCount);
+    for (ItemType& it : items) {
+        if (!unserializeItemType(it, propStream)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void Items::saveToCache(PropWriteStream& propWriteStream) const
+{
+    propWriteStream.write<uint32_t>(majorVersion);
+    propWriteStream.write<uint32_t>(minorVersion);
+    propWriteStream.write<uint32_t>(buildNumber);
+
+    propWriteStream.write<uint32_t>(static_cast<uint32_t>(reverseItemMap.size()));
+    for (uint16_t serverId : reverseItemMap) {
+        propWriteStream.write<uint16_t>(serverId);
+    }
+
+    propWriteStream.write<uint32_t>(static_cast<uint32_t>(items.size()));
+    for (const ItemType& it : items) {
+        serializeItemType(it, propWriteStream);
+    }
+}
+
 ItemType& Items::getItemType(const size_t id)
 {
     if (id < items.size()) {
@@ -428,6 +428,9 @@ public:
     bool loadFromXml();
     void parseItemNode(const pugi::xml_node& itemNode, uint16_t id);
 
+    bool loadFromCache(PropStream& propStream);
+    void saveToCache(PropWriteStream& propWriteStream) const;
+
     size_t size() const {
         return items.size();
     }
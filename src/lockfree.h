@@ -25,8 +25,17 @@
 #define _ENABLE_ATOMIC_ALIGNMENT_FIX
 #endif
 
+#include <atomic>
 #include <boost/lockfree/stack.hpp>
 
+struct LockfreePoolStats
+{
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint32_t> inUse{0};
+    std::atomic<uint32_t> highWater{0};
+};
+
  /*
   * we use this to avoid instantiating multiple free lists for objects of the
   * same size and it can be replaced by a variable template in C++14
@@ -43,6 +52,12 @@ struct LockfreeFreeList
         static FreeList freeList;
         return freeList;
     }
+
+    static LockfreePoolStats& getStats()
+    {
+        static LockfreePoolStats stats;
+        return stats;
+    }
 };
 
 template <typename T, size_t CAPACITY>
@@ -55,18 +70,36 @@ public:
     explicit constexpr LockfreePoolingAllocator(const U&) {}
     using value_type = T;
 
+    //the capacity is a non-type template parameter so allocator_traits can't deduce the rebind
+    template <typename U>
+    struct rebind
+    {
+        using other = LockfreePoolingAllocator<U, CAPACITY>;
+    };
+
     T* allocate(size_t) const {
         auto& inst = LockfreeFreeList<sizeof(T), CAPACITY>::get();
+        auto& stats = LockfreeFreeList<sizeof(T), CAPACITY>::getStats();
         void* p; // NOTE: p doesn't have to be initialized
-        if (!inst.pop(p)) {
+        if (inst.pop(p)) {
+            stats.hits.fetch_add(1, std::memory_order_relaxed);
+        } else {
             //Acquire memory without calling the constructor of T
             p = operator new (sizeof(T));
+            stats.misses.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        const uint32_t inUse = stats.inUse.fetch_add(1, std::memory_order_relaxed) + 1;
+        uint32_t highWater = stats.highWater.load(std::memory_order_relaxed);
+        while (inUse > highWater && !stats.highWater.compare_exchange_weak(highWater, inUse, std::memory_order_relaxed)) {
+            //highWater got reloaded by the failed exchange
         }
         return static_cast<T*>(p);
     }
 
     void deallocate(T* p, size_t) const {
         auto& inst = LockfreeFreeList<sizeof(T), CAPACITY>::get();
+        LockfreeFreeList<sizeof(T), CAPACITY>::getStats().inUse.fetch_sub(1, std::memory_order_relaxed);
         if (!inst.bounded_push(p)) {
             //Release memory without calling the destructor of T
             //(it has already been called at this point)
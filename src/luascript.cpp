@@ -30,6 +30,7 @@
 #include "protocolstatus.h"
 #include "spells.h"
 #include "iologindata.h"
+#include "iomapserialize.h"
 #include "configmanager.h"
 #include "teleport.h"
 #include "databasemanager.h"
@@ -41,6 +42,8 @@
 #include "script.h"
 #include "weapons.h"
 #include "tasks.h"
+#include "outputmessage.h"
+#include "lockfree.h"
 
 extern Chat* g_chat;
 
@@ -2319,6 +2322,7 @@ void LuaScriptInterface::registerFunctions()
         registerEnumIn("configKeys", ConfigManager::GAME_PORT)
         registerEnumIn("configKeys", ConfigManager::LOGIN_PORT)
         registerEnumIn("configKeys", ConfigManager::STATUS_PORT)
+        registerEnumIn("configKeys", ConfigManager::NETWORK_THREADS)
         registerEnumIn("configKeys", ConfigManager::STAIRHOP_DELAY)
         registerEnumIn("configKeys", ConfigManager::MARKET_OFFER_DURATION)
         registerEnumIn("configKeys", ConfigManager::CHECK_EXPIRED_MARKET_OFFERS_EACH_MINUTES)
@@ -2388,6 +2392,21 @@ void LuaScriptInterface::registerFunctions()
 
     registerMethod("Game", "reload", luaGameReload);
 
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+    registerMethod("Game", "getDispatcherStats", luaGameGetDispatcherStats);
+    registerMethod("Game", "dumpDispatcherStats", luaGameDumpDispatcherStats);
+    registerMethod("Game", "resetDispatcherStats", luaGameResetDispatcherStats);
+#endif
+
+    registerMethod("Game", "getOutputMessagePoolStats", luaGameGetOutputMessagePoolStats);
+    registerMethod("Game", "getPlayerSaveStats", luaGameGetPlayerSaveStats);
+    registerMethod("Game", "getLoginStats", luaGameGetLoginStats);
+    registerMethod("Game", "getNetworkWriteStats", luaGameGetNetworkWriteStats);
+    registerMethod("Game", "getServerSaveStats", luaGameGetServerSaveStats);
+    registerMethod("Game", "getHouseSaveStats", luaGameGetHouseSaveStats);
+    registerMethod("Game", "getDatabaseStats", luaGameGetDatabaseStats);
+    registerMethod("Game", "getPathCacheStats", luaGameGetPathCacheStats);
+
     // Variant
     registerClass("Variant", "", luaVariantCreate);
 
@@ -5047,6 +5066,206 @@ int LuaScriptInterface::luaGameReload(lua_State* L)
     return 1;
 }
 
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+int LuaScriptInterface::luaGameGetDispatcherStats(lua_State* L)
+{
+    // Game.getDispatcherStats()
+    auto pushHistogram = [L](const DispatcherHistogram& histogram) {
+        lua_createtable(L, 0, 6);
+        setField(L, "count", histogram.count);
+        setField(L, "total", histogram.total);
+        setField(L, "average", histogram.getAverage());
+        setField(L, "p50", histogram.getPercentile(50.0));
+        setField(L, "p99", histogram.getPercentile(99.0));
+        setField(L, "max", histogram.max);
+    };
+
+    const DispatcherStats& stats = g_dispatcher.getStats();
+    lua_createtable(L, 0, 7);
+    setField(L, "since", stats.since);
+    setField(L, "cycle", g_dispatcher.getDispatcherCycle());
+
+    pushHistogram(stats.taskLatency);
+    lua_setfield(L, -2, "taskLatency");
+
+    pushHistogram(stats.eventLatency);
+    lua_setfield(L, -2, "eventLatency");
+
+    pushHistogram(stats.execution);
+    lua_setfield(L, -2, "execution");
+
+    const auto tagStats = g_dispatcher.getTagStats();
+    lua_createtable(L, tagStats.size(), 0);
+
+    int index = 0;
+    for (const auto& it : tagStats) {
+        lua_createtable(L, 0, 3);
+        setField(L, "tag", it.first);
+        pushHistogram(it.second.latency);
+        lua_setfield(L, -2, "latency");
+        pushHistogram(it.second.execution);
+        lua_setfield(L, -2, "execution");
+        lua_rawseti(L, -2, ++index);
+    }
+    lua_setfield(L, -2, "tags");
+
+    lua_createtable(L, stats.stalls.size(), 0);
+
+    index = 0;
+    for (const DispatcherStall& stall : stats.stalls) {
+        lua_createtable(L, 0, 4);
+        setField(L, "tag", (stall.tag ? stall.tag : "unknown"));
+        setField(L, "latency", stall.latency);
+        setField(L, "execution", stall.execution);
+        setField(L, "time", stall.time);
+        lua_rawseti(L, -2, ++index);
+    }
+    lua_setfield(L, -2, "stalls");
+    return 1;
+}
+
+int LuaScriptInterface::luaGameDumpDispatcherStats(lua_State* L)
+{
+    // Game.dumpDispatcherStats([fileName = "dispatcher_stats.txt"])
+    const std::string& fileName = getString(L, 1);
+    pushBoolean(L, g_dispatcher.dumpStats(fileName.empty() ? "dispatcher_stats.txt" : fileName));
+    return 1;
+}
+
+int LuaScriptInterface::luaGameResetDispatcherStats(lua_State* L)
+{
+    // Game.resetDispatcherStats()
+    g_dispatcher.resetStats();
+    pushBoolean(L, true);
+    return 1;
+}
+#endif
+
+int LuaScriptInterface::luaGameGetOutputMessagePoolStats(lua_State* L)
+{
+    // Game.getOutputMessagePoolStats()
+    const LockfreePoolStats& stats = OutputMessagePool::getPoolStats();
+    lua_createtable(L, 0, 5);
+    setField(L, "hits", stats.hits.load(std::memory_order_relaxed));
+    setField(L, "misses", stats.misses.load(std::memory_order_relaxed));
+    setField(L, "inUse", stats.inUse.load(std::memory_order_relaxed));
+    setField(L, "highWater", stats.highWater.load(std::memory_order_relaxed));
+    setField(L, "capacity", OutputMessagePool::getPoolCapacity());
+    return 1;
+}
+
+int LuaScriptInterface::luaGameGetPlayerSaveStats(lua_State* L)
+{
+    // Game.getPlayerSaveStats()
+    const IOLoginData::PlayerSaveStats& stats = IOLoginData::getSaveStats();
+    lua_createtable(L, 0, 6);
+    setField(L, "saves", stats.saves);
+    setField(L, "unchanged", stats.unchanged);
+    setField(L, "bytes", stats.bytes);
+    setField(L, "lastBytes", stats.lastBytes);
+    setField(L, "failed", stats.failed);
+    setField(L, "waits", stats.waits);
+    return 1;
+}
+
+int LuaScriptInterface::luaGameGetLoginStats(lua_State* L)
+{
+    // Game.getLoginStats()
+    static const char* stageNames[] = { "authenticate", "admit", "load", "place" };
+
+    const ProtocolGame::LoginStats& stats = ProtocolGame::getLoginStats();
+    lua_createtable(L, 0, 4);
+    setField(L, "logins", stats.logins);
+    setField(L, "rejected", stats.rejected);
+    setField(L, "reloads", stats.reloads);
+
+    lua_createtable(L, 0, stats.stages.size());
+    for (size_t stage = 0; stage < stats.stages.size(); ++stage) {
+        const ProtocolGame::LoginStageStats& stageStats = stats.stages[stage];
+        lua_createtable(L, 0, 3);
+        setField(L, "count", stageStats.count);
+        setField(L, "average", stageStats.count ? stageStats.total / stageStats.count : 0);
+        setField(L, "max", stageStats.max);
+        lua_setfield(L, -2, stageNames[stage]);
+    }
+    lua_setfield(L, -2, "stages");
+    return 1;
+}
+
+int LuaScriptInterface::luaGameGetNetworkWriteStats(lua_State* L)
+{
+    // Game.getNetworkWriteStats()
+    const ConnectionWriteStats& stats = Connection::getWriteStats();
+    lua_createtable(L, 0, 4);
+    setField(L, "writes", stats.writes.load(std::memory_order_relaxed));
+    setField(L, "messages", stats.messages.load(std::memory_order_relaxed));
+    setField(L, "bytes", stats.bytes.load(std::memory_order_relaxed));
+    setField(L, "overflows", stats.overflows.load(std::memory_order_relaxed));
+    return 1;
+}
+
+int LuaScriptInterface::luaGameGetServerSaveStats(lua_State* L)
+{
+    // Game.getServerSaveStats()
+    const ServerSaveStats& stats = g_game.getServerSaveStats();
+    lua_createtable(L, 0, 6);
+    setField(L, "saves", stats.saves);
+    setField(L, "lastStall", stats.lastStall);
+    setField(L, "maxStall", stats.maxStall);
+    setField(L, "lastWrite", stats.lastWrite);
+    setField(L, "maxWrite", stats.maxWrite);
+    setField(L, "lastPlayers", stats.lastPlayers);
+    return 1;
+}
+
+int LuaScriptInterface::luaGameGetHouseSaveStats(lua_State* L)
+{
+    // Game.getHouseSaveStats()
+    const IOMapSerialize::HouseSaveStats& stats = IOMapSerialize::getHouseSaveStats();
+    lua_createtable(L, 0, 5);
+    setField(L, "saves", stats.saves);
+    setField(L, "written", stats.written);
+    setField(L, "skipped", stats.skipped);
+    setField(L, "lastWritten", stats.lastWritten);
+    setField(L, "lastSkipped", stats.lastSkipped);
+    return 1;
+}
+
+int LuaScriptInterface::luaGameGetDatabaseStats(lua_State* L)
+{
+    // Game.getDatabaseStats()
+    const std::vector<DatabaseWorkerStats> workers = g_databaseTasks.getStats();
+    lua_createtable(L, static_cast<int>(workers.size()), 0);
+
+    int index = 0;
+    for (const DatabaseWorkerStats& stats : workers) {
+        lua_createtable(L, 0, 7);
+        setField(L, "queued", stats.queued);
+        setField(L, "maxQueued", stats.maxQueued);
+        setField(L, "executed", stats.executed);
+        setField(L, "waitTime", stats.waitTime);
+        setField(L, "maxWaitTime", stats.maxWaitTime);
+        setField(L, "runTime", stats.runTime);
+        setField(L, "maxRunTime", stats.maxRunTime);
+        lua_rawseti(L, -2, ++index);
+    }
+    return 1;
+}
+
+int LuaScriptInterface::luaGameGetPathCacheStats(lua_State* L)
+{
+    // Game.getPathCacheStats()
+    const PathCacheStats& stats = g_game.map.getPathCacheStats();
+    lua_createtable(L, 0, 6);
+    setField(L, "hits", stats.hits);
+    setField(L, "misses", stats.misses);
+    setField(L, "stale", stats.stale);
+    setField(L, "blocked", stats.blocked);
+    setField(L, "searchTime", stats.searchTime);
+    setField(L, "savedTime", stats.savedTime);
+    return 1;
+}
+
 // Variant
 int LuaScriptInterface::luaVariantCreate(lua_State* L)
 {
@@ -6642,6 +6861,7 @@ int LuaScriptInterface::luaItemSetActionId(lua_State* L)
     Item* item = getUserdata<Item>(L, 1);
     if (item) {
         item->setActionId(actionId);
+        item->markHouseDirty();
         pushBoolean(L, true);
     } else {
         lua_pushnil(L);
@@ -6882,9 +7102,11 @@ int LuaScriptInterface::luaItemSetAttribute(lua_State* L)
         }
 
         item->setIntAttr(attribute, getNumber<int64_t>(L, 3));
+        item->markHouseDirty();
         pushBoolean(L, true);
     } else if (ItemAttributes::isStrAttrType(attribute)) {
         item->setStrAttr(attribute, getString(L, 3));
+        item->markHouseDirty();
         pushBoolean(L, true);
     } else {
         lua_pushnil(L);
@@ -6915,6 +7137,7 @@ int LuaScriptInterface::luaItemRemoveAttribute(lua_State* L)
         ret = attribute != ITEM_ATTRIBUTE_DURATION_TIMESTAMP;
         if (ret) {
             item->removeAttribute(attribute);
+            item->markHouseDirty();
         } else {
             reportErrorFunc("Attempt to erase protected key \"duration timestamp\"");
         }
@@ -6987,6 +7210,7 @@ int LuaScriptInterface::luaItemSetCustomAttribute(lua_State* L) {
     }
 
     item->setCustomAttribute(key, val);
+    item->markHouseDirty();
     pushBoolean(L, true);
     return 1;
 }
@@ -6999,13 +7223,20 @@ int LuaScriptInterface::luaItemRemoveCustomAttribute(lua_State* L) {
         return 1;
     }
 
+    bool ret;
     if (isNumber(L, 2)) {
-        pushBoolean(L, item->removeCustomAttribute(getNumber<int64_t>(L, 2)));
+        ret = item->removeCustomAttribute(getNumber<int64_t>(L, 2));
     } else if (isString(L, 2)) {
-        pushBoolean(L, item->removeCustomAttribute(getString(L, 2)));
+        ret = item->removeCustomAttribute(getString(L, 2));
     } else {
         lua_pushnil(L);
+        return 1;
     }
+
+    if (ret) {
+        item->markHouseDirty();
+    }
+    pushBoolean(L, ret);
     return 1;
 }
 
@@ -583,6 +583,21 @@ private:
 
     static int luaGameReload(lua_State* L);
 
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+    static int luaGameGetDispatcherStats(lua_State* L);
+    static int luaGameDumpDispatcherStats(lua_State* L);
+    static int luaGameResetDispatcherStats(lua_State* L);
+#endif
+
+    static int luaGameGetOutputMessagePoolStats(lua_State* L);
+    static int luaGameGetPlayerSaveStats(lua_State* L);
+    static int luaGameGetLoginStats(lua_State* L);
+    static int luaGameGetNetworkWriteStats(lua_State* L);
+    static int luaGameGetServerSaveStats(lua_State* L);
+    static int luaGameGetHouseSaveStats(lua_State* L);
+    static int luaGameGetDatabaseStats(lua_State* L);
+    static int luaGameGetPathCacheStats(lua_State* L);
+
     // Variant
     static int luaVariantCreate(lua_State* L);
 
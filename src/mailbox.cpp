@@ -127,6 +127,7 @@ bool Mailbox::sendItem(Item* item)
 #endif
     } else {
         Player tmpPlayer(nullptr);
+        IOLoginData::waitForPendingSaves();
         if (!IOLoginData::loadPlayerByName(&tmpPlayer, receiver)) {
             return false;
         }
@@ -26,6 +26,9 @@
 #include "creature.h"
 #include "monster.h"
 #include "game.h"
+#include "configmanager.h"
+
+extern ConfigManager g_config;
 
 bool Map::loadMap(const std::string& identifier, const bool loadHouses)
 {
@@ -88,6 +91,7 @@ MapSector* Map::createMapSector(const uint32_t x, const uint32_t y)
     }
 
     MapSector::newSector = true;
+    ++sectorsGeneration;
     return &mapSectors[index];
 }
 
@@ -303,15 +307,17 @@ void Map::moveCreature(Creature& creature, Tile& newTile, const bool forceTelepo
     MapSector* old_sector = getMapSector(oldPos.x, oldPos.y);
     MapSector* new_sector = getMapSector(newPos.x, newPos.y);
 
-    // Switch the node ownership
+    //add the creature
+    newTile.addThing(&creature);
+
+    // Switch the node ownership, done after the creature is on its new tile so the sector sees the new position
     if (old_sector != new_sector) {
         old_sector->removeCreature(&creature);
         new_sector->addCreature(&creature);
+    } else {
+        new_sector->updateCreature(&creature);
     }
 
-    //add the creature
-    newTile.addThing(&creature);
-
     if (!teleport) {
         if (oldPos.y > newPos.y) {
             creature.setDirection(DIRECTION_NORTH);
@@ -397,7 +403,7 @@ std::vector<Tile*> Map::getFloorTiles(const int32_t x, const int32_t y, const in
     return tileVector;
 }
 
-void Map::getSpectatorsInternal(SpectatorVector& spectators, const Position& centerPos, const int32_t minRangeX, const int32_t maxRangeX, const int32_t minRangeY, const int32_t maxRangeY, const int32_t minRangeZ, const int32_t maxRangeZ, const bool onlyPlayers) const
+void Map::getSpectatorsInternal(SpectatorVector& spectators, const Position& centerPos, const int32_t minRangeX, const int32_t maxRangeX, const int32_t minRangeY, const int32_t maxRangeY, const int32_t minRangeZ, const int32_t maxRangeZ, const bool onlyPlayers, SpectatorCacheEntry* cacheEntry/* = nullptr*/) const
 {
     const int32_t min_y = centerPos.y - minRangeY;
     const int32_t min_x = centerPos.x - minRangeX;
@@ -427,13 +433,45 @@ void Map::getSpectatorsInternal(SpectatorVector& spectators, const Position& cen
         const MapSector* sectorE = sectorS;
         for (int32_t nx = startx1; nx <= endx2; nx += SECTOR_SIZE) {
             if (sectorE) {
-                const CreatureVector& node_list = onlyPlayers ? sectorE->player_list : sectorE->creature_list;
-                for (const auto creature : node_list) {
-                    const Position& cpos = creature->getPosition();
-                    if (static_cast<uint32_t>(static_cast<int32_t>(cpos.z) - minRangeZ) <= depth) {
-                        const int_fast16_t offsetZ = Position::getOffsetZ(centerPos, cpos);
-                        if (static_cast<uint32_t>(cpos.x - offsetZ - min_x) <= width && static_cast<uint32_t>(cpos.y - offsetZ - min_y) <= height) {
-                            spectators.push_back(creature);
+                if (cacheEntry) {
+                    if (cacheEntry->sectorCount < SPECTATOR_CACHE_MAX_SECTORS) {
+                        cacheEntry->sectors[cacheEntry->sectorCount] = std::make_pair(sectorE, (onlyPlayers ? sectorE->playerGeneration : sectorE->creatureGeneration));
+                    }
+                    ++cacheEntry->sectorCount;
+                }
+
+                const SectorCreatureList& node_list = onlyPlayers ? sectorE->player_list : sectorE->creature_list;
+                const size_t count = node_list.size();
+                size_t i = 0;
+#if defined(__SSE2__)
+                // a creature on floor z is seen shifted by (centerPos.z - z), so compare x + z and y + z against the range moved by centerPos.z
+                const __m128i minZ = _mm_set1_epi32(minRangeZ);
+                const __m128i maxZ = _mm_set1_epi32(maxRangeZ);
+                const __m128i minX = _mm_set1_epi32(min_x + centerPos.z);
+                const __m128i maxX = _mm_set1_epi32(max_x + centerPos.z);
+                const __m128i minY = _mm_set1_epi32(min_y + centerPos.z);
+                const __m128i maxY = _mm_set1_epi32(max_y + centerPos.z);
+                for (; i + 4 <= count; i += 4) {
+                    const __m128i vz = _mm_loadu_si128(reinterpret_cast<const __m128i*>(node_list.z.data() + i));
+                    const __m128i vx = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(node_list.x.data() + i)), vz);
+                    const __m128i vy = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(node_list.y.data() + i)), vz);
+                    __m128i outside = _mm_or_si128(_mm_cmpgt_epi32(minZ, vz), _mm_cmpgt_epi32(vz, maxZ));
+                    outside = _mm_or_si128(outside, _mm_or_si128(_mm_cmpgt_epi32(minX, vx), _mm_cmpgt_epi32(vx, maxX)));
+                    outside = _mm_or_si128(outside, _mm_or_si128(_mm_cmpgt_epi32(minY, vy), _mm_cmpgt_epi32(vy, maxY)));
+                    const int mask = ~_mm_movemask_ps(_mm_castsi128_ps(outside)) & 0x0F;
+                    for (size_t lane = 0; lane < 4; ++lane) {
+                        if (mask & (1 << lane)) {
+                            spectators.push_back(node_list.creatures[i + lane]);
+                        }
+                    }
+                }
+#endif
+                for (; i < count; ++i) {
+                    const int32_t cz = node_list.z[i];
+                    if (static_cast<uint32_t>(cz - minRangeZ) <= depth) {
+                        const int32_t offsetZ = static_cast<int32_t>(centerPos.getZ()) - cz;
+                        if (static_cast<uint32_t>(node_list.x[i] - offsetZ - min_x) <= width && static_cast<uint32_t>(node_list.y[i] - offsetZ - min_y) <= height) {
+                            spectators.push_back(node_list.creatures[i]);
                         }
                     }
                 }
@@ -451,6 +489,21 @@ void Map::getSpectatorsInternal(SpectatorVector& spectators, const Position& cen
     }
 }
 
+bool Map::isSpectatorCacheValid(const SpectatorCacheEntry& cacheEntry, const bool onlyPlayers) const
+{
+    if (cacheEntry.sectorsGeneration != sectorsGeneration) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < cacheEntry.sectorCount; ++i) {
+        const auto& it = cacheEntry.sectors[i];
+        if (it.second != (onlyPlayers ? it.first->playerGeneration : it.first->creatureGeneration)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void Map::getSpectators(SpectatorVector& spectators, const Position& centerPos, const bool multifloor /*= false*/, const bool onlyPlayers /*= false*/, int32_t minRangeX /*= 0*/, int32_t maxRangeX /*= 0*/, int32_t minRangeY /*= 0*/, int32_t maxRangeY /*= 0*/)
 {
     if (centerPos.z >= MAP_MAX_LAYERS) {
@@ -460,19 +513,21 @@ void Map::getSpectators(SpectatorVector& spectators, const Position& centerPos,
     bool foundCache = false;
     bool cacheResult = false;
 
+    const uint64_t cacheKey = (static_cast<uint64_t>(centerPos.z) << 32) | (static_cast<uint64_t>(centerPos.y) << 16) | static_cast<uint64_t>(centerPos.x);
+
     minRangeX = minRangeX == 0 ? maxViewportX : minRangeX;
     maxRangeX = maxRangeX == 0 ? maxViewportX : maxRangeX;
     minRangeY = minRangeY == 0 ? maxViewportY : minRangeY;
     maxRangeY = maxRangeY == 0 ? maxViewportY : maxRangeY;
     if (minRangeX == maxViewportX && maxRangeX == maxViewportX && minRangeY == maxViewportY && maxRangeY == maxViewportY && multifloor) {
         if (onlyPlayers) {
-            const auto it = playersSpectatorCache.find(centerPos);
-            if (it != playersSpectatorCache.end()) {
+            const auto it = playersSpectatorCache.find(cacheKey);
+            if (it != playersSpectatorCache.end() && isSpectatorCacheValid(it->second, true)) {
                 if (!spectators.empty()) {
-                    const SpectatorVector& cachedSpectators = it->second;
+                    const SpectatorVector& cachedSpectators = it->second.spectators;
                     spectators.insert(spectators.end(), cachedSpectators.begin(), cachedSpectators.end());
                 } else {
-                    spectators = it->second;
+                    spectators = it->second.spectators;
                 }
 
                 foundCache = true;
@@ -480,17 +535,17 @@ void Map::getSpectators(SpectatorVector& spectators, const Position& centerPos,
         }
 
         if (!foundCache) {
-            const auto it = spectatorCache.find(centerPos);
-            if (it != spectatorCache.end()) {
+            const auto it = spectatorCache.find(cacheKey);
+            if (it != spectatorCache.end() && isSpectatorCacheValid(it->second, false)) {
                 if (!onlyPlayers) {
                     if (!spectators.empty()) {
-                        const SpectatorVector& cachedSpectators = it->second;
+                        const SpectatorVector& cachedSpectators = it->second.spectators;
                         spectators.insert(spectators.end(), cachedSpectators.begin(), cachedSpectators.end());
                     } else {
-                        spectators = it->second;
+                        spectators = it->second.spectators;
                     }
                 } else {
-                    const SpectatorVector& cachedSpectators = it->second;
+                    const SpectatorVector& cachedSpectators = it->second.spectators;
                     for (Creature* spectator : cachedSpectators) {
                         if (spectator->getPlayer()) {
                             spectators.emplace_back(spectator);
@@ -530,22 +585,51 @@ void Map::getSpectators(SpectatorVector& spectators, const Position& centerPos,
             maxRangeZ = centerPos.z;
         }
 
-        getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
         if (cacheResult) {
-            if (onlyPlayers) {
-                playersSpectatorCache[centerPos] = spectators;
+            SpectatorCache& cache = (onlyPlayers ? playersSpectatorCache : spectatorCache);
+            if (cache.size() >= SPECTATOR_CACHE_MAX_ENTRIES) {
+                cache.clear();
+            }
+
+            // the cache only holds the spectators found by this query so collect them apart from the ones we were given
+            SpectatorCacheEntry& cacheEntry = cache[cacheKey];
+            cacheEntry.spectators.clear();
+            cacheEntry.sectorCount = 0;
+            cacheEntry.sectorsGeneration = sectorsGeneration;
+            getSpectatorsInternal(cacheEntry.spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers, &cacheEntry);
+
+            const SpectatorVector& cachedSpectators = cacheEntry.spectators;
+            if (!spectators.empty()) {
+                spectators.insert(spectators.end(), cachedSpectators.begin(), cachedSpectators.end());
             } else {
-                spectatorCache[centerPos] = spectators;
+                spectators = cachedSpectators;
+            }
+
+            if (cacheEntry.sectorCount > SPECTATOR_CACHE_MAX_SECTORS) {
+                cache.erase(cacheKey);
             }
+        } else {
+            getSpectatorsInternal(spectators, centerPos, minRangeX, maxRangeX, minRangeY, maxRangeY, minRangeZ, maxRangeZ, onlyPlayers);
         }
     }
 }
 
-void Map::clearSpectatorCache(const bool clearPlayer)
+void Map::invalidateSpectatorCache(const Position& pos, const bool player)
 {
-    spectatorCache.clear();
-    if (clearPlayer) {
-        playersSpectatorCache.clear();
+    MapSector* sector = getMapSector(pos.x, pos.y);
+    if (sector) {
+        ++sector->creatureGeneration;
+        if (player) {
+            ++sector->playerGeneration;
+        }
+    }
+}
+
+void Map::invalidateTileState(const Position& pos)
+{
+    MapSector* sector = getMapSector(pos.x, pos.y);
+    if (sector) {
+        ++sector->tileGeneration;
     }
 }
 
@@ -756,6 +840,7 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
     Position endPos;
 
     AStarNodes nodes(pos.x, pos.y, AStarNodes::getTileWalkCost(creature, getTile(pos.x, pos.y, pos.z)));
+    const int32_t maxClosedNodes = fpp.maxClosedNodes > 0 ? fpp.maxClosedNodes : g_config.getNumber(ConfigManager::PATHFINDING_MAX_CLOSED_NODES);
 
     int32_t bestMatch = 0;
 
@@ -875,7 +960,7 @@ bool Map::getPathMatching(const Creature& creature, const Position& targetPos, s
             }
         }
         nodes.closeNode(n);
-    } while (nodes.getClosedNodes() < 100);
+    } while (nodes.getClosedNodes() < maxClosedNodes);
     if (!found) {
         return false;
     }
@@ -925,6 +1010,7 @@ bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPo
     Position endPos;
 
     AStarNodes nodes(pos.x, pos.y, AStarNodes::getTileWalkCost(creature, getTile(pos.x, pos.y, pos.z)));
+    const int32_t maxClosedNodes = fpp.maxClosedNodes > 0 ? fpp.maxClosedNodes : g_config.getNumber(ConfigManager::PATHFINDING_MAX_CLOSED_NODES);
 
     int32_t bestMatch = 0;
 
@@ -1051,7 +1137,7 @@ bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPo
             }
         }
         nodes.closeNode(n);
-    } while (fpp.maxSearchDist != 0 || nodes.getClosedNodes() < 100);
+    } while (fpp.maxSearchDist != 0 || nodes.getClosedNodes() < maxClosedNodes);
 
     if (!found) {
         return false;
@@ -1096,204 +1182,497 @@ bool Map::getPathMatchingCond(const Creature& creature, const Position& targetPo
     return true;
 }
 
+bool Map::getPathTo(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp)
+{
+    PathCacheKey key;
+    key.startPos = creature.getPosition();
+    key.targetPos = targetPos;
+    if (const Monster* monster = creature.getMonster()) {
+        //everything else that decides where a monster can walk and what it costs comes from its type
+        key.monsterType = monster->getMonsterType();
+        key.walkClass = (monster->isSummon() ? 1 : 0) | (monster->isIgnoringFieldDamage() ? 2 : 0) |
+            (creature.hasCondition(CONDITION_FIRE) ? 4 : 0) | (creature.hasCondition(CONDITION_ENERGY) ? 8 : 0) | (creature.hasCondition(CONDITION_POISON) ? 16 : 0);
+    } else {
+        key.monsterType = nullptr;
+        key.walkClass = creature.getID();
+    }
+    key.maxSearchDist = fpp.maxSearchDist;
+    key.minTargetDist = fpp.minTargetDist;
+    key.maxTargetDist = fpp.maxTargetDist;
+    key.searchFlags = (fpp.fullPathSearch ? 1 : 0) | (fpp.clearSight ? 2 : 0) | (fpp.allowDiagonal ? 4 : 0) | (fpp.keepDistance ? 8 : 0);
+
+    auto it = pathCacheIndex.find(key);
+    if (it != pathCacheIndex.end()) {
+        const auto entry = it->second;
+        if (!isPathCacheValid(*entry)) {
+            ++pathCacheStats.stale;
+            pathCache.erase(entry);
+            pathCacheIndex.erase(it);
+        } else if (!canWalkPathStart(creature, *entry)) {
+            //still fine for whoever comes next, the search below replaces it
+            ++pathCacheStats.blocked;
+        } else {
+            ++pathCacheStats.hits;
+            pathCacheStats.savedTime += pathCacheStats.searchTime / pathCacheStats.misses;
+            pathCache.splice(pathCache.begin(), pathCache, entry);
+            dirList.insert(dirList.end(), entry->dirList.begin(), entry->dirList.end());
+            return true;
+        }
+    }
+
+    ++pathCacheStats.misses;
+
+    const size_t pathStart = dirList.size();
+    const auto searchStart = std::chrono::steady_clock::now();
+    bool found;
+    if (fpp.maxSearchDist != 0 || fpp.keepDistance) {
+        found = getPathMatchingCond(creature, targetPos, dirList, FrozenPathingConditionCall(targetPos), fpp);
+    } else {
+        found = getPathMatching(creature, targetPos, dirList, FrozenPathingConditionCall(targetPos), fpp);
+    }
+    pathCacheStats.searchTime += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - searchStart).count();
+
+    if (found) {
+        cachePath(key, dirList, pathStart);
+    }
+    return found;
+}
+
+void Map::cachePath(const PathCacheKey& key, const std::vector<Direction>& dirList, const size_t pathStart)
+{
+    PathCacheEntry entry;
+    entry.key = key;
+    entry.sectorsGeneration = sectorsGeneration;
+
+    //steps are taken from the back of the list
+    Position pos = key.startPos;
+    size_t index = dirList.size();
+    while (true) {
+        const MapSector* sector = getMapSector(pos.x, pos.y);
+        if (!sector) {
+            return;
+        }
+
+        bool knownSector = false;
+        for (uint32_t i = 0; i < entry.sectorCount; ++i) {
+            if (entry.sectors[i].first == sector) {
+                knownSector = true;
+                break;
+            }
+        }
+
+        if (!knownSector) {
+            if (entry.sectorCount == PATH_CACHE_MAX_SECTORS) {
+                return;
+            }
+            entry.sectors[entry.sectorCount++] = std::make_pair(sector, sector->tileGeneration);
+        }
+
+        if (index == pathStart) {
+            break;
+        }
+        pos = getNextPosition(dirList[--index], pos);
+    }
+
+    //a chaser searches again after every step, so every tile on the way gets the rest of the path,
+    //checked against all the sectors of the whole path which is a bit stricter than needed
+    pos = key.startPos;
+    for (size_t end = dirList.size(); end > pathStart; pos = getNextPosition(dirList[--end], pos)) {
+        entry.key.startPos = pos;
+        entry.dirList.assign(dirList.begin() + pathStart, dirList.begin() + end);
+
+        auto it = pathCacheIndex.find(entry.key);
+        if (it != pathCacheIndex.end()) {
+            pathCache.erase(it->second);
+            pathCacheIndex.erase(it);
+        } else if (pathCache.size() >= PATH_CACHE_MAX_ENTRIES) {
+            pathCacheIndex.erase(pathCache.back().key);
+            pathCache.pop_back();
+        }
+
+        pathCache.push_front(entry);
+        pathCacheIndex[entry.key] = pathCache.begin();
+    }
+}
+
+bool Map::isPathCacheValid(const PathCacheEntry& entry) const
+{
+    if (entry.sectorsGeneration != sectorsGeneration) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < entry.sectorCount; ++i) {
+        const auto& it = entry.sectors[i];
+        if (it.second != it.first->tileGeneration) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Map::canWalkPathStart(const Creature& creature, const PathCacheEntry& entry) const
+{
+    //creatures further down the path will have moved by the time they matter, walking into one searches again
+    Position pos = entry.key.startPos;
+    const size_t steps = std::min<size_t>(entry.dirList.size(), PATH_CACHE_CHECKED_STEPS);
+    for (size_t i = 1; i <= steps; ++i) {
+        pos = getNextPosition(entry.dirList[entry.dirList.size() - i], pos);
+        if (!canWalkTo(creature, pos)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Map::isRegionAwake(const uint32_t regionKey)
+{
+    const int64_t now = OTSYS_TIME();
+    auto& state = regionStates[regionKey];
+    if (state.first > now) {
+        return state.second;
+    }
+
+    // regions and the wake radius are whole sectors, so the scan can step sector by sector
+    const int32_t regionX = static_cast<int32_t>(regionKey & 0xFFFF) * HIBERNATION_REGION_SIZE;
+    const int32_t regionY = static_cast<int32_t>(regionKey >> 16) * HIBERNATION_REGION_SIZE;
+    const int32_t startx = std::max<int32_t>(0, regionX - HIBERNATION_WAKE_RADIUS);
+    const int32_t starty = std::max<int32_t>(0, regionY - HIBERNATION_WAKE_RADIUS);
+    const int32_t endx = std::min<int32_t>(0xFFFF, regionX + HIBERNATION_REGION_SIZE + HIBERNATION_WAKE_RADIUS - 1);
+    const int32_t endy = std::min<int32_t>(0xFFFF, regionY + HIBERNATION_REGION_SIZE + HIBERNATION_WAKE_RADIUS - 1);
+
+    bool awake = false;
+    for (int32_t ny = starty; ny <= endy && !awake; ny += SECTOR_SIZE) {
+        for (int32_t nx = startx; nx <= endx; nx += SECTOR_SIZE) {
+            const MapSector* sector = getMapSector(nx, ny);
+            if (sector && sector->player_list.size() != 0) {
+                awake = true;
+                break;
+            }
+        }
+    }
+
+    state = std::make_pair(now + EVENT_CREATURE_THINK_INTERVAL, awake);
+    return awake;
+}
+
+bool Map::getFlowFieldPath(const Monster& monster, const Creature& target, std::vector<Direction>& dirList)
+{
+    const Position& startPos = monster.getPosition();
+    const Position& targetPos = target.getPosition();
+    if (startPos.z != targetPos.z) {
+        return false;
+    }
+
+    int32_t x = Position::getOffsetX(startPos, targetPos) + FLOW_FIELD_RADIUS;
+    int32_t y = Position::getOffsetY(startPos, targetPos) + FLOW_FIELD_RADIUS;
+    if (x < 0 || x >= FLOW_FIELD_WIDTH || y < 0 || y >= FLOW_FIELD_WIDTH) {
+        return false;
+    }
+
+    const int64_t now = OTSYS_TIME();
+    const auto key = std::make_pair(target.getID(), monster.getMonsterType());
+    auto it = flowFields.find(key);
+    if (it == flowFields.end()) {
+        if (flowFields.size() >= FLOW_FIELD_MAX_ENTRIES) {
+            for (auto fit = flowFields.begin(); fit != flowFields.end();) {
+                if (now - fit->second.lastUse >= FLOW_FIELD_EXPIRATION) {
+                    fit = flowFields.erase(fit);
+                } else {
+                    ++fit;
+                }
+            }
+        }
+
+        it = flowFields.emplace(key, FlowField()).first;
+        buildFlowField(it->second, monster, targetPos);
+    } else if (it->second.targetPos != targetPos || !isFlowFieldValid(it->second)) {
+        buildFlowField(it->second, monster, targetPos);
+    }
+
+    FlowField& field = it->second;
+    field.lastUse = now;
+
+    int32_t index = y * FLOW_FIELD_WIDTH + x;
+    if (field.costs[index] < 0) {
+        return false;
+    }
+
+    if (field.costs[index] == 0) {
+        return true;
+    }
+
+    //creatures standing in the way aren't part of the shared field, the first step is checked against this monster like A* would
+    Direction dir = field.steps[index];
+    if (!canWalkTo(monster, getNextPosition(dir, startPos))) {
+        dir = DIRECTION_NONE;
+
+        int32_t bestCost = std::numeric_limits<int32_t>::max();
+        for (uint8_t i = DIRECTION_NORTH; i <= DIRECTION_LAST; ++i) {
+            const Direction nextDir = static_cast<Direction>(i);
+            const Position nextPos = getNextPosition(nextDir, startPos);
+            const int32_t nextX = x + Position::getOffsetX(nextPos, startPos);
+            const int32_t nextY = y + Position::getOffsetY(nextPos, startPos);
+            if (nextX < 0 || nextX >= FLOW_FIELD_WIDTH || nextY < 0 || nextY >= FLOW_FIELD_WIDTH) {
+                continue;
+            }
+
+            const int32_t nextCost = field.costs[nextY * FLOW_FIELD_WIDTH + nextX];
+            if (nextCost < 0) {
+                continue;
+            }
+
+            const Tile* tile = canWalkTo(monster, nextPos);
+            if (!tile) {
+                continue;
+            }
+
+            const int32_t cost = nextCost + ((i & DIRECTION_DIAGONAL_MASK) ? MAP_NORMALWALKCOST + MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST) + AStarNodes::getTileWalkCost(monster, tile);
+            if (cost < bestCost) {
+                bestCost = cost;
+                dir = nextDir;
+            }
+        }
+
+        if (dir == DIRECTION_NONE) {
+            return false;
+        }
+    }
+
+    //every step lowers the cost, so this ends at a tile next to the target
+    Position pos = startPos;
+    do {
+        dirList.emplace_back(dir);
+        const Position nextPos = getNextPosition(dir, pos);
+        x += Position::getOffsetX(nextPos, pos);
+        y += Position::getOffsetY(nextPos, pos);
+        pos = nextPos;
+
+        index = y * FLOW_FIELD_WIDTH + x;
+        dir = field.steps[index];
+    } while (field.costs[index] > 0);
+    return true;
+}
+
+void Map::buildFlowField(FlowField& field, const Monster& monster, const Position& targetPos)
+{
+    //walk costs around target as they would be for A*, -1 not checked yet and -2 not walkable
+    //creatures don't block here since the monsters sharing the field are the ones in the way
+    std::array<int32_t, FLOW_FIELD_WIDTH * FLOW_FIELD_WIDTH> tileCosts;
+    tileCosts.fill(-1);
+    tileCosts[FLOW_FIELD_RADIUS * FLOW_FIELD_WIDTH + FLOW_FIELD_RADIUS] = -2;
+
+    const int32_t baseX = static_cast<int32_t>(targetPos.x) - FLOW_FIELD_RADIUS;
+    const int32_t baseY = static_cast<int32_t>(targetPos.y) - FLOW_FIELD_RADIUS;
+    const auto getTileCost = [&](int32_t index) {
+        int32_t& tileCost = tileCosts[index];
+        if (tileCost == -1) {
+            tileCost = -2;
+
+            const int32_t x = baseX + index % FLOW_FIELD_WIDTH;
+            const int32_t y = baseY + index / FLOW_FIELD_WIDTH;
+            if (x >= 0 && y >= 0 && x <= std::numeric_limits<uint16_t>::max() && y <= std::numeric_limits<uint16_t>::max()) {
+                const Tile* tile = getTile(static_cast<uint16_t>(x), static_cast<uint16_t>(y), targetPos.z);
+                if (tile && tile->queryAdd(0, monster, 1, FLAG_PATHFINDING | FLAG_IGNOREFIELDDAMAGE | FLAG_IGNOREBLOCKCREATURE) == RETURNVALUE_NOERROR) {
+                    tileCost = AStarNodes::getTileWalkCost(monster, tile);
+                }
+            }
+        }
+        return tileCost;
+    };
+
+    //neighbor offset and the direction of the step from that neighbor back to the tile
+    static const int32_t neighbors[8][3] = {
+        {0, -1, DIRECTION_SOUTH}, {1, 0, DIRECTION_WEST}, {0, 1, DIRECTION_NORTH}, {-1, 0, DIRECTION_EAST},
+        {-1, 1, DIRECTION_NORTHEAST}, {1, 1, DIRECTION_NORTHWEST}, {-1, -1, DIRECTION_SOUTHEAST}, {1, -1, DIRECTION_SOUTHWEST}
+    };
+
+    field.targetPos = targetPos;
+    field.costs.fill(-1);
+
+    //Dijkstra outwards from every walkable tile next to the target
+    std::vector<std::pair<int32_t, int32_t>> openNodes;
+    openNodes.reserve(FLOW_FIELD_WIDTH * FLOW_FIELD_WIDTH);
+    for (const auto& neighbor : neighbors) {
+        const int32_t index = (FLOW_FIELD_RADIUS + neighbor[1]) * FLOW_FIELD_WIDTH + FLOW_FIELD_RADIUS + neighbor[0];
+        if (getTileCost(index) >= 0) {
+            field.costs[index] = 0;
+            openNodes.emplace_back(0, index);
+        }
+    }
+
+    const auto compareNodes = [](const std::pair<int32_t, int32_t>& lhs, const std::pair<int32_t, int32_t>& rhs) {
+        return lhs.first > rhs.first;
+    };
+    std::make_heap(openNodes.begin(), openNodes.end(), compareNodes);
+    while (!openNodes.empty()) {
+        std::pop_heap(openNodes.begin(), openNodes.end(), compareNodes);
+        const auto [cost, index] = openNodes.back();
+        openNodes.pop_back();
+        if (cost != field.costs[index]) {
+            continue;
+        }
+
+        const int32_t x = index % FLOW_FIELD_WIDTH;
+        const int32_t y = index / FLOW_FIELD_WIDTH;
+        const int32_t enterCost = cost + tileCosts[index];
+        for (const auto& neighbor : neighbors) {
+            const int32_t neighborX = x + neighbor[0];
+            const int32_t neighborY = y + neighbor[1];
+            if (neighborX < 0 || neighborX >= FLOW_FIELD_WIDTH || neighborY < 0 || neighborY >= FLOW_FIELD_WIDTH) {
+                continue;
+            }
+
+            const int32_t neighborIndex = neighborY * FLOW_FIELD_WIDTH + neighborX;
+            if (getTileCost(neighborIndex) < 0) {
+                continue;
+            }
+
+            const int32_t newCost = enterCost + ((neighbor[2] & DIRECTION_DIAGONAL_MASK) ? MAP_NORMALWALKCOST + MAP_DIAGONALWALKCOST : MAP_NORMALWALKCOST);
+            int32_t& neighborCost = field.costs[neighborIndex];
+            if (neighborCost < 0 || newCost < neighborCost) {
+                neighborCost = newCost;
+                field.steps[neighborIndex] = static_cast<Direction>(neighbor[2]);
+                openNodes.emplace_back(newCost, neighborIndex);
+                std::push_heap(openNodes.begin(), openNodes.end(), compareNodes);
+            }
+        }
+    }
+
+    field.sectorCount = 0;
+    field.sectorsGeneration = sectorsGeneration;
+
+    const int32_t startX = std::max<int32_t>(0, baseX) & ~SECTOR_MASK;
+    const int32_t startY = std::max<int32_t>(0, baseY) & ~SECTOR_MASK;
+    for (int32_t sectorY = startY; sectorY <= baseY + FLOW_FIELD_WIDTH - 1; sectorY += SECTOR_SIZE) {
+        for (int32_t sectorX = startX; sectorX <= baseX + FLOW_FIELD_WIDTH - 1; sectorX += SECTOR_SIZE) {
+            const MapSector* sector = getMapSector(sectorX, sectorY);
+            if (sector && field.sectorCount < FLOW_FIELD_MAX_SECTORS) {
+                field.sectors[field.sectorCount++] = std::make_pair(sector, sector->tileGeneration);
+            }
+        }
+    }
+}
+
+bool Map::isFlowFieldValid(const FlowField& field) const
+{
+    if (field.sectorsGeneration != sectorsGeneration) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < field.sectorCount; ++i) {
+        const auto& it = field.sectors[i];
+        if (it.second != it.first->tileGeneration) {
+            return false;
+        }
+    }
+    return true;
+}
+
 // AStarNodes
-AStarNodes::AStarNodes(const uint32_t x, const uint32_t y, const int_fast32_t extraCost) : openNodes()
+AStarNodes::AStarNodes(const uint32_t x, const uint32_t y, const int_fast32_t extraCost) :
+    storage(getStorage()), startX(x), startY(y), maxNodes(g_config.getNumber(ConfigManager::PATHFINDING_MAX_NODES))
 {
-#if defined(__AVX2__)
-    __m256i defaultCost = _mm256_set1_epi32(std::numeric_limits<int32_t>::max());
-    for (int32_t i = 0; i < MAX_NODES; i += 32) {
-        _mm256_stream_si256(reinterpret_cast<__m256i*>(&calculatedNodes[i + 0]), defaultCost);
-        _mm256_stream_si256(reinterpret_cast<__m256i*>(&calculatedNodes[i + 8]), defaultCost);
-        _mm256_stream_si256(reinterpret_cast<__m256i*>(&calculatedNodes[i + 16]), defaultCost);
-        _mm256_stream_si256(reinterpret_cast<__m256i*>(&calculatedNodes[i + 24]), defaultCost);
-    }
-    _mm_sfence();
-#elif defined(__SSE2__)
-    __m128i defaultCost = _mm_set1_epi32(std::numeric_limits<int32_t>::max());
-    for (int32_t i = 0; i < MAX_NODES; i += 16) {
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&calculatedNodes[i + 0]), defaultCost);
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&calculatedNodes[i + 4]), defaultCost);
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&calculatedNodes[i + 8]), defaultCost);
-        _mm_stream_si128(reinterpret_cast<__m128i*>(&calculatedNodes[i + 12]), defaultCost);
-    }
-    _mm_sfence();
-#endif
+    if (storage.nodes.size() < static_cast<size_t>(maxNodes)) {
+        //parents point into the nodes so they're never reallocated during a search
+        storage.nodes.resize(maxNodes);
+        storage.heapPositions.resize(maxNodes);
+        storage.heap.reserve(maxNodes);
+    }
+
+    if (++storage.generation == 0) {
+        std::fill(storage.grid.begin(), storage.grid.end(), GridCell{0, 0});
+        storage.generation = 1;
+    }
+    storage.heap.clear();
+    if (!storage.farNodes.empty()) {
+        storage.farNodes.clear();
+    }
 
     curNode = 1;
     closedNodes = 0;
-    openNodes[0] = true;
 
-    AStarNode& startNode = nodes[0];
+    AStarNode& startNode = storage.nodes[0];
     startNode.parent = nullptr;
     startNode.x = x;
     startNode.y = y;
     startNode.f = 0;
     startNode.g = 0;
     startNode.c = extraCost;
-    nodesTable[0] = x << 16 | y;
-#if defined(__SSE2__)
-    calculatedNodes[0] = 0;
-#endif
+    storage.grid[getGridIndex(x, y)] = GridCell{storage.generation, 0};
+    pushNode(0);
+}
+
+AStarNodes::Storage& AStarNodes::getStorage()
+{
+    static thread_local Storage threadStorage;
+    return threadStorage;
 }
 
 bool AStarNodes::createOpenNode(AStarNode* parent, const uint32_t x, const uint32_t y, const int_fast32_t f, const int_fast32_t heuristic, const int_fast32_t extraCost)
 {
-    if (curNode >= MAX_NODES) {
+    if (curNode >= maxNodes) {
         return false;
     }
 
     const int32_t retNode = curNode++;
-    openNodes[retNode] = true;
 
-    AStarNode& node = nodes[retNode];
+    AStarNode& node = storage.nodes[retNode];
     node.parent = parent;
     node.x = x;
     node.y = y;
     node.f = f;
     node.g = heuristic;
     node.c = extraCost;
-    nodesTable[retNode] = x << 16 | y;
-#if defined(__SSE2__)
-    calculatedNodes[retNode] = f + heuristic;
-#endif
+
+    const int32_t gridIndex = getGridIndex(x, y);
+    if (gridIndex != -1) {
+        storage.grid[gridIndex] = GridCell{storage.generation, retNode};
+    } else {
+        storage.farNodes[x << 16 | y] = retNode;
+    }
+    pushNode(retNode);
     return true;
 }
 
 AStarNode* AStarNodes::getBestNode()
 {
-    //Branchless best node search
-#if defined(__AVX512F__)
-    const __m512i increment = _mm512_set1_epi32(16);
-    __m512i indices = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
-    __m512i minindices = indices;
-    __m512i minvalues = _mm512_load_si512(reinterpret_cast<const void*>(calculatedNodes));
-    for (int32_t pos = 16; pos < curNode; pos += 16) {
-        const __m512i values = _mm512_load_si512(reinterpret_cast<const void*>(&calculatedNodes[pos]));
-        indices = _mm512_add_epi32(indices, increment);
-        minindices = _mm512_mask_blend_epi32(_mm512_cmplt_epi32_mask(values, minvalues), minindices, indices);
-        minvalues = _mm512_min_epi32(minvalues, values);
-    }
-
-    alignas(64) int32_t values_array[16];
-    alignas(64) int32_t indices_array[16];
-    _mm512_store_si512(reinterpret_cast<void*>(values_array), minvalues);
-    _mm512_store_si512(reinterpret_cast<void*>(indices_array), minindices);
-
-    int32_t best_node = indices_array[0];
-    int32_t best_node_f = values_array[0];
-    for (int32_t i = 1; i < 16; ++i) {
-        int32_t total_cost = values_array[i];
-        best_node = (total_cost < best_node_f ? indices_array[i] : best_node);
-        best_node_f = (total_cost < best_node_f ? total_cost : best_node_f);
-    }
-    return (openNodes[best_node] ? &nodes[best_node] : NULL);
-#elif defined(__AVX2__)
-    const __m256i increment = _mm256_set1_epi32(8);
-    __m256i indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
-    __m256i minindices = indices;
-    __m256i minvalues = _mm256_load_si256(reinterpret_cast<const __m256i*>(calculatedNodes));
-    for (int32_t pos = 8; pos < curNode; pos += 8) {
-        const __m256i values = _mm256_load_si256(reinterpret_cast<const __m256i*>(&calculatedNodes[pos]));
-        indices = _mm256_add_epi32(indices, increment);
-        minindices = _mm256_blendv_epi8(minindices, indices, _mm256_cmpgt_epi32(minvalues, values));
-        minvalues = _mm256_min_epi32(values, minvalues);
-    }
-
-    __m256i res = _mm256_min_epi32(minvalues, _mm256_shuffle_epi32(minvalues, _MM_SHUFFLE(2, 3, 0, 1))); //Calculate horizontal minimum
-    res = _mm256_min_epi32(res, _mm256_shuffle_epi32(res, _MM_SHUFFLE(0, 1, 2, 3))); //Calculate horizontal minimum
-    res = _mm256_min_epi32(res, _mm256_permutevar8x32_epi32(res, _mm256_set_epi32(0, 1, 2, 3, 4, 5, 6, 7))); //Calculate horizontal minimum
-
-    alignas(32) int32_t indices_array[8];
-    _mm256_store_si256(reinterpret_cast<__m256i*>(indices_array), minindices);
-
-    int32_t best_node = indices_array[(_mm_ctz(_mm256_movemask_epi8(_mm256_cmpeq_epi32(minvalues, res))) >> 2)];
-    return openNodes[best_node] ? &nodes[best_node] : nullptr;
-#elif defined(__SSE4_1__)
-    const __m128i increment = _mm_set1_epi32(4);
-    __m128i indices = _mm_setr_epi32(0, 1, 2, 3);
-    __m128i minindices = indices;
-    __m128i minvalues = _mm_load_si128(reinterpret_cast<const __m128i*>(calculatedNodes));
-    for (int32_t pos = 4; pos < curNode; pos += 4) {
-        const __m128i values = _mm_load_si128(reinterpret_cast<const __m128i*>(&calculatedNodes[pos]));
-        indices = _mm_add_epi32(indices, increment);
-        minindices = _mm_blendv_epi8(minindices, indices, _mm_cmplt_epi32(values, minvalues));
-        minvalues = _mm_min_epi32(values, minvalues);
-    }
-
-    __m128i res = _mm_min_epi32(minvalues, _mm_shuffle_epi32(minvalues, _MM_SHUFFLE(2, 3, 0, 1))); //Calculate horizontal minimum
-    res = _mm_min_epi32(res, _mm_shuffle_epi32(res, _MM_SHUFFLE(0, 1, 2, 3))); //Calculate horizontal minimum
-
-    alignas(16) int32_t indices_array[4];
-    _mm_store_si128(reinterpret_cast<__m128i*>(indices_array), minindices);
-
-    int32_t best_node = indices_array[(_mm_ctz(_mm_movemask_epi8(_mm_cmpeq_epi32(minvalues, res))) >> 2)];
-    return (openNodes[best_node] ? &nodes[best_node] : NULL);
-#elif defined(__SSE2__)
-    auto _mm_sse2_min_epi32 = [](const __m128i a, const __m128i b) {
-        __m128i mask = _mm_cmpgt_epi32(a, b);
-        return _mm_or_si128(_mm_and_si128(mask, b), _mm_andnot_si128(mask, a));
-    };
-
-    auto _mm_sse2_blendv_epi8 = [](const __m128i a, const __m128i b, __m128i mask) {
-        mask = _mm_cmplt_epi8(mask, _mm_setzero_si128());
-        return _mm_or_si128(_mm_andnot_si128(mask, a), _mm_and_si128(mask, b));
-    };
-
-    const __m128i increment = _mm_set1_epi32(4);
-    __m128i indices = _mm_setr_epi32(0, 1, 2, 3);
-    __m128i minindices = indices;
-    __m128i minvalues = _mm_load_si128(reinterpret_cast<const __m128i*>(calculatedNodes));
-    for (int32_t pos = 4; pos < curNode; pos += 4) {
-        const __m128i values = _mm_load_si128(reinterpret_cast<const __m128i*>(&calculatedNodes[pos]));
-        indices = _mm_add_epi32(indices, increment);
-        minindices = _mm_sse2_blendv_epi8(minindices, indices, _mm_cmplt_epi32(values, minvalues));
-        minvalues = _mm_sse2_min_epi32(values, minvalues);
+    //the best node leaves the open list here already, closeNode only counts it
+    if (storage.heap.empty()) {
+        return nullptr;
     }
 
-    __m128i res = _mm_sse2_min_epi32(minvalues, _mm_shuffle_epi32(minvalues, _MM_SHUFFLE(2, 3, 0, 1))); //Calculate horizontal minimum
-    res = _mm_sse2_min_epi32(res, _mm_shuffle_epi32(res, _MM_SHUFFLE(0, 1, 2, 3))); //Calculate horizontal minimum
-
-    alignas(16) int32_t indices_array[4];
-    _mm_store_si128(reinterpret_cast<__m128i*>(indices_array), minindices);
-
-    int32_t best_node = indices_array[(_mm_ctz(_mm_movemask_epi8(_mm_cmpeq_epi32(minvalues, res))) >> 2)];
-    return (openNodes[best_node] ? &nodes[best_node] : NULL);
-#else
-    int32_t best_node_f = std::numeric_limits<int32_t>::max();
-    int32_t best_node = -1;
-    for (int32_t pos = 0; pos < curNode; ++pos) {
-        if (!openNodes[pos]) {
-            continue;
-        }
+    const int32_t bestNode = storage.heap.front();
+    storage.heapPositions[bestNode] = -1;
 
-        int32_t total_cost = nodes[pos].f + nodes[pos].g;
-        best_node = (total_cost < best_node_f ? pos : best_node);
-        best_node_f = (total_cost < best_node_f ? total_cost : best_node_f);
+    const int32_t lastNode = storage.heap.back();
+    storage.heap.pop_back();
+    if (!storage.heap.empty()) {
+        storage.heap.front() = lastNode;
+        storage.heapPositions[lastNode] = 0;
+        siftDown(0);
     }
-    return (best_node != -1 ? &nodes[best_node] : nullptr);
-#endif
+    return &storage.nodes[bestNode];
 }
 
 void AStarNodes::closeNode(const AStarNode* node)
 {
-    const size_t index = node - nodes;
-    assert(index < MAX_NODES);
-#if defined(__SSE2__)
-    calculatedNodes[index] = std::numeric_limits<int32_t>::max();
-#endif
-    openNodes[index] = false;
+    assert(static_cast<size_t>(node - storage.nodes.data()) < static_cast<size_t>(curNode));
     ++closedNodes;
 }
 
 void AStarNodes::openNode(const AStarNode* node)
 {
-    const size_t index = node - nodes;
-    assert(index < MAX_NODES);
-#if defined(__SSE2__)
-    calculatedNodes[index] = nodes[index].f + nodes[index].g;
-#endif
-    closedNodes -= openNodes[index] ? 0 : 1;
-    openNodes[index] = true;
+    const size_t index = node - storage.nodes.data();
+    assert(index < static_cast<size_t>(curNode));
+
+    const int32_t position = storage.heapPositions[index];
+    if (position == -1) {
+        --closedNodes;
+        pushNode(static_cast<int32_t>(index));
+    } else {
+        //only ever reopened with a lower cost
+        siftUp(position);
+    }
 }
 
 int32_t AStarNodes::getClosedNodes() const
@@ -1303,48 +1682,85 @@ int32_t AStarNodes::getClosedNodes() const
 
 AStarNode* AStarNodes::getNodeByPosition(const uint32_t x, const uint32_t y)
 {
-    uint32_t xy = x << 16 | y;
-#if defined(__SSE2__)
-    const __m128i key = _mm_set1_epi32(xy);
+    const int32_t gridIndex = getGridIndex(x, y);
+    if (gridIndex != -1) {
+        const GridCell& cell = storage.grid[gridIndex];
+        return (cell.generation == storage.generation ? &storage.nodes[cell.node] : nullptr);
+    }
+
+    const auto it = storage.farNodes.find(x << 16 | y);
+    return (it != storage.farNodes.end() ? &storage.nodes[it->second] : nullptr);
+}
+
+bool AStarNodes::isBefore(const int32_t lhs, const int32_t rhs) const
+{
+    //ties go to the older node
+    const AStarNode& lhsNode = storage.nodes[lhs];
+    const AStarNode& rhsNode = storage.nodes[rhs];
+    const int_fast32_t lhsCost = lhsNode.f + lhsNode.g;
+    const int_fast32_t rhsCost = rhsNode.f + rhsNode.g;
+    return lhsCost < rhsCost || (lhsCost == rhsCost && lhs < rhs);
+}
 
-    int32_t pos = 0;
-    int32_t curRound = curNode - 16;
-    for (; pos <= curRound; pos += 16) {
-        __m128i v[4];
-        v[0] = _mm_cmpeq_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(&nodesTable[pos])), key);
-        v[1] = _mm_cmpeq_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(&nodesTable[pos + 4])), key);
-        v[2] = _mm_cmpeq_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(&nodesTable[pos + 8])), key);
-        v[3] = _mm_cmpeq_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(&nodesTable[pos + 12])), key);
-        const uint32_t mask = _mm_movemask_epi8(_mm_packs_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3])));
-        if (mask != 0) {
-            return &nodes[pos + _mm_ctz(mask)];
+void AStarNodes::siftUp(int32_t position)
+{
+    std::vector<int32_t>& heap = storage.heap;
+    const int32_t node = heap[position];
+    while (position > 0) {
+        const int32_t parent = (position - 1) / 2;
+        if (!isBefore(node, heap[parent])) {
+            break;
         }
+
+        heap[position] = heap[parent];
+        storage.heapPositions[heap[position]] = position;
+        position = parent;
     }
-    curRound = curNode - 8;
-    if (pos <= curRound) {
-        __m128i v[2];
-        v[0] = _mm_cmpeq_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(&nodesTable[pos])), key);
-        v[1] = _mm_cmpeq_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(&nodesTable[pos + 4])), key);
-        const uint32_t mask = _mm_movemask_epi8(_mm_packs_epi32(v[0], v[1]));
-        if (mask != 0) {
-            return &nodes[pos + (_mm_ctz(mask) >> 1)];
+    heap[position] = node;
+    storage.heapPositions[node] = position;
+}
+
+void AStarNodes::siftDown(int32_t position)
+{
+    std::vector<int32_t>& heap = storage.heap;
+    const int32_t size = static_cast<int32_t>(heap.size());
+    const int32_t node = heap[position];
+    while (true) {
+        int32_t child = position * 2 + 1;
+        if (child >= size) {
+            break;
         }
-        pos += 8;
-    }
-    for (; pos < curNode; ++pos) {
-        if (nodesTable[pos] == xy) {
-            return &nodes[pos];
+
+        if (child + 1 < size && isBefore(heap[child + 1], heap[child])) {
+            ++child;
         }
-    }
-    return nullptr;
-#else
-    for (int32_t i = 1; i < curNode; ++i) {
-        if (nodesTable[i] == xy) {
-            return &nodes[i];
+
+        if (!isBefore(heap[child], node)) {
+            break;
         }
+
+        heap[position] = heap[child];
+        storage.heapPositions[heap[position]] = position;
+        position = child;
     }
-    return (nodesTable[0] == xy ? &nodes[0] : nullptr); // The first node is very unlikely to be the "neighbor" so leave it for end
-#endif
+    heap[position] = node;
+    storage.heapPositions[node] = position;
+}
+
+void AStarNodes::pushNode(const int32_t index)
+{
+    storage.heap.push_back(index);
+    siftUp(static_cast<int32_t>(storage.heap.size()) - 1);
+}
+
+int32_t AStarNodes::getGridIndex(const uint32_t x, const uint32_t y) const
+{
+    const int32_t gridX = static_cast<int32_t>(x) - static_cast<int32_t>(startX) + ASTAR_GRID_RADIUS;
+    const int32_t gridY = static_cast<int32_t>(y) - static_cast<int32_t>(startY) + ASTAR_GRID_RADIUS;
+    if (gridX < 0 || gridX >= ASTAR_GRID_WIDTH || gridY < 0 || gridY >= ASTAR_GRID_WIDTH) {
+        return -1;
+    }
+    return gridY * ASTAR_GRID_WIDTH + gridX;
 }
 
 inline int_fast32_t AStarNodes::getMapWalkCost(AStarNode* node, const Position& neighborPos)
@@ -1398,26 +1814,69 @@ bool MapSector::getFloor(const uint8_t z) const
 
 void MapSector::addCreature(Creature* c)
 {
-    creature_list.push_back(c);
+    const Position& pos = c->getPosition();
+    creature_list.add(c, pos);
     if (c->getPlayer()) {
-        player_list.push_back(c);
+        player_list.add(c, pos);
     }
 }
 
 void MapSector::removeCreature(Creature* c)
 {
-    auto iter = std::find(creature_list.begin(), creature_list.end(), c);
-    assert(iter != creature_list.end());
-    *iter = creature_list.back();
-    creature_list.pop_back();
+    creature_list.remove(c);
+    if (c->getPlayer()) {
+        player_list.remove(c);
+    }
+}
+
+void MapSector::updateCreature(Creature* c)
+{
+    const Position& pos = c->getPosition();
+    creature_list.update(c, pos);
     if (c->getPlayer()) {
-        iter = std::find(player_list.begin(), player_list.end(), c);
-        assert(iter != player_list.end());
-        *iter = player_list.back();
-        player_list.pop_back();
+        player_list.update(c, pos);
     }
 }
 
+uint32_t& SectorCreatureList::indexOf(Creature* c) const
+{
+    return players ? c->playerSectorIndex : c->sectorIndex;
+}
+
+void SectorCreatureList::add(Creature* c, const Position& pos)
+{
+    indexOf(c) = static_cast<uint32_t>(creatures.size());
+    creatures.push_back(c);
+    x.push_back(pos.x);
+    y.push_back(pos.y);
+    z.push_back(pos.z);
+}
+
+void SectorCreatureList::remove(Creature* c)
+{
+    const size_t index = indexOf(c);
+    assert(index < creatures.size() && creatures[index] == c);
+    Creature* last = creatures.back();
+    creatures[index] = last;
+    indexOf(last) = static_cast<uint32_t>(index);
+    creatures.pop_back();
+    x[index] = x.back();
+    x.pop_back();
+    y[index] = y.back();
+    y.pop_back();
+    z[index] = z.back();
+    z.pop_back();
+}
+
+void SectorCreatureList::update(Creature* c, const Position& pos)
+{
+    const size_t index = indexOf(c);
+    assert(index < creatures.size() && creatures[index] == c);
+    x[index] = pos.x;
+    y[index] = pos.y;
+    z[index] = pos.z;
+}
+
 uint32_t Map::clean() const
 {
     const uint64_t start = OTSYS_TIME();
@@ -45,11 +45,13 @@ struct AStarNode
     uint16_t x, y;
 };
 
-static constexpr int32_t MAX_NODES = 512;
-
 static constexpr int32_t MAP_NORMALWALKCOST = 10;
 static constexpr int32_t MAP_DIAGONALWALKCOST = 25;
 
+//Nodes within ASTAR_GRID_RADIUS tiles of the search start are found through a grid, the rest through a hash map
+static constexpr int32_t ASTAR_GRID_RADIUS = 63;
+static constexpr int32_t ASTAR_GRID_WIDTH = ASTAR_GRID_RADIUS * 2 + 1;
+
 class AStarNodes
 {
 public:
@@ -66,27 +68,178 @@ public:
     static inline int_fast32_t getTileWalkCost(const Creature& creature, const Tile* tile);
 
 private:
-#if defined(__SSE2__)
-    alignas(16) uint32_t nodesTable[MAX_NODES];
-    alignas(64) int32_t calculatedNodes[MAX_NODES];
-    AStarNode nodes[MAX_NODES];
-#else
-    AStarNode nodes[MAX_NODES];
-    uint32_t nodesTable[MAX_NODES];
-#endif
+    struct GridCell
+    {
+        uint32_t generation;
+        int32_t node;
+    };
+
+    //kept between searches, grid cells from an older search are told apart by their generation
+    struct Storage
+    {
+        std::vector<AStarNode> nodes;
+        std::vector<int32_t> heap;
+        std::vector<int32_t> heapPositions;
+        std::vector<GridCell> grid = std::vector<GridCell>(ASTAR_GRID_WIDTH * ASTAR_GRID_WIDTH, GridCell{0, 0});
+        std::unordered_map<uint32_t, int32_t> farNodes;
+        uint32_t generation = 0;
+    };
+
+    static Storage& getStorage();
+
+    bool isBefore(int32_t lhs, int32_t rhs) const;
+    void siftUp(int32_t position);
+    void siftDown(int32_t position);
+    void pushNode(int32_t index);
+    int32_t getGridIndex(uint32_t x, uint32_t y) const;
+
+    Storage& storage;
+    uint32_t startX;
+    uint32_t startY;
+    int32_t maxNodes;
     int32_t closedNodes;
     int32_t curNode;
-    bool openNodes[MAX_NODES];
 };
 
-using SpectatorCache = std::map<Position, SpectatorVector>;
-
 //SECTOR_SIZE must be power of 2 value
 //The bigger the SECTOR_SIZE is the less hash map collision there should be but it'll consume more memory
 static constexpr int32_t SECTOR_SIZE = 16;
 static constexpr int32_t SECTOR_MASK = SECTOR_SIZE - 1;
 
+//Cached spectators are validated against the generation of every sector they were collected from
+//full viewport multifloor queries touch at most 3x3 sectors, results spanning more sectors than that are not cached
+static constexpr size_t SPECTATOR_CACHE_MAX_SECTORS = 16;
+static constexpr size_t SPECTATOR_CACHE_MAX_ENTRIES = 32768;
+
+//Monsters far from players are hibernated by regions of HIBERNATION_REGION_SIZE square tiles,
+//a region is woken as soon as a player gets within HIBERNATION_WAKE_RADIUS tiles of it on any floor
+static constexpr int32_t HIBERNATION_REGION_SIZE = SECTOR_SIZE * 8;
+static constexpr int32_t HIBERNATION_WAKE_RADIUS = SECTOR_SIZE * 2;
+
 class FrozenPathingConditionCall;
+class MapSector;
+class Monster;
+class MonsterType;
+
+struct SpectatorCacheEntry
+{
+    SpectatorVector spectators;
+    std::array<std::pair<const MapSector*, uint32_t>, SPECTATOR_CACHE_MAX_SECTORS> sectors;
+    uint32_t sectorCount = 0;
+    uint32_t sectorsGeneration = 0;
+};
+
+#if GAME_FEATURE_ROBINHOOD_HASH_MAP > 0
+using SpectatorCache = robin_hood::unordered_flat_map<uint64_t, SpectatorCacheEntry>;
+#else
+using SpectatorCache = std::unordered_map<uint64_t, SpectatorCacheEntry>;
+#endif
+
+//Flow fields cover the tiles around a chased target, FLOW_FIELD_WIDTH tiles wide
+//a field that wide spans at most 3x3 sectors
+static constexpr int32_t FLOW_FIELD_RADIUS = 12;
+static constexpr int32_t FLOW_FIELD_WIDTH = FLOW_FIELD_RADIUS * 2 + 1;
+static constexpr size_t FLOW_FIELD_MAX_SECTORS = 9;
+static constexpr size_t FLOW_FIELD_MAX_ENTRIES = 1024;
+static constexpr int64_t FLOW_FIELD_EXPIRATION = 60000;
+
+struct FlowField
+{
+    // cheapest walk cost from each tile to a tile next to the target, -1 if there is no way
+    std::array<int32_t, FLOW_FIELD_WIDTH * FLOW_FIELD_WIDTH> costs;
+    // first step of that cheapest walk
+    std::array<Direction, FLOW_FIELD_WIDTH * FLOW_FIELD_WIDTH> steps;
+    std::array<std::pair<const MapSector*, uint32_t>, FLOW_FIELD_MAX_SECTORS> sectors;
+    Position targetPos;
+    int64_t lastUse = 0;
+    uint32_t sectorCount = 0;
+    uint32_t sectorsGeneration = 0;
+};
+
+//Paths are only cached while no tile they cross changed, checked through the sectors they cross
+//creatures moving around don't drop them, only the first steps get checked for blocking creatures
+static constexpr size_t PATH_CACHE_MAX_SECTORS = 8;
+static constexpr size_t PATH_CACHE_MAX_ENTRIES = 4096;
+static constexpr size_t PATH_CACHE_CHECKED_STEPS = 2;
+
+struct PathCacheKey
+{
+    Position startPos;
+    Position targetPos;
+    // monsters walk alike when they share a type and walkClass, other creatures only share with themselves
+    const MonsterType* monsterType;
+    uint32_t walkClass;
+    int32_t maxSearchDist;
+    int32_t minTargetDist;
+    int32_t maxTargetDist;
+    uint8_t searchFlags;
+
+    bool operator==(const PathCacheKey& other) const {
+        return startPos == other.startPos && targetPos == other.targetPos && monsterType == other.monsterType && walkClass == other.walkClass &&
+            maxSearchDist == other.maxSearchDist && minTargetDist == other.minTargetDist && maxTargetDist == other.maxTargetDist && searchFlags == other.searchFlags;
+    }
+};
+
+struct PathCacheKeyHash
+{
+    size_t operator()(const PathCacheKey& key) const {
+        uint64_t hash = (static_cast<uint64_t>(key.startPos.x) << 24) | (static_cast<uint64_t>(key.startPos.y) << 8) | key.startPos.z;
+        hash = hash * 0x9E3779B97F4A7C15ULL ^ ((static_cast<uint64_t>(key.targetPos.x) << 24) | (static_cast<uint64_t>(key.targetPos.y) << 8) | key.targetPos.z);
+        hash = hash * 0x9E3779B97F4A7C15ULL ^ (reinterpret_cast<uintptr_t>(key.monsterType) ^ key.walkClass);
+        hash = hash * 0x9E3779B97F4A7C15ULL ^ ((static_cast<uint64_t>(key.maxSearchDist) << 40) ^ (static_cast<uint64_t>(key.minTargetDist) << 24) ^ (static_cast<uint64_t>(key.maxTargetDist) << 8) ^ key.searchFlags);
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+};
+
+struct PathCacheEntry
+{
+    PathCacheKey key;
+    std::vector<Direction> dirList;
+    std::array<std::pair<const MapSector*, uint32_t>, PATH_CACHE_MAX_SECTORS> sectors;
+    uint32_t sectorCount = 0;
+    uint32_t sectorsGeneration = 0;
+};
+
+struct PathCacheStats
+{
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    // cached paths found but dropped because something changed on their way
+    uint64_t stale = 0;
+    // cached paths found but skipped because a creature stands on one of their first steps
+    uint64_t blocked = 0;
+    // microseconds spent searching on misses, hits are credited the average of that
+    uint64_t searchTime = 0;
+    uint64_t savedTime = 0;
+};
+
+// creatures of a sector together with a packed copy of their positions,
+// lets spectator queries filter on contiguous memory and only touch the
+// creatures that actually match
+struct SectorCreatureList
+{
+    explicit SectorCreatureList(bool players) : players(players) {}
+
+    void add(Creature* c, const Position& pos);
+    void remove(Creature* c);
+    void update(Creature* c, const Position& pos);
+
+    size_t size() const {
+        return creatures.size();
+    }
+
+    CreatureVector creatures;
+    // parallel to creatures
+    std::vector<int32_t> x;
+    std::vector<int32_t> y;
+    std::vector<int32_t> z;
+
+private:
+    // where the creature sits in this list, kept on the creature
+    uint32_t& indexOf(Creature* c) const;
+
+    const bool players;
+};
 
 class MapSector
 {
@@ -107,16 +260,23 @@ public:
 
     void addCreature(Creature* c);
     void removeCreature(Creature* c);
+    void updateCreature(Creature* c);
 
 private:
     static bool newSector;
     MapSector* sectorS = nullptr;
     MapSector* sectorE = nullptr;
-    CreatureVector creature_list;
-    CreatureVector player_list;
+    SectorCreatureList creature_list{false};
+    SectorCreatureList player_list{true};
     Tile* tiles[MAP_MAX_LAYERS][SECTOR_SIZE][SECTOR_SIZE] = {};
     uint32_t floorBits = 0;
 
+    // bumped whenever a creature enters or leaves any tile of this sector
+    uint32_t creatureGeneration = 0;
+    uint32_t playerGeneration = 0;
+    // bumped whenever an item is added, changed or removed on any tile of this sector
+    uint32_t tileGeneration = 0;
+
     friend class Map;
 };
 
@@ -194,7 +354,8 @@ public:
                        int32_t minRangeX = 0, int32_t maxRangeX = 0,
                        int32_t minRangeY = 0, int32_t maxRangeY = 0);
 
-    void clearSpectatorCache(bool clearPlayer);
+    void invalidateSpectatorCache(const Position& pos, bool player);
+    void invalidateTileState(const Position& pos);
 
     /**
       * Checks if you can throw an object to that position
@@ -226,6 +387,41 @@ public:
     bool getPathMatchingCond(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList,
         const FrozenPathingConditionCall& pathCondition, const FindPathParams& fpp) const;
 
+    /**
+      * Gets a path for creature through the path cache, searching for it on a miss
+      *	\param creature the walking creature
+      *	\param targetPos the position to walk to
+      *	\param dirList receives the path, last step first
+      *	\param fpp the search parameters
+      *	\returns true if a path was found
+      */
+    bool getPathTo(const Creature& creature, const Position& targetPos, std::vector<Direction>& dirList, const FindPathParams& fpp);
+
+    const PathCacheStats& getPathCacheStats() const {
+        return pathCacheStats;
+    }
+
+    /**
+      * Gets a melee chase path from the flow field shared by every monster of the same type chasing target
+      *	\param monster the chasing monster
+      *	\param target the creature being chased
+      *	\param dirList receives the path
+      *	\returns false if the monster isn't covered by the field or can't reach the target through it
+      */
+    bool getFlowFieldPath(const Monster& monster, const Creature& target, std::vector<Direction>& dirList);
+
+    static uint32_t getRegionKey(const Position& pos) {
+        return pos.x / HIBERNATION_REGION_SIZE | pos.y / HIBERNATION_REGION_SIZE << 16;
+    }
+
+    /**
+      * Checks whether any player is inside the region or within its wake radius,
+      * the answer is reused for one think interval
+      *	\param regionKey the region as returned by getRegionKey
+      *	\returns true if creatures of the region should keep thinking
+      */
+    bool isRegionAwake(uint32_t regionKey);
+
     std::map<std::string, Position> waypoints;
 
     Spawns spawns;
@@ -235,6 +431,18 @@ public:
 private:
     SpectatorCache spectatorCache;
     SpectatorCache playersSpectatorCache;
+    std::map<std::pair<uint32_t, const MonsterType*>, FlowField> flowFields;
+
+    //most recently used first
+    std::list<PathCacheEntry> pathCache;
+    std::unordered_map<PathCacheKey, std::list<PathCacheEntry>::iterator, PathCacheKeyHash> pathCacheIndex;
+    PathCacheStats pathCacheStats;
+
+    // region key -> (expiry time, awake)
+    std::unordered_map<uint32_t, std::pair<int64_t, bool>> regionStates;
+
+    // bumped whenever a new sector gets created so entries that skipped a missing sector are dropped
+    uint32_t sectorsGeneration = 0;
 
 #if GAME_FEATURE_ROBINHOOD_HASH_MAP > 0
     robin_hood::unordered_map<uint32_t, MapSector> mapSectors;
@@ -252,7 +460,13 @@ private:
     void getSpectatorsInternal(SpectatorVector& spectators, const Position& centerPos,
                                int32_t minRangeX, int32_t maxRangeX,
                                int32_t minRangeY, int32_t maxRangeY,
-                               int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers) const;
+                               int32_t minRangeZ, int32_t maxRangeZ, bool onlyPlayers, SpectatorCacheEntry* cacheEntry = nullptr) const;
+    bool isSpectatorCacheValid(const SpectatorCacheEntry& cacheEntry, bool onlyPlayers) const;
+    void buildFlowField(FlowField& field, const Monster& monster, const Position& targetPos);
+    bool isFlowFieldValid(const FlowField& field) const;
+    void cachePath(const PathCacheKey& key, const std::vector<Direction>& dirList, size_t pathStart);
+    bool isPathCacheValid(const PathCacheEntry& entry) const;
+    bool canWalkPathStart(const Creature& creature, const PathCacheEntry& entry) const;
 
     friend class Game;
     friend class IOMap;
@@ -97,6 +97,10 @@ public:
     int32_t getDefense() const override {
         return mType->info.defense;
     }
+    const MonsterType* getMonsterType() const {
+        return mType;
+    }
+
     bool isPushable() const override {
         return mType->info.pushable && baseSpeed != 0;
     }
@@ -36,6 +36,7 @@
 #include "databasemanager.h"
 #include "databasetasks.h"
 #include "script.h"
+#include "worldcache.h"
 #include <fstream>
 
 #include "tasks.h"
@@ -247,20 +248,31 @@ void mainLoader(int, char* [], ServiceManager* services)
 
     // load item data
     std::cout << ">> Loading items" << std::endl;
-    try {
-        if (!Item::items.loadFromOtb("data/items/" + std::to_string(CLIENT_VERSION) + "/items.otb")) {
+    #if GAME_FEATURE_WORLD_CACHE > 0
+    const bool itemsCached = WorldCache::loadItems();
+    #else
+    constexpr bool itemsCached = false;
+    #endif
+    if (!itemsCached) {
+        try {
+            if (!Item::items.loadFromOtb("data/items/" + std::to_string(CLIENT_VERSION) + "/items.otb")) {
+                startupErrorMessage("Unable to load items (OTB)!");
+                return;
+            }
+        } catch (const std::exception& e) {
+            std::cout << "[Fatal Error - Items::loadFromOtb] " << e.what() << std::endl;
             startupErrorMessage("Unable to load items (OTB)!");
             return;
         }
-    } catch (const std::exception& e) {
-        std::cout << "[Fatal Error - Items::loadFromOtb] " << e.what() << std::endl;
-        startupErrorMessage("Unable to load items (OTB)!");
-        return;
-    }
 
-    if (!Item::items.loadFromXml()) {
-        startupErrorMessage("Unable to load items (XML)!");
-        return;
+        if (!Item::items.loadFromXml()) {
+            startupErrorMessage("Unable to load items (XML)!");
+            return;
+        }
+
+        #if GAME_FEATURE_WORLD_CACHE > 0
+        WorldCache::saveItems();
+        #endif
     }
 
     std::cout << ">> Loading script systems" << std::endl;
@@ -353,6 +365,8 @@ void mainLoader(int, char* [], ServiceManager* services)
     g_game.map.houses.payHouses(rentPeriod);
 
 #if GAME_FEATURE_MARKET > 0
+    std::cout << ">> Loading market offers" << std::endl;
+    IOMarket::loadOffers();
     IOMarket::checkExpiredOffers();
     IOMarket::getInstance().updateStatistics();
 #endif
@@ -366,6 +380,7 @@ void mainLoader(int, char* [], ServiceManager* services)
 #endif
 
     g_game.start(services);
+    ProtocolStatus::updateCache();
     g_game.setGameState(GAME_STATE_NORMAL);
     g_loaderSignal.notify_all();
 }
\ No newline at end of file
@@ -26,6 +26,18 @@
 #include "tasks.h"
 
 const std::chrono::milliseconds OUTPUTMESSAGE_AUTOSEND_DELAY{ 10 };
+static constexpr size_t OUTPUTMESSAGE_FREE_LIST_CAPACITY = 2048;
+
+using OutputMessageAllocator = LockfreePoolingAllocator<OutputMessage, OUTPUTMESSAGE_FREE_LIST_CAPACITY>;
+using OutputMessageFreeList = LockfreeFreeList<sizeof(OutputMessage), OUTPUTMESSAGE_FREE_LIST_CAPACITY>;
+
+struct OutputMessageDeleter
+{
+    void operator()(OutputMessage* msg) const {
+        msg->~OutputMessage();
+        OutputMessageAllocator().deallocate(msg, 1);
+    }
+};
 
 void OutputMessagePool::scheduleSendAll()
 {
@@ -68,5 +80,21 @@ void OutputMessagePool::removeProtocolFromAutosend(const Protocol_ptr& protocol)
 
 OutputMessage_ptr OutputMessagePool::getOutputMessage()
 {
-    return std::make_shared<OutputMessage>();
-}
\ No newline at end of file
+    //the message buffer and the shared_ptr control block come from separate size classes of the pool
+    //default-initialized, the NETWORKMESSAGE_MAXSIZE buffer is always written before it gets read
+    //every message gets the full buffer: only the pages that were ever written are resident, bench_output_message_pool
+    //puts that at ~30MB for 1000 players against ~10MB with a 4kb class promoted on demand, not worth giving
+    //NetworkMessage a variable capacity for the login, status and disconnect messages written directly
+    OutputMessage* msg = new (OutputMessageAllocator().allocate(1)) OutputMessage;
+    return OutputMessage_ptr(msg, OutputMessageDeleter(), LockfreePoolingAllocator<void, OUTPUTMESSAGE_FREE_LIST_CAPACITY>());
+}
+
+const LockfreePoolStats& OutputMessagePool::getPoolStats()
+{
+    return OutputMessageFreeList::getStats();
+}
+
+size_t OutputMessagePool::getPoolCapacity()
+{
+    return OUTPUTMESSAGE_FREE_LIST_CAPACITY;
+}
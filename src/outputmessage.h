@@ -26,6 +26,30 @@
 #include "tools.h"
 
 class Protocol;
+struct LockfreePoolStats;
+
+// Packet encoded once for a broadcast and spliced into the output buffer of every spectator
+class PacketFragment
+{
+public:
+    explicit PacketFragment(const NetworkMessage& msg) :
+        data(msg.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION, msg.getBuffer() + NetworkMessage::INITIAL_BUFFER_POSITION + msg.getLength()) {}
+
+    // non-copyable
+    PacketFragment(const PacketFragment&) = delete;
+    PacketFragment& operator=(const PacketFragment&) = delete;
+
+    const uint8_t* getBuffer() const {
+        return data.data();
+    }
+
+    NetworkMessage::MsgSize_t getLength() const {
+        return static_cast<NetworkMessage::MsgSize_t>(data.size());
+    }
+
+private:
+    std::vector<uint8_t> data;
+};
 
 class OutputMessage : public NetworkMessage
 {
@@ -52,6 +76,14 @@ public:
         writeMessageLength();
     }
 
+    //set when the message was already encrypted in the batch of its write
+    bool isEncrypted() const {
+        return encrypted;
+    }
+    void setEncrypted() {
+        encrypted = true;
+    }
+
     void append(const NetworkMessage& msg) {
         const auto msgLen = msg.getLength();
         memcpy(buffer + info.position, msg.getBuffer() + INITIAL_BUFFER_POSITION, msgLen);
@@ -66,6 +98,13 @@ public:
         info.position += msgLen;
     }
 
+    void append(const PacketFragment& fragment) {
+        const auto msgLen = fragment.getLength();
+        memcpy(buffer + info.position, fragment.getBuffer(), msgLen);
+        info.length += msgLen;
+        info.position += msgLen;
+    }
+
 private:
     template <typename T>
     void add_header(T add) {
@@ -77,6 +116,7 @@ private:
     }
 
     MsgSize_t outputBufferStart = INITIAL_BUFFER_POSITION;
+    bool encrypted = false;
 };
 
 class OutputMessagePool
@@ -96,6 +136,9 @@ public:
 
     static OutputMessage_ptr getOutputMessage();
 
+    static const LockfreePoolStats& getPoolStats();
+    static size_t getPoolCapacity();
+
     void addProtocolToAutosend(const Protocol_ptr& protocol);
     void removeProtocolFromAutosend(const Protocol_ptr& protocol);
 private:
@@ -145,6 +145,27 @@ enum PlayerAsyncOngoingTaskFlags : uint64_t
     PlayerAsyncTask_RecentPvPKills = 1 << 2
 };
 
+enum PlayerSaveSection_t : uint8_t
+{
+    PLAYER_SAVE_CONDITIONS,
+    PLAYER_SAVE_SPELLS,
+    PLAYER_SAVE_STORAGES,
+    PLAYER_SAVE_ITEMS,
+    PLAYER_SAVE_DEPOTLOCKERITEMS,
+    PLAYER_SAVE_DEPOTITEMS,
+    PLAYER_SAVE_INBOXITEMS,
+    PLAYER_SAVE_SUPPLYSTASH,
+    PLAYER_SAVE_LAST = PLAYER_SAVE_SUPPLYSTASH
+};
+
+// What the last successful save wrote to the players row, blob sections are kept as hashes
+struct PlayerSaveState
+{
+    std::vector<std::optional<int64_t>> columns;
+    uint64_t sections[PLAYER_SAVE_LAST + 1] = {};
+    uint16_t savedSections = 0;
+};
+
 using MuteCountMap = std::map<uint32_t, uint32_t>;
 
 static constexpr int32_t PLAYER_MAX_SPEED = 1500;
@@ -880,6 +901,12 @@ public:
             client->sendCreatureSay(creature, type, text, pos);
         }
     }
+    void sendCreatureSay(const PacketFragment_ptr & fragment) const
+    {
+        if (client) {
+            client->sendBroadcast(fragment);
+        }
+    }
     void sendPrivateMessage(const Player * speaker, const SpeakClasses type, const std::string & text) const
     {
         if (client) {
@@ -898,6 +925,12 @@ public:
             client->sendCreatureOutfit(creature, outfit);
         }
     }
+    void sendCreatureChangeOutfit(const Creature * creature, const PacketFragment_ptr & fragment) const
+    {
+        if (client) {
+            client->sendCreatureOutfit(creature, fragment);
+        }
+    }
     void sendCreatureChangeVisible(const Creature * creature, const bool visible) const
     {
         if (!client) {
@@ -1092,11 +1125,21 @@ public:
             client->sendChangeSpeed(creature, newSpeed);
         }
     }
+    void sendChangeSpeed(const PacketFragment_ptr & fragment) const {
+        if (client) {
+            client->sendBroadcast(fragment);
+        }
+    }
     void sendCreatureHealth(const Creature * creature, const uint8_t healthPercent) const {
         if (client) {
             client->sendCreatureHealth(creature, healthPercent);
         }
     }
+    void sendCreatureHealth(const Creature * creature, const uint8_t healthPercent, const PacketFragment_ptr & fragment) const {
+        if (client) {
+            client->sendCreatureHealth(creature, healthPercent, fragment);
+        }
+    }
 #if GAME_FEATURE_PARTY_LIST > 0
     void sendPartyCreatureUpdate(const Creature * creature) const {
         if (client) {
@@ -1148,6 +1191,11 @@ public:
             client->sendDistanceShoot(from, to, type);
         }
     }
+    void sendDistanceShoot(const PacketFragment_ptr & fragment) const {
+        if (client) {
+            client->sendBroadcast(fragment);
+        }
+    }
     void sendHouseWindow(const House * house, uint32_t listId) const;
     void sendCreatePrivateChannel(const uint16_t channelId, const std::string & channelName) const
     {
@@ -1166,6 +1214,11 @@ public:
             client->sendMagicEffect(pos, type);
         }
     }
+    void sendMagicEffect(const Position & pos, const PacketFragment_ptr & fragment) const {
+        if (client) {
+            client->sendMagicEffect(pos, fragment);
+        }
+    }
     void sendPing();
     void sendPingBack() const {
         if (client) {
@@ -1695,6 +1748,8 @@ private:
     Position loginPosition;
     Position lastWalkthroughPosition;
 
+    PlayerSaveState saveState;
+
     time_t lastLoginSaved = 0;
     time_t lastLogout = 0;
 
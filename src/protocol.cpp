@@ -31,6 +31,21 @@
 extern RSA g_RSA;
 extern ConfigManager g_config;
 
+//messages that stay this short with their length header never reach the 32 byte vector paths,
+//so the ones written together get encrypted by XTEA_encryptBatch with one message per SIMD lane;
+//longer ones are faster on their own and a single short one is faster without the idle lanes (see bench/xtea.cpp)
+static constexpr size_t XTEA_BATCH_MAX_LENGTH = 24;
+static constexpr size_t XTEA_BATCH_MIN_MESSAGES = 2;
+
+static void addXTEAPadding(OutputMessage& msg)
+{
+    // The message must be a multiple of 8
+    const size_t paddingBytes = msg.getLength() & 7;
+    if (paddingBytes != 0) {
+        msg.addPaddingBytes(8 - paddingBytes);
+    }
+}
+
 Protocol::~Protocol()
 {
     if (compreesionEnabled) {
@@ -42,16 +57,21 @@ void Protocol::onSendMessage(const OutputMessage_ptr& msg)
 {
     if (!rawMessages) {
         uint32_t _compression = 0;
-        if (compreesionEnabled && msg->getLength() >= 128) {
-            if (compression(*msg)) {
-                _compression = 1U << 31;
+        if (!msg->isEncrypted()) {
+            if (compreesionEnabled && msg->getLength() >= 128) {
+                if (compression(*msg)) {
+                    _compression = 1U << 31;
+                }
             }
-        }
 
-        msg->writeMessageLength();
+            msg->writeMessageLength();
+
+            if (encryptionEnabled) {
+                XTEA_encrypt(*msg);
+            }
+        }
 
         if (encryptionEnabled) {
-            XTEA_encrypt(*msg);
             if (checksumMethod == CHECKSUM_METHOD_NONE) {
                 msg->addCryptoHeader(false, 0);
             } else if (checksumMethod == CHECKSUM_METHOD_ADLER32) {
@@ -132,15 +152,28 @@ OutputMessage_ptr Protocol::getOutputBuffer(const int32_t size)
     return outputBuffer;
 }
 
-void Protocol::XTEA_encrypt(OutputMessage& msg) const
+void Protocol::setXTEAKey(const uint32_t* key)
 {
     const uint32_t delta = 0x61C88647;
 
-    // The message must be a multiple of 8
-    const size_t paddingBytes = msg.getLength() & 7;
-    if (paddingBytes != 0) {
-        msg.addPaddingBytes(8 - paddingBytes);
+    uint32_t sum = 0;
+    for (auto& i : encryptSchedule) {
+        i[0] = sum + key[sum & 3];
+        sum -= delta;
+        i[1] = sum + key[sum >> 11 & 3];
+    }
+
+    sum = 0xC6EF3720;
+    for (auto& i : decryptSchedule) {
+        i[0] = sum + key[sum >> 11 & 3];
+        sum += delta;
+        i[1] = sum + key[sum & 3];
     }
+}
+
+void Protocol::XTEA_encrypt(OutputMessage& msg) const
+{
+    addXTEAPadding(msg);
 
     uint8_t* buffer = msg.getOutputBuffer();
 #if defined(__AVX512F__)
@@ -153,14 +186,7 @@ void Protocol::XTEA_encrypt(OutputMessage& msg) const
     int32_t messageLength = static_cast<int32_t>(msg.getLength());
 #endif
     int32_t readPos = 0;
-    const uint32_t k[] = { key[0], key[1], key[2], key[3] };
-    uint32_t precachedControlSum[32][2];
-    uint32_t sum = 0;
-    for (auto& i : precachedControlSum) {
-        i[0] = sum + k[sum & 3];
-        sum -= delta;
-        i[1] = sum + k[sum >> 11 & 3];
-    }
+    const auto& precachedControlSum = encryptSchedule;
 #if defined(__AVX512F__)
     while (readPos <= messageLength) {
         const __m512i data0 = _mm512_shuffle_epi32(_mm512_loadu_si512(reinterpret_cast<const void*>(buffer + readPos)), _MM_PERM_DBCA);
@@ -317,6 +343,118 @@ void Protocol::XTEA_encrypt(OutputMessage& msg) const
     }
 }
 
+void Protocol::XTEA_encryptBatch(OutputMessage* const* messages, const size_t count) const
+{
+    //network thread of the connection, the messages are the ones about to be written together
+    if (rawMessages || !encryptionEnabled) {
+        return;
+    }
+
+    struct XTEAStream
+    {
+        uint8_t* buffer;
+        size_t blocks;
+    };
+
+    auto isShort = [](const OutputMessage& msg) {
+        return msg.getLength() + sizeof(NetworkMessage::MsgSize_t) <= XTEA_BATCH_MAX_LENGTH;
+    };
+
+    const size_t shortMessages = std::count_if(messages, messages + count, [&isShort](const OutputMessage* msg) { return isShort(*msg); });
+    if (shortMessages < XTEA_BATCH_MIN_MESSAGES) {
+        return;
+    }
+
+    static thread_local std::vector<XTEAStream> streams;
+    streams.clear();
+    for (size_t i = 0; i < count; ++i) {
+        OutputMessage& msg = *messages[i];
+        if (isShort(msg)) {
+            msg.writeMessageLength();
+            addXTEAPadding(msg);
+            msg.setEncrypted();
+            streams.push_back({msg.getOutputBuffer(), static_cast<size_t>(msg.getLength() / 8)});
+        }
+    }
+
+#if defined(__SSE2__)
+    //every lane runs its own message and gets refilled as soon as it drains,
+    //lanes left without a message keep encrypting a scratch block until the others are done
+    alignas(16) uint32_t schedule[32][2][4];
+    for (size_t i = 0; i < 32; ++i) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            schedule[i][0][lane] = encryptSchedule[i][0];
+            schedule[i][1][lane] = encryptSchedule[i][1];
+        }
+    }
+
+    uint8_t scratch[8] = {};
+    XTEAStream lanes[4];
+    size_t nextStream = 0;
+    int32_t activeLanes = 0;
+
+    auto refillLane = [&](const size_t lane) {
+        if (nextStream == streams.size()) {
+            lanes[lane] = { scratch, 0 };
+            return;
+        }
+
+        lanes[lane] = streams[nextStream++];
+        ++activeLanes;
+    };
+
+    for (size_t lane = 0; lane < 4; ++lane) {
+        refillLane(lane);
+    }
+
+    while (activeLanes > 0) {
+        alignas(16) uint32_t data0[4];
+        alignas(16) uint32_t data1[4];
+        for (size_t lane = 0; lane < 4; ++lane) {
+            memcpy(&data0[lane], lanes[lane].buffer, 4);
+            memcpy(&data1[lane], lanes[lane].buffer + 4, 4);
+        }
+
+        __m128i vdata0 = _mm_load_si128(reinterpret_cast<const __m128i*>(data0));
+        __m128i vdata1 = _mm_load_si128(reinterpret_cast<const __m128i*>(data1));
+        for (auto& i : schedule) {
+            vdata0 = _mm_add_epi32(vdata0, _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(vdata1, 4), _mm_srli_epi32(vdata1, 5)), vdata1), _mm_load_si128(reinterpret_cast<const __m128i*>(i[0]))));
+            vdata1 = _mm_add_epi32(vdata1, _mm_xor_si128(_mm_add_epi32(_mm_xor_si128(_mm_slli_epi32(vdata0, 4), _mm_srli_epi32(vdata0, 5)), vdata0), _mm_load_si128(reinterpret_cast<const __m128i*>(i[1]))));
+        }
+        _mm_store_si128(reinterpret_cast<__m128i*>(data0), vdata0);
+        _mm_store_si128(reinterpret_cast<__m128i*>(data1), vdata1);
+
+        for (size_t lane = 0; lane < 4; ++lane) {
+            XTEAStream& current = lanes[lane];
+            if (current.blocks == 0) {
+                continue;
+            }
+
+            memcpy(current.buffer, &data0[lane], 4);
+            memcpy(current.buffer + 4, &data1[lane], 4);
+            current.buffer += 8;
+            if (--current.blocks == 0) {
+                --activeLanes;
+                refillLane(lane);
+            }
+        }
+    }
+#else
+    for (const XTEAStream& stream : streams) {
+        uint8_t* buffer = stream.buffer;
+        for (size_t block = 0; block < stream.blocks; ++block, buffer += 8) {
+            uint32_t vData[2];
+            memcpy(vData, buffer, 8);
+            for (auto& i : encryptSchedule) {
+                vData[0] += (vData[1] << 4 ^ vData[1] >> 5) + vData[1] ^ i[0];
+                vData[1] += (vData[0] << 4 ^ vData[0] >> 5) + vData[0] ^ i[1];
+            }
+            memcpy(buffer, vData, 8);
+        }
+    }
+#endif
+}
+
 bool Protocol::XTEA_decrypt(NetworkMessage& msg) const
 {
     uint16_t msgLength = msg.getLength() - (checksumMethod == CHECKSUM_METHOD_NONE ? 2 : 6);
@@ -324,8 +462,6 @@ bool Protocol::XTEA_decrypt(NetworkMessage& msg) const
         return false;
     }
 
-    const uint32_t delta = 0x61C88647;
-
     uint8_t* buffer = msg.getBuffer() + msg.getBufferPosition();
 #if defined(__AVX512F__)
     int32_t messageLength = static_cast<int32_t>(msgLength) - 256;
@@ -337,14 +473,7 @@ bool Protocol::XTEA_decrypt(NetworkMessage& msg) const
     int32_t messageLength = static_cast<int32_t>(msgLength);
 #endif
     int32_t readPos = 0;
-    const uint32_t k[] = { key[0], key[1], key[2], key[3] };
-    uint32_t precachedControlSum[32][2];
-    uint32_t sum = 0xC6EF3720;
-    for (auto& i : precachedControlSum) {
-        i[0] = sum + k[sum >> 11 & 3];
-        sum += delta;
-        i[1] = sum + k[sum & 3];
-    }
+    const auto& precachedControlSum = decryptSchedule;
 #if defined(__AVX512F__)
     while (readPos <= messageLength) {
         const __m512i data0 = _mm512_shuffle_epi32(_mm512_loadu_si512(reinterpret_cast<const void*>(buffer + readPos)), _MM_PERM_DBCA);
@@ -81,9 +81,7 @@ protected:
     void enableXTEAEncryption() {
         encryptionEnabled = true;
     }
-    void setXTEAKey(const uint32_t* key) {
-        memcpy(this->key, key, sizeof * key * 4);
-    }
+    void setXTEAKey(const uint32_t* key);
     void setChecksumMethod(const ChecksumMethods_t method) {
         checksumMethod = method;
     }
@@ -100,6 +98,7 @@ protected:
 private:
     void XTEA_encrypt(OutputMessage& msg) const;
     bool XTEA_decrypt(NetworkMessage& msg) const;
+    void XTEA_encryptBatch(OutputMessage* const* messages, size_t count) const;
     bool compression(OutputMessage& msg) const;
 
     friend class Connection;
@@ -108,7 +107,9 @@ private:
     std::unique_ptr<z_stream> defStream;
 
     const ConnectionWeak_ptr connection;
-    uint32_t key[4] = {};
+    //round keys of both directions are derived once per session instead of once per packet
+    uint32_t encryptSchedule[32][2] = {};
+    uint32_t decryptSchedule[32][2] = {};
     uint32_t serverSequenceNumber = 0;
     uint32_t clientSequenceNumber = 0;
     std::underlying_type_t<ChecksumMethods_t> checksumMethod = CHECKSUM_METHOD_NONE;
@@ -64,15 +64,84 @@ void ProtocolGame::release()
     Protocol::release();
 }
 
+struct ProtocolGame::PendingLogin
+{
+    PendingLogin(std::string characterName, const OperatingSystem_t operatingSystem, const OperatingSystem_t tfcOperatingSystem) :
+        characterName(std::move(characterName)), operatingSystem(operatingSystem), tfcOperatingSystem(tfcOperatingSystem) {}
+
+    void finishStage(const LoginStage_t stage) {
+        const auto now = std::chrono::steady_clock::now();
+        stageTime[stage] = std::chrono::duration_cast<std::chrono::microseconds>(now - stageStart).count();
+        stageStart = now;
+        completedStages = stage + 1;
+    }
+
+    //dispatcher thread
+    void releasePlayer() {
+        if (player) {
+            player->decrementReferenceCounter();
+            player = nullptr;
+        }
+    }
+
+    std::string characterName;
+    std::string error;
+    DeferredPlayerLoad deferred;
+    std::array<uint64_t, LOGIN_STAGE_LAST + 1> stageTime = {};
+    std::chrono::steady_clock::time_point stageStart = std::chrono::steady_clock::now();
+    Player* player = nullptr;
+    uint32_t accountId = 0;
+    //set while the character is registered as a login in flight
+    uint32_t loadingGuid = 0;
+    OperatingSystem_t operatingSystem;
+    OperatingSystem_t tfcOperatingSystem;
+    uint8_t completedStages = 0;
+};
+
+ProtocolGame::LoginStats ProtocolGame::loginStats;
+
+void ProtocolGame::finishLogin(PendingLogin& pending, const bool success)
+{
+    //dispatcher thread
+    pending.releasePlayer();
+    if (pending.loadingGuid != 0) {
+        IOLoginData::removeLoginInFlight(pending.loadingGuid);
+        pending.loadingGuid = 0;
+    }
+
+    for (uint8_t stage = 0; stage < pending.completedStages; ++stage) {
+        LoginStageStats& stageStats = loginStats.stages[stage];
+        ++stageStats.count;
+        stageStats.total += pending.stageTime[stage];
+        stageStats.max = std::max<uint64_t>(stageStats.max, pending.stageTime[stage]);
+    }
+
+    if (success) {
+        ++loginStats.logins;
+    } else {
+        ++loginStats.rejected;
+    }
+}
+
+void ProtocolGame::rejectLogin(const PendingLogin_ptr& pending)
+{
+    //database thread, the login ended before it reached the dispatcher
+    pending->finishStage(LOGIN_STAGE_AUTHENTICATE);
+    g_dispatcher.addTask([pending] {
+        finishLogin(*pending, false);
+    });
+}
+
 #if GAME_FEATURE_SESSIONKEY > 0
-void ProtocolGame::login(const std::string& accountName, const std::string& password, std::string& characterName, const std::string& token, const uint32_t tokenTime, OperatingSystem_t operatingSystem, OperatingSystem_t tfcOperatingSystem)
+void ProtocolGame::login(const PendingLogin_ptr& pending, const std::string& accountName, const std::string& password, const std::string& token, const uint32_t tokenTime)
 #else
-void ProtocolGame::login(const std::string& accountName, const std::string& password, std::string& characterName, OperatingSystem_t operatingSystem, OperatingSystem_t tfcOperatingSystem)
+void ProtocolGame::login(const PendingLogin_ptr& pending, const std::string& accountName, const std::string& password)
 #endif
 {
-    //dispatcher thread
+    //database thread
     const auto connection = getConnection();
     if (!connection) {
+        rejectLogin(pending);
         return;
     }
 
@@ -85,139 +154,265 @@ void ProtocolGame::login(const std::string& accountName, const std::string& pass
         std::stringExtended ss(banInfo.bannedBy.length() + banInfo.reason.length() + static_cast<size_t>(64));
         ss << "Your IP has been banned until " << formatDateShort(banInfo.expiresAt) << " by " << banInfo.bannedBy << ".\n\nReason specified:\n" << banInfo.reason;
         disconnectClient(ss);
+        rejectLogin(pending);
         return;
     }
 
 #if GAME_FEATURE_SESSIONKEY > 0
-    uint32_t accountId = IOLoginData::gameworldAuthentication(accountName, password, characterName, token, tokenTime);
-    if (accountId == 0) {
-        disconnectClient("Account name or password is not correct.");
-        return;
-    }
+    pending->accountId = IOLoginData::gameworldAuthentication(accountName, password, pending->characterName, token, tokenTime);
 #else
-    uint32_t accountId = IOLoginData::gameworldAuthentication(accountName, password, characterName);
-    if (accountId == 0) {
+    pending->accountId = IOLoginData::gameworldAuthentication(accountName, password, pending->characterName);
+#endif
+    if (pending->accountId == 0) {
         disconnectClient("Account name or password is not correct.");
+        rejectLogin(pending);
         return;
     }
-#endif
-
-    Player* foundPlayer = g_game.getPlayerByName(characterName);
-    if (!foundPlayer || g_config.getBoolean(ConfigManager::ALLOW_CLONES)) {
-        player = new Player(getThis());
-        player->setName(characterName);
 
-        player->incrementReferenceCounter();
+    //the player stays detached from the game until placeLogin, only this pipeline references it
+    Player* loadedPlayer = new Player(getThis());
+    loadedPlayer->setName(pending->characterName);
+    loadedPlayer->incrementReferenceCounter();
+    pending->player = loadedPlayer;
 
-        if (!IOLoginData::preloadPlayer(player, characterName)) {
-            disconnectClient("Your character could not be loaded.");
-            return;
+    if (!IOLoginData::preloadPlayer(loadedPlayer, pending->characterName, &pending->deferred)) {
+        pending->error = "Your character could not be loaded.";
+    } else if (IOBan::isPlayerNamelocked(loadedPlayer->getGUID())) {
+        pending->error = "Your character has been namelocked.";
+    } else if (!loadedPlayer->hasFlag(PlayerFlag_CannotBeBanned) && IOBan::isAccountBanned(pending->accountId, banInfo)) {
+        if (banInfo.reason.empty()) {
+            banInfo.reason = "(none)";
         }
 
-        player->setID();
-        if (IOBan::isPlayerNamelocked(player->getGUID())) {
-            disconnectClient("Your character has been namelocked.");
-            return;
+        std::stringExtended ss(banInfo.bannedBy.length() + banInfo.reason.length() + static_cast<size_t>(68));
+        if (banInfo.expiresAt > 0) {
+            ss << "Your account has been banned until " << formatDateShort(banInfo.expiresAt) << " by " << banInfo.bannedBy << ".\n\nReason specified:\n" << banInfo.reason;
+        } else {
+            ss << "Your account has been permanently banned by " << banInfo.bannedBy << ".\n\nReason specified:\n" << banInfo.reason;
         }
+        pending->error = std::move(static_cast<std::string&>(ss));
+    }
 
-        if (g_game.getGameState() == GAME_STATE_CLOSING && !player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
-            disconnectClient("The game is just going down.\nPlease try again later.");
-            return;
-        }
+    pending->finishStage(LOGIN_STAGE_AUTHENTICATE);
+    g_dispatcher.addTask([thisPtr = getThis(), pending] {
+        thisPtr->admitLogin(pending);
+    });
+}
 
-        if (g_game.getGameState() == GAME_STATE_CLOSED && !player->hasFlag(PlayerFlag_CanAlwaysLogin)) {
-            disconnectClient("Server is currently closed.\nPlease try again later.");
-            return;
-        }
+void ProtocolGame::admitLogin(const PendingLogin_ptr& pending)
+{
+    //dispatcher thread
+    if (isConnectionExpired()) {
+        finishLogin(*pending, false);
+        return;
+    }
 
-        if (g_config.getBoolean(ConfigManager::ONE_PLAYER_ON_ACCOUNT) && player->getAccountType() < ACCOUNT_TYPE_GAMEMASTER && g_game.getPlayerByAccount(player->getAccount())) {
-            disconnectClient("You may only login with one character\nof your account at the same time.");
+    Player* foundPlayer = g_game.getPlayerByName(pending->characterName);
+    if (foundPlayer && !g_config.getBoolean(ConfigManager::ALLOW_CLONES)) {
+        finishLogin(*pending, true);
+        if (eventConnect != 0 || !g_config.getBoolean(ConfigManager::REPLACE_KICK_ON_LOGIN)) {
+            //Already trying to connect
+            disconnectClient("You are already logged in.");
             return;
         }
 
-        if (!player->hasFlag(PlayerFlag_CannotBeBanned)) {
-            if (IOBan::isAccountBanned(accountId, banInfo)) {
-                if (banInfo.reason.empty()) {
-                    banInfo.reason = "(none)";
-                }
+        if (foundPlayer->client) {
+            foundPlayer->disconnect();
+            foundPlayer->isConnecting = true;
 
-                std::stringExtended ss(banInfo.bannedBy.length() + banInfo.reason.length() + static_cast<size_t>(68));
-                if (banInfo.expiresAt > 0) {
-                    ss << "Your account has been banned until " << formatDateShort(banInfo.expiresAt) << " by " << banInfo.bannedBy << ".\n\nReason specified:\n" << banInfo.reason;
-                } else {
-                    ss << "Your account has been permanently banned by " << banInfo.bannedBy << ".\n\nReason specified:\n" << banInfo.reason;
-                }
-                disconnectClient(ss);
-                return;
-            }
+            eventConnect = g_dispatcher.addEvent(1000, [capture0 = getThis(), capture1 = foundPlayer->getID(),
+                                                     operatingSystem = pending->operatingSystem, tfcOperatingSystem = pending->tfcOperatingSystem] {
+                capture0->connect(capture1, operatingSystem, tfcOperatingSystem);
+            });
+        } else {
+            connect(foundPlayer->getID(), pending->operatingSystem, pending->tfcOperatingSystem);
         }
+        OutputMessagePool::getInstance().addProtocolToAutosend(shared_from_this());
+        return;
+    }
 
-        std::size_t currentSlot;
-        if (!WaitingList::getInstance().clientLogin(player, currentSlot)) {
-            const int64_t retryTime = WaitingList::getTime(currentSlot);
-            std::stringExtended ss(128);
+    if (!pending->error.empty()) {
+        disconnectClient(pending->error);
+        finishLogin(*pending, false);
+        return;
+    }
 
-            ss << "Too many players online.\nYou are at place "
-                << currentSlot << " on the waiting list.";
+    Player* loadedPlayer = pending->player;
+    loadedPlayer->setID();
+    if (g_game.getGameState() == GAME_STATE_CLOSING && !loadedPlayer->hasFlag(PlayerFlag_CanAlwaysLogin)) {
+        disconnectClient("The game is just going down.\nPlease try again later.");
+        finishLogin(*pending, false);
+        return;
+    }
 
-            const auto output = OutputMessagePool::getOutputMessage();
-            output->addByte(0x16);
-            output->addString(ss);
-            output->addByte(static_cast<uint8_t>(retryTime));
-            send(output);
-            disconnect();
-            return;
-        }
+    if (g_game.getGameState() == GAME_STATE_CLOSED && !loadedPlayer->hasFlag(PlayerFlag_CanAlwaysLogin)) {
+        disconnectClient("Server is currently closed.\nPlease try again later.");
+        finishLogin(*pending, false);
+        return;
+    }
 
-        if (!IOLoginData::loadPlayerById(player, player->getGUID())) {
-            disconnectClient("Your character could not be loaded.");
-            return;
-        }
+    if (g_config.getBoolean(ConfigManager::ONE_PLAYER_ON_ACCOUNT) && loadedPlayer->getAccountType() < ACCOUNT_TYPE_GAMEMASTER && g_game.getPlayerByAccount(loadedPlayer->getAccount())) {
+        disconnectClient("You may only login with one character\nof your account at the same time.");
+        finishLogin(*pending, false);
+        return;
+    }
 
-        player->setOperatingSystem(operatingSystem);
-        player->setTfcOperatingSystem(tfcOperatingSystem);
-        if (!g_game.placeCreature(player, player->getLoginPosition())) {
-            if (!g_game.placeCreature(player, player->getTemplePosition(), false, true)) {
-                disconnectClient("Temple position is wrong. Contact the administrator.");
-                return;
-            }
-        }
+    std::size_t currentSlot;
+    if (!WaitingList::getInstance().clientLogin(loadedPlayer, currentSlot)) {
+        const int64_t retryTime = WaitingList::getTime(currentSlot);
+        std::stringExtended ss(128);
 
-        if (operatingSystem >= CLIENTOS_OTCLIENT_LINUX) {
-            NetworkMessage opcodeMessage;
-            opcodeMessage.addByte(0x32);
-            opcodeMessage.addByte(0x00);
-            opcodeMessage.add<uint16_t>(0x00);
-            writeToOutputBuffer(opcodeMessage);
+        ss << "Too many players online.\nYou are at place "
+            << currentSlot << " on the waiting list.";
 
-            player->registerCreatureEvent("ExtendedOpcode");
-        }
+        const auto output = OutputMessagePool::getOutputMessage();
+        output->addByte(0x16);
+        output->addString(ss);
+        output->addByte(static_cast<uint8_t>(retryTime));
+        send(output);
+        disconnect();
+        finishLogin(*pending, false);
+        return;
+    }
 
-        player->lastIP = player->getIP();
-        player->lastLoginSaved = std::max<time_t>(time(nullptr), player->lastLoginSaved + 1);
-        acceptPackets = true;
-    } else {
-        if (eventConnect != 0 || !g_config.getBoolean(ConfigManager::REPLACE_KICK_ON_LOGIN)) {
-            //Already trying to connect
-            disconnectClient("You are already logged in.");
+    pending->finishStage(LOGIN_STAGE_ADMIT);
+    //the character counts as offline until placeLogin, offline changes saved meanwhile make it read again there
+    const uint32_t guid = pending->player->getGUID();
+    IOLoginData::addLoginInFlight(guid);
+    pending->loadingGuid = guid;
+
+    //same key as the background saves of this character, so it's loaded after them
+    g_databaseTasks.addAsyncTask([thisPtr = getThis(), pending] {
+        thisPtr->loadLogin(pending);
+    }, guid);
+}
+
+void ProtocolGame::loadLogin(const PendingLogin_ptr& pending)
+{
+    //database thread
+    IOMap::deferredActions = &pending->deferred.itemActions;
+    const bool loaded = IOLoginData::loadPlayerById(pending->player, pending->player->getGUID(), false);
+    IOMap::deferredActions = nullptr;
+
+    if (!loaded) {
+        pending->error = "Your character could not be loaded.";
+        pending->finishStage(LOGIN_STAGE_LOAD);
+        g_dispatcher.addTask([thisPtr = getThis(), pending] {
+            thisPtr->placeLogin(pending);
+        });
+        return;
+    }
+
+    //vip edits are queued on the account key, so the list is read behind them
+    g_databaseTasks.addAsyncTask([thisPtr = getThis(), pending] {
+        IOLoginData::loadVIPList(pending->player);
+        pending->finishStage(LOGIN_STAGE_LOAD);
+        g_dispatcher.addTask([thisPtr, pending] {
+            thisPtr->placeLogin(pending);
+        });
+    }, pending->player->getAccount());
+}
+
+void ProtocolGame::placeLogin(const PendingLogin_ptr& pending)
+{
+    //dispatcher thread
+    if (isConnectionExpired()) {
+        finishLogin(*pending, false);
+        return;
+    }
+
+    if (!pending->error.empty()) {
+        disconnectClient(pending->error);
+        finishLogin(*pending, false);
+        return;
+    }
+
+    //a parcel, market delivery, rent or bank transfer may have saved the character after it was read
+    const uint32_t guid = pending->loadingGuid;
+    pending->loadingGuid = 0;
+    if (IOLoginData::removeLoginInFlight(guid)) {
+        reloadLogin(pending);
+        return;
+    }
+
+    //another login of the same character or account may have been admitted while this one was loading
+    Player* loadedPlayer = pending->player;
+    if (!g_config.getBoolean(ConfigManager::ALLOW_CLONES) && g_game.getPlayerByName(pending->characterName)) {
+        disconnectClient("You are already logged in.");
+        finishLogin(*pending, false);
+        return;
+    }
+
+    if (g_config.getBoolean(ConfigManager::ONE_PLAYER_ON_ACCOUNT) && loadedPlayer->getAccountType() < ACCOUNT_TYPE_GAMEMASTER && g_game.getPlayerByAccount(loadedPlayer->getAccount())) {
+        disconnectClient("You may only login with one character\nof your account at the same time.");
+        finishLogin(*pending, false);
+        return;
+    }
+
+    //from here on the protocol owns the player reference and releases it on disconnect
+    player = loadedPlayer;
+    pending->player = nullptr;
+    IOLoginData::applyDeferredLoad(player, pending->deferred);
+
+    //a reloaded character is a new object without an id, it gets the same one from its guid
+    player->setID();
+    player->setOperatingSystem(pending->operatingSystem);
+    player->setTfcOperatingSystem(pending->tfcOperatingSystem);
+    if (!g_game.placeCreature(player, player->getLoginPosition())) {
+        if (!g_game.placeCreature(player, player->getTemplePosition(), false, true)) {
+            disconnectClient("Temple position is wrong. Contact the administrator.");
+            pending->finishStage(LOGIN_STAGE_PLACE);
+            finishLogin(*pending, false);
             return;
         }
+    }
 
-        if (foundPlayer->client) {
-            foundPlayer->disconnect();
-            foundPlayer->isConnecting = true;
+    if (pending->operatingSystem >= CLIENTOS_OTCLIENT_LINUX) {
+        NetworkMessage opcodeMessage;
+        opcodeMessage.addByte(0x32);
+        opcodeMessage.addByte(0x00);
+        opcodeMessage.add<uint16_t>(0x00);
+        writeToOutputBuffer(opcodeMessage);
 
-            eventConnect = g_dispatcher.addEvent(1000, [capture0 = getThis(), capture1 = foundPlayer->getID(),
-                                                     operatingSystem, tfcOperatingSystem] {
-                capture0->connect(capture1, operatingSystem, tfcOperatingSystem);
-            });
-        } else {
-            connect(foundPlayer->getID(), operatingSystem, tfcOperatingSystem);
-        }
+        player->registerCreatureEvent("ExtendedOpcode");
     }
+
+    player->lastIP = player->getIP();
+    player->lastLoginSaved = std::max<time_t>(time(nullptr), player->lastLoginSaved + 1);
+    acceptPackets = true;
+
+    pending->finishStage(LOGIN_STAGE_PLACE);
+    finishLogin(*pending, true);
     OutputMessagePool::getInstance().addProtocolToAutosend(shared_from_this());
 }
 
+void ProtocolGame::reloadLogin(const PendingLogin_ptr& pending)
+{
+    //dispatcher thread, the loaded copy is thrown away and the character read again from scratch
+    const uint32_t guid = pending->player->getGUID();
+    pending->releasePlayer();
+    pending->deferred = DeferredPlayerLoad();
+    ++loginStats.reloads;
+
+    Player* loadedPlayer = new Player(getThis());
+    loadedPlayer->setName(pending->characterName);
+    loadedPlayer->incrementReferenceCounter();
+    pending->player = loadedPlayer;
+
+    IOLoginData::addLoginInFlight(guid);
+    pending->loadingGuid = guid;
+    g_databaseTasks.addAsyncTask([thisPtr = getThis(), pending] {
+        if (!IOLoginData::preloadPlayer(pending->player, pending->characterName, &pending->deferred)) {
+            pending->error = "Your character could not be loaded.";
+            g_dispatcher.addTask([thisPtr, pending] {
+                thisPtr->placeLogin(pending);
+            });
+            return;
+        }
+        thisPtr->loadLogin(pending);
+    }, guid);
+}
+
 void ProtocolGame::connect(const uint32_t playerId, const OperatingSystem_t operatingSystem, const OperatingSystem_t tfcOperatingSystem)
 {
     eventConnect = 0;
@@ -448,10 +643,11 @@ void ProtocolGame::onRecvFirstMessage(NetworkMessage& msg)
         return;
     }
 
+    auto pending = std::make_shared<PendingLogin>(std::move(characterName), operatingSystem, TFCoperatingSystem);
 #if GAME_FEATURE_SESSIONKEY > 0
-    g_dispatcher.addTask(std::bind(&ProtocolGame::login, getThis(), std::move(accountName), std::move(password), std::move(characterName), std::move(token), tokenTime, operatingSystem, TFCoperatingSystem));
+    g_databaseTasks.addAsyncTask(std::bind(&ProtocolGame::login, getThis(), std::move(pending), std::move(accountName), std::move(password), std::move(token), tokenTime), DatabaseTasks::AUTHENTICATION_KEY);
 #else
-    g_dispatcher.addTask(std::bind(&ProtocolGame::login, getThis(), std::move(accountName), std::move(password), std::move(characterName), operatingSystem, TFCoperatingSystem));
+    g_databaseTasks.addAsyncTask(std::bind(&ProtocolGame::login, getThis(), std::move(pending), std::move(accountName), std::move(password)), DatabaseTasks::AUTHENTICATION_KEY);
 #endif
 }
 
@@ -498,6 +694,12 @@ void ProtocolGame::writeToOutputBuffer(const NetworkMessage & msg)
     out->append(msg);
 }
 
+void ProtocolGame::writeToOutputBuffer(const PacketFragment & fragment)
+{
+    const auto out = getOutputBuffer(fragment.getLength());
+    out->append(fragment);
+}
+
 void ProtocolGame::parsePacket(NetworkMessage & msg)
 {
     if (!acceptPackets || g_game.getGameState() == GAME_STATE_SHUTDOWN || msg.getLength() <= 0) {
@@ -1791,23 +1993,19 @@ void ProtocolGame::sendCreatureOutfit(const Creature * creature, const Outfit_t
     }
 
     playermsg.reset();
-    playermsg.addByte(0x8E);
-    playermsg.add<uint32_t>(creature->getID());
-    AddOutfit(outfit);
-#if GAME_FEATURE_MOUNTS > 0
-    playermsg.add<uint16_t>(outfit.lookMount);
-#endif
-#if GAME_FEATURE_MOUNT_COLORS > 0
-    if (outfit.lookMount != 0) {
-        playermsg.addByte(outfit.lookMountHead);
-        playermsg.addByte(outfit.lookMountBody);
-        playermsg.addByte(outfit.lookMountLegs);
-        playermsg.addByte(outfit.lookMountFeet);
-    }
-#endif
+    AddCreatureOutfit(creature, outfit);
     writeToOutputBuffer(playermsg);
 }
 
+void ProtocolGame::sendCreatureOutfit(const Creature * creature, const PacketFragment_ptr & fragment)
+{
+    if (!canSee(creature)) {
+        return;
+    }
+
+    writeToOutputBuffer(*fragment);
+}
+
 void ProtocolGame::sendCreatureLight(const Creature * creature)
 {
     if (!canSee(creature)) {
@@ -4040,35 +4238,7 @@ void ProtocolGame::sendCreatureSay(const Creature * creature, const SpeakClasses
     }
 
     playermsg.reset();
-    playermsg.addByte(0xAA);
-#if GAME_FEATURE_MESSAGE_STATEMENT > 0
-    static uint32_t statementId = 0;
-    playermsg.add<uint32_t>(++statementId);
-#endif
-    playermsg.addString(creature->getName());
-#if CLIENT_VERSION >= 1250
-    if (statementId != 0) {
-        playermsg.addByte(0x00);//(Traded)
-    }
-#endif
-
-    //Add level only for players
-#if GAME_FEATURE_MESSAGE_LEVEL > 0
-    if (const Player* speaker = creature->getPlayer()) {
-        playermsg.add<uint16_t>(speaker->getLevel());
-    } else {
-        playermsg.add<uint16_t>(0x00);
-    }
-#endif
-
-    playermsg.addByte(talkType);
-    if (pos) {
-        playermsg.addPosition(*pos);
-    } else {
-        playermsg.addPosition(creature->getPosition());
-    }
-
-    playermsg.addString(text);
+    AddCreatureSay(creature, talkType, text, pos);
     writeToOutputBuffer(playermsg);
 }
 
@@ -4206,6 +4376,12 @@ void ProtocolGame::sendCancelTarget()
 void ProtocolGame::sendChangeSpeed(const Creature * creature, uint32_t speed)
 {
     playermsg.reset();
+    AddChangeSpeed(creature, speed);
+    writeToOutputBuffer(playermsg);
+}
+
+void ProtocolGame::AddChangeSpeed(const Creature * creature, uint32_t speed)
+{
     playermsg.addByte(0x8F);
     playermsg.add<uint32_t>(creature->getID());
 #if CLIENT_VERSION >= 1059
@@ -4220,7 +4396,6 @@ void ProtocolGame::sendChangeSpeed(const Creature * creature, uint32_t speed)
 #else
     playermsg.add<uint16_t>(speed);
 #endif
-    writeToOutputBuffer(playermsg);
 }
 
 void ProtocolGame::sendCancelWalk()
@@ -4258,8 +4433,14 @@ void ProtocolGame::sendPingBack()
 
 void ProtocolGame::sendDistanceShoot(const Position & from, const Position & to, uint8_t type)
 {
-#if CLIENT_VERSION >= 1203
     playermsg.reset();
+    AddDistanceShoot(from, to, type);
+    writeToOutputBuffer(playermsg);
+}
+
+void ProtocolGame::AddDistanceShoot(const Position & from, const Position & to, uint8_t type)
+{
+#if CLIENT_VERSION >= 1203
     playermsg.addByte(0x83);
     playermsg.addPosition(from);
     playermsg.addByte(MAGIC_EFFECTS_CREATE_DISTANCEEFFECT);
@@ -4267,14 +4448,11 @@ void ProtocolGame::sendDistanceShoot(const Position & from, const Position & to,
     playermsg.addByte(static_cast<uint8_t>(static_cast<int8_t>(static_cast<int16_t>(to.x - from.x))));
     playermsg.addByte(static_cast<uint8_t>(static_cast<int8_t>(static_cast<int16_t>(to.y - from.y))));
     playermsg.addByte(MAGIC_EFFECTS_END_LOOP);
-    writeToOutputBuffer(playermsg);
 #else
-    playermsg.reset();
     playermsg.addByte(0x85);
     playermsg.addPosition(from);
     playermsg.addPosition(to);
     playermsg.addByte(type);
-    writeToOutputBuffer(playermsg);
 #endif
 }
 
@@ -4284,20 +4462,32 @@ void ProtocolGame::sendMagicEffect(const Position & pos, uint8_t type)
         return;
     }
 
-#if CLIENT_VERSION >= 1203
     playermsg.reset();
+    AddMagicEffect(pos, type);
+    writeToOutputBuffer(playermsg);
+}
+
+void ProtocolGame::sendMagicEffect(const Position & pos, const PacketFragment_ptr & fragment)
+{
+    if (!canSee(pos)) {
+        return;
+    }
+
+    writeToOutputBuffer(*fragment);
+}
+
+void ProtocolGame::AddMagicEffect(const Position & pos, uint8_t type)
+{
+#if CLIENT_VERSION >= 1203
     playermsg.addByte(0x83);
     playermsg.addPosition(pos);
     playermsg.addByte(MAGIC_EFFECTS_CREATE_EFFECT);
     playermsg.addByte(type);
     playermsg.addByte(MAGIC_EFFECTS_END_LOOP);
-    writeToOutputBuffer(playermsg);
 #else
-    playermsg.reset();
     playermsg.addByte(0x83);
     playermsg.addPosition(pos);
     playermsg.addByte(type);
-    writeToOutputBuffer(playermsg);
 #endif
 }
 
@@ -4322,6 +4512,75 @@ void ProtocolGame::sendCreatureHealth(const Creature * creature, uint8_t healthP
     writeToOutputBuffer(playermsg);
 }
 
+void ProtocolGame::sendCreatureHealth(const Creature * creature, uint8_t healthPercent, const PacketFragment_ptr & fragment)
+{
+#if CLIENT_VERSION >= 1121
+    //players still see their own hidden health
+    if (creature == player && creature->isHealthHidden()) {
+        sendCreatureHealth(creature, healthPercent);
+        return;
+    }
+#else
+    (void)creature;
+    (void)healthPercent;
+#endif
+    writeToOutputBuffer(*fragment);
+}
+
+void ProtocolGame::sendBroadcast(const PacketFragment_ptr & fragment)
+{
+    writeToOutputBuffer(*fragment);
+}
+
+PacketFragment_ptr ProtocolGame::encodeDistanceShoot(const Position & from, const Position & to, uint8_t type)
+{
+    playermsg.reset();
+    AddDistanceShoot(from, to, type);
+    return std::make_shared<PacketFragment>(playermsg);
+}
+
+PacketFragment_ptr ProtocolGame::encodeMagicEffect(const Position & pos, uint8_t type)
+{
+    playermsg.reset();
+    AddMagicEffect(pos, type);
+    return std::make_shared<PacketFragment>(playermsg);
+}
+
+PacketFragment_ptr ProtocolGame::encodeCreatureHealth(const Creature * creature, uint8_t healthPercent)
+{
+    playermsg.reset();
+    playermsg.addByte(0x8C);
+    playermsg.add<uint32_t>(creature->getID());
+    playermsg.addByte(creature->isHealthHidden() ? 0x00 : healthPercent);
+    return std::make_shared<PacketFragment>(playermsg);
+}
+
+PacketFragment_ptr ProtocolGame::encodeChangeSpeed(const Creature * creature, uint32_t speed)
+{
+    playermsg.reset();
+    AddChangeSpeed(creature, speed);
+    return std::make_shared<PacketFragment>(playermsg);
+}
+
+PacketFragment_ptr ProtocolGame::encodeCreatureOutfit(const Creature * creature, const Outfit_t & outfit)
+{
+    playermsg.reset();
+    AddCreatureOutfit(creature, outfit);
+    return std::make_shared<PacketFragment>(playermsg);
+}
+
+PacketFragment_ptr ProtocolGame::encodeCreatureSay(const Creature * creature, const SpeakClasses type, const std::string & text, const Position * pos/* = nullptr*/)
+{
+    const uint8_t talkType = translateSpeakClassToClient(type);
+    if (talkType == TALKTYPE_NONE) {
+        return nullptr;
+    }
+
+    playermsg.reset();
+    AddCreatureSay(creature, talkType, text, pos);
+    return std::make_shared<PacketFragment>(playermsg);
+}
+
 #if GAME_FEATURE_PARTY_LIST > 0
 void ProtocolGame::sendPartyCreatureUpdate(const Creature * target)
 {
@@ -5335,7 +5594,8 @@ void ProtocolGame::sendVIPEntries()
             }
         }
     };
-    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)), callback, true);
+    //keyed like the viplist edits of the account, so it sees all of them
+    g_databaseTasks.addTask(std::move(static_cast<std::string&>(query)), callback, true, player->getAccount());
 }
 
 #if CLIENT_VERSION >= 870
@@ -5722,6 +5982,57 @@ void ProtocolGame::AddOutfit(const Outfit_t & outfit)
     }
 }
 
+void ProtocolGame::AddCreatureOutfit(const Creature * creature, const Outfit_t & outfit)
+{
+    playermsg.addByte(0x8E);
+    playermsg.add<uint32_t>(creature->getID());
+    AddOutfit(outfit);
+#if GAME_FEATURE_MOUNTS > 0
+    playermsg.add<uint16_t>(outfit.lookMount);
+#endif
+#if GAME_FEATURE_MOUNT_COLORS > 0
+    if (outfit.lookMount != 0) {
+        playermsg.addByte(outfit.lookMountHead);
+        playermsg.addByte(outfit.lookMountBody);
+        playermsg.addByte(outfit.lookMountLegs);
+        playermsg.addByte(outfit.lookMountFeet);
+    }
+#endif
+}
+
+void ProtocolGame::AddCreatureSay(const Creature * creature, const uint8_t talkType, const std::string & text, const Position * pos)
+{
+    playermsg.addByte(0xAA);
+#if GAME_FEATURE_MESSAGE_STATEMENT > 0
+    static uint32_t statementId = 0;
+    playermsg.add<uint32_t>(++statementId);
+#endif
+    playermsg.addString(creature->getName());
+#if CLIENT_VERSION >= 1250
+    if (statementId != 0) {
+        playermsg.addByte(0x00);//(Traded)
+    }
+#endif
+
+    //Add level only for players
+#if GAME_FEATURE_MESSAGE_LEVEL > 0
+    if (const Player* speaker = creature->getPlayer()) {
+        playermsg.add<uint16_t>(speaker->getLevel());
+    } else {
+        playermsg.add<uint16_t>(0x00);
+    }
+#endif
+
+    playermsg.addByte(talkType);
+    if (pos) {
+        playermsg.addPosition(*pos);
+    } else {
+        playermsg.addPosition(creature->getPosition());
+    }
+
+    playermsg.addString(text);
+}
+
 void ProtocolGame::AddWorldLight(const LightInfo lightInfo) const
 {
     playermsg.addByte(0x82);
@@ -77,13 +77,39 @@ public:
         return "gameworld protocol";
     }
 
+    // login runs in stages alternating between the database thread and the dispatcher
+    enum LoginStage_t : uint8_t
+    {
+        LOGIN_STAGE_AUTHENTICATE, // database thread: bans, credentials and player preload
+        LOGIN_STAGE_ADMIT, // dispatcher: online check, game state and waiting list
+        LOGIN_STAGE_LOAD, // database thread: player data and items
+        LOGIN_STAGE_PLACE, // dispatcher: shared state and map placement
+        LOGIN_STAGE_LAST = LOGIN_STAGE_PLACE
+    };
+
+    // latencies in microseconds, measured from scheduling a stage to its completion
+    struct LoginStageStats
+    {
+        uint64_t count = 0;
+        uint64_t total = 0;
+        uint64_t max = 0;
+    };
+
+    struct LoginStats
+    {
+        std::array<LoginStageStats, LOGIN_STAGE_LAST + 1> stages;
+        uint64_t logins = 0;
+        uint64_t rejected = 0;
+        // logins that read the character again because it was saved by someone else while loading
+        uint64_t reloads = 0;
+    };
+
     explicit ProtocolGame(const Connection_ptr& connection) : Protocol(connection) {}
 
-#if GAME_FEATURE_SESSIONKEY > 0
-    void login(const std::string& accountName, const std::string& password, std::string& characterName, const std::string& token, uint32_t tokenTime, OperatingSystem_t operatingSystem, OperatingSystem_t tfcOperatingSystem);
-#else
-    void login(const std::string& accountName, const std::string& password, std::string& characterName, OperatingSystem_t operatingSystem, OperatingSystem_t tfcOperatingSystem);
-#endif
+    static const LoginStats& getLoginStats() {
+        return loginStats;
+    }
+
     void logout(bool displayEffect, bool forced) const;
 
     uint16_t getVersion() const {
@@ -92,13 +118,37 @@ public:
 
     static NetworkMessage playermsg;
 
+    //broadcast packets are encoded once and spliced into the output buffer of every spectator
+    static PacketFragment_ptr encodeDistanceShoot(const Position& from, const Position& to, uint8_t type);
+    static PacketFragment_ptr encodeMagicEffect(const Position& pos, uint8_t type);
+    static PacketFragment_ptr encodeCreatureHealth(const Creature* creature, uint8_t healthPercent);
+    static PacketFragment_ptr encodeChangeSpeed(const Creature* creature, uint32_t speed);
+    static PacketFragment_ptr encodeCreatureOutfit(const Creature* creature, const Outfit_t& outfit);
+    static PacketFragment_ptr encodeCreatureSay(const Creature* creature, SpeakClasses type, const std::string& text, const Position* pos = nullptr);
+
 private:
     ProtocolGame_ptr getThis() {
         return std::static_pointer_cast<ProtocolGame>(shared_from_this());
     }
+    struct PendingLogin;
+    using PendingLogin_ptr = std::shared_ptr<PendingLogin>;
+
+#if GAME_FEATURE_SESSIONKEY > 0
+    void login(const PendingLogin_ptr& pending, const std::string& accountName, const std::string& password, const std::string& token, uint32_t tokenTime);
+#else
+    void login(const PendingLogin_ptr& pending, const std::string& accountName, const std::string& password);
+#endif
+    void admitLogin(const PendingLogin_ptr& pending);
+    void loadLogin(const PendingLogin_ptr& pending);
+    void placeLogin(const PendingLogin_ptr& pending);
+    void reloadLogin(const PendingLogin_ptr& pending);
+    static void rejectLogin(const PendingLogin_ptr& pending);
+    static void finishLogin(PendingLogin& pending, bool success);
+
     void connect(uint32_t playerId, OperatingSystem_t operatingSystem, OperatingSystem_t tfcOperatingSystem);
     void disconnectClient(const std::string& message) const;
     void writeToOutputBuffer(const NetworkMessage& msg);
+    void writeToOutputBuffer(const PacketFragment& fragment);
 
     void release() override;
 
@@ -260,7 +310,10 @@ private:
 
     void sendDistanceShoot(const Position& from, const Position& to, uint8_t type);
     void sendMagicEffect(const Position& pos, uint8_t type);
+    void sendMagicEffect(const Position& pos, const PacketFragment_ptr& fragment);
     void sendCreatureHealth(const Creature* creature, uint8_t healthPercent);
+    void sendCreatureHealth(const Creature* creature, uint8_t healthPercent, const PacketFragment_ptr& fragment);
+    void sendBroadcast(const PacketFragment_ptr& fragment);
 #if GAME_FEATURE_PARTY_LIST > 0
     void sendPartyCreatureUpdate(const Creature* target);
     void sendPartyCreatureShield(const Creature* target);
@@ -292,6 +345,7 @@ private:
     void sendChangeSpeed(const Creature* creature, uint32_t speed);
     void sendCancelTarget();
     void sendCreatureOutfit(const Creature* creature, const Outfit_t& outfit);
+    void sendCreatureOutfit(const Creature* creature, const PacketFragment_ptr& fragment);
     void sendStats();
 #if CLIENT_VERSION >= 950
     void sendBasicData();
@@ -463,6 +517,11 @@ private:
     void AddCreature(const Creature* creature, bool known, uint32_t remove) const;
     void AddPlayerStats() const;
     static void AddOutfit(const Outfit_t& outfit);
+    static void AddCreatureOutfit(const Creature* creature, const Outfit_t& outfit);
+    static void AddCreatureSay(const Creature* creature, uint8_t talkType, const std::string& text, const Position* pos);
+    static void AddChangeSpeed(const Creature* creature, uint32_t speed);
+    static void AddDistanceShoot(const Position& from, const Position& to, uint8_t type);
+    static void AddMagicEffect(const Position& pos, uint8_t type);
     void AddPlayerSkills() const;
     void AddWorldLight(LightInfo lightInfo) const;
     void AddCreatureLight(const Creature* creature) const;
@@ -490,6 +549,8 @@ private:
 
     friend class Player;
 
+    static LoginStats loginStats;
+
     std::unordered_set<uint32_t> knownCreatureSet;
     Player* player = nullptr;
 
@@ -23,7 +23,7 @@
 #include "protocollogin.h"
 
 #include "outputmessage.h"
-#include "tasks.h"
+#include "databasetasks.h"
 
 #include "configmanager.h"
 #include "iologindata.h"
@@ -48,6 +48,7 @@ void ProtocolLogin::getCharacterList(const std::string& accountName, const std::
 void ProtocolLogin::getCharacterList(const std::string& accountName, const std::string& password, uint32_t version)
 #endif
 {
+    //database thread
 #if !(GAME_FEATURE_LOGIN_EXTENDED > 0)
     static uint32_t serverIp = INADDR_NONE;
     if (serverIp == INADDR_NONE) {
@@ -263,13 +264,13 @@ void ProtocolLogin::onRecvFirstMessage(NetworkMessage& msg)
     std::string authToken = msg.getString();
 
     auto thisPtr = std::static_pointer_cast<ProtocolLogin>(shared_from_this());
-    g_dispatcher.addTask(
+    g_databaseTasks.addAsyncTask(
         [thisPtr, capture0 = std::move(accountName), capture1 = std::move(password), capture2 = std::move(authToken),
             clientVersion] {
         thisPtr->getCharacterList(capture0, capture1, capture2, clientVersion);
     });
 #else
     auto thisPtr = std::static_pointer_cast<ProtocolLogin>(shared_from_this());
-    g_dispatcher.addTask(std::bind(&ProtocolLogin::getCharacterList, thisPtr, std::move(accountName), std::move(password), clientVersion));
+    g_databaseTasks.addAsyncTask(std::bind(&ProtocolLogin::getCharacterList, thisPtr, std::move(accountName), std::move(password), clientVersion));
 #endif
 }
\ No newline at end of file
@@ -29,8 +29,14 @@
 extern ConfigManager g_config;
 
 std::map<uint32_t, int64_t> ProtocolStatus::ipConnectMap;
+std::mutex ProtocolStatus::ipConnectMapLock;
+std::shared_ptr<const ProtocolStatus::StatusCache> ProtocolStatus::cache;
+std::mutex ProtocolStatus::cacheLock;
 const uint64_t ProtocolStatus::start = OTSYS_TIME();
 
+static constexpr int32_t STATUS_CACHE_CHECK_INTERVAL = 1000;
+static constexpr int64_t STATUS_CACHE_TTL = 10000;
+
 enum RequestedInfo_t : uint16_t
 {
     REQUEST_BASIC_SERVER_INFO = 1 << 0,
@@ -43,29 +49,47 @@ enum RequestedInfo_t : uint16_t
     REQUEST_SERVER_SOFTWARE_INFO = 1 << 7,
 };
 
+namespace {
+
+template<typename T>
+void addStatusValue(std::string& buffer, T value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void addStatusString(std::string& buffer, const std::string& value)
+{
+    addStatusValue<uint16_t>(buffer, static_cast<uint16_t>(value.length()));
+    buffer.append(value);
+}
+
+}
+
 void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
 {
     const uint32_t ip = getIP();
-    if (ip != 0x0100007F) {
-        const std::string ipStr = convertIPToString(ip);
-        if (ipStr != g_config.getString(ConfigManager::IP)) {
-            const std::map<uint32_t, int64_t>::const_iterator it = ipConnectMap.find(ip);
-            if (it != ipConnectMap.end() && OTSYS_TIME() < it->second + g_config.getNumber(ConfigManager::STATUSQUERY_TIMEOUT)) {
-                disconnect();
-                return;
+    {
+        //status requests are handled on every network thread
+        std::lock_guard<std::mutex> lockClass(ipConnectMapLock);
+        if (ip != 0x0100007F) {
+            const std::string ipStr = convertIPToString(ip);
+            if (ipStr != g_config.getString(ConfigManager::IP)) {
+                const std::map<uint32_t, int64_t>::const_iterator it = ipConnectMap.find(ip);
+                if (it != ipConnectMap.end() && OTSYS_TIME() < it->second + g_config.getNumber(ConfigManager::STATUSQUERY_TIMEOUT)) {
+                    disconnect();
+                    return;
+                }
             }
         }
-    }
 
-    ipConnectMap[ip] = OTSYS_TIME();
+        ipConnectMap[ip] = OTSYS_TIME();
+    }
 
     switch (msg.getByte()) {
         //XML info protocol
         case 0xFF: {
             if (!tfs_strcmp(msg.getString(4).c_str(), "info")) {
-                g_dispatcher.addTask([capture0 = std::static_pointer_cast<ProtocolStatus>(shared_from_this())] {
-                    capture0->sendStatusString();
-                });
+                sendStatusString();
                 return;
             }
             break;
@@ -78,11 +102,7 @@ void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
             if (requestedInfo & REQUEST_PLAYER_STATUS_INFO) {
                 characterName = msg.getString();
             }
-            g_dispatcher.addTask(
-                [capture0 = std::static_pointer_cast<ProtocolStatus>(shared_from_this()), requestedInfo, capture1 =
-                    std::move(characterName)] {
-                capture0->sendInfo(requestedInfo, capture1);
-            });
+            sendInfo(requestedInfo, characterName);
             return;
         }
 
@@ -92,12 +112,99 @@ void ProtocolStatus::onRecvFirstMessage(NetworkMessage& msg)
     disconnect();
 }
 
-void ProtocolStatus::sendStatusString()
+std::shared_ptr<const ProtocolStatus::StatusCache> ProtocolStatus::getCache()
 {
-    const auto output = OutputMessagePool::getOutputMessage();
+    std::lock_guard<std::mutex> lockClass(cacheLock);
+    return cache;
+}
 
-    setRawMessages(true);
+void ProtocolStatus::updateCache()
+{
+    //dispatcher thread
+    g_dispatcher.addEvent(STATUS_CACHE_CHECK_INTERVAL, updateCache);
+
+    const uint32_t playersGeneration = g_game.getPlayersGeneration();
+    const uint32_t playersOnline = static_cast<uint32_t>(g_game.getPlayersOnline());
+    const uint32_t playersRecord = g_game.getPlayersRecord();
+    const uint32_t monstersOnline = static_cast<uint32_t>(g_game.getMonstersOnline());
+    const uint32_t npcsOnline = static_cast<uint32_t>(g_game.getNpcsOnline());
+
+    const int64_t now = OTSYS_TIME();
+    std::shared_ptr<const StatusCache> current = getCache();
+    if (current && now < current->created + STATUS_CACHE_TTL && current->playersGeneration == playersGeneration && current->playersRecord == playersRecord &&
+        current->monstersOnline == monstersOnline && current->npcsOnline == npcsOnline) {
+        return;
+    }
+
+    std::shared_ptr<StatusCache> newCache = std::make_shared<StatusCache>();
+    newCache->created = now;
+    newCache->playersGeneration = playersGeneration;
+    newCache->playersRecord = playersRecord;
+    newCache->monstersOnline = monstersOnline;
+    newCache->npcsOnline = npcsOnline;
+
+    const uint64_t uptime = (now - start) / 1000;
+    newCache->statusString = buildStatusString(uptime);
+
+    std::string& basicInfo = newCache->info[0];
+    basicInfo.push_back(0x10);
+    addStatusString(basicInfo, g_config.getString(ConfigManager::SERVER_NAME));
+    addStatusString(basicInfo, g_config.getString(ConfigManager::IP));
+    addStatusString(basicInfo, std::to_string(g_config.getNumber(ConfigManager::LOGIN_PORT)));
+
+    std::string& ownerInfo = newCache->info[1];
+    ownerInfo.push_back(0x11);
+    addStatusString(ownerInfo, g_config.getString(ConfigManager::OWNER_NAME));
+    addStatusString(ownerInfo, g_config.getString(ConfigManager::OWNER_EMAIL));
+
+    std::string& miscInfo = newCache->info[2];
+    miscInfo.push_back(0x12);
+    addStatusString(miscInfo, g_config.getString(ConfigManager::MOTD));
+    addStatusString(miscInfo, g_config.getString(ConfigManager::LOCATION));
+    addStatusString(miscInfo, g_config.getString(ConfigManager::URL));
+    addStatusValue<uint64_t>(miscInfo, uptime);
+
+    std::string& playersInfo = newCache->info[3];
+    playersInfo.push_back(0x20);
+    addStatusValue<uint32_t>(playersInfo, playersOnline);
+    addStatusValue<uint32_t>(playersInfo, static_cast<uint32_t>(g_config.getNumber(ConfigManager::MAX_PLAYERS)));
+    addStatusValue<uint32_t>(playersInfo, playersRecord);
+
+    std::string& mapInfo = newCache->info[4];
+    mapInfo.push_back(0x30);
+    addStatusString(mapInfo, g_config.getString(ConfigManager::MAP_NAME));
+    addStatusString(mapInfo, g_config.getString(ConfigManager::MAP_AUTHOR));
+    uint32_t mapWidth;
+    uint32_t mapHeight;
+    g_game.getMapDimensions(mapWidth, mapHeight);
+    addStatusValue<uint16_t>(mapInfo, static_cast<uint16_t>(mapWidth));
+    addStatusValue<uint16_t>(mapInfo, static_cast<uint16_t>(mapHeight));
+
+    // players info - online players list
+    const auto& players = g_game.getPlayers();
+    std::string& extPlayersInfo = newCache->info[5];
+    extPlayersInfo.push_back(0x21);
+    addStatusValue<uint32_t>(extPlayersInfo, static_cast<uint32_t>(players.size()));
+    newCache->playerNames.reserve(players.size());
+    for (const auto& it : players) {
+        addStatusString(extPlayersInfo, it.second->getName());
+        addStatusValue<uint32_t>(extPlayersInfo, it.second->getLevel());
+        newCache->playerNames.insert(asLowerCaseString(it.second->getName()));
+    }
+
+    // server software info
+    std::string& softwareInfo = newCache->info[7];
+    softwareInfo.push_back(0x23);
+    addStatusString(softwareInfo, STATUS_SERVER_NAME);
+    addStatusString(softwareInfo, STATUS_SERVER_VERSION);
+    addStatusString(softwareInfo, std::to_string(CLIENT_VERSION_UPPER) + "." + std::to_string(CLIENT_VERSION_LOWER));
 
+    std::lock_guard<std::mutex> lockClass(cacheLock);
+    cache = std::move(newCache);
+}
+
+std::string ProtocolStatus::buildStatusString(const uint64_t uptime)
+{
     pugi::xml_document doc;
 
     pugi::xml_node decl = doc.prepend_child(pugi::node_declaration);
@@ -107,7 +214,6 @@ void ProtocolStatus::sendStatusString()
     tsqp.append_attribute("version") = "1.0";
 
     pugi::xml_node serverinfo = tsqp.append_child("serverinfo");
-    const uint64_t uptime = (OTSYS_TIME() - start) / 1000;
     serverinfo.append_attribute("uptime") = std::to_string(uptime).c_str();
     serverinfo.append_attribute("ip") = g_config.getString(ConfigManager::IP).c_str();
     serverinfo.append_attribute("servername") = g_config.getString(ConfigManager::SERVER_NAME).c_str();
@@ -156,81 +262,53 @@ void ProtocolStatus::sendStatusString()
     std::ostringstream ss;
     doc.save(ss, "", pugi::format_raw);
 
-    const std::string data = ss.str();
-    output->addBytes(data.c_str(), data.size());
-    send(output);
-    disconnect();
+    return ss.str();
 }
 
-void ProtocolStatus::sendInfo(const uint16_t requestedInfo, const std::string& characterName) const
+void ProtocolStatus::sendStatusString()
 {
-    const auto output = OutputMessagePool::getOutputMessage();
-
-    if (requestedInfo & REQUEST_BASIC_SERVER_INFO) {
-        output->addByte(0x10);
-        output->addString(g_config.getString(ConfigManager::SERVER_NAME));
-        output->addString(g_config.getString(ConfigManager::IP));
-        output->addString(std::to_string(g_config.getNumber(ConfigManager::LOGIN_PORT)));
+    //network thread, served from the cache so a status ping never waits for the dispatcher
+    std::shared_ptr<const StatusCache> current = getCache();
+    if (!current) {
+        disconnect();
+        return;
     }
 
-    if (requestedInfo & REQUEST_OWNER_SERVER_INFO) {
-        output->addByte(0x11);
-        output->addString(g_config.getString(ConfigManager::OWNER_NAME));
-        output->addString(g_config.getString(ConfigManager::OWNER_EMAIL));
-    }
+    const auto output = OutputMessagePool::getOutputMessage();
 
-    if (requestedInfo & REQUEST_MISC_SERVER_INFO) {
-        output->addByte(0x12);
-        output->addString(g_config.getString(ConfigManager::MOTD));
-        output->addString(g_config.getString(ConfigManager::LOCATION));
-        output->addString(g_config.getString(ConfigManager::URL));
-        output->add<uint64_t>((OTSYS_TIME() - start) / 1000);
-    }
+    setRawMessages(true);
 
-    if (requestedInfo & REQUEST_PLAYERS_INFO) {
-        output->addByte(0x20);
-        output->add<uint32_t>(g_game.getPlayersOnline());
-        output->add<uint32_t>(g_config.getNumber(ConfigManager::MAX_PLAYERS));
-        output->add<uint32_t>(g_game.getPlayersRecord());
-    }
+    output->addBytes(current->statusString.data(), current->statusString.size());
+    send(output);
+    disconnect();
+}
 
-    if (requestedInfo & REQUEST_MAP_INFO) {
-        output->addByte(0x30);
-        output->addString(g_config.getString(ConfigManager::MAP_NAME));
-        output->addString(g_config.getString(ConfigManager::MAP_AUTHOR));
-        uint32_t mapWidth;
-        uint32_t mapHeight;
-        g_game.getMapDimensions(mapWidth, mapHeight);
-        output->add<uint16_t>(mapWidth);
-        output->add<uint16_t>(mapHeight);
+void ProtocolStatus::sendInfo(const uint16_t requestedInfo, const std::string& characterName)
+{
+    std::shared_ptr<const StatusCache> current = getCache();
+    if (!current) {
+        disconnect();
+        return;
     }
 
-    if (requestedInfo & REQUEST_EXT_PLAYERS_INFO) {
-        output->addByte(0x21); // players info - online players list
-
-        const auto& players = g_game.getPlayers();
-        output->add<uint32_t>(players.size());
-        for (const auto& it : players) {
-            output->addString(it.second->getName());
-            output->add<uint32_t>(it.second->getLevel());
+    const auto output = OutputMessagePool::getOutputMessage();
+    for (size_t i = 0; i < current->info.size(); ++i) {
+        if (!(requestedInfo & (1 << i))) {
+            continue;
         }
-    }
 
-    if (requestedInfo & REQUEST_PLAYER_STATUS_INFO) {
-        output->addByte(0x22); // players info - online status info of a player
-        if (g_game.getPlayerByName(characterName) != nullptr) {
-            output->addByte(0x01);
+        if ((1 << i) == REQUEST_PLAYER_STATUS_INFO) {
+            output->addByte(0x22); // players info - online status info of a player
+            if (current->playerNames.find(asLowerCaseString(characterName)) != current->playerNames.end()) {
+                output->addByte(0x01);
+            } else {
+                output->addByte(0x00);
+            }
         } else {
-            output->addByte(0x00);
+            const std::string& info = current->info[i];
+            output->addBytes(info.data(), info.size());
         }
     }
-
-    if (requestedInfo & REQUEST_SERVER_SOFTWARE_INFO) {
-        output->addByte(0x23); // server software info
-        output->addString(STATUS_SERVER_NAME);
-        output->addString(STATUS_SERVER_VERSION);
-        output->addString(std::to_string(CLIENT_VERSION_UPPER) + "." + std::to_string(CLIENT_VERSION_LOWER));
-    }
     send(output);
     disconnect();
-}
\ No newline at end of file
+}
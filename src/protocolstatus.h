@@ -21,6 +21,8 @@
 #ifndef FS_STATUS_H_8B28B354D65B4C0483E37AD1CA316EB4
 #define FS_STATUS_H_8B28B354D65B4C0483E37AD1CA316EB4
 
+#include <unordered_set>
+
 #include "networkmessage.h"
 #include "protocol.h"
 
@@ -40,12 +42,36 @@ public:
     void onRecvFirstMessage(NetworkMessage& msg) override;
 
     void sendStatusString();
-    void sendInfo(uint16_t requestedInfo, const std::string& characterName) const;
+    void sendInfo(uint16_t requestedInfo, const std::string& characterName);
+
+    static void updateCache();
 
     static const uint64_t start;
 
 private:
+    // responses encoded once on the dispatcher and shared by every network thread, rebuilt at the
+    // next check after any login or logout so the online status of a player (0x22) and the player
+    // list lag by at most STATUS_CACHE_CHECK_INTERVAL, levels and uptime by up to STATUS_CACHE_TTL
+    struct StatusCache
+    {
+        std::string statusString;
+        std::array<std::string, 8> info;
+        std::unordered_set<std::string> playerNames;
+        int64_t created;
+        uint32_t playersGeneration;
+        uint32_t playersRecord;
+        uint32_t monstersOnline;
+        uint32_t npcsOnline;
+    };
+
+    static std::shared_ptr<const StatusCache> getCache();
+    static std::string buildStatusString(uint64_t uptime);
+
+    static std::shared_ptr<const StatusCache> cache;
+    static std::mutex cacheLock;
+
     static std::map<uint32_t, int64_t> ipConnectMap;
+    static std::mutex ipConnectMapLock;
 };
 
 #endif
@@ -37,13 +37,52 @@ ServiceManager::~ServiceManager()
 void ServiceManager::die()
 {
     io_service.stop();
+    for (auto& networkService : networkServices) {
+        networkService->stop();
+    }
+}
+
+asio::io_service& ServiceManager::getNetworkService()
+{
+    //acceptor thread, or the dispatcher while the services are being opened
+    if (networkServices.empty()) {
+        size_t threads = static_cast<size_t>(std::max<int32_t>(0, g_config.getNumber(ConfigManager::NETWORK_THREADS)));
+        if (threads == 0) {
+            threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+        }
+
+        networkServices.reserve(threads);
+        networkWork.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            networkServices.emplace_back(std::make_unique<asio::io_service>(1));
+            networkWork.emplace_back(asio::make_work_guard(*networkServices.back()));
+        }
+    }
+
+    asio::io_service& networkService = *networkServices[nextNetworkService];
+    if (++nextNetworkService == networkServices.size()) {
+        nextNetworkService = 0;
+    }
+    return networkService;
 }
 
 void ServiceManager::run()
 {
     assert(!running);
     running = true;
+
+    networkThreads.reserve(networkServices.size());
+    for (auto& networkService : networkServices) {
+        networkThreads.emplace_back([service = networkService.get()] { service->run(); });
+    }
+
     io_service.run();
+
+    for (std::thread& networkThread : networkThreads) {
+        networkThread.join();
+    }
+    networkThreads.clear();
+    networkWork.clear();
 }
 
 void ServiceManager::stop()
@@ -103,7 +142,8 @@ void ServicePort::accept()
         return;
     }
 
-    auto connection = ConnectionManager::getInstance().createConnection(io_service, shared_from_this());
+    //the socket lives on the next network thread while the acceptor itself stays on the main one
+    auto connection = ConnectionManager::getInstance().createConnection(serviceManager.getNetworkService(), shared_from_this());
     acceptor->async_accept(connection->getSocket(), [capture0 = shared_from_this(), connection](auto&& PH1) {
         capture0->onAccept(connection, std::forward<decltype(PH1)>(PH1));
     });
@@ -116,6 +156,7 @@ void ServicePort::onAccept(const Connection_ptr& connection, const std::error_co
             return;
         }
 
+        connection->updateIP();
         const auto remote_ip = connection->getIP();
         if (remote_ip != 0 && g_bans.acceptConnection(remote_ip)) {
             const Service_ptr service = services.front();
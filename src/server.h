@@ -26,6 +26,7 @@
 #include <memory>
 
 class Protocol;
+class ServiceManager;
 
 class ServiceBase
 {
@@ -63,7 +64,7 @@ public:
 class ServicePort : public std::enable_shared_from_this<ServicePort>
 {
 public:
-    explicit ServicePort(asio::io_service& io_service) : io_service(io_service) {}
+    ServicePort(asio::io_service& io_service, ServiceManager& serviceManager) : io_service(io_service), serviceManager(serviceManager) {}
     ~ServicePort();
 
     // non-copyable
@@ -86,6 +87,7 @@ private:
     void accept();
 
     asio::io_service& io_service;
+    ServiceManager& serviceManager;
     std::unique_ptr<asio::ip::tcp::acceptor> acceptor;
     std::vector<Service_ptr> services;
     asio::high_resolution_timer deadline_timer{ io_service };
@@ -114,11 +116,19 @@ public:
         return acceptors.empty() == false;
     }
 
+    asio::io_service& getNetworkService();
+
 private:
     void die();
 
     std::unordered_map<uint16_t, ServicePort_ptr> acceptors;
 
+    //accepted connections are spread over these, the acceptors and signals stay on io_service
+    std::vector<std::unique_ptr<asio::io_service>> networkServices;
+    std::vector<asio::executor_work_guard<asio::io_service::executor_type>> networkWork;
+    std::vector<std::thread> networkThreads;
+    size_t nextNetworkService = 0;
+
     asio::io_service io_service;
     Signals signals{ io_service };
     asio::high_resolution_timer death_timer{ io_service };
@@ -138,7 +148,7 @@ bool ServiceManager::add(uint16_t port)
     const auto foundServicePort = acceptors.find(port);
 
     if (foundServicePort == acceptors.end()) {
-        service_port = std::make_shared<ServicePort>(io_service);
+        service_port = std::make_shared<ServicePort>(io_service, *this);
         service_port->open(port);
         acceptors[port] = service_port;
     } else {
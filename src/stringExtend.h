@@ -272,6 +272,7 @@ namespace std
 
         //Allow implicit conversion to std::string&
         operator string& () { return outStr; }
+        operator const string& () const { return outStr; }
 
     private:
         string outStr;
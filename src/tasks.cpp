@@ -29,8 +29,18 @@ void Dispatcher::threadMain()
     g_database.disconnect();
 }
 
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+void Dispatcher::addTask(std::function<void(void)> functor, const char* tag)
+{
+    functor = [this, tag, queued = std::chrono::steady_clock::now(), f = std::move(functor)] {
+        const auto start = std::chrono::steady_clock::now();
+        (f)();
+        recordTask(tag, queued, start, false);
+    };
+#else
 void Dispatcher::addTask(std::function<void(void)> functor)
 {
+#endif
 #if BOOST_VERSION >= 106600
     post(io_service,
 #else
@@ -53,46 +63,276 @@ void Dispatcher::addTask(std::function<void(void)> functor)
 #endif
 }
 
-uint64_t Dispatcher::addEvent(const uint32_t delay, std::function<void(void)> functor)
+uint64_t Dispatcher::getWheelTime() const
 {
-    if (getState() == THREAD_STATE_TERMINATED) {
-        return 0;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - wheelEpoch).count());
+}
+
+DispatcherEvent* Dispatcher::allocateEvent()
+{
+    DispatcherEvent* event = freeEvents;
+    if (event) {
+        freeEvents = static_cast<DispatcherEvent*>(event->next);
+        event->next = event;
+        return event;
     }
 
-    uint64_t eventId = ++lastEventId;
-    const auto res = eventIds.emplace(std::piecewise_construct, std::forward_as_tuple(eventId), std::forward_as_tuple(io_service));
+    if (usedEventNodes > DISPATCHER_EVENT_INDEX_MASK) {
+        return nullptr;
+    }
 
-    asio::high_resolution_timer& timer = res.first->second;
-    timer.expires_from_now(asio::chrono::milliseconds(delay));
-#ifdef __cpp_generic_lambdas
-    timer.async_wait([this, eventId, f = std::move(functor)](const std::error_code& error) {
+    const uint32_t chunkIndex = (usedEventNodes & (DISPATCHER_EVENT_CHUNK_SIZE - 1));
+    if (chunkIndex == 0) {
+        eventChunks.emplace_back(new DispatcherEvent[DISPATCHER_EVENT_CHUNK_SIZE]);
+    }
+
+    event = &eventChunks.back()[chunkIndex];
+    event->index = usedEventNodes++;
+    return event;
+}
+
+void Dispatcher::releaseEvent(DispatcherEvent* event)
+{
+    event->eventId = 0;
+    event->prev = event;
+    event->next = freeEvents;
+    freeEvents = event;
+    --wheelEvents;
+}
+
+void Dispatcher::linkEvent(DispatcherEvent* event)
+{
+    DispatcherEventLink* slot;
+    if (event->expiration < wheelTick) {
+        // already expired - run it on the next processed tick
+        const uint32_t index = static_cast<uint32_t>(wheelTick & (DISPATCHER_WHEEL_ROOT_SIZE - 1));
+        wheelRootBits[index >> 5] |= (1U << (index & 31));
+        slot = &wheelRoot[index];
+    } else {
+        uint64_t ticks = event->expiration - wheelTick;
+        if (ticks < DISPATCHER_WHEEL_ROOT_SIZE) {
+            const uint32_t index = static_cast<uint32_t>(event->expiration & (DISPATCHER_WHEEL_ROOT_SIZE - 1));
+            wheelRootBits[index >> 5] |= (1U << (index & 31));
+            slot = &wheelRoot[index];
+        } else {
+            // events beyond the wheel range are parked in the last level and get re-linked on every cascade
+            ticks = std::min<uint64_t>(ticks, DISPATCHER_WHEEL_MAX_TICKS);
+
+            const uint64_t expiration = wheelTick + ticks;
+            uint32_t level = 0;
+            while (ticks >= (UINT64_C(1) << (DISPATCHER_WHEEL_ROOT_BITS + (level + 1) * DISPATCHER_WHEEL_LEVEL_BITS))) {
+                ++level;
+            }
+            slot = &wheelLevels[level][(expiration >> (DISPATCHER_WHEEL_ROOT_BITS + level * DISPATCHER_WHEEL_LEVEL_BITS)) & (DISPATCHER_WHEEL_LEVEL_SIZE - 1)];
+        }
+    }
+
+    event->prev = slot->prev;
+    event->next = slot;
+    slot->prev->next = event;
+    slot->prev = event;
+}
+
+void Dispatcher::cascadeEvents(DispatcherEventLink& slot)
+{
+    DispatcherEventLink* link = slot.next;
+    slot.prev = slot.next = &slot;
+    while (link != &slot) {
+        DispatcherEventLink* next = link->next;
+        linkEvent(static_cast<DispatcherEvent*>(link));
+        link = next;
+    }
+}
+
+void Dispatcher::processEvents()
+{
+    const uint64_t now = getWheelTime();
+    while (wheelTick <= now) {
+        if (wheelEvents == 0) {
+            wheelTick = now + 1;
+            break;
+        }
+
+        const uint32_t index = static_cast<uint32_t>(wheelTick & (DISPATCHER_WHEEL_ROOT_SIZE - 1));
+        if (index == 0) {
+            for (uint32_t level = 0; level < DISPATCHER_WHEEL_LEVELS; ++level) {
+                const uint32_t levelIndex = static_cast<uint32_t>((wheelTick >> (DISPATCHER_WHEEL_ROOT_BITS + level * DISPATCHER_WHEEL_LEVEL_BITS)) & (DISPATCHER_WHEEL_LEVEL_SIZE - 1));
+                cascadeEvents(wheelLevels[level][levelIndex]);
+                if (levelIndex != 0) {
+                    break;
+                }
+            }
+        }
+
+        ++wheelTick;
+        wheelRootBits[index >> 5] &= ~(1U << (index & 31));
+
+        DispatcherEventLink& slot = wheelRoot[index];
+        if (slot.empty()) {
+            continue;
+        }
+
+        // move the expired events to a local list so they can still be stopped by the events we execute
+        DispatcherEventLink expired;
+        expired.next = slot.next;
+        expired.prev = slot.prev;
+        expired.next->prev = &expired;
+        expired.prev->next = &expired;
+        slot.prev = slot.next = &slot;
+        while (!expired.empty()) {
+            DispatcherEvent* event = static_cast<DispatcherEvent*>(expired.next);
+            event->prev->next = event->next;
+            event->next->prev = event->prev;
+
+            std::function<void(void)> functor;
+            functor.swap(event->functor);
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+            // event latency is measured from the time it was scheduled to run
+            const char* tag = event->tag;
+            const auto scheduled = wheelEpoch + std::chrono::milliseconds(event->expiration);
+#endif
+            releaseEvent(event);
+            if (getState() == THREAD_STATE_TERMINATED) {
+                continue;
+            }
+
+            // execute it
+            ++dispatcherCycle;
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+            const auto start = std::chrono::steady_clock::now();
+            (functor)();
+            recordTask(tag, scheduled, start, true);
 #else
-    timer.async_wait([this, eventId, functor](const std::error_code& error) {
+            (functor)();
 #endif
-        eventIds.erase(eventId);
+        }
+    }
+}
+
+void Dispatcher::armWheelTimer()
+{
+    if (wheelEvents == 0) {
+        return;
+    }
+
+    // wake up on the first occupied slot of the current round or on the next cascade
+    const uint32_t start = static_cast<uint32_t>(wheelTick & (DISPATCHER_WHEEL_ROOT_SIZE - 1));
+    uint64_t nextTick = wheelTick + (DISPATCHER_WHEEL_ROOT_SIZE - start);
+    for (uint32_t word = (start >> 5); word < wheelRootBits.size(); ++word) {
+        uint32_t bits = wheelRootBits[word];
+        if (word == (start >> 5)) {
+            bits &= (0xFFFFFFFFU << (start & 31));
+        }
+
+        while (bits) {
+            const uint32_t index = ((word << 5) | _mm_ctz(bits));
+            if (!wheelRoot[index].empty()) {
+                nextTick = wheelTick + (index - start);
+                goto FoundSlot;
+            }
+
+            wheelRootBits[word] &= ~(1U << (index & 31));
+            bits &= (bits - 1);
+        }
+    }
+
+    FoundSlot:
+    if (wheelArmed && wheelArmedTick <= nextTick) {
+        return;
+    }
 
-        if (error == asio::error::operation_aborted || getState() == THREAD_STATE_TERMINATED) {
+    wheelArmed = true;
+    wheelArmedTick = nextTick;
+    wheelTimer.expires_at(wheelEpoch + std::chrono::milliseconds(nextTick));
+    wheelTimer.async_wait([this](const std::error_code& error) {
+        if (error == asio::error::operation_aborted) {
             return;
         }
 
-        // execute it
-        ++dispatcherCycle;
-#ifdef __cpp_generic_lambdas
-        (f)();
+        wheelArmed = false;
+        processEvents();
+        armWheelTimer();
+    });
+}
+
+void Dispatcher::clearEvents()
+{
+    auto clearSlot = [this](DispatcherEventLink& slot) {
+        while (!slot.empty()) {
+            DispatcherEvent* event = static_cast<DispatcherEvent*>(slot.next);
+            event->prev->next = event->next;
+            event->next->prev = event->prev;
+
+            std::function<void(void)> functor;
+            functor.swap(event->functor);
+            releaseEvent(event);
+        }
+    };
+
+    for (auto& slot : wheelRoot) {
+        clearSlot(slot);
+    }
+    for (auto& level : wheelLevels) {
+        for (auto& slot : level) {
+            clearSlot(slot);
+        }
+    }
+    wheelRootBits.fill(0);
+}
+
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+uint64_t Dispatcher::addEvent(const uint32_t delay, std::function<void(void)> functor, const char* tag)
 #else
-        (functor)();
+uint64_t Dispatcher::addEvent(const uint32_t delay, std::function<void(void)> functor)
 #endif
-    });
+{
+    if (getState() == THREAD_STATE_TERMINATED) {
+        return 0;
+    }
 
-    return eventId;
+    DispatcherEvent* event = allocateEvent();
+    if (!event) {
+        return 0;
+    }
+
+    const uint64_t now = getWheelTime();
+    if (wheelEvents == 0) {
+        // nothing is scheduled so we can skip the idle ticks
+        wheelTick = std::max<uint64_t>(wheelTick, now);
     }
 
+    event->eventId = ((++lastEventId << DISPATCHER_EVENT_INDEX_BITS) | event->index);
+    // wheel time is truncated to whole ticks so round the expiration up to never run an event too early
+    event->expiration = (delay == 0 ? now : now + delay + 1);
+    event->functor = std::move(functor);
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+    event->tag = tag;
+#endif
+    linkEvent(event);
+    ++wheelEvents;
+
+    armWheelTimer();
+    return event->eventId;
+}
+
 void Dispatcher::stopEvent(const uint64_t eventId)
 {
-    const auto it = eventIds.find(eventId);
-    if (it != eventIds.end()) {
-        it->second.cancel();
+    const uint64_t index = (eventId & DISPATCHER_EVENT_INDEX_MASK);
+    if (eventId == 0 || index >= usedEventNodes) {
+        return;
+    }
+
+    DispatcherEvent* event = &eventChunks[index >> DISPATCHER_EVENT_CHUNK_BITS][index & (DISPATCHER_EVENT_CHUNK_SIZE - 1)];
+    if (event->eventId != eventId) {
+        return;
     }
+
+    event->prev->next = event->next;
+    event->next->prev = event->prev;
+
+    std::function<void(void)> functor;
+    functor.swap(event->functor);
+    releaseEvent(event);
 }
 
 void Dispatcher::shutdown()
@@ -104,10 +344,143 @@ void Dispatcher::shutdown()
     io_service.post(
 #endif
          [this] {
-        for (auto& it : eventIds) {
-            it.second.cancel();
-        }
+        clearEvents();
+        wheelTimer.cancel();
 
         work.reset();
     });
-}
\ No newline at end of file
+}
+
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+void DispatcherHistogram::add(const uint64_t micros)
+{
+    size_t bucket = 0;
+    while (bucket < DISPATCHER_STATS_BUCKETS - 1 && (micros >> (bucket + 1)) != 0) {
+        ++bucket;
+    }
+
+    ++buckets[bucket];
+    ++count;
+    total += micros;
+    max = std::max<uint64_t>(max, micros);
+}
+
+void DispatcherHistogram::merge(const DispatcherHistogram& other)
+{
+    for (size_t bucket = 0; bucket < DISPATCHER_STATS_BUCKETS; ++bucket) {
+        buckets[bucket] += other.buckets[bucket];
+    }
+
+    count += other.count;
+    total += other.total;
+    max = std::max<uint64_t>(max, other.max);
+}
+
+uint64_t DispatcherHistogram::getPercentile(const double percentile) const
+{
+    if (count == 0) {
+        return 0;
+    }
+
+    // report the upper bound of the bucket holding the requested sample
+    const uint64_t sample = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(count * percentile / 100.0)));
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < DISPATCHER_STATS_BUCKETS; ++bucket) {
+        seen += buckets[bucket];
+        if (seen >= sample) {
+            return std::min<uint64_t>(max, (UINT64_C(2) << bucket) - 1);
+        }
+    }
+    return max;
+}
+
+void Dispatcher::recordTask(const char* tag, const std::chrono::steady_clock::time_point queued, const std::chrono::steady_clock::time_point start, const bool event)
+{
+    const auto end = std::chrono::steady_clock::now();
+    const uint64_t latency = (start > queued ? static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(start - queued).count()) : 0);
+    const uint64_t execution = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(end - start).count());
+    if (event) {
+        stats.eventLatency.add(latency);
+    } else {
+        stats.taskLatency.add(latency);
+    }
+    stats.execution.add(execution);
+
+    DispatcherTagStats& tagStats = stats.tags[tag];
+    tagStats.latency.add(latency);
+    tagStats.execution.add(execution);
+
+    auto& stalls = stats.stalls;
+    if (stalls.size() < DISPATCHER_STATS_STALLS || execution > stalls.back().execution) {
+        if (stalls.size() >= DISPATCHER_STATS_STALLS) {
+            stalls.pop_back();
+        }
+
+        const auto it = std::upper_bound(stalls.begin(), stalls.end(), execution, [](const uint64_t value, const DispatcherStall& stall) {
+            return value > stall.execution;
+        });
+        stalls.insert(it, DispatcherStall{ tag, latency, execution, time(nullptr) });
+    }
+}
+
+std::vector<std::pair<std::string, DispatcherTagStats>> Dispatcher::getTagStats() const
+{
+    // the same function name can come from different translation units
+    std::map<std::string, DispatcherTagStats> merged;
+    for (const auto& it : stats.tags) {
+        DispatcherTagStats& tagStats = merged[(it.first ? it.first : "unknown")];
+        tagStats.latency.merge(it.second.latency);
+        tagStats.execution.merge(it.second.execution);
+    }
+
+    std::vector<std::pair<std::string, DispatcherTagStats>> tagStats(merged.begin(), merged.end());
+    std::sort(tagStats.begin(), tagStats.end(), [](const std::pair<std::string, DispatcherTagStats>& a, const std::pair<std::string, DispatcherTagStats>& b) {
+        return a.second.execution.total > b.second.execution.total;
+    });
+    return tagStats;
+}
+
+bool Dispatcher::dumpStats(const std::string& fileName) const
+{
+    FILE* file = fopen(fileName.c_str(), "a");
+    if (!file) {
+        return false;
+    }
+
+    auto printHistogram = [file](const char* name, const DispatcherHistogram& histogram) {
+        fprintf(file, "%-24s count: %llu, avg: %lluus, p50: %lluus, p99: %lluus, max: %lluus\n", name,
+                static_cast<unsigned long long>(histogram.count), static_cast<unsigned long long>(histogram.getAverage()),
+                static_cast<unsigned long long>(histogram.getPercentile(50.0)), static_cast<unsigned long long>(histogram.getPercentile(99.0)),
+                static_cast<unsigned long long>(histogram.max));
+    };
+
+    fprintf(file, "----- Dispatcher stats from %s to %s (cycle %llu) -----\n", formatDate(stats.since).c_str(), formatDate(time(nullptr)).c_str(),
+            static_cast<unsigned long long>(dispatcherCycle));
+    printHistogram("Task latency", stats.taskLatency);
+    printHistogram("Event latency", stats.eventLatency);
+    printHistogram("Execution", stats.execution);
+
+    fprintf(file, "\nExecution time by tag:\n");
+    for (const auto& it : getTagStats()) {
+        const DispatcherHistogram& execution = it.second.execution;
+        fprintf(file, "%-40s count: %llu, total: %llums, avg: %lluus, p99: %lluus, max: %lluus, avg latency: %lluus\n", it.first.c_str(),
+                static_cast<unsigned long long>(execution.count), static_cast<unsigned long long>(execution.total / 1000),
+                static_cast<unsigned long long>(execution.getAverage()), static_cast<unsigned long long>(execution.getPercentile(99.0)),
+                static_cast<unsigned long long>(execution.max), static_cast<unsigned long long>(it.second.latency.getAverage()));
+    }
+
+    fprintf(file, "\nLongest stalls:\n");
+    for (const DispatcherStall& stall : stats.stalls) {
+        fprintf(file, "%s - %-40s execution: %lluus, latency: %lluus\n", formatDate(stall.time).c_str(), (stall.tag ? stall.tag : "unknown"),
+                static_cast<unsigned long long>(stall.execution), static_cast<unsigned long long>(stall.latency));
+    }
+    fprintf(file, "\n");
+    fclose(file);
+    return true;
+}
+
+void Dispatcher::resetStats()
+{
+    stats = DispatcherStats();
+}
+#endif
@@ -23,17 +23,109 @@
 
 #include "thread_holder_base.h"
 
+// Hierarchical timing wheel (1ms resolution) used by the dispatcher to schedule events
+// level 0 covers 256 ms with one slot per tick, every next level covers 64 slots of the level before it
+static constexpr uint32_t DISPATCHER_WHEEL_ROOT_BITS = 8;
+static constexpr uint32_t DISPATCHER_WHEEL_LEVEL_BITS = 6;
+static constexpr uint32_t DISPATCHER_WHEEL_LEVELS = 3;
+static constexpr uint32_t DISPATCHER_WHEEL_ROOT_SIZE = (1 << DISPATCHER_WHEEL_ROOT_BITS);
+static constexpr uint32_t DISPATCHER_WHEEL_LEVEL_SIZE = (1 << DISPATCHER_WHEEL_LEVEL_BITS);
+static constexpr uint64_t DISPATCHER_WHEEL_MAX_TICKS = (UINT64_C(1) << (DISPATCHER_WHEEL_ROOT_BITS + DISPATCHER_WHEEL_LEVELS * DISPATCHER_WHEEL_LEVEL_BITS)) - 1;
+
+// Event ids are built from an increasing serial and the index of the pooled node holding the event
+// so stopEvent can find the node without any lookup structure, stale ids are rejected by comparing the whole id
+static constexpr uint32_t DISPATCHER_EVENT_INDEX_BITS = 24;
+static constexpr uint64_t DISPATCHER_EVENT_INDEX_MASK = (UINT64_C(1) << DISPATCHER_EVENT_INDEX_BITS) - 1;
+static constexpr uint32_t DISPATCHER_EVENT_CHUNK_BITS = 12;
+static constexpr uint32_t DISPATCHER_EVENT_CHUNK_SIZE = (1 << DISPATCHER_EVENT_CHUNK_BITS);
+
+struct DispatcherEventLink
+{
+    DispatcherEventLink* prev = this;
+    DispatcherEventLink* next = this;
+
+    bool empty() const {
+        return next == this;
+    }
+};
+
+struct DispatcherEvent : public DispatcherEventLink
+{
+    std::function<void(void)> functor;
+    uint64_t eventId = 0;
+    uint64_t expiration = 0;
+    uint32_t index = 0;
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+    const char* tag = nullptr;
+#endif
+};
+
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+static constexpr size_t DISPATCHER_STATS_BUCKETS = 32;
+static constexpr size_t DISPATCHER_STATS_STALLS = 32;
+
+// base-2 logarithmic histogram of microseconds
+struct DispatcherHistogram
+{
+    void add(uint64_t micros);
+    void merge(const DispatcherHistogram& other);
+    uint64_t getPercentile(double percentile) const;
+    uint64_t getAverage() const {
+        return (count ? total / count : 0);
+    }
+
+    std::array<uint64_t, DISPATCHER_STATS_BUCKETS> buckets = {};
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t max = 0;
+};
+
+struct DispatcherTagStats
+{
+    DispatcherHistogram latency;
+    DispatcherHistogram execution;
+};
+
+struct DispatcherStall
+{
+    const char* tag;
+    uint64_t latency;
+    uint64_t execution;
+    time_t time;
+};
+
+struct DispatcherStats
+{
+    DispatcherHistogram taskLatency;
+    DispatcherHistogram eventLatency;
+    DispatcherHistogram execution;
+    std::unordered_map<const char*, DispatcherTagStats> tags;
+    std::vector<DispatcherStall> stalls;
+    time_t since = time(nullptr);
+};
+#endif
+
 class Dispatcher : public ThreadHolder<Dispatcher>
 {
 public:
 #if BOOST_VERSION >= 106600
-    Dispatcher() : work(make_work_guard(io_service)) {}
+    Dispatcher() : wheelTimer(io_service), work(make_work_guard(io_service)) {}
 #else
-    Dispatcher() : work(std::make_shared<asio::io_service::work>(io_service)) {}
+    Dispatcher() : wheelTimer(io_service), work(std::make_shared<asio::io_service::work>(io_service)) {}
 #endif
 
+    // non-copyable
+    Dispatcher(const Dispatcher&) = delete;
+    Dispatcher& operator=(const Dispatcher&) = delete;
+
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+    // tag defaults to the name of the calling function
+    void addTask(std::function<void(void)> functor, const char* tag = __builtin_FUNCTION());
+    uint64_t addEvent(uint32_t delay, std::function<void(void)> functor, const char* tag = __builtin_FUNCTION());
+#else
     void addTask(std::function<void(void)> functor);
     uint64_t addEvent(uint32_t delay, std::function<void(void)> functor);
+#endif
     void stopEvent(uint64_t eventId);
 
     void shutdown();
@@ -44,11 +136,53 @@ public:
 
     void threadMain();
 
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+    const DispatcherStats& getStats() const {
+        return stats;
+    }
+
+    // tag statistics merged by name and sorted by total execution time
+    std::vector<std::pair<std::string, DispatcherTagStats>> getTagStats() const;
+    bool dumpStats(const std::string& fileName) const;
+    void resetStats();
+#endif
+
 private:
+#if GAME_FEATURE_DISPATCHER_STATS > 0
+    void recordTask(const char* tag, std::chrono::steady_clock::time_point queued, std::chrono::steady_clock::time_point start, bool event);
+
+    DispatcherStats stats;
+#endif
+
+    uint64_t getWheelTime() const;
+    DispatcherEvent* allocateEvent();
+    void releaseEvent(DispatcherEvent* event);
+    void linkEvent(DispatcherEvent* event);
+    void cascadeEvents(DispatcherEventLink& slot);
+    void processEvents();
+    void armWheelTimer();
+    void clearEvents();
+
     uint64_t lastEventId = 0;
     uint64_t dispatcherCycle = 0;
-    std::map<uint64_t, asio::high_resolution_timer> eventIds;
+
+    // timing wheel state
+    std::array<DispatcherEventLink, DISPATCHER_WHEEL_ROOT_SIZE> wheelRoot;
+    std::array<std::array<DispatcherEventLink, DISPATCHER_WHEEL_LEVEL_SIZE>, DISPATCHER_WHEEL_LEVELS> wheelLevels;
+    std::array<uint32_t, DISPATCHER_WHEEL_ROOT_SIZE / 32> wheelRootBits = {};
+    std::chrono::steady_clock::time_point wheelEpoch = std::chrono::steady_clock::now();
+    uint64_t wheelTick = 0;
+    uint64_t wheelArmedTick = 0;
+    size_t wheelEvents = 0;
+    bool wheelArmed = false;
+
+    // event node pool
+    std::vector<std::unique_ptr<DispatcherEvent[]>> eventChunks;
+    DispatcherEvent* freeEvents = nullptr;
+    uint32_t usedEventNodes = 0;
+
     asio::io_service io_service;
+    asio::steady_timer wheelTimer;
 #if BOOST_VERSION >= 106600
     asio::executor_work_guard<asio::io_context::executor_type> work;
 #else
@@ -370,6 +370,8 @@ Thing* Tile::getTopVisibleThing(const Creature* creature)
 
 void Tile::onAddTileItem(Item* item)
 {
+    markHouseDirty();
+
 #if GAME_FEATURE_BROWSEFIELD > 0
     if (item->hasProperty(CONST_PROP_MOVEABLE) || item->getContainer()) {
         const auto it = g_game.browseFields.find(this);
@@ -383,6 +385,7 @@ void Tile::onAddTileItem(Item* item)
     setTileFlags(item);
 
     const Position& cylinderMapPos = getPosition();
+    g_game.map.invalidateTileState(cylinderMapPos);
 
     SpectatorVector spectators;
     g_game.map.getSpectators(spectators, cylinderMapPos, true);
@@ -402,6 +405,8 @@ void Tile::onAddTileItem(Item* item)
 
 void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newItem, const ItemType& newType)
 {
+    markHouseDirty();
+
 #if GAME_FEATURE_BROWSEFIELD > 0
     if (newItem->hasProperty(CONST_PROP_MOVEABLE) || newItem->getContainer()) {
         const auto it = g_game.browseFields.find(this);
@@ -423,6 +428,7 @@ void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newIte
 #endif
 
     const Position& cylinderMapPos = getPosition();
+    g_game.map.invalidateTileState(cylinderMapPos);
 
     SpectatorVector spectators;
     g_game.map.getSpectators(spectators, cylinderMapPos, true);
@@ -442,6 +448,8 @@ void Tile::onUpdateTileItem(Item* oldItem, const ItemType& oldType, Item* newIte
 
 void Tile::onRemoveTileItem(const SpectatorVector& spectators, const std::vector<int32_t>& oldStackPosVector, Item* item)
 {
+    markHouseDirty();
+
 #if GAME_FEATURE_BROWSEFIELD > 0
     if (item->hasProperty(CONST_PROP_MOVEABLE) || item->getContainer()) {
         const auto it = g_game.browseFields.find(this);
@@ -454,6 +462,7 @@ void Tile::onRemoveTileItem(const SpectatorVector& spectators, const std::vector
     resetTileFlags(item);
 
     const Position& cylinderMapPos = getPosition();
+    g_game.map.invalidateTileState(cylinderMapPos);
     const ItemType& iType = Item::items[item->getID()];
 
     //send to client + event method
@@ -467,6 +476,13 @@ void Tile::onRemoveTileItem(const SpectatorVector& spectators, const std::vector
     }
 }
 
+void Tile::markHouseDirty() const
+{
+    if (hasFlag(TILESTATE_HOUSE)) {
+        static_cast<const HouseTile*>(this)->getHouse()->setItemsDirty();
+    }
+}
+
 void Tile::onUpdateTile(const SpectatorVector& spectators) const
 {
     const Position& cylinderMapPos = getPosition();
@@ -497,25 +513,27 @@ ReturnValue Tile::queryAdd(int32_t, const Thing& thing, uint32_t, const uint32_t
                 return RETURNVALUE_NOTPOSSIBLE;
             }
 
-            const CreatureVector* creatures = getCreatures();
-            if (monster->canPushCreatures() && !monster->isSummon()) {
-                if (creatures) {
-                    for (Creature* tileCreature : *creatures) {
-                        if (tileCreature->getPlayer() && tileCreature->getPlayer()->isInGhostMode()) {
-                            continue;
-                        }
+            if (!hasBitSet(FLAG_IGNOREBLOCKCREATURE, flags)) {
+                const CreatureVector* creatures = getCreatures();
+                if (monster->canPushCreatures() && !monster->isSummon()) {
+                    if (creatures) {
+                        for (Creature* tileCreature : *creatures) {
+                            if (tileCreature->getPlayer() && tileCreature->getPlayer()->isInGhostMode()) {
+                                continue;
+                            }
 
-                        const Monster* creatureMonster = tileCreature->getMonster();
-                        if (!creatureMonster || !tileCreature->isPushable() ||
-                                (creatureMonster->isSummon() && creatureMonster->getMaster()->getPlayer())) {
-                            return RETURNVALUE_NOTPOSSIBLE;
+                            const Monster* creatureMonster = tileCreature->getMonster();
+                            if (!creatureMonster || !tileCreature->isPushable() ||
+                                    (creatureMonster->isSummon() && creatureMonster->getMaster()->getPlayer())) {
+                                return RETURNVALUE_NOTPOSSIBLE;
+                            }
                         }
                     }
-                }
-            } else if (creatures && !creatures->empty()) {
-                for (const Creature* tileCreature : *creatures) {
-                    if (!tileCreature->isInGhostMode()) {
-                        return RETURNVALUE_NOTENOUGHROOM;
+                } else if (creatures && !creatures->empty()) {
+                    for (const Creature* tileCreature : *creatures) {
+                        if (!tileCreature->isInGhostMode()) {
+                            return RETURNVALUE_NOTENOUGHROOM;
+                        }
                     }
                 }
             }
@@ -830,7 +848,7 @@ void Tile::addThing(int32_t, Thing* thing)
 {
     Creature* creature = thing->getCreature();
     if (creature) {
-        g_game.map.clearSpectatorCache(creature->getPlayer());
+        g_game.map.invalidateSpectatorCache(tilePos, creature->getPlayer() != nullptr);
         creature->setParent(this);
         CreatureVector* creatures = makeCreatures();
 #if CLIENT_VERSION >= 853
@@ -1034,7 +1052,7 @@ void Tile::removeThing(Thing* thing, const uint32_t count)
         if (creatures) {
             const auto it = std::find(creatures->begin(), creatures->end(), thing);
             if (it != creatures->end()) {
-                g_game.map.clearSpectatorCache(creature->getPlayer());
+                g_game.map.invalidateSpectatorCache(tilePos, creature->getPlayer() != nullptr);
                 creatures->erase(it);
             }
         }
@@ -1498,7 +1516,7 @@ void Tile::internalAddThing(uint32_t, Thing * thing)
 
     Creature* creature = thing->getCreature();
     if (creature) {
-        g_game.map.clearSpectatorCache(creature->getPlayer());
+        g_game.map.invalidateSpectatorCache(tilePos, creature->getPlayer() != nullptr);
         CreatureVector* creatures = makeCreatures();
 #if CLIENT_VERSION >= 853
         creatures->insert(creatures->begin(), creature);
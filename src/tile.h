@@ -67,6 +67,7 @@ enum tileflags_t : uint32_t
     TILESTATE_NOFIELDBLOCKPATH = 1 << 22,
     TILESTATE_SUPPORTS_HANGABLE = 1 << 23,
     TILESTATE_BLOCKPROJECTILE = 1 << 24,
+    TILESTATE_HOUSE = 1 << 25,
 
     TILESTATE_FLOORCHANGE = TILESTATE_FLOORCHANGE_DOWN | TILESTATE_FLOORCHANGE_NORTH | TILESTATE_FLOORCHANGE_SOUTH | TILESTATE_FLOORCHANGE_EAST | TILESTATE_FLOORCHANGE_WEST | TILESTATE_FLOORCHANGE_SOUTH_ALT | TILESTATE_FLOORCHANGE_EAST_ALT,
 };
@@ -279,6 +280,9 @@ public:
         this->flags &= ~flag;
     }
 
+    //flags the owning house for the next house items save
+    void markHouseDirty() const;
+
     ZoneType_t getZone() const {
         if (hasFlag(TILESTATE_PROTECTIONZONE)) {
             return ZONE_PROTECTION;
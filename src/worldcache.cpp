@@ -0,0 +1,193 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "otpch.h"
+
+#include "worldcache.h"
+#include "item.h"
+
+#include <cstdio>
+
+static constexpr auto WORLD_CACHE_FILE = "data/world.cache";
+static constexpr OTB::Identifier WORLD_CACHE_IDENTIFIER = { {'W', 'C', 'C', 'H'} };
+static constexpr uint32_t WORLD_CACHE_VERSION = 1;
+
+struct WorldCacheSource
+{
+    uint64_t size = 0;
+    uint64_t hash = 0;
+};
+
+static std::array<std::string, 2> getItemSourceFiles()
+{
+    const std::string directory = "data/items/" + std::to_string(CLIENT_VERSION);
+    return { {directory + "/items.otb", directory + "/items.xml"} };
+}
+
+static bool hashSourceFile(const std::string& fileName, WorldCacheSource& source)
+{
+    try {
+        OTB::MappedFile file(fileName);
+
+        //FNV-1a
+        uint64_t hash = 0xCBF29CE484222325ULL;
+        for (const char byte : file) {
+            hash ^= static_cast<uint8_t>(byte);
+            hash *= 0x100000001B3ULL;
+        }
+
+        source.size = file.size();
+        source.hash = hash;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+static bool hashItemSources(std::array<WorldCacheSource, 2>& sources)
+{
+    const auto files = getItemSourceFiles();
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!hashSourceFile(files[i], sources[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void writeHeader(PropWriteStream& propWriteStream, const std::array<WorldCacheSource, 2>& sources)
+{
+    propWriteStream.write(WORLD_CACHE_IDENTIFIER);
+    propWriteStream.write<uint32_t>(WORLD_CACHE_VERSION);
+    propWriteStream.write<uint32_t>(CLIENT_VERSION);
+
+    //raw layout of the stored structures depends on the build
+    propWriteStream.write<uint32_t>(sizeof(ItemType));
+    propWriteStream.write<uint32_t>(sizeof(Abilities));
+
+    propWriteStream.write<uint8_t>(static_cast<uint8_t>(sources.size()));
+    for (const WorldCacheSource& source : sources) {
+        propWriteStream.write<uint64_t>(source.size);
+        propWriteStream.write<uint64_t>(source.hash);
+    }
+}
+
+static bool readHeader(PropStream& propStream, const std::array<WorldCacheSource, 2>& sources)
+{
+    OTB::Identifier identifier;
+    if (!propStream.read(identifier) || identifier != WORLD_CACHE_IDENTIFIER) {
+        return false;
+    }
+
+    uint32_t version, clientVersion, itemTypeSize, abilitiesSize;
+    if (!propStream.read<uint32_t>(version) || !propStream.read<uint32_t>(clientVersion) ||
+        !propStream.read<uint32_t>(itemTypeSize) || !propStream.read<uint32_t>(abilitiesSize)) {
+        return false;
+    }
+
+    if (version != WORLD_CACHE_VERSION || clientVersion != CLIENT_VERSION || itemTypeSize != sizeof(ItemType) || abilitiesSize != sizeof(Abilities)) {
+        return false;
+    }
+
+    uint8_t sourceCount;
+    if (!propStream.read<uint8_t>(sourceCount) || sourceCount != sources.size()) {
+        return false;
+    }
+
+    for (const WorldCacheSource& source : sources) {
+        WorldCacheSource cached;
+        if (!propStream.read<uint64_t>(cached.size) || !propStream.read<uint64_t>(cached.hash)) {
+            return false;
+        }
+
+        if (cached.size != source.size || cached.hash != source.hash) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool WorldCache::loadItems()
+{
+    std::array<WorldCacheSource, 2> sources;
+    if (!hashItemSources(sources)) {
+        return false;
+    }
+
+    try {
+        OTB::MappedFile cacheFile(WORLD_CACHE_FILE);
+
+        PropStream propStream;
+        propStream.init(cacheFile.data(), cacheFile.size());
+        if (!readHeader(propStream, sources)) {
+            std::cout << "> World cache is outdated, parsing items." << std::endl;
+            return false;
+        }
+
+        if (!Item::items.loadFromCache(propStream)) {
+            std::cout << "[Warning - WorldCache::loadItems] " << WORLD_CACHE_FILE << " is corrupted, parsing items." << std::endl;
+            Item::items.clear();
+            return false;
+        }
+    } catch (const std::exception&) {
+        //no cache yet
+        return false;
+    }
+
+    std::cout << "> Loaded items from world cache." << std::endl;
+    return true;
+}
+
+bool WorldCache::saveItems()
+{
+    std::array<WorldCacheSource, 2> sources;
+    if (!hashItemSources(sources)) {
+        return false;
+    }
+
+    PropWriteStream propWriteStream;
+    writeHeader(propWriteStream, sources);
+    Item::items.saveToCache(propWriteStream);
+
+    size_t size;
+    const char* data = propWriteStream.getStream(size);
+
+    //write aside and rename so a crash never leaves a truncated cache behind
+    const std::string tmpFileName = std::string(WORLD_CACHE_FILE) + ".tmp";
+    FILE* file = fopen(tmpFileName.c_str(), "wb");
+    if (!file) {
+        std::cout << "[Warning - WorldCache::saveItems] Unable to write " << tmpFileName << std::endl;
+        return false;
+    }
+
+    const bool written = fwrite(data, 1, size, file) == size;
+    if (fclose(file) != 0 || !written) {
+        std::remove(tmpFileName.c_str());
+        std::cout << "[Warning - WorldCache::saveItems] Unable to write " << tmpFileName << std::endl;
+        return false;
+    }
+
+    std::remove(WORLD_CACHE_FILE);
+    if (std::rename(tmpFileName.c_str(), WORLD_CACHE_FILE) != 0) {
+        std::remove(tmpFileName.c_str());
+        std::cout << "[Warning - WorldCache::saveItems] Unable to replace " << WORLD_CACHE_FILE << std::endl;
+        return false;
+    }
+    return true;
+}
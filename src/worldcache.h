@@ -0,0 +1,32 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FS_WORLDCACHE_H_1BD571BF69814661228161DDD406CEA5
+#define FS_WORLDCACHE_H_1BD571BF69814661228161DDD406CEA5
+
+// Versioned binary snapshot of parsed startup data, keyed by the size and hash
+// of every source file so a changed source invalidates the whole snapshot
+class WorldCache
+{
+public:
+    static bool loadItems();
+    static bool saveItems();
+};
+
+#endif
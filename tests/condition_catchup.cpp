@@ -0,0 +1,244 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// The catch-up of conditions on creatures that were hibernated, ConditionDamage and
+// ConditionRegeneration executeElapsed. However long the creature slept, in one catch-up
+// or spread over several, a condition with a duration never deals or heals more than it
+// would have over that whole duration:
+// - periodic damage: periodDamage for every full tickInterval of the duration
+// - damage list: every entry of the list once
+// - regeneration: healthGain for every full healthTicks of the duration
+//
+// usage: test_condition_catchup
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <list>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr int32_t EVENT_CREATURE_THINK_INTERVAL = 1000;
+
+struct IntervalInfo
+{
+    int32_t timeLeft;
+    int32_t value;
+    int32_t interval;
+};
+
+// Condition::executeCondition, the end time is the remaining ticks
+struct Condition
+{
+    explicit Condition(int32_t ticks) : ticks(ticks) {}
+
+    bool executeCondition(int32_t interval) {
+        if (ticks == -1) {
+            return true;
+        }
+
+        ticks = std::max<int32_t>(0, ticks - interval);
+        return ticks > 0;
+    }
+
+    int32_t ticks;
+};
+
+// ConditionDamage::executeElapsed, doDamage adds up what was dealt
+struct ConditionDamage : Condition
+{
+    using Condition::Condition;
+
+    bool executeElapsed(int32_t interval) {
+        int64_t damage = 0;
+        if (periodDamage != 0) {
+            const int64_t elapsed = static_cast<int64_t>(periodDamageTick) + (ticks != -1 ? std::min<int32_t>(interval, ticks) : interval);
+            if (tickInterval > 0) {
+                damage = static_cast<int64_t>(periodDamage) * (elapsed / tickInterval);
+                periodDamageTick = static_cast<int32_t>(elapsed % tickInterval);
+            } else {
+                damage = periodDamage;
+                periodDamageTick = 0;
+            }
+        } else if (!damageList.empty()) {
+            bool bRemove = ticks != -1;
+
+            int64_t remaining = interval;
+            while (!damageList.empty() && remaining > 0) {
+                IntervalInfo& damageInfo = damageList.front();
+                if (damageInfo.timeLeft > remaining) {
+                    damageInfo.timeLeft -= static_cast<int32_t>(remaining);
+                    break;
+                }
+
+                remaining -= damageInfo.timeLeft;
+                damage += damageInfo.value;
+                if (bRemove) {
+                    damageList.pop_front();
+                } else if (damageInfo.interval > 0) {
+                    damage += static_cast<int64_t>(damageInfo.value) * (remaining / damageInfo.interval);
+                    damageInfo.timeLeft = damageInfo.interval - static_cast<int32_t>(remaining % damageInfo.interval);
+                    break;
+                } else {
+                    damageInfo.timeLeft = damageInfo.interval;
+                    break;
+                }
+            }
+
+            if (!bRemove) {
+                interval = 0;
+            }
+        }
+
+        dealt += damage;
+        return executeCondition(interval);
+    }
+
+    // ConditionDamage::addDamage for rounds other than -1
+    void addDamage(int32_t rounds, int32_t time, int32_t value) {
+        time = std::max<int32_t>(time, EVENT_CREATURE_THINK_INTERVAL);
+        for (int32_t i = 0; i < rounds; ++i) {
+            damageList.push_back(IntervalInfo{time, value, time});
+            if (ticks != -1) {
+                ticks += time;
+            }
+        }
+    }
+
+    std::list<IntervalInfo> damageList;
+    int64_t dealt = 0;
+    int32_t periodDamage = 0;
+    int32_t periodDamageTick = 0;
+    int32_t tickInterval = 0;
+};
+
+// ConditionRegeneration::executeElapsed for health outside of protection zones
+struct ConditionRegeneration : Condition
+{
+    using Condition::Condition;
+
+    bool executeElapsed(int32_t interval) {
+        const int32_t elapsed = (ticks != -1 ? std::min<int32_t>(interval, ticks) : interval);
+        const uint64_t healthTotal = static_cast<uint64_t>(internalHealthTicks) + static_cast<uint32_t>(elapsed);
+        const uint64_t healthRounds = healthTicks != 0 ? healthTotal / healthTicks : 1;
+        internalHealthTicks = healthTicks != 0 ? static_cast<uint32_t>(healthTotal % healthTicks) : 0;
+        if (healthRounds != 0 && healthGain != 0) {
+            healed += static_cast<int64_t>(std::min<uint64_t>(healthRounds * healthGain, std::numeric_limits<int32_t>::max()));
+        }
+        return executeCondition(interval);
+    }
+
+    int64_t healed = 0;
+    uint32_t internalHealthTicks = 0;
+    uint32_t healthTicks = 0;
+    uint32_t healthGain = 0;
+};
+
+// the hibernated time handed to the catch-up, in one piece or in several up to INT32_MAX
+std::vector<std::vector<int32_t>> getCatchUps(int32_t duration, std::mt19937& rng)
+{
+    std::vector<std::vector<int32_t>> catchUps = {
+        {duration},
+        {duration + 1},
+        {std::numeric_limits<int32_t>::max()},
+        {duration / 2, std::numeric_limits<int32_t>::max()},
+    };
+
+    std::uniform_int_distribution<int32_t> piece(1, std::max<int32_t>(1, duration / 3));
+    for (int i = 0; i < 8; ++i) {
+        std::vector<int32_t> pieces;
+        for (int64_t total = 0; total <= duration; total += pieces.back()) {
+            pieces.push_back(piece(rng));
+        }
+        catchUps.push_back(std::move(pieces));
+    }
+    return catchUps;
+}
+
+template <typename ConditionType>
+void runCatchUp(ConditionType& condition, const std::vector<int32_t>& pieces)
+{
+    for (const int32_t piece : pieces) {
+        if (!condition.executeElapsed(piece)) {
+            return;
+        }
+    }
+}
+
+int failures = 0;
+
+void check(const char* name, int32_t duration, int32_t period, size_t catchUp, int64_t result, int64_t expected)
+{
+    if (result != expected) {
+        std::cout << name << ": duration " << duration << " ms, period " << period << " ms, catch-up "
+            << catchUp << " dealt " << result << " instead of " << expected << std::endl;
+        ++failures;
+    }
+}
+
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    const std::vector<int32_t> durations = {1000, 4000, 10000, 60000, 123456, 3600000};
+    const std::vector<int32_t> periods = {1000, 2000, 3000, 4000, 7000};
+
+    for (const int32_t duration : durations) {
+        for (const int32_t period : periods) {
+            const std::vector<std::vector<int32_t>> catchUps = getCatchUps(duration, rng);
+            for (size_t i = 0; i < catchUps.size(); ++i) {
+                ConditionDamage periodic(duration);
+                periodic.periodDamage = -20;
+                periodic.tickInterval = period;
+                runCatchUp(periodic, catchUps[i]);
+                check("periodic damage", duration, period, i, periodic.dealt, -20LL * (duration / period));
+
+                ConditionRegeneration regeneration(duration);
+                regeneration.healthTicks = period;
+                regeneration.healthGain = 15;
+                runCatchUp(regeneration, catchUps[i]);
+                check("regeneration", duration, period, i, regeneration.healed, 15LL * (duration / period));
+            }
+
+            // a damage list lasts as long as its entries, the sum of their intervals
+            const int32_t rounds = std::max<int32_t>(1, duration / period);
+            ConditionDamage listed(0);
+            listed.addDamage(rounds, period, -7);
+            const std::vector<std::vector<int32_t>> listCatchUps = getCatchUps(listed.ticks, rng);
+            for (size_t i = 0; i < listCatchUps.size(); ++i) {
+                ConditionDamage damage = listed;
+                runCatchUp(damage, listCatchUps[i]);
+                check("damage list", listed.ticks, period, i, damage.dealt, -7LL * rounds);
+            }
+        }
+    }
+
+    if (failures != 0) {
+        std::cout << failures << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "all catch-ups dealt the damage and healing of the full duration" << std::endl;
+    return EXIT_SUCCESS;
+}
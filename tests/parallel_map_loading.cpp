@@ -0,0 +1,1425 @@
+/**
+ * The Forgotten Server - a free and open-source MMORPG server emulator
+ * Copyright (C) 2019-2021  Saiyans King
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+// IOMap::loadMap with GAME_FEATURE_PARALLEL_MAP_LOADING against the serial loader. A fixture
+// OTBM is written out and loaded both ways, the parallel way with several worker counts,
+// and everything the load leaves behind has to be the same:
+// - every tile, its kind, flags and house, its ground and items with their attributes
+//   and container contents, in order
+// - the unique ids registered, the beds' sleepers and the order items started decaying
+// - the tiles of every house in order, towns and waypoints
+//
+// The fixture has house tiles, moveable items on them that get dropped, grounds replaced
+// by a later ground, duplicate unique ids and property bytes that need escaping. Broken
+// fixtures, on a plain tile and on a house tile, have to fail the same way in both loaders
+// without leaking any item.
+//
+// The OTB loader, items and the game state are modelled, IOMap itself follows the server.
+//
+// usage: test_parallel_map_loading [fixture path = parallel_map_loading.otbm]
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+enum OTBM_AttrTypes_t : uint8_t
+{
+    OTBM_ATTR_DESCRIPTION = 1,
+    OTBM_ATTR_TILE_FLAGS = 3,
+    OTBM_ATTR_ITEM = 9,
+};
+
+enum OTBM_NodeTypes_t : uint8_t
+{
+    OTBM_ROOTV1 = 1,
+    OTBM_MAP_DATA = 2,
+    OTBM_TILE_AREA = 4,
+    OTBM_TILE = 5,
+    OTBM_ITEM = 6,
+    OTBM_TOWNS = 12,
+    OTBM_TOWN = 13,
+    OTBM_HOUSETILE = 14,
+    OTBM_WAYPOINTS = 15,
+    OTBM_WAYPOINT = 16,
+};
+
+enum AttrTypes_t : uint8_t
+{
+    ATTR_ACTION_ID = 4,
+    ATTR_UNIQUE_ID = 5,
+    ATTR_TEXT = 6,
+    ATTR_SLEEPERGUID = 20,
+    ATTR_CHARGES = 22,
+};
+
+constexpr uint32_t OTBM_TILEFLAG_PROTECTIONZONE = 1 << 0;
+constexpr uint32_t OTBM_TILEFLAG_NOPVPZONE = 1 << 2;
+constexpr uint32_t OTBM_TILEFLAG_NOLOGOUT = 1 << 3;
+constexpr uint32_t OTBM_TILEFLAG_PVPZONE = 1 << 4;
+
+constexpr uint32_t TILESTATE_PROTECTIONZONE = 1 << 0;
+constexpr uint32_t TILESTATE_NOPVPZONE = 1 << 1;
+constexpr uint32_t TILESTATE_NOLOGOUT = 1 << 2;
+constexpr uint32_t TILESTATE_PVPZONE = 1 << 3;
+
+// OTB::Node and OTB::Loader reading the file into memory instead of mapping it
+struct Node
+{
+    using ContentIt = std::vector<char>::const_iterator;
+
+    std::vector<Node> children;
+    ContentIt propsBegin;
+    ContentIt propsEnd;
+    uint8_t type = 0;
+
+    enum NodeChar : uint8_t
+    {
+        ESCAPE = 0xFD,
+        START = 0xFE,
+        END = 0xFF,
+    };
+};
+
+class PropStream
+{
+public:
+    void init(const char* a, size_t size) {
+        p = a;
+        end = a + size;
+    }
+
+    size_t size() const {
+        return end - p;
+    }
+
+    template <typename T>
+    bool read(T& ret) {
+        if (size() < sizeof(T)) {
+            return false;
+        }
+
+        memcpy(&ret, p, sizeof(T));
+        p += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& ret) {
+        uint16_t strLen;
+        if (!read<uint16_t>(strLen) || size() < strLen) {
+            return false;
+        }
+
+        ret.assign(p, strLen);
+        p += strLen;
+        return true;
+    }
+
+private:
+    const char* p = nullptr;
+    const char* end = nullptr;
+};
+
+class Loader
+{
+public:
+    explicit Loader(const std::string& fileName) {
+        std::ifstream file(fileName, std::ios::binary);
+        fileContents.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    const Node& parseTree() {
+        auto it = fileContents.cbegin() + 4;
+        root.type = *++it;
+        root.propsBegin = ++it;
+        std::vector<Node*> parseStack{&root};
+        for (const auto end = fileContents.cend(); it != end; ++it) {
+            const auto nodeType = static_cast<uint8_t>(*it);
+            if (nodeType == Node::START) {
+                Node& currentNode = *parseStack.back();
+                if (currentNode.children.empty()) {
+                    currentNode.propsEnd = it;
+                }
+                currentNode.children.emplace_back();
+                Node& child = currentNode.children.back();
+                child.type = *++it;
+                child.propsBegin = it + 1;
+                parseStack.push_back(&child);
+            } else if (nodeType == Node::END) {
+                Node& currentNode = *parseStack.back();
+                if (currentNode.children.empty()) {
+                    currentNode.propsEnd = it;
+                }
+                parseStack.pop_back();
+            } else if (nodeType == Node::ESCAPE) {
+                ++it;
+            }
+        }
+        return root;
+    }
+
+    // safe to call from several threads at once, every thread unescapes into its own buffer
+    bool getProps(const Node& node, PropStream& props) const {
+        const size_t size = std::distance(node.propsBegin, node.propsEnd);
+        if (size == 0) {
+            return false;
+        }
+
+        static thread_local std::vector<char> propBuffer;
+        if (propBuffer.size() < size) {
+            propBuffer.resize(size);
+        }
+
+        bool lastEscaped = false;
+        const auto escapedPropEnd = std::copy_if(node.propsBegin, node.propsEnd, propBuffer.begin(), [&lastEscaped](const char& byte) {
+            lastEscaped = byte == static_cast<char>(Node::ESCAPE) && !lastEscaped;
+            return !lastEscaped;
+        });
+        props.init(propBuffer.data(), std::distance(propBuffer.begin(), escapedPropEnd));
+        return true;
+    }
+
+private:
+    std::vector<char> fileContents;
+    Node root;
+};
+
+// the item types the fixture uses, by id range
+struct ItemType
+{
+    bool ground = false;
+    bool blocking = false;
+    bool moveable = false;
+    bool container = false;
+    bool bed = false;
+    bool decays = false;
+};
+
+const ItemType& getItemType(uint16_t id)
+{
+    static const std::vector<ItemType> types = []() {
+        std::vector<ItemType> result(700);
+        for (uint16_t id = 100; id < 110; ++id) {
+            result[id].ground = true;
+            result[id].blocking = (id == 109);
+        }
+        for (uint16_t id = 200; id < 210; ++id) {
+            result[id].blocking = true;
+        }
+        for (uint16_t id = 300; id < 310; ++id) {
+            result[id].moveable = true;
+            result[id].decays = (id >= 305);
+        }
+        for (uint16_t id = 400; id < 406; ++id) {
+            result[id].container = true;
+            result[id].moveable = (id != 405);
+        }
+        result[500].bed = true;
+        for (uint16_t id = 600; id < 605; ++id) {
+            result[id].decays = true;
+        }
+        return result;
+    }();
+    return types[id];
+}
+
+class Item;
+class Tile;
+using MapLoadActions = std::vector<struct MapLoadAction>;
+
+// the parts of the game state loading items touches
+struct Game
+{
+    std::map<uint16_t, Item*> uniqueItems;
+    std::map<uint32_t, Item*> sleepers;
+    std::vector<Item*> decayingItems;
+};
+
+Game* g_game = nullptr;
+std::atomic<int64_t> liveItems{0};
+
+enum MapLoadAction_t : uint8_t
+{
+    MAPLOAD_ACTION_UNIQUEID,
+    MAPLOAD_ACTION_SLEEPER,
+    MAPLOAD_ACTION_DECAY,
+    MAPLOAD_ACTION_RELEASE,
+    MAPLOAD_ACTION_SETTILE,
+    MAPLOAD_ACTION_HOUSETILE,
+};
+
+struct MapLoadAction
+{
+    MapLoadAction(MapLoadAction_t type, Item* item, uint32_t value = 0) : item(item), value(value), type(type) {}
+    explicit MapLoadAction(Tile* tile) : tile(tile), value(0), type(MAPLOAD_ACTION_SETTILE) {}
+    explicit MapLoadAction(const Node* node) : node(node), value(0), type(MAPLOAD_ACTION_HOUSETILE) {}
+
+    union {
+        Item* item;
+        Tile* tile;
+        const Node* node;
+    };
+    uint32_t value;
+    MapLoadAction_t type;
+};
+
+struct MapTileArea
+{
+    explicit MapTileArea(const Node* node) : node(node) {}
+
+    const Node* node;
+    MapLoadActions actions;
+    std::string error;
+    bool done = false;
+};
+
+thread_local MapLoadActions* deferredActions = nullptr;
+
+class Item
+{
+public:
+    explicit Item(uint16_t id) : id(id) {
+        ++liveItems;
+    }
+    ~Item() {
+        for (Item* item : itemList) {
+            delete item;
+        }
+        --liveItems;
+    }
+
+    // non-copyable
+    Item(const Item&) = delete;
+    Item& operator=(const Item&) = delete;
+
+    static Item* CreateItem(PropStream& propStream) {
+        uint16_t id;
+        if (!propStream.read<uint16_t>(id) || id >= 700) {
+            return nullptr;
+        }
+        return new Item(id);
+    }
+
+    uint16_t getID() const {
+        return id;
+    }
+    uint16_t getUniqueId() const {
+        return uniqueId;
+    }
+    uint32_t getSleeper() const {
+        return sleeper;
+    }
+    const ItemType& getType() const {
+        return getItemType(id);
+    }
+
+    // Item::unserializeItemNode, Container::unserializeItemNode for containers
+    bool unserializeItemNode(const Loader& loader, const Node& node, PropStream& propStream) {
+        if (!unserializeAttr(propStream)) {
+            return false;
+        }
+
+        for (const Node& itemNode : node.children) {
+            if (!getType().container || itemNode.type != OTBM_ITEM) {
+                return false;
+            }
+
+            PropStream itemPropStream;
+            if (!loader.getProps(itemNode, itemPropStream)) {
+                return false;
+            }
+
+            Item* item = CreateItem(itemPropStream);
+            if (!item) {
+                return false;
+            }
+
+            // Container::addItem
+            itemList.push_back(item);
+            if (!item->unserializeItemNode(loader, itemNode, itemPropStream)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Item::setUniqueId
+    void setUniqueId(uint16_t n) {
+        if (uniqueId != 0) {
+            return;
+        }
+
+        if (deferredActions) {
+            deferredActions->emplace_back(MAPLOAD_ACTION_UNIQUEID, this, n);
+            return;
+        }
+
+        if (g_game->uniqueItems.emplace(n, this).second) {
+            uniqueId = n;
+        }
+    }
+
+    // BedItem::loadSleeper
+    void loadSleeper(uint32_t guid) {
+        sleeper = guid;
+        g_game->sleepers[guid] = this;
+    }
+
+    // Item::startDecaying, only the order matters here
+    void startDecaying() {
+        if (getType().decays) {
+            g_game->decayingItems.push_back(this);
+        }
+    }
+
+    void setLoadedFromMap(bool value) {
+        loadedFromMap = value;
+    }
+
+    void describe(std::ostream& os) const {
+        os << id << (loadedFromMap ? "" : "!") << " aid " << actionId << " uid " << uniqueId << " charges " << charges << " text '" << text << "' sleeper " << sleeper;
+        if (!itemList.empty()) {
+            os << " [";
+            for (const Item* item : itemList) {
+                item->describe(os);
+                os << "; ";
+            }
+            os << ']';
+        }
+    }
+
+    const std::vector<Item*>& getItemList() const {
+        return itemList;
+    }
+
+private:
+    bool unserializeAttr(PropStream& propStream) {
+        uint8_t attr_type;
+        while (propStream.read<uint8_t>(attr_type) && attr_type != 0) {
+            switch (attr_type) {
+                case ATTR_ACTION_ID:
+                    if (!propStream.read<uint16_t>(actionId)) {
+                        return false;
+                    }
+                    break;
+
+                case ATTR_UNIQUE_ID: {
+                    uint16_t uid;
+                    if (!propStream.read<uint16_t>(uid)) {
+                        return false;
+                    }
+                    setUniqueId(uid);
+                    break;
+                }
+
+                case ATTR_TEXT:
+                    if (!propStream.readString(text)) {
+                        return false;
+                    }
+                    break;
+
+                case ATTR_CHARGES:
+                    if (!propStream.read<uint16_t>(charges)) {
+                        return false;
+                    }
+                    break;
+
+                case ATTR_SLEEPERGUID: {
+                    uint32_t guid;
+                    if (!getType().bed || !propStream.read<uint32_t>(guid)) {
+                        return false;
+                    }
+
+                    if (guid != 0) {
+                        if (deferredActions) {
+                            deferredActions->emplace_back(MAPLOAD_ACTION_SLEEPER, this, guid);
+                        } else {
+                            loadSleeper(guid);
+                        }
+                    }
+                    break;
+                }
+
+                default:
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<Item*> itemList;
+    std::string text;
+    uint32_t sleeper = 0;
+    uint16_t id;
+    uint16_t actionId = 0;
+    uint16_t uniqueId = 0;
+    uint16_t charges = 0;
+    bool loadedFromMap = false;
+};
+
+struct Position
+{
+    uint16_t x;
+    uint16_t y;
+    uint8_t z;
+
+    bool operator<(const Position& other) const {
+        return std::tie(z, y, x) < std::tie(other.z, other.y, other.x);
+    }
+};
+
+std::ostream& operator<<(std::ostream& os, const Position& pos)
+{
+    return os << '(' << pos.x << ", " << pos.y << ", " << static_cast<int>(pos.z) << ')';
+}
+
+struct House
+{
+    std::vector<Tile*> tiles;
+};
+
+class Tile
+{
+public:
+    Tile(uint16_t x, uint16_t y, uint8_t z, bool dynamic, House* house = nullptr, uint32_t houseId = 0) :
+        position{x, y, z}, house(house), houseId(houseId), dynamic(dynamic) {}
+    ~Tile() {
+        delete ground;
+        for (Item* item : items) {
+            delete item;
+        }
+    }
+
+    // non-copyable
+    Tile(const Tile&) = delete;
+    Tile& operator=(const Tile&) = delete;
+
+    void internalAddThing(Item* item) {
+        if (item->getType().ground && !ground) {
+            ground = item;
+        } else {
+            items.push_back(item);
+        }
+    }
+
+    void setFlag(uint32_t flag) {
+        flags |= flag;
+    }
+
+    const Position& getPosition() const {
+        return position;
+    }
+
+    void describe(std::ostream& os) const {
+        os << position << (dynamic ? " dynamic" : " static") << " flags " << flags << " house " << houseId << " ground ";
+        if (ground) {
+            ground->describe(os);
+        }
+        for (const Item* item : items) {
+            os << "\n    ";
+            item->describe(os);
+        }
+    }
+
+    Item* ground = nullptr;
+    std::vector<Item*> items;
+
+private:
+    Position position;
+    House* house;
+    uint32_t houseId;
+    uint32_t flags = 0;
+    bool dynamic;
+};
+
+struct Map
+{
+    ~Map() {
+        for (auto& it : tiles) {
+            delete it.second;
+        }
+    }
+
+    void setTile(uint16_t x, uint16_t y, uint8_t z, Tile* tile) {
+        Tile*& slot = tiles[Position{x, y, z}];
+        delete slot;
+        slot = tile;
+    }
+
+    std::map<Position, Tile*> tiles;
+    std::map<uint32_t, House> houses;
+    std::map<uint32_t, std::pair<std::string, Position>> towns;
+    std::map<std::string, Position> waypoints;
+    std::string description;
+    uint16_t width = 0;
+    uint16_t height = 0;
+};
+
+#pragma pack(1)
+struct OTBM_root_header
+{
+    uint32_t version;
+    uint16_t width;
+    uint16_t height;
+    uint32_t majorVersionItems;
+    uint32_t minorVersionItems;
+};
+
+struct OTBM_Destination_coords
+{
+    uint16_t x;
+    uint16_t y;
+    uint8_t z;
+};
+
+struct OTBM_Tile_coords
+{
+    uint8_t x;
+    uint8_t y;
+};
+#pragma pack()
+
+void startItemDecay(Item* item)
+{
+    if (deferredActions) {
+        deferredActions->emplace_back(MAPLOAD_ACTION_DECAY, item);
+    } else {
+        item->startDecaying();
+    }
+}
+
+// deleteItem in iomap.cpp
+void deleteItem(Item* item)
+{
+    std::vector<Item*> items{item};
+    for (size_t i = 0; i < items.size(); ++i) {
+        Item* current = items[i];
+        if (current->getUniqueId() != 0) {
+            g_game->uniqueItems.erase(current->getUniqueId());
+        }
+
+        auto it = g_game->sleepers.find(current->getSleeper());
+        if (it != g_game->sleepers.end() && it->second == current) {
+            g_game->sleepers.erase(it);
+        }
+        items.insert(items.end(), current->getItemList().begin(), current->getItemList().end());
+    }
+    delete item;
+}
+
+void releaseItem(Item* item)
+{
+    if (!item) {
+        return;
+    }
+
+    if (deferredActions) {
+        deferredActions->emplace_back(MAPLOAD_ACTION_RELEASE, item);
+    } else {
+        deleteItem(item);
+    }
+}
+
+void releaseTileArea(const MapLoadActions& actions, size_t first)
+{
+    for (size_t i = first; i < actions.size(); ++i) {
+        const MapLoadAction& action = actions[i];
+        if (action.type == MAPLOAD_ACTION_SETTILE) {
+            delete action.tile;
+        } else if (action.type == MAPLOAD_ACTION_RELEASE) {
+            deleteItem(action.item);
+        }
+    }
+}
+
+// IOMap with the OTBM nodes the fixture has, workers = 0 loads serially
+class IOMap
+{
+public:
+    bool loadMap(Map& map, const std::string& fileName, size_t workers) {
+        Loader loader(fileName);
+        const Node& root = loader.parseTree();
+
+        PropStream propStream;
+        OTBM_root_header root_header;
+        if (!loader.getProps(root, propStream) || !propStream.read(root_header)) {
+            setLastErrorString("Could not read header.");
+            return false;
+        }
+
+        map.width = root_header.width;
+        map.height = root_header.height;
+        if (root.children.size() != 1 || root.children[0].type != OTBM_MAP_DATA) {
+            setLastErrorString("Could not read data node.");
+            return false;
+        }
+
+        const Node& mapNode = root.children[0];
+        PropStream mapPropStream;
+        uint8_t attribute;
+        if (!loader.getProps(mapNode, mapPropStream) || !mapPropStream.read<uint8_t>(attribute) || attribute != OTBM_ATTR_DESCRIPTION ||
+                !mapPropStream.readString(map.description)) {
+            setLastErrorString("Could not read map data attributes.");
+            return false;
+        }
+
+        if (workers != 0) {
+            return parseTileAreas(loader, mapNode, map, workers);
+        }
+
+        for (const Node& mapDataNode : mapNode.children) {
+            if (mapDataNode.type == OTBM_TILE_AREA) {
+                if (!parseTileArea(loader, mapDataNode, map)) {
+                    return false;
+                }
+            } else if (mapDataNode.type == OTBM_TOWNS) {
+                if (!parseTowns(loader, mapDataNode, map)) {
+                    return false;
+                }
+            } else if (mapDataNode.type == OTBM_WAYPOINTS) {
+                if (!parseWaypoints(loader, mapDataNode, map)) {
+                    return false;
+                }
+            } else {
+                setLastErrorString("Unknown map node.");
+                return false;
+            }
+        }
+        return true;
+    }
+
+    const std::string& getLastErrorString() const {
+        return errorString;
+    }
+
+private:
+    void setLastErrorString(std::string error) {
+        errorString = std::move(error);
+    }
+
+    static std::string getTileError(uint16_t x, uint16_t y, uint16_t z, const char* error) {
+        std::ostringstream ss;
+        ss << "[x:" << x << ", y:" << y << ", z:" << z << "] " << error;
+        return ss.str();
+    }
+
+    static Tile* createTile(Item*& ground, const Item* item, uint16_t x, uint16_t y, uint8_t z) {
+        if (!ground) {
+            return new Tile(x, y, z, false);
+        }
+
+        Tile* tile = new Tile(x, y, z, !((item && item->getType().blocking) || ground->getType().blocking));
+        tile->internalAddThing(ground);
+        startItemDecay(ground);
+        ground = nullptr;
+        return tile;
+    }
+
+    bool parseTileArea(const Loader& loader, const Node& tileAreaNode, Map& map) {
+        PropStream propStream;
+        OTBM_Destination_coords area_coord;
+        if (!loader.getProps(tileAreaNode, propStream) || !propStream.read(area_coord)) {
+            setLastErrorString("Invalid map node.");
+            return false;
+        }
+
+        for (const Node& tileNode : tileAreaNode.children) {
+            if (tileNode.type != OTBM_TILE && tileNode.type != OTBM_HOUSETILE) {
+                setLastErrorString("Unknown tile node.");
+                return false;
+            }
+
+            if (deferredActions && tileNode.type == OTBM_HOUSETILE) {
+                deferredActions->emplace_back(&tileNode);
+                continue;
+            }
+
+            if (!parseTile(loader, tileNode, map, area_coord.x, area_coord.y, area_coord.z)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // adds an item read from the tile's properties or its item nodes
+    static void addTileItem(Tile*& tile, Item*& ground_item, Item* item, bool isHouseTile, uint16_t x, uint16_t y, uint8_t z) {
+        if (isHouseTile && item->getType().moveable) {
+            releaseItem(item);
+        } else if (tile) {
+            tile->internalAddThing(item);
+            startItemDecay(item);
+            item->setLoadedFromMap(true);
+        } else if (item->getType().ground) {
+            releaseItem(ground_item);
+            ground_item = item;
+        } else {
+            tile = createTile(ground_item, item, x, y, z);
+            tile->internalAddThing(item);
+            startItemDecay(item);
+            item->setLoadedFromMap(true);
+        }
+    }
+
+    bool parseTile(const Loader& loader, const Node& tileNode, Map& map, uint16_t base_x, uint16_t base_y, uint16_t z) {
+        PropStream propStream;
+        OTBM_Tile_coords tile_coord;
+        if (!loader.getProps(tileNode, propStream) || !propStream.read(tile_coord)) {
+            setLastErrorString("Could not read tile position.");
+            return false;
+        }
+
+        const uint16_t x = base_x + tile_coord.x;
+        const uint16_t y = base_y + tile_coord.y;
+
+        bool isHouseTile = false;
+        Tile* tile = nullptr;
+        Item* ground_item = nullptr;
+        uint32_t tileflags = 0;
+
+        if (tileNode.type == OTBM_HOUSETILE) {
+            uint32_t houseId;
+            if (!propStream.read<uint32_t>(houseId)) {
+                setLastErrorString(getTileError(x, y, z, "Could not read house id."));
+                return false;
+            }
+
+            House* house = &map.houses[houseId];
+            tile = new Tile(x, y, z, true, house, houseId);
+            house->tiles.push_back(tile);
+            isHouseTile = true;
+        }
+
+        uint8_t attribute;
+        while (propStream.read<uint8_t>(attribute)) {
+            switch (attribute) {
+                case OTBM_ATTR_TILE_FLAGS: {
+                    uint32_t flags;
+                    if (!propStream.read<uint32_t>(flags)) {
+                        setLastErrorString(getTileError(x, y, z, "Failed to read tile flags."));
+                        return false;
+                    }
+
+                    if ((flags & OTBM_TILEFLAG_PROTECTIONZONE) != 0) {
+                        tileflags |= TILESTATE_PROTECTIONZONE;
+                    } else if ((flags & OTBM_TILEFLAG_NOPVPZONE) != 0) {
+                        tileflags |= TILESTATE_NOPVPZONE;
+                    } else if ((flags & OTBM_TILEFLAG_PVPZONE) != 0) {
+                        tileflags |= TILESTATE_PVPZONE;
+                    }
+
+                    if ((flags & OTBM_TILEFLAG_NOLOGOUT) != 0) {
+                        tileflags |= TILESTATE_NOLOGOUT;
+                    }
+                    break;
+                }
+
+                case OTBM_ATTR_ITEM: {
+                    Item* item = Item::CreateItem(propStream);
+                    if (!item) {
+                        setLastErrorString(getTileError(x, y, z, "Failed to create item."));
+                        return false;
+                    }
+                    addTileItem(tile, ground_item, item, isHouseTile, x, y, z);
+                    break;
+                }
+
+                default:
+                    setLastErrorString(getTileError(x, y, z, "Unknown tile attribute."));
+                    return false;
+            }
+        }
+
+        for (const Node& itemNode : tileNode.children) {
+            if (itemNode.type != OTBM_ITEM) {
+                setLastErrorString(getTileError(x, y, z, "Unknown node type."));
+                return false;
+            }
+
+            PropStream stream;
+            if (!loader.getProps(itemNode, stream)) {
+                setLastErrorString("Invalid item node.");
+                return false;
+            }
+
+            Item* item = Item::CreateItem(stream);
+            if (!item) {
+                setLastErrorString(getTileError(x, y, z, "Failed to create item."));
+                return false;
+            }
+
+            if (!item->unserializeItemNode(loader, itemNode, stream)) {
+                setLastErrorString(getTileError(x, y, z, "Failed to load item."));
+                releaseItem(item);
+                return false;
+            }
+            addTileItem(tile, ground_item, item, isHouseTile, x, y, z);
+        }
+
+        if (!tile) {
+            tile = createTile(ground_item, nullptr, x, y, z);
+        }
+
+        tile->setFlag(tileflags);
+
+        if (deferredActions) {
+            deferredActions->emplace_back(tile);
+        } else {
+            map.setTile(x, y, z, tile);
+        }
+        return true;
+    }
+
+    bool parseTileAreas(const Loader& loader, const Node& mapNode, Map& map, size_t workerCount) {
+        std::vector<MapTileArea> areas;
+        for (const Node& mapDataNode : mapNode.children) {
+            if (mapDataNode.type == OTBM_TILE_AREA) {
+                areas.emplace_back(&mapDataNode);
+            }
+        }
+
+        std::mutex areasLock;
+        std::condition_variable areasSignal;
+        std::atomic<size_t> nextArea(0);
+        std::atomic<bool> stopped(false);
+
+        auto decodeAreas = [&]() {
+            IOMap areaLoader;
+            while (!stopped.load(std::memory_order_relaxed)) {
+                const size_t index = nextArea.fetch_add(1, std::memory_order_relaxed);
+                if (index >= areas.size()) {
+                    break;
+                }
+
+                MapTileArea& area = areas[index];
+                deferredActions = &area.actions;
+                if (!areaLoader.parseTileArea(loader, *area.node, map)) {
+                    area.error = areaLoader.getLastErrorString();
+                }
+                deferredActions = nullptr;
+
+                std::lock_guard<std::mutex> lockGuard(areasLock);
+                area.done = true;
+                areasSignal.notify_one();
+            }
+        };
+
+        // the server starts hardware_concurrency() workers
+        const size_t threads = std::min<size_t>(workerCount, areas.size());
+        std::vector<std::thread> workers;
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back(decodeAreas);
+        }
+
+        bool success = true;
+        size_t areaIndex = 0;
+        for (const Node& mapDataNode : mapNode.children) {
+            if (mapDataNode.type == OTBM_TILE_AREA) {
+                MapTileArea& area = areas[areaIndex];
+                {
+                    std::unique_lock<std::mutex> lockGuard(areasLock);
+                    areasSignal.wait(lockGuard, [&area]() { return area.done; });
+                }
+
+                ++areaIndex;
+                success = applyTileArea(loader, area, map);
+                MapLoadActions().swap(area.actions);
+            } else if (mapDataNode.type == OTBM_TOWNS) {
+                success = parseTowns(loader, mapDataNode, map);
+            } else if (mapDataNode.type == OTBM_WAYPOINTS) {
+                success = parseWaypoints(loader, mapDataNode, map);
+            } else {
+                setLastErrorString("Unknown map node.");
+                success = false;
+            }
+
+            if (!success) {
+                break;
+            }
+        }
+
+        stopped.store(true, std::memory_order_relaxed);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+
+        if (!success) {
+            for (size_t i = areaIndex; i < areas.size(); ++i) {
+                releaseTileArea(areas[i].actions, 0);
+            }
+        }
+        return success;
+    }
+
+    bool applyTileArea(const Loader& loader, const MapTileArea& area, Map& map) {
+        OTBM_Destination_coords area_coord = {};
+        bool hasAreaCoord = false;
+        for (const MapLoadAction& action : area.actions) {
+            switch (action.type) {
+                case MAPLOAD_ACTION_UNIQUEID:
+                    action.item->setUniqueId(static_cast<uint16_t>(action.value));
+                    break;
+
+                case MAPLOAD_ACTION_SLEEPER:
+                    action.item->loadSleeper(action.value);
+                    break;
+
+                case MAPLOAD_ACTION_DECAY:
+                    action.item->startDecaying();
+                    break;
+
+                case MAPLOAD_ACTION_RELEASE:
+                    deleteItem(action.item);
+                    break;
+
+                case MAPLOAD_ACTION_SETTILE: {
+                    const Position& tilePos = action.tile->getPosition();
+                    map.setTile(tilePos.x, tilePos.y, tilePos.z, action.tile);
+                    break;
+                }
+
+                case MAPLOAD_ACTION_HOUSETILE: {
+                    if (!hasAreaCoord) {
+                        PropStream propStream;
+                        loader.getProps(*area.node, propStream);
+                        propStream.read(area_coord);
+                        hasAreaCoord = true;
+                    }
+
+                    if (!parseTile(loader, *action.node, map, area_coord.x, area_coord.y, area_coord.z)) {
+                        releaseTileArea(area.actions, static_cast<size_t>(&action - area.actions.data()) + 1);
+                        return false;
+                    }
+                    break;
+                }
+            }
+        }
+
+        if (!area.error.empty()) {
+            setLastErrorString(area.error);
+            return false;
+        }
+        return true;
+    }
+
+    bool parseTowns(const Loader& loader, const Node& townsNode, Map& map) {
+        for (const Node& townNode : townsNode.children) {
+            PropStream propStream;
+            uint32_t townId;
+            std::string townName;
+            OTBM_Destination_coords town_coords;
+            if (townNode.type != OTBM_TOWN || !loader.getProps(townNode, propStream) || !propStream.read<uint32_t>(townId) ||
+                    !propStream.readString(townName) || !propStream.read(town_coords)) {
+                setLastErrorString("Could not read town data.");
+                return false;
+            }
+            map.towns[townId] = std::make_pair(townName, Position{town_coords.x, town_coords.y, town_coords.z});
+        }
+        return true;
+    }
+
+    bool parseWaypoints(const Loader& loader, const Node& waypointsNode, Map& map) {
+        for (const Node& node : waypointsNode.children) {
+            PropStream propStream;
+            std::string name;
+            OTBM_Destination_coords waypoint_coords;
+            if (node.type != OTBM_WAYPOINT || !loader.getProps(node, propStream) || !propStream.readString(name) || !propStream.read(waypoint_coords)) {
+                setLastErrorString("Could not read waypoint data.");
+                return false;
+            }
+            map.waypoints[name] = Position{waypoint_coords.x, waypoint_coords.y, waypoint_coords.z};
+        }
+        return true;
+    }
+
+    std::string errorString;
+};
+
+// writes OTB nodes, escaping property bytes that collide with the node markers
+class Writer
+{
+public:
+    Writer() : data{0, 0, 0, 0} {}
+
+    void startNode(uint8_t type) {
+        data.push_back(static_cast<char>(Node::START));
+        data.push_back(static_cast<char>(type));
+    }
+
+    void endNode() {
+        data.push_back(static_cast<char>(Node::END));
+    }
+
+    template <typename T>
+    void write(T value) {
+        char bytes[sizeof(T)];
+        memcpy(bytes, &value, sizeof(T));
+        for (const char byte : bytes) {
+            const auto marker = static_cast<uint8_t>(byte);
+            if (marker == Node::ESCAPE || marker == Node::START || marker == Node::END) {
+                data.push_back(static_cast<char>(Node::ESCAPE));
+            }
+            data.push_back(byte);
+        }
+    }
+
+    void writeString(const std::string& value) {
+        write<uint16_t>(static_cast<uint16_t>(value.size()));
+        for (const char byte : value) {
+            write<char>(byte);
+        }
+    }
+
+    bool save(const std::string& fileName) const {
+        std::ofstream file(fileName, std::ios::binary);
+        file.write(data.data(), data.size());
+        return static_cast<bool>(file);
+    }
+
+private:
+    std::vector<char> data;
+};
+
+enum class Corruption
+{
+    None,
+    Tile,
+    HouseTile,
+};
+
+constexpr int32_t AREA_COUNT = 48;
+constexpr int32_t CORRUPT_AREA = 29;
+
+void writeItem(Writer& writer, std::mt19937& rng, int32_t depth)
+{
+    std::uniform_int_distribution<int32_t> percent(0, 99);
+    static const std::vector<std::pair<uint16_t, uint16_t>> ranges = {
+        {200, 209}, {300, 309}, {400, 405}, {500, 500}, {600, 604}, {300, 309}
+    };
+    const auto& range = ranges[std::uniform_int_distribution<size_t>(0, ranges.size() - 1)(rng)];
+    const uint16_t id = std::uniform_int_distribution<uint16_t>(range.first, range.second)(rng);
+
+    writer.startNode(OTBM_ITEM);
+    writer.write<uint16_t>(id);
+    if (percent(rng) < 20) {
+        writer.write<uint8_t>(ATTR_ACTION_ID);
+        // a good share of these need escaping
+        writer.write<uint16_t>(static_cast<uint16_t>(0xFD00 + percent(rng)));
+    }
+    if (percent(rng) < 8) {
+        writer.write<uint8_t>(ATTR_UNIQUE_ID);
+        // few enough ids for some of them to be taken twice
+        writer.write<uint16_t>(static_cast<uint16_t>(1000 + std::uniform_int_distribution<int32_t>(0, 150)(rng)));
+    }
+    if (percent(rng) < 10) {
+        writer.write<uint8_t>(ATTR_CHARGES);
+        writer.write<uint16_t>(static_cast<uint16_t>(percent(rng) + 1));
+    }
+    if (percent(rng) < 5) {
+        writer.write<uint8_t>(ATTR_TEXT);
+        writer.writeString("note \xFE\xFF " + std::to_string(percent(rng)));
+    }
+    if (id == 500 && percent(rng) < 60) {
+        writer.write<uint8_t>(ATTR_SLEEPERGUID);
+        writer.write<uint32_t>(static_cast<uint32_t>(100 + percent(rng)));
+    }
+
+    if (getItemType(id).container && depth < 2) {
+        const int32_t contents = std::uniform_int_distribution<int32_t>(0, 3)(rng);
+        for (int32_t i = 0; i < contents; ++i) {
+            writeItem(writer, rng, depth + 1);
+        }
+    }
+    writer.endNode();
+}
+
+void writeTowns(Writer& writer)
+{
+    writer.startNode(OTBM_TOWNS);
+    for (uint32_t townId = 1; townId <= 3; ++townId) {
+        writer.startNode(OTBM_TOWN);
+        writer.write<uint32_t>(townId);
+        writer.writeString("Town " + std::to_string(townId));
+        writer.write(OTBM_Destination_coords{static_cast<uint16_t>(100 * townId), static_cast<uint16_t>(200 + townId), 7});
+        writer.endNode();
+    }
+    writer.endNode();
+}
+
+bool writeFixture(const std::string& fileName, Corruption corruption)
+{
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int32_t> percent(0, 99);
+
+    Writer writer;
+    writer.startNode(0);
+    writer.write(OTBM_root_header{2, 2048, 1024, 3, 57});
+
+    writer.startNode(OTBM_MAP_DATA);
+    writer.write<uint8_t>(OTBM_ATTR_DESCRIPTION);
+    writer.writeString("parallel map loading fixture");
+
+    bool corrupted = false;
+    for (int32_t area = 0; area < AREA_COUNT; ++area) {
+        // towns between the tile areas, merged in file order like the areas
+        if (area == AREA_COUNT / 2) {
+            writeTowns(writer);
+        }
+
+        writer.startNode(OTBM_TILE_AREA);
+        writer.write(OTBM_Destination_coords{static_cast<uint16_t>((area % 8) * 256), static_cast<uint16_t>((area / 8) * 256), static_cast<uint8_t>(6 + area % 2)});
+
+        std::vector<std::pair<uint8_t, uint8_t>> offsets;
+        const int32_t tileCount = std::uniform_int_distribution<int32_t>(40, 120)(rng);
+        while (static_cast<int32_t>(offsets.size()) < tileCount) {
+            const std::pair<uint8_t, uint8_t> offset(static_cast<uint8_t>(percent(rng) * 2), static_cast<uint8_t>(percent(rng) * 2 + 1));
+            if (std::find(offsets.begin(), offsets.end(), offset) == offsets.end()) {
+                offsets.push_back(offset);
+            }
+        }
+
+        for (const auto& offset : offsets) {
+            const bool houseTile = percent(rng) < 12;
+            writer.startNode(houseTile ? OTBM_HOUSETILE : OTBM_TILE);
+            writer.write(OTBM_Tile_coords{offset.first, offset.second});
+            if (houseTile) {
+                writer.write<uint32_t>(static_cast<uint32_t>(std::uniform_int_distribution<int32_t>(1, 24)(rng)));
+            }
+
+            if (!corrupted && area == CORRUPT_AREA && corruption != Corruption::None && houseTile == (corruption == Corruption::HouseTile)) {
+                // an attribute no loader knows, before anything the tile could leak
+                writer.write<uint8_t>(0x7F);
+                corrupted = true;
+            }
+
+            if (percent(rng) < 30) {
+                writer.write<uint8_t>(OTBM_ATTR_TILE_FLAGS);
+                writer.write<uint32_t>(static_cast<uint32_t>(percent(rng) & 0x1F));
+            }
+            if (percent(rng) < 92) {
+                writer.write<uint8_t>(OTBM_ATTR_ITEM);
+                writer.write<uint16_t>(static_cast<uint16_t>(100 + percent(rng) % 10));
+            }
+            if (percent(rng) < 6) {
+                // replaces the ground read before it
+                writer.write<uint8_t>(OTBM_ATTR_ITEM);
+                writer.write<uint16_t>(static_cast<uint16_t>(100 + percent(rng) % 10));
+            }
+            if (percent(rng) < 5) {
+                writer.write<uint8_t>(OTBM_ATTR_ITEM);
+                writer.write<uint16_t>(static_cast<uint16_t>(300 + percent(rng) % 10));
+            }
+
+            const int32_t itemCount = std::uniform_int_distribution<int32_t>(0, 4)(rng);
+            for (int32_t i = 0; i < itemCount; ++i) {
+                writeItem(writer, rng, 0);
+            }
+            writer.endNode();
+        }
+        writer.endNode();
+    }
+
+    writer.startNode(OTBM_WAYPOINTS);
+    for (int32_t i = 0; i < 4; ++i) {
+        writer.startNode(OTBM_WAYPOINT);
+        writer.writeString("waypoint " + std::to_string(i));
+        writer.write(OTBM_Destination_coords{static_cast<uint16_t>(300 + i), static_cast<uint16_t>(400 + i), 7});
+        writer.endNode();
+    }
+    writer.endNode();
+
+    writer.endNode();
+    writer.endNode();
+    return writer.save(fileName) && (corrupted || corruption == Corruption::None);
+}
+
+// everything a load leaves behind, items named by where they are
+std::vector<std::string> describe(const Map& map, const Game& game)
+{
+    std::map<const Item*, std::string> locations;
+    std::vector<std::string> lines;
+    std::function<void(const Item*, const std::string&)> locate = [&](const Item* item, const std::string& location) {
+        locations[item] = location;
+        for (size_t i = 0; i < item->getItemList().size(); ++i) {
+            locate(item->getItemList()[i], location + '/' + std::to_string(i));
+        }
+    };
+
+    for (const auto& it : map.tiles) {
+        std::ostringstream ss;
+        ss << it.first;
+        const std::string position = ss.str();
+        if (it.second->ground) {
+            locate(it.second->ground, position + " ground");
+        }
+        for (size_t i = 0; i < it.second->items.size(); ++i) {
+            locate(it.second->items[i], position + " item " + std::to_string(i));
+        }
+
+        std::ostringstream tile;
+        tile << "tile ";
+        it.second->describe(tile);
+        lines.push_back(tile.str());
+    }
+
+    auto getLocation = [&](const Item* item) {
+        auto it = locations.find(item);
+        return it != locations.end() ? it->second : std::string("not on the map");
+    };
+
+    for (const auto& it : game.uniqueItems) {
+        lines.push_back("unique id " + std::to_string(it.first) + " at " + getLocation(it.second));
+    }
+    for (const auto& it : game.sleepers) {
+        lines.push_back("sleeper " + std::to_string(it.first) + " at " + getLocation(it.second));
+    }
+    for (const Item* item : game.decayingItems) {
+        lines.push_back("decaying " + getLocation(item));
+    }
+    for (const auto& it : map.houses) {
+        std::ostringstream ss;
+        ss << "house " << it.first << ':';
+        for (const Tile* tile : it.second.tiles) {
+            ss << ' ' << tile->getPosition();
+        }
+        lines.push_back(ss.str());
+    }
+    for (const auto& it : map.towns) {
+        std::ostringstream ss;
+        ss << "town " << it.first << ' ' << it.second.first << ' ' << it.second.second;
+        lines.push_back(ss.str());
+    }
+    for (const auto& it : map.waypoints) {
+        std::ostringstream ss;
+        ss << "waypoint " << it.first << ' ' << it.second;
+        lines.push_back(ss.str());
+    }
+
+    std::ostringstream ss;
+    ss << "map " << map.width << 'x' << map.height << " '" << map.description << "'";
+    lines.push_back(ss.str());
+    return lines;
+}
+
+struct LoadResult
+{
+    bool success = false;
+    std::string error;
+    std::vector<std::string> contents;
+};
+
+LoadResult load(const std::string& fileName, size_t workers)
+{
+    LoadResult result;
+    {
+        Game game;
+        g_game = &game;
+        Map map;
+        IOMap loader;
+        result.success = loader.loadMap(map, fileName, workers);
+        result.error = loader.getLastErrorString();
+        result.contents = describe(map, game);
+        g_game = nullptr;
+    }
+    return result;
+}
+
+int failures = 0;
+
+void compare(const char* fixture, size_t workers, const LoadResult& serial, const LoadResult& parallel)
+{
+    if (serial.success != parallel.success || serial.error != parallel.error) {
+        std::cout << fixture << ", " << workers << " workers: the serial loader " << (serial.success ? "succeeded" : "failed with '" + serial.error + "'")
+            << ", the parallel one " << (parallel.success ? "succeeded" : "failed with '" + parallel.error + "'") << std::endl;
+        ++failures;
+        return;
+    }
+
+    const size_t lines = std::max(serial.contents.size(), parallel.contents.size());
+    for (size_t i = 0; i < lines; ++i) {
+        const std::string serialLine = (i < serial.contents.size() ? serial.contents[i] : "nothing");
+        const std::string parallelLine = (i < parallel.contents.size() ? parallel.contents[i] : "nothing");
+        if (serialLine != parallelLine) {
+            std::cout << fixture << ", " << workers << " workers: the serial loader left\n  " << serialLine << "\nthe parallel one\n  " << parallelLine << std::endl;
+            ++failures;
+            return;
+        }
+    }
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string fileName = (argc > 1 ? argv[1] : "parallel_map_loading.otbm");
+    const std::vector<std::pair<const char*, Corruption>> fixtures = {
+        {"fixture", Corruption::None},
+        {"broken tile", Corruption::Tile},
+        {"broken house tile", Corruption::HouseTile},
+    };
+
+    for (const auto& fixture : fixtures) {
+        if (!writeFixture(fileName, fixture.second)) {
+            std::cout << "could not write the " << fixture.first << " to " << fileName << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        const LoadResult serial = load(fileName, 0);
+        if (serial.success != (fixture.second == Corruption::None)) {
+            std::cout << fixture.first << ": the serial loader " << (serial.success ? "succeeded" : "failed with '" + serial.error + "'") << std::endl;
+            ++failures;
+        }
+
+        for (const size_t workers : {1, 2, 4, 8}) {
+            compare(fixture.first, workers, serial, load(fileName, workers));
+        }
+
+        if (liveItems != 0) {
+            std::cout << fixture.first << ": " << liveItems << " items leaked" << std::endl;
+            ++failures;
+            liveItems = 0;
+        }
+    }
+
+    std::remove(fileName.c_str());
+    if (failures != 0) {
+        std::cout << failures << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << "the parallel loader left the same map as the serial one" << std::endl;
+    return EXIT_SUCCESS;
+}